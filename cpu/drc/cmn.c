@@ -6,24 +6,192 @@
  * See COPYING file in the top-level directory.
  */
 #include <stdio.h>
+#ifdef DRC_PERFMAP
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 #include <pico/pico_int.h>
 #include "cmn.h"
 
 u8 ALIGNED(4096) tcache_default[DRC_TCACHE_SIZE];
 u8 *tcache;
+int tcache_size;
+
+#ifdef DRC_PERFMAP
+// symbols for translated code, for linux perf. Two formats are written:
+// - /tmp/perf-<pid>.map, used by perf report directly. This has no notion of
+//   time, so code reused after eviction may be attributed to an old symbol.
+// - /tmp/jit-<pid>.dump, to be merged into perf.data by "perf inject --jit"
+//   (record with "perf record -k mono"). Load records are timestamped, thus a
+//   block overwriting an evicted one supersedes it from then on.
+#define JITDUMP_MAGIC     0x4A695444
+#define JITDUMP_VERSION   1
+#define JIT_CODE_LOAD     0
+
+#if defined(__x86_64__)
+#define JITDUMP_MACH      EM_X86_64
+#elif defined(__i386__)
+#define JITDUMP_MACH      EM_386
+#elif defined(__aarch64__)
+#define JITDUMP_MACH      EM_AARCH64
+#elif defined(__arm__)
+#define JITDUMP_MACH      EM_ARM
+#elif defined(__mips__)
+#define JITDUMP_MACH      EM_MIPS
+#elif defined(__riscv__) || defined(__riscv)
+#define JITDUMP_MACH      EM_RISCV
+#elif defined(__powerpc64__)
+#define JITDUMP_MACH      EM_PPC64
+#else
+#define JITDUMP_MACH      EM_PPC
+#endif
+
+struct jitdump_hdr {
+  u32 magic;
+  u32 version;
+  u32 total_size;
+  u32 elf_mach;
+  u32 pad1;
+  u32 pid;
+  u64 timestamp;
+  u64 flags;
+};
+
+struct jitdump_code_load {
+  u32 id;
+  u32 total_size;
+  u64 timestamp;
+  u32 pid;
+  u32 tid;
+  u64 vma;
+  u64 code_addr;
+  u64 code_size;
+  u64 code_index;
+  // followed by name and code
+};
+
+static FILE *perf_map, *perf_jit;
+static void *perf_jit_mark;
+static u64 perf_index;
+static int perf_opened;
+
+static u64 perf_timestamp(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void drc_perf_init(void)
+{
+  struct jitdump_hdr hdr = { JITDUMP_MAGIC, JITDUMP_VERSION, sizeof(hdr),
+    JITDUMP_MACH, 0, getpid(), 0, 0 };
+  char fname[64];
+
+  if (perf_map != NULL)
+    return;
+
+  // symbols of earlier drc sessions in this process are kept on reinit
+  snprintf(fname, sizeof(fname), "/tmp/perf-%d.map", (int)getpid());
+  perf_map = fopen(fname, perf_opened ? "a" : "w");
+
+  snprintf(fname, sizeof(fname), "/tmp/jit-%d.dump", (int)getpid());
+  perf_jit = fopen(fname, perf_opened ? "a+" : "w+");
+  perf_opened = 1;
+  if (perf_jit != NULL) {
+    // perf record finds the dump file by this executable mapping of it
+    perf_jit_mark = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ|PROT_EXEC,
+          MAP_PRIVATE, fileno(perf_jit), 0);
+    if (perf_jit_mark == MAP_FAILED) {
+      perf_jit_mark = NULL;
+      fclose(perf_jit);
+      perf_jit = NULL;
+    } else if (fseek(perf_jit, 0, SEEK_END) == 0 && ftell(perf_jit) == 0) {
+      hdr.timestamp = perf_timestamp();
+      fwrite(&hdr, sizeof(hdr), 1, perf_jit);
+    }
+  }
+  elprintf(EL_STATUS, "drc perf map: %s", perf_map ? "on" : "failed");
+}
+
+void drc_perf_add(const void *ptr, int size, const char *fmt, ...)
+{
+  struct jitdump_code_load rec;
+  char name[64];
+  va_list ap;
+  int len;
+
+  if (size <= 0)
+    return;
+  va_start(ap, fmt);
+  len = vsnprintf(name, sizeof(name), fmt, ap);
+  va_end(ap);
+  if (len >= sizeof(name))
+    len = sizeof(name) - 1;
+
+  if (perf_map != NULL) {
+    fprintf(perf_map, "%lx %x %s\n", (unsigned long)(uptr)ptr, size, name);
+    fflush(perf_map);
+  }
+  if (perf_jit != NULL) {
+    rec.id = JIT_CODE_LOAD;
+    rec.total_size = sizeof(rec) + len+1 + size;
+    rec.timestamp = perf_timestamp();
+    rec.pid = getpid();
+    rec.tid = syscall(SYS_gettid);
+    rec.vma = rec.code_addr = (uptr)ptr;
+    rec.code_size = size;
+    rec.code_index = perf_index++;
+    fwrite(&rec, sizeof(rec), 1, perf_jit);
+    fwrite(name, len+1, 1, perf_jit);
+    fwrite(ptr, size, 1, perf_jit);
+    fflush(perf_jit);
+  }
+}
+
+static void drc_perf_finish(void)
+{
+  if (perf_jit_mark != NULL)
+    munmap(perf_jit_mark, sysconf(_SC_PAGESIZE));
+  if (perf_jit != NULL)
+    fclose(perf_jit);
+  if (perf_map != NULL)
+    fclose(perf_map);
+  perf_jit_mark = NULL;
+  perf_jit = perf_map = NULL;
+}
+#endif
 
 void drc_cmn_init(void)
 {
   int ret;
 
-  tcache = plat_mem_get_for_drc(DRC_TCACHE_SIZE);
-  if (tcache == NULL)
+  // size requested by the frontend, rounded to whole pages
+  tcache_size = PicoIn.drcTcacheSize ? PicoIn.drcTcacheSize : DRC_TCACHE_SIZE;
+  if (tcache_size < DRC_TCACHE_SIZE_MIN)
+    tcache_size = DRC_TCACHE_SIZE_MIN;
+  tcache_size = (tcache_size + 4095) & ~4095;
+
+  tcache = plat_mem_get_for_drc(tcache_size);
+  if (tcache == NULL) {
+    // the static buffer can't grow
     tcache = tcache_default;
+    if (tcache_size > DRC_TCACHE_SIZE)
+      tcache_size = DRC_TCACHE_SIZE;
+  }
 
-  ret = plat_mem_set_exec(tcache, DRC_TCACHE_SIZE);
-  elprintf(EL_STATUS, "drc_cmn_init: %p, %zd bytes: %d",
-    tcache, DRC_TCACHE_SIZE, ret);
+  ret = plat_mem_set_exec(tcache, tcache_size);
+  elprintf(EL_STATUS, "drc_cmn_init: %p, %d bytes: %d",
+    tcache, tcache_size, ret);
+#ifdef DRC_PERFMAP
+  drc_perf_init();
+#endif
 
 #ifdef __arm__
   if (PicoIn.opt & POPT_EN_DRC)
@@ -51,6 +219,9 @@ void drc_cmn_init(void)
 
 void drc_cmn_cleanup(void)
 {
+#ifdef DRC_PERFMAP
+  drc_perf_finish();
+#endif
 }
 
 // vim:shiftwidth=2:expandtab
@@ -1,11 +1,21 @@
 
+// default size, and max. size if the static buffer must be used
 #define DRC_TCACHE_SIZE         (4*1024*1024)
+#define DRC_TCACHE_SIZE_MIN     (512*1024)
 
 extern u8 *tcache;
+extern int tcache_size;
 
 void drc_cmn_init(void);
 void drc_cmn_cleanup(void);
 
+// register translated code with linux perf
+#ifdef DRC_PERFMAP
+void drc_perf_add(const void *ptr, int size, const char *fmt, ...);
+#else
+static inline void drc_perf_add(const void *ptr, int size, const char *fmt, ...) {}
+#endif
+
 #define BITMASK1(v0) (1 << (v0))
 #define BITMASK2(v0,v1) ((1 << (v0)) | (1 << (v1)))
 #define BITMASK3(v0,v1,v2) (BITMASK2(v0,v1) | (1 << (v2)))
@@ -347,6 +347,7 @@ static void emith_flush(void)
 #define EOP_LDR_IMM2(cond,rd,rn,offset_12)  EOP_C_AM2_IMM(cond,(offset_12) >= 0,0,1,rn,rd,pabs(offset_12))
 #define EOP_LDRB_IMM2(cond,rd,rn,offset_12) EOP_C_AM2_IMM(cond,(offset_12) >= 0,1,1,rn,rd,pabs(offset_12))
 #define EOP_STR_IMM2(cond,rd,rn,offset_12)  EOP_C_AM2_IMM(cond,(offset_12) >= 0,0,0,rn,rd,pabs(offset_12))
+#define EOP_STRB_IMM2(cond,rd,rn,offset_12) EOP_C_AM2_IMM(cond,(offset_12) >= 0,1,0,rn,rd,pabs(offset_12))
 
 #define EOP_LDR_IMM(   rd,rn,offset_12) EOP_C_AM2_IMM(A_COND_AL,(offset_12) >= 0,0,1,rn,rd,pabs(offset_12))
 #define EOP_LDR_SIMPLE(rd,rn)           EOP_C_AM2_IMM(A_COND_AL,1,0,1,rn,rd,0)
@@ -365,6 +366,7 @@ static void emith_flush(void)
 #define EOP_LDRH_SIMPLE(rd,rn)           EOP_C_AM3_IMM(A_COND_AL,1,1,rn,rd,0,1,0)
 #define EOP_LDRH_REG(   rd,rn,rm)        EOP_C_AM3_REG(A_COND_AL,1,1,rn,rd,0,1,rm)
 #define EOP_STRH_IMM(   rd,rn,offset_8)  EOP_C_AM3_IMM(A_COND_AL,(offset_8) >= 0,0,rn,rd,0,1,pabs(offset_8))
+#define EOP_STRH_IMM2(cond,rd,rn,offset_8)  EOP_C_AM3_IMM(cond,(offset_8) >= 0,0,rn,rd,0,1,pabs(offset_8))
 #define EOP_STRH_SIMPLE(rd,rn)           EOP_C_AM3_IMM(A_COND_AL,1,0,rn,rd,0,1,0)
 #define EOP_STRH_REG(   rd,rn,rm)        EOP_C_AM3_REG(A_COND_AL,1,0,rn,rd,0,1,rm)
 
@@ -1089,6 +1091,16 @@ static inline void emith_pool_adjust(int tcache_offs, int move_offs)
 #define emith_write_r_r_offs_ptr(r, rs, offs) \
 	emith_write_r_r_offs_c(A_COND_AL, r, rs, offs)
 
+#define emith_write16_r_r_offs_c(cond, r, rs, offs) \
+	EOP_STRH_IMM2(cond, r, rs, offs)
+#define emith_write16_r_r_offs(r, rs, offs) \
+	emith_write16_r_r_offs_c(A_COND_AL, r, rs, offs)
+
+#define emith_write8_r_r_offs_c(cond, r, rs, offs) \
+	EOP_STRB_IMM2(cond, r, rs, offs)
+#define emith_write8_r_r_offs(r, rs, offs) \
+	emith_write8_r_r_offs_c(A_COND_AL, r, rs, offs)
+
 #define emith_ctx_read_c(cond, r, offs) \
 	emith_read_r_r_offs_c(cond, r, CONTEXT_REG, offs)
 #define emith_ctx_read(r, offs) \
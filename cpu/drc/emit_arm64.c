@@ -997,6 +997,16 @@ static void emith_ldst_offs(int sz, int rd, int rn, int o9, int ld, int mode)
 #define emith_write_r_r_offs_c(cond, r, rs, offs) \
 	emith_write_r_r_offs(r, rs, offs)
 
+#define emith_write16_r_r_offs(r, rs, offs) \
+	emith_ldst_offs(AM_H, r, rs, offs, LT_ST, AM_IDX)
+#define emith_write16_r_r_offs_c(cond, r, rs, offs) \
+	emith_write16_r_r_offs(r, rs, offs)
+
+#define emith_write8_r_r_offs(r, rs, offs) \
+	emith_ldst_offs(AM_B, r, rs, offs, LT_ST, AM_IDX)
+#define emith_write8_r_r_offs_c(cond, r, rs, offs) \
+	emith_write8_r_r_offs(r, rs, offs)
+
 #define emith_write_r_r_r(r, rs, rm) \
 	EMIT(A64_LDST_REG(r, rs, rm, LT_ST, XT_SXTW))
 #define emith_write_r_r_r_c(cond, r, rs, rm) \
@@ -1262,6 +1262,16 @@ static void emith_lohi_nops(void)
 #define emith_write_r_r_offs_c(cond, r, rs, offs) \
 	emith_write_r_r_offs(r, rs, offs)
 
+#define emith_write16_r_r_offs(r, rs, offs) \
+	EMIT(MIPS_SH(r, rs, offs))
+#define emith_write16_r_r_offs_c(cond, r, rs, offs) \
+	emith_write16_r_r_offs(r, rs, offs)
+
+#define emith_write8_r_r_offs(r, rs, offs) \
+	EMIT(MIPS_SB(r, rs, offs))
+#define emith_write8_r_r_offs_c(cond, r, rs, offs) \
+	emith_write8_r_r_offs(r, rs, offs)
+
 #define emith_write_r_r_r(r, rs, rm) do { \
 	emith_add_r_r_r(AT, rs, rm); \
 	EMIT(MIPS_SW(r, AT, 0)); \
@@ -1255,6 +1255,16 @@ static void emith_add_imm(int rt, int ra, u32 imm)
 #define emith_write_r_r_offs_c(cond, r, ra, offs) \
 	emith_write_r_r_offs(r, ra, offs)
 
+#define emith_write16_r_r_offs(r, ra, offs) \
+	EMIT(PPC_STH_IMM(r, ra, offs))
+#define emith_write16_r_r_offs_c(cond, r, ra, offs) \
+	emith_write16_r_r_offs(r, ra, offs)
+
+#define emith_write8_r_r_offs(r, ra, offs) \
+	EMIT(PPC_STB_IMM(r, ra, offs))
+#define emith_write8_r_r_offs_c(cond, r, ra, offs) \
+	emith_write8_r_r_offs(r, ra, offs)
+
 #define emith_write_r_r_r(r, ra, rm) \
 	EMIT(PPC_STW_REG(r, ra, rm))
 #define emith_write_r_r_r_c(cond, r, ra, rm) \
@@ -1111,6 +1111,16 @@ static void emith_st_offs(int sz, int rt, int rs, int o12)
 #define emith_write_r_r_offs_c(cond, r, rs, offs) \
 	emith_write_r_r_offs(r, rs, offs)
 
+#define emith_write16_r_r_offs(r, rs, offs) \
+	emith_st_offs(F1_H, r, rs, offs)
+#define emith_write16_r_r_offs_c(cond, r, rs, offs) \
+	emith_write16_r_r_offs(r, rs, offs)
+
+#define emith_write8_r_r_offs(r, rs, offs) \
+	emith_st_offs(F1_B, r, rs, offs)
+#define emith_write8_r_r_offs_c(cond, r, rs, offs) \
+	emith_write8_r_r_offs(r, rs, offs)
+
 #define emith_write_r_r_r(r, rs, rm) do { \
 	emith_add_r_r_r(AT, rs, rm); \
 	emith_st_offs(F1_W, r, AT, 0); \
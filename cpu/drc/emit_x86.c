@@ -782,7 +782,13 @@ enum { xAX = 0, xCX, xDX, xBX, xSP, xBP, xSI, xDI,	// x86-64,i386 common
 } while (0)
 
 #define emith_write8_r_r_offs(r, rs, offs) do {\
-	EMIT_REX_IF(0, r, rs); \
+	/* regs 4-7 are AH-BH w/o REX, x86-64 needs an empty REX for SIL/DIL */ \
+	if (PTR_SCALE == 3 && (r) >= 4 && (r) < 8 && (rs) < 8) \
+		EMIT_REX(0, 0, 0, 0); \
+	else { \
+		assert(PTR_SCALE == 3 || is_abcdx(r)); \
+		EMIT_REX_IF(0, r, rs); \
+	} \
 	emith_deref_op(0x88, r, rs, offs); \
 } while (0)
 
@@ -33,6 +33,7 @@
 #include <assert.h>
 
 #include <pico/pico_int.h>
+#include <pico/pico_thread.h>
 #include <pico/arm_features.h>
 #include "sh2.h"
 #include "compiler.h"
@@ -50,6 +51,13 @@
 #define LOOP_OPTIMIZER          1
 #define T_OPTIMIZER             1
 #define DIV_OPTIMIZER           0
+#ifdef DRC_HOTNESS // block entry counters, for eviction and superblocks
+#define BLOCK_HOTNESS           1
+#else
+#define BLOCK_HOTNESS           0
+#endif
+#define SUPERBLOCKS             BLOCK_HOTNESS
+#define INLINE_RAM_ACCESS       1
 
 #define MAX_LITERAL_OFFSET      0x200	// max. MOVA, MOV @(PC) offset
 #define MAX_LOCAL_TARGETS       (BLOCK_INSN_LIMIT / 4)
@@ -199,7 +207,7 @@ static char sh2dasm_buff[64];
 	printf("%csh2 tmp-p  %08x %08x %08x %08x %08x %08lx %08x %08x\n", ms, \
 		(sh2)->drc_tmp, (sh2)->irq_cycles, \
 		(sh2)->pdb_io_csum[0], (sh2)->pdb_io_csum[1], (sh2)->state, \
-		(ulong)(sh2)->poll_addr, (sh2)->poll_cycles, (sh2)->poll_cnt); \
+		(ulong)(sh2)->poll.addr[0], (sh2)->poll.cycles, (sh2)->poll.cnt); \
 }
 
 #if (DRC_DEBUG & (256|512|1024))
@@ -242,7 +250,7 @@ static void REGPARM(3) *sh2_drc_log_entry(void *block, SH2 *sh2, u32 sr)
     if (trace[idx] && csh2[idx][0].pc != sh2->pc) {
       fwrite(sh2, offsetof(SH2, read8_map), 1, trace[idx]);
       fwrite(&sh2->pdb_io_csum, sizeof(sh2->pdb_io_csum), 1, trace[idx]);
-      memcpy(&csh2[idx][0], sh2, offsetof(SH2, poll_cnt)+4);
+      memcpy(&csh2[idx][0], sh2, offsetof(SH2, poll)+sizeof(sh2->poll));
       csh2[idx][0].is_slave = idx;
     }
   }
@@ -282,8 +290,8 @@ static void REGPARM(3) *sh2_drc_log_entry(void *block, SH2 *sh2, u32 sr)
   {
     int x = sh2->is_slave, i;
     for (i = 0; i < ARRAY_SIZE(csh2[x])-1; i++)
-      memcpy(&csh2[x][i], &csh2[x][i+1], offsetof(SH2, poll_cnt)+4);
-    memcpy(&csh2[x][ARRAY_SIZE(csh2[x])-1], sh2, offsetof(SH2, poll_cnt)+4);
+      memcpy(&csh2[x][i], &csh2[x][i+1], offsetof(SH2, poll)+sizeof(sh2->poll));
+    memcpy(&csh2[x][ARRAY_SIZE(csh2[x])-1], sh2, offsetof(SH2, poll)+sizeof(sh2->poll));
     csh2[x][0].is_slave = x;
   }
 #endif
@@ -329,11 +337,11 @@ struct block_entry {
   struct block_entry *prev;
   struct block_link *links;  // incoming links to this entry
   struct block_link *o_links;// outgoing links from this entry
-#if (DRC_DEBUG & 2)
+#if (DRC_DEBUG & 2) || SUPERBLOCKS
   struct block_desc *block;
 #endif
-#if (DRC_DEBUG & 32)
-  int entry_count;
+#if (DRC_DEBUG & 32) || BLOCK_HOTNESS
+  int entry_count;           // number of times this entry was executed
 #endif
 };
 
@@ -345,6 +353,7 @@ struct block_desc {
   u8 *tcache_ptr;            // start address of block in cache
   u16 crc;                   // crc of insns and literals
   u16 active;                // actively used or deactivated?
+  u16 superblock;            // hot block, regs are kept across branch targets
   struct block_list *list;
 #if (DRC_DEBUG & 2)
   int refcount;
@@ -366,22 +375,22 @@ static u8 *tcache_ptr;       // ptr for code emitters
 // XXX: need to tune sizes
 
 static struct ring_buffer tcache_ring[TCACHE_BUFFERS];
-static const int tcache_sizes[TCACHE_BUFFERS] = {
-  DRC_TCACHE_SIZE * 30 / 32, // ROM (rarely used), DRAM
-  DRC_TCACHE_SIZE / 32, // BIOS, data array in master sh2
-  DRC_TCACHE_SIZE / 32, // ... slave
-};
+static int tcache_sizes[TCACHE_BUFFERS]; // set up from tcache_size at init:
+  // 30/32: ROM (rarely used), DRAM
+  //  1/32: BIOS, data array in master sh2
+  //  1/32: ... slave
+static int tcache_scale;     // tcache_size relative to DRC_TCACHE_SIZE
 
-#define BLOCK_MAX_COUNT(tcid)		((tcid) ? 256 : 32*256)
+#define BLOCK_MAX_COUNT(tcid)		(((tcid) ? 256 : 32*256) * tcache_scale)
 static struct ring_buffer block_ring[TCACHE_BUFFERS];
 static struct block_desc *block_tables[TCACHE_BUFFERS];
 
-#define ENTRY_MAX_COUNT(tcid)		((tcid) ? 8*512 : 256*512)
+#define ENTRY_MAX_COUNT(tcid)		(((tcid) ? 8*512 : 256*512) * tcache_scale)
 static struct ring_buffer entry_ring[TCACHE_BUFFERS];
 static struct block_entry *entry_tables[TCACHE_BUFFERS];
 
 // we have block_link_pool to avoid using mallocs
-#define BLOCK_LINK_MAX_COUNT(tcid)	((tcid) ? 512 : 32*512)
+#define BLOCK_LINK_MAX_COUNT(tcid)	(((tcid) ? 512 : 32*512) * tcache_scale)
 static struct block_link *block_link_pool[TCACHE_BUFFERS]; 
 static int block_link_pool_counts[TCACHE_BUFFERS];
 static struct block_link **unresolved_links[TCACHE_BUFFERS];
@@ -393,6 +402,60 @@ static struct block_link *blink_free[TCACHE_BUFFERS];
 
 static struct block_list *inactive_blocks[TCACHE_BUFFERS];
 
+#if BLOCK_HOTNESS
+// hot blocks which had to be evicted are retranslated right away
+#define HOT_BLOCK_COUNT   256   // min. executed block entries for a hot block
+#define HOT_QUEUE_SIZE    16
+
+struct hot_block {
+  u32 addr;
+  u16 crc;
+};
+static struct hot_block hot_queue[TCACHE_BUFFERS][HOT_QUEUE_SIZE];
+static int hot_queue_count[TCACHE_BUFFERS];
+#endif
+
+#if SUPERBLOCKS
+// blocks with an entry executed this often are translated again as superblock,
+// keeping registers cached across the branch targets inside the block
+#define SUPERBLOCK_COUNT  1024
+
+static int superblock_request; // next sh2_translate makes a superblock
+#endif
+
+#ifdef USE_THREADS
+// background translation: on a lookup miss the sh2 leaves the drc and is
+// interpreted while a worker thread translates the block. The drc data is
+// owned by the worker as long as a job is pending, memory writes hitting
+// translated code are queued and checked when the job is collected.
+#define JIT_WCHECKS       64    // max. queued write checks
+#define JIT_INTERPRET     64    // cycles to interpret between job checks
+
+enum { JIT_IDLE, JIT_BUSY, JIT_DONE };
+
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;
+  pico_cond_t cond;
+  int state;                    // JIT_*
+  SH2 sh2;                      // copy of the sh2 state at the lookup miss
+  int tcache_id;
+  int blk_next[TCACHE_BUFFERS]; // first block translated by the job
+  struct { u32 a; u16 len; u16 tcache_id; } wcheck[JIT_WCHECKS];
+  int wcheck_count;
+  int wcheck_flush;             // tcache_ids to flush if the queue overflowed
+  int illegal;                  // job found an illegal op, drop its blocks
+  int miss[2];                  // sh2 left the drc for a pending job
+  int running, failed, quit;
+} jit;
+#endif
+
+// statistics. evicted blocks are remembered in a hashed bitmap for detecting
+// retranslations, which may thus be slightly overestimated.
+#define EVICT_MAP_BITS    4096
+static u32 evict_map[TCACHE_BUFFERS][EVICT_MAP_BITS / 32];
+static struct sh2_drc_stats drc_stats[TCACHE_BUFFERS];
+
 // array of pointers to block_lists for RAM and 2 data arrays
 // each array has len: sizeof(mem) / INVAL_PAGE_SIZE 
 static struct block_list **inval_lookup[TCACHE_BUFFERS];
@@ -513,6 +576,12 @@ static u32  REGPARM(2) (*sh2_drc_dispatcher_call)(u32 pc);
 static void REGPARM(1) (*sh2_drc_dispatcher_return)(u32 pc);
 #endif
 static void REGPARM(1) (*sh2_drc_exit)(u32 pc);
+#if SUPERBLOCKS
+static void REGPARM(1) (*sh2_drc_dispatcher_hot)(u32 pc);
+#endif
+#ifdef USE_THREADS
+static void            (*sh2_drc_exit_async)(void);
+#endif
 static void            (*sh2_drc_test_irq)(void);
 
 static u32  REGPARM(1) (*sh2_drc_read8)(u32 a);
@@ -1073,7 +1142,7 @@ static void dr_rm_block_entry(struct block_desc *bd, int tcache_id, u32 nolit, i
 }
 
 static struct block_desc *dr_find_inactive_block(int tcache_id, u16 crc,
-  u32 addr, int size, u32 addr_lit, int size_lit)
+  u32 addr, int size, u32 addr_lit, int size_lit, int superblock)
 {
   struct block_list **head = &inactive_blocks[tcache_id];
   struct block_list *current;
@@ -1081,7 +1150,8 @@ static struct block_desc *dr_find_inactive_block(int tcache_id, u16 crc,
   for (current = *head; current != NULL; current = current->next) {
     struct block_desc *block = current->block;
     if (block->crc == crc && block->addr == addr && block->size == size &&
-        block->addr_lit == addr_lit && block->size_lit == size_lit)
+        block->addr_lit == addr_lit && block->size_lit == size_lit &&
+        block->superblock == superblock)
     {
       rm_from_block_lists(block);
       return block;
@@ -1095,7 +1165,7 @@ static struct block_desc *dr_add_block(int entries, u32 addr, int size,
 {
   struct block_entry *be;
   struct block_desc *bd;
-  int tcache_id;
+  int tcache_id, i;
 
   // do a lookup to get tcache_id and override check
   be = dr_get_entry(addr, is_slave, &tcache_id);
@@ -1119,12 +1189,20 @@ static struct block_desc *dr_add_block(int entries, u32 addr, int size,
   bd->tcache_ptr = tcache_ptr;
   bd->crc = crc;
   bd->active = 0;
+  bd->superblock = 0;
   bd->list = NULL;
   bd->entry_count = 0;
 #if (DRC_DEBUG & 2)
   bd->refcount = 0;
 #endif
 
+  drc_stats[tcache_id].translations++;
+  i = (addr >> 1) % EVICT_MAP_BITS;
+  if (evict_map[tcache_id][i / 32] & (1 << (i % 32))) {
+    evict_map[tcache_id][i / 32] &= ~(1 << (i % 32));
+    drc_stats[tcache_id].retranslations++;
+  }
+
   return bd;
 }
 
@@ -1203,13 +1281,41 @@ static void REGPARM(3) *dr_lookup_block(u32 pc, SH2 *sh2, int *tcache_id)
   return block;
 }
 
+#if BLOCK_HOTNESS
+static void dr_queue_hot_block(struct block_desc *bd, int tcache_id)
+{
+  struct hot_block *hb;
+  u32 count = 0;
+  int i;
+
+  if (!bd->active || hot_queue_count[tcache_id] >= HOT_QUEUE_SIZE)
+    return;
+
+  for (i = 0; i < bd->entry_count; i++)
+    count += bd->entryp[i].entry_count;
+  if (count >= HOT_BLOCK_COUNT) {
+    hb = &hot_queue[tcache_id][hot_queue_count[tcache_id]++];
+    hb->addr = bd->addr;
+    hb->crc = bd->crc;
+  }
+}
+#endif
+
 static void dr_free_oldest_block(int tcache_id)
 {
   struct block_desc *bf;
+  int i;
 
   bf = ring_first(&block_ring[tcache_id]);
-  if (bf->addr && bf->entry_count)
+  if (bf->addr && bf->entry_count) {
+#if BLOCK_HOTNESS
+    dr_queue_hot_block(bf, tcache_id);
+#endif
+    i = (bf->addr >> 1) % EVICT_MAP_BITS;
+    evict_map[tcache_id][i / 32] |= 1 << (i % 32);
+    drc_stats[tcache_id].evictions++;
     dr_rm_block_entry(bf, tcache_id, 0, 1);
+  }
   ring_free(&block_ring[tcache_id], 1);
 
   if (block_ring[tcache_id].used) {
@@ -1288,6 +1394,9 @@ static void dr_flush_tcache(int tcid)
   ring_reset(&tcache_ring[tcid]);
   ring_reset(&block_ring[tcid]);
   ring_reset(&entry_ring[tcid]);
+#if BLOCK_HOTNESS
+  hot_queue_count[tcid] = 0;
+#endif
 
   block_link_pool_counts[tcid] = 0;
   blink_free[tcid] = NULL;
@@ -2519,6 +2628,54 @@ static void rcache_flush(void)
   rcache_invalidate();
 }
 
+#if SUPERBLOCKS
+// like rcache_flush, but keeps the guest regs in mask which are cached in
+// non-temp host regs. Other code paths must load these from the context before
+// continuing here (see rcache_load_kept). Returns the number of vregs kept.
+static int rcache_keep(u32 mask)
+{
+  u32 kept[ARRAY_SIZE(cache_regs)];
+  int i, r, n = 0;
+
+  rcache_clean();
+  mask &= ~(rcache_regs_static | rcache_regs_pinned | rcache_regs_discard);
+  for (i = 0; i < ARRAY_SIZE(cache_regs); i++) {
+    kept[i] = 0;
+    // aliases may differ on other paths, keep only one of them
+    if (cache_regs[i].type == HR_CACHED && (cache_regs[i].htype & HRT_REG) &&
+        !(cache_regs[i].flags & HRF_PINNED) && (cache_regs[i].gregs & mask)) {
+      kept[i] = cache_regs[i].gregs & mask;
+      kept[i] &= -kept[i];
+      n++;
+    }
+  }
+  rcache_invalidate();
+
+  for (i = 0; i < ARRAY_SIZE(cache_regs); i++)
+    if (kept[i]) {
+      cache_regs[i].type = HR_CACHED;
+      cache_regs[i].gregs = kept[i];
+      cache_regs[i].stamp = ++rcache_counter;
+      FOR_ALL_BITS_SET_DO(kept[i], r, guest_regs[r].vreg = i);
+    }
+#if DRC_DEBUG & 64
+  RCACHE_CHECK("after keep");
+#endif
+  return n;
+}
+
+// load the regs kept by rcache_keep from the context
+static void rcache_load_kept(void)
+{
+  int i, r;
+
+  for (i = 0; i < ARRAY_SIZE(cache_regs); i++)
+    if (cache_regs[i].type == HR_CACHED && !(cache_regs[i].flags & HRF_PINNED))
+      FOR_ALL_BITS_SET_DO(cache_regs[i].gregs, r,
+        emith_ctx_read(cache_regs[i].hreg, r * 4));
+}
+#endif
+
 static void rcache_create(void)
 {
   int x = 0, i;
@@ -2722,6 +2879,8 @@ static void emit_move_r_imm32(sh2_reg_e dst, u32 imm)
 
 static void emit_move_r_r(sh2_reg_e dst, sh2_reg_e src)
 {
+  if (dst == src)
+    return;
   if (gconst_check(src) || rcache_is_cached(src))
     rcache_alias_vreg(dst, src);
   else {
@@ -2773,20 +2932,100 @@ static void emit_sync_t_to_sr(void)
   }
 }
 
-// rd = @(arg0)
-static int emit_memhandler_read(int size)
+#if INLINE_RAM_ACCESS
+// Inlined SDRAM/DRAM access in generated code. Register t is 0 afterwards if
+// the access has been done inline, else the memory handler must be called.
+// Cache-through mirrors are covered by masking out address bit 29.
+
+// t = 0 if a is in SDRAM (0x06000000, mirrored up to 0x07ffffff)
+static void emit_sdram_check(int t, int a)
 {
-  int hr;
+  emith_lsr(t, a, 25);
+  emith_and_r_imm(t, 0x6f);
+  emith_eor_r_imm(t, 0x06000000 >> 25);
+  emith_cmp_r_imm(t, 0);
+}
 
-  emit_sync_t_to_sr();
-  rcache_clean_tmp();
-#ifndef DRC_SR_REG
-  // must writeback cycles for poll detection stuff
-  if (guest_regs[SHR_SR].vreg != -1)
-    rcache_unmap_vreg(guest_regs[SHR_SR].vreg);
+// t = 0 if a is in DRAM, but not in the overwrite image at 0x04020000
+static void emit_dram_check(int t, int a)
+{
+  emith_lsr(t, a, 17);
+  emith_and_r_imm(t, 0x6f01);
+  emith_eor_r_imm(t, 0x04000000 >> 17);
+  emith_cmp_r_imm(t, 0);
+}
+
+// RET_REG = @(a) if a is in SDRAM, a is lost then
+static void emit_ram_read(int a, int t, int u, int size)
+{
+  static const u32 mask[] = { 0x3ffff, 0x3fffe, 0x3fffc };
+
+  emit_sdram_check(t, a);
+  EMITH_JMP_START(DCOND_NE);
+  emith_and_r_r_imm(u, a, mask[size]);
+  emith_ctx_read_ptr(t, offsetof(SH2, p_sdram));
+  switch (size) {
+  case 0: emit_le_ptr8(-1, u);
+          emith_read8s_r_r_r(RET_REG, t, u);              break; // 8
+  case 1: emith_read16s_r_r_r(RET_REG, t, u);             break; // 16
+  case 2: emith_read_r_r_r(RET_REG, t, u);
+          emit_le_swap(-1, RET_REG);                      break; // 32
+  }
+  emith_move_r_imm(t, 0);
+  EMITH_JMP_END(DCOND_NE);
+}
+
+// @(a) = d if a is in SDRAM or DRAM. For SDRAM the drcblk map is checked,
+// the handler must do SMC detection and poll wakeup if anything is set there.
+static void emit_ram_write(int a, int d, int t, int u, int size)
+{
+  emit_sdram_check(t, a);
+  EMITH_JMP_START(DCOND_NE);
+  emith_and_r_r_imm(u, a, size == 2 ? 0x3fffc : 0x3fffe);
+  emith_ctx_read_ptr(t, offsetof(SH2, p_sdram));
+  emith_add_r_r_ptr(t, u);
+  if (size == 2) {
+    emit_le_swap(-1, d);
+    emith_write_r_r_offs(d, t, 0);
+    emit_le_swap(-1, d);
+  } else
+    emith_write16_r_r_offs(d, t, 0);
+  emith_lsr(u, u, SH2_DRCBLK_RAM_SHIFT);
+  emith_ctx_read_ptr(t, offsetof(SH2, p_drcblk_ram));
+  emith_add_r_r_ptr(t, u);
+  if (size == 2 && (2 >> SH2_DRCBLK_RAM_SHIFT)) {
+    emith_read8_r_r_offs(u, t, 2 >> SH2_DRCBLK_RAM_SHIFT);
+    emith_read8_r_r_offs(t, t, 0);
+    emith_or_r_r(t, u);
+  } else
+    emith_read8_r_r_offs(t, t, 0);
+#ifdef SH2_THREADS
+  // the handler tracks SDRAM writes in parallel mode
+  emith_ctx_read(u, offsetof(SH2, state));
+  emith_and_r_imm(u, SH2_PAR_SDRAM);
+  emith_or_r_r(t, u);
+#endif
+  EMITH_JMP_END(DCOND_NE);
+
+  // t != 0 here if not in SDRAM, or if the drcblk map has something there
+  emit_dram_check(u, a);
+  EMITH_JMP_START(DCOND_NE);
+  emith_and_r_r_imm(u, a, size == 2 ? 0x1fffc : 0x1fffe);
+  emith_ctx_read_ptr(t, offsetof(SH2, p_dram));
+  emith_add_r_r_ptr(t, u);
+  if (size == 2) {
+    emit_le_swap(-1, d);
+    emith_write_r_r_offs(d, t, 0);
+    emit_le_swap(-1, d);
+  } else
+    emith_write16_r_r_offs(d, t, 0);
+  emith_move_r_imm(t, 0);
+  EMITH_JMP_END(DCOND_NE);
+}
 #endif
-  rcache_invalidate_tmp();
 
+static void emit_memhandler_read_call(int size)
+{
   if (size & MF_POLLING)
     switch (size & MF_SIZEMASK) {
     case 0:   emith_call(sh2_drc_read8_poll);   break; // 8
@@ -2799,6 +3038,45 @@ static int emit_memhandler_read(int size)
     case 1:   emith_call(sh2_drc_read16);       break; // 16
     case 2:   emith_call(sh2_drc_read32);       break; // 32
     }
+}
+
+static void emit_memhandler_write_call(int size)
+{
+  switch (size & MF_SIZEMASK) {
+  case 0:   emith_call(sh2_drc_write8);     break;  // 8
+  case 1:   emith_call(sh2_drc_write16);    break;  // 16
+  case 2:   emith_call(sh2_drc_write32);    break;  // 32
+  }
+}
+
+// rd = @(arg0)
+static int emit_memhandler_read(int size)
+{
+  int hr;
+
+  emit_sync_t_to_sr();
+  rcache_clean_tmp();
+#ifndef DRC_SR_REG
+  // must writeback cycles for poll detection stuff
+  if (guest_regs[SHR_SR].vreg != -1)
+    rcache_unmap_vreg(guest_regs[SHR_SR].vreg);
+#endif
+  rcache_invalidate_tmp();
+
+#if INLINE_RAM_ACCESS
+  if (!(size & MF_POLLING)) {
+    int a, t, u;
+    host_arg2reg(a, 0);
+    host_arg2reg(t, 2);
+    host_arg2reg(u, 3);
+    emit_ram_read(a, t, u, size & MF_SIZEMASK);
+    emith_cmp_r_imm(t, 0);
+    EMITH_JMP_START(DCOND_EQ);
+    emit_memhandler_read_call(size);
+    EMITH_JMP_END(DCOND_EQ);
+  } else
+#endif
+    emit_memhandler_read_call(size);
 
   hr = rcache_get_tmp_ret();
   rcache_set_x16(hr, (size & MF_SIZEMASK) < 2, 0);
@@ -2816,11 +3094,22 @@ static void emit_memhandler_write(int size)
 #endif
   rcache_invalidate_tmp();
 
-  switch (size & MF_SIZEMASK) {
-  case 0:   emith_call(sh2_drc_write8);     break;  // 8
-  case 1:   emith_call(sh2_drc_write16);    break;  // 16
-  case 2:   emith_call(sh2_drc_write32);    break;  // 32
-  }
+#if INLINE_RAM_ACCESS
+  // byte writes to cache-through SDRAM need a sync, see memory.c
+  if (size & MF_SIZEMASK) {
+    int a, d, t, u;
+    host_arg2reg(a, 0);
+    host_arg2reg(d, 1);
+    host_arg2reg(t, 2);
+    host_arg2reg(u, 3);
+    emit_ram_write(a, d, t, u, size & MF_SIZEMASK);
+    emith_cmp_r_imm(t, 0);
+    EMITH_JMP_START(DCOND_EQ);
+    emit_memhandler_write_call(size);
+    EMITH_JMP_END(DCOND_EQ);
+  } else
+#endif
+    emit_memhandler_write_call(size);
 }
 
 // rd = @(Rs,#offs); rd < 0 -> return a temp
@@ -3228,6 +3517,10 @@ static void emit_branch_linkage_code(SH2 *sh2, struct block_desc *block, int tca
     } else {
       // external or exit, emit blx area entry
       void *target = (links[u].mask & 0x1 ? sh2_drc_exit : sh2_drc_dispatcher);
+#if SUPERBLOCKS
+      if (links[u].mask & 0x4)
+        target = sh2_drc_dispatcher_hot;
+#endif
       if (links[u].bl)
         links[u].bl->blx = tcache_ptr;
       emith_jump_patch(links[u].ptr, tcache_ptr, NULL);
@@ -3254,6 +3547,31 @@ static void emit_branch_linkage_code(SH2 *sh2, struct block_desc *block, int tca
   }
 
 static void *dr_get_pc_base(u32 pc, SH2 *sh2);
+#if BLOCK_HOTNESS
+static void dr_rescue_hot_blocks(SH2 *sh2, int tcache_id);
+#endif
+
+#if SUPERBLOCKS
+// guest regs read before being written by the insns from ops[i] on, up to the
+// next branch target or the end of the next branch (max. n insns)
+static u32 dr_regs_read_next(const u8 *op_flags, int i, int n)
+{
+  u32 read = 0, write = 0;
+  int v;
+
+  if (n > 16)
+    n = 16;
+  for (v = 0; v < n; v++) {
+    if (v > 0 && ((op_flags[i+v] & OF_BTARGET) ||
+        (!(op_flags[i+v] & OF_DELAY_OP) && (OP_ISBRAUC(ops[i+v-1].op) ||
+          OP_ISBRACND(ops[i+v-1].op) || (op_flags[i+v-1] & OF_DELAY_OP)))))
+      break;
+    read |= ops[i+v].source & ~write;
+    write |= ops[i+v].dest;
+  }
+  return read & ((1 << SH2_REGS) - 1) & ~BITMASK3(SHR_PC, SHR_PPC, SHR_SR);
+}
+#endif
 
 static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 {
@@ -3302,6 +3620,16 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
   u32 u, m1, m2, m3, m4;
   int op;
   u16 crc;
+  int superblock = 0;
+
+#if SUPERBLOCKS
+  superblock = superblock_request;
+  superblock_request = 0;
+#endif
+#if BLOCK_HOTNESS
+  if (hot_queue_count[tcache_id])
+    dr_rescue_hot_blocks(sh2, tcache_id);
+#endif
 
   base_pc = sh2->pc;
 
@@ -3321,7 +3649,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
   // if there is already a translated but inactive block, reuse it
   block = dr_find_inactive_block(tcache_id, crc, base_pc, end_pc - base_pc,
-    base_literals, end_literals - base_literals);
+    base_literals, end_literals - base_literals, superblock);
 
   if (block) {
     dbg(2, "== %csh2 reuse block %08x-%08x,%08x-%08x -> %p", sh2->is_slave ? 's' : 'm',
@@ -3434,6 +3762,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
     base_literals, end_literals-base_literals, crc, sh2->is_slave, &blkid_main);
   if (block == NULL)
     return NULL;
+  block->superblock = superblock;
 
   block_entry_ptr = tcache_ptr;
   dbg(2, "== %csh2 block #%d,%d %08x-%08x,%08x-%08x -> %p", sh2->is_slave ? 's' : 'm',
@@ -3461,15 +3790,39 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
     if (op_flags[i] & OF_BTARGET)
     {
+      u8 *entry_ptr;
+
       if (pc != base_pc)
       {
         sr = rcache_get_reg(SHR_SR, RC_GR_RMW, NULL);
         FLUSH_CYCLES(sr);
         emith_sync_t(sr);
         drcf.Mflag = FLG_UNKNOWN;
-        rcache_flush();
-        emith_flush();
-      }
+#if SUPERBLOCKS
+        // keep regs read by the next insns if arriving here by fallthrough.
+        // Branches and block entries for this target go to a stub loading them.
+        if (superblock && !(op_flags[i] & (OF_LOOP|OF_BASIC_LOOP)) &&
+            rcache_keep(dr_regs_read_next(op_flags, i, (end_pc - pc) / 2)))
+        {
+          u8 *jump;
+
+          emith_flush();
+          jump = tcache_ptr;
+          emith_jump_patchable(jump);
+          emith_flush();
+          entry_ptr = tcache_ptr;
+          rcache_load_kept();
+          emith_flush();
+          emith_jump_patch(jump, tcache_ptr, NULL);
+        } else
+#endif
+        {
+          rcache_flush();
+          emith_flush();
+          entry_ptr = tcache_ptr;
+        }
+      } else
+        entry_ptr = tcache_ptr;
 
       // make block entry
       v = block->entry_count;
@@ -3478,16 +3831,19 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       {
         entry = &block->entryp[v];
         entry->pc = pc;
-        entry->tcache_ptr = tcache_ptr;
+        entry->tcache_ptr = entry_ptr;
         entry->links = entry->o_links = NULL;
-#if (DRC_DEBUG & 2)
+#if (DRC_DEBUG & 2) || SUPERBLOCKS
         entry->block = block;
+#endif
+#if (DRC_DEBUG & 32) || BLOCK_HOTNESS
+        entry->entry_count = 0;
 #endif
         block->entry_count++;
 
         dbg(2, "-- %csh2 block #%d,%d entry %08x -> %p",
           sh2->is_slave ? 's' : 'm', tcache_id, blkid_main,
-          pc, tcache_ptr);
+          pc, entry_ptr);
       }
       else {
         dbg(1, "too many entryp for block #%d,%d pc=%08x",
@@ -3497,7 +3853,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
       v = find_in_sorted_linkage(branch_targets, branch_target_count, pc);
       if (v >= 0)
-        branch_targets[v].ptr = tcache_ptr;
+        branch_targets[v].ptr = entry_ptr;
 #if LOOP_DETECTION
       drcf.loop_type = op_flags[i] & OF_LOOP;
       drcf.delay_reg = -1;
@@ -3580,7 +3936,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
         }
       }
 
-#if (DRC_DEBUG & 32)
+#if (DRC_DEBUG & 32) || BLOCK_HOTNESS
       // block hit counter
       tmp  = rcache_get_tmp_arg(0);
       tmp2 = rcache_get_tmp_arg(1);
@@ -3588,6 +3944,28 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       emith_read_r_r_offs(tmp2, tmp, offsetof(struct block_entry, entry_count));
       emith_add_r_imm(tmp2, 1);
       emith_write_r_r_offs(tmp2, tmp, offsetof(struct block_entry, entry_count));
+#if SUPERBLOCKS
+      if (!superblock && blx_target_count < ARRAY_SIZE(blx_targets)) {
+        // translate again as superblock if hot, via stub in blx table
+        emith_cmp_r_imm(tmp2, SUPERBLOCK_COUNT);
+#if LOOP_OPTIMIZER
+        if (op_flags[i] & OF_BASIC_LOOP) {
+          // this counts loop iterations, pinned regs must be written back
+          EMITH_JMP_START(DCOND_NE);
+          rcache_save_pinned();
+          blx_targets[blx_target_count++] =
+              (struct linkage) { .pc = pc, .ptr = tcache_ptr, .mask = 0x4 };
+          emith_jump_patchable(tcache_ptr);
+          EMITH_JMP_END(DCOND_NE);
+        } else
+#endif
+        {
+          blx_targets[blx_target_count++] =
+              (struct linkage) { .pc = pc, .ptr = tcache_ptr, .mask = 0x4 };
+          emith_jump_cond_patchable(DCOND_EQ, tcache_ptr);
+        }
+      }
+#endif
       rcache_free_tmp(tmp);
       rcache_free_tmp(tmp2);
 #endif
@@ -4195,8 +4573,12 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       case 0x0d: // XTRCT  Rm,Rn        0010nnnnmmmm1101
         tmp2 = rcache_get_reg(GET_Rm(), RC_GR_READ, NULL);
         tmp  = rcache_get_reg(GET_Rn(), RC_GR_RMW, &tmp3);
-        emith_lsr(tmp, tmp3, 16);
-        emith_or_r_r_lsl(tmp, tmp2, 16);
+        if (GET_Rm() == GET_Rn())
+          emith_ror(tmp, tmp3, 16);
+        else {
+          emith_lsr(tmp, tmp3, 16);
+          emith_or_r_r_lsl(tmp, tmp2, 16);
+        }
         goto end_op;
       case 0x0e: // MULU.W Rm,Rn        0010nnnnmmmm1110
       case 0x0f: // MULS.W Rm,Rn        0010nnnnmmmm1111
@@ -4274,6 +4656,8 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
         // T = (Q == M) = !(Q ^ M) = !(Q1 ^ Q2)
         tmp3 = rcache_get_reg(GET_Rm(), RC_GR_READ, NULL);
         tmp2 = rcache_get_reg(GET_Rn(), RC_GR_RMW, NULL);
+        if (GET_Rm() == GET_Rn())
+          tmp3 = tmp2; // Rm is the shifted Rn
         sr   = rcache_get_reg(SHR_SR, RC_GR_RMW, NULL);
         emith_sync_t(sr);
         tmp = rcache_get_tmp();
@@ -4875,6 +5259,14 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       if (!(op_flags[i] & OF_B_IN_DS)) {
         elprintf_sh2(sh2, EL_ANOMALY,
           "drc: illegal op %04x @ %08x", op, pc - 2);
+#ifdef USE_THREADS
+        // the code may have been overwritten while translating in the
+        // background, the block is dropped when the job is collected
+        if (pico_atomic_load(&jit.state) == JIT_BUSY) {
+          jit.illegal = 1;
+          goto end_op;
+        }
+#endif
         exit(1);
       }
     }
@@ -5187,6 +5579,8 @@ end_op:
 
   ring_alloc(&tcache_ring[tcache_id], tcache_ptr - block_entry_ptr);
   host_instructions_updated(block_entry_ptr, tcache_ptr, 1);
+  drc_perf_add(block_entry_ptr, tcache_ptr - block_entry_ptr, "%csh2_%08x_tc%d",
+    sh2->is_slave ? 's' : 'm', base_pc, tcache_id);
 
   dr_activate_block(block, tcache_id, sh2->is_slave);
   emith_update_cache();
@@ -5199,7 +5593,9 @@ end_op:
     insns_compiled, host_insn_count, (float)host_insn_count / insns_compiled);
   if ((sh2->pc & 0xc6000000) == 0x02000000) { // ROM
     dbg(2, "  hash collisions %d/%d", hash_collisions, block_ring[tcache_id].used);
-    Pico32x.emu_flags |= P32XF_DRC_ROM_C;
+    // NB may run on the jit worker, don't write if already set
+    if (!(Pico32x.emu_flags & P32XF_DRC_ROM_C))
+      Pico32x.emu_flags |= P32XF_DRC_ROM_C;
   }
 /*
  printf("~~~\n");
@@ -5215,6 +5611,179 @@ end_op:
   return block_entry_ptr;
 }
 
+#ifdef USE_THREADS
+static void *dr_jit_worker(void *arg)
+{
+  pico_mutex_lock(&jit.lock);
+  for (;;) {
+    while (jit.state != JIT_BUSY && !jit.quit)
+      pico_cond_wait(&jit.cond, &jit.lock);
+    if (jit.quit)
+      break;
+    pico_mutex_unlock(&jit.lock);
+
+    // the result is found by the lookup once the job has been collected
+    sh2_translate(&jit.sh2, jit.tcache_id);
+
+    pico_mutex_lock(&jit.lock);
+    pico_atomic_store(&jit.state, JIT_DONE);
+    pico_cond_broadcast(&jit.cond);
+  }
+  pico_mutex_unlock(&jit.lock);
+  return NULL;
+}
+
+// hand the block at sh2->pc over to the jit worker
+static int dr_jit_start(SH2 *sh2, int tcache_id)
+{
+  int i;
+
+  if (!jit.running) {
+    if (jit.failed)
+      return 0;
+    pico_mutex_init(&jit.lock);
+    pico_cond_init(&jit.cond);
+    jit.state = JIT_IDLE;
+    jit.quit = 0;
+    if (pico_thread_create(&jit.thread, dr_jit_worker, NULL) != 0) {
+      elprintf(EL_STATUS, "sh2 drc: failed to create jit thread");
+      pico_cond_destroy(&jit.cond);
+      pico_mutex_destroy(&jit.lock);
+      jit.failed = 1;
+      return 0;
+    }
+    jit.running = 1;
+  }
+
+  jit.sh2 = *sh2;
+  jit.tcache_id = tcache_id;
+  for (i = 0; i < TCACHE_BUFFERS; i++)
+    jit.blk_next[i] = block_ring[i].next;
+  jit.wcheck_count = jit.wcheck_flush = jit.illegal = 0;
+  jit.miss[sh2->is_slave] = 1;
+  // set here since the emulator thread may flush on ROM bank switches
+  if ((sh2->pc & 0xc6000000) == 0x02000000)
+    Pico32x.emu_flags |= P32XF_DRC_ROM_C;
+
+  pico_mutex_lock(&jit.lock);
+  pico_atomic_store(&jit.state, JIT_BUSY);
+  pico_cond_broadcast(&jit.cond);
+  pico_mutex_unlock(&jit.lock);
+  return 1;
+}
+
+static void dr_jit_stop(void)
+{
+  if (!jit.running)
+    return;
+
+  pico_mutex_lock(&jit.lock);
+  while (jit.state == JIT_BUSY)
+    pico_cond_wait(&jit.cond, &jit.lock);
+  jit.quit = 1;
+  pico_cond_broadcast(&jit.cond);
+  pico_mutex_unlock(&jit.lock);
+  pico_thread_join(jit.thread);
+
+  pico_cond_destroy(&jit.cond);
+  pico_mutex_destroy(&jit.lock);
+  jit.running = 0;
+  // the drc data is about to be freed, a pending result isn't needed anymore
+  jit.state = JIT_IDLE;
+  jit.miss[0] = jit.miss[1] = 0;
+}
+
+#ifdef SH2_THREADS
+// wait for the other sh2 in the dispatcher. This isn't translated code, hence
+// the other sh2 may change the drc cache meanwhile. The state can't be changed
+// by the other sh2 while this one is running, see p32x_sh2_par_enter.
+static void dr_par_enter(SH2 *sh2)
+{
+  sh2->state &= ~SH2_IN_DRC;
+  p32x_sh2_par_enter(sh2, sh2_cycles_done_m68k(sh2));
+}
+
+static void dr_par_leave(SH2 *sh2)
+{
+  p32x_sh2_par_leave(sh2);
+  sh2->state |= SH2_IN_DRC;
+}
+#endif
+
+// the translation cache is shared if the sh2s are running in parallel
+static void REGPARM(2) *sh2_translate_par(SH2 *sh2, int tcache_id)
+{
+#ifdef SH2_THREADS
+  void *block;
+
+  if (unlikely(p32x_par_active)) {
+    dr_par_enter(sh2);
+    // the other sh2 may have translated this while this one was waiting
+    block = dr_lookup_block(sh2->pc, sh2, &tcache_id);
+    if (block == NULL && P32X_PAR_DRC_SAFE(sh2))
+      block = sh2_translate(sh2, tcache_id);
+    dr_par_leave(sh2);
+    if (block != NULL)
+      return block;
+    // the other sh2 is stopped inside a block, interpret up to the next branch
+    jit.miss[sh2->is_slave] = 1;
+    return sh2_drc_exit_async;
+  }
+#endif
+  // background jobs only in serial mode, the worker uses the drc data alone
+  if ((PicoIn.opt & POPT_EN_DRC_ASYNC) && dr_jit_start(sh2, tcache_id))
+    return sh2_drc_exit_async;
+  return sh2_translate(sh2, tcache_id);
+}
+#endif
+
+#if SUPERBLOCKS
+// called from a hot block entry, replace its block by a superblock
+static void REGPARM(1) sh2_translate_hot(SH2 *sh2)
+{
+  struct block_entry *be;
+  struct block_desc *bd;
+  u32 pc = sh2->pc;
+  int tcache_id;
+
+#ifdef SH2_THREADS
+  if (unlikely(p32x_par_active))
+    dr_par_enter(sh2);
+#endif
+  be = dr_get_entry(pc, sh2->is_slave, &tcache_id);
+  if (be != NULL && !P32X_PAR_DRC_SAFE(sh2))
+    be->entry_count = 0; // the other sh2 is inside a block, retry later
+  else if (be != NULL && !be->block->superblock) {
+    bd = be->block;
+    dbg(2, "== %csh2 hot block %08x, making superblock", sh2->is_slave ? 's' : 'm',
+      bd->addr);
+    // the old code stays valid until its space is reused. A failed translation
+    // will reactivate it on the next lookup.
+    dr_rm_block_entry(bd, tcache_id, 0, 0);
+    sh2->pc = bd->addr;
+    superblock_request = 1;
+    if (sh2_translate(sh2, tcache_id) != NULL)
+      drc_stats[tcache_id].superblocks++;
+    superblock_request = 0;
+    sh2->pc = pc;
+
+    // don't return to the old code via the branch cache
+#if BRANCH_CACHE
+    if (tcache_id)
+      memset32(sh2s[tcache_id-1].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
+    else {
+      memset32(sh2s[0].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
+      memset32(sh2s[1].branch_cache, -1, sizeof(sh2s[1].branch_cache)/4);
+    }
+#endif
+  }
+#ifdef SH2_THREADS
+  if (unlikely(p32x_par_active))
+    dr_par_leave(sh2);
+#endif
+}
+#endif
+
 static void sh2_generate_utils(void)
 {
   int arg0, arg1, arg2, arg3, sr, tmp, tmp2;
@@ -5351,6 +5920,14 @@ static void sh2_generate_utils(void)
   emith_sh2_drc_exit();
   emith_flush();
 
+#ifdef USE_THREADS
+  // sh2_drc_exit_async(void), leave while translating in the background
+  sh2_drc_exit_async = (void *)tcache_ptr;
+  emith_ctx_read(arg0, SHR_PC * 4);
+  emith_jump(sh2_drc_exit);
+  emith_flush();
+#endif
+
   // sh2_drc_dispatcher(u32 pc)
   sh2_drc_dispatcher = (void *)tcache_ptr;
   emith_ctx_write(arg0, SHR_PC * 4);
@@ -5393,9 +5970,24 @@ static void sh2_generate_utils(void)
   emith_jump_reg_c(DCOND_NE, RET_REG);
   EMITH_SJMP_END(DCOND_EQ);
   // lookup failed, call sh2_translate()
+#ifdef SH2_THREADS
+  // SR has the time for waiting on the other sh2, which may end the slice
+  sr = rcache_get_reg(SHR_SR, RC_GR_READ, NULL);
+  emith_ctx_write(sr, SHR_SR * 4);
+  rcache_invalidate();
+#endif
   emith_move_r_r_ptr(arg0, CONTEXT_REG);
   emith_ctx_read(arg1, offsetof(SH2, drc_tmp)); // tcache_id
+#ifdef USE_THREADS
+  emith_abicall(sh2_translate_par);
+#ifdef SH2_THREADS
+  sr = rcache_get_reg(SHR_SR, RC_GR_WRITE, NULL);
+  emith_ctx_read(sr, SHR_SR * 4);
+  rcache_flush();
+#endif
+#else
   emith_abicall(sh2_translate);
+#endif
   emith_tst_r_r_ptr(RET_REG, RET_REG);
   EMITH_SJMP_START(DCOND_EQ);
   emith_jump_reg_c(DCOND_NE, RET_REG);
@@ -5404,6 +5996,27 @@ static void sh2_generate_utils(void)
   emith_abicall(dr_failure);
   emith_flush();
 
+#if SUPERBLOCKS
+  // sh2_drc_dispatcher_hot(u32 pc)
+  sh2_drc_dispatcher_hot = (void *)tcache_ptr;
+  emith_ctx_write(arg0, SHR_PC * 4);
+#ifdef SH2_THREADS
+  sr = rcache_get_reg(SHR_SR, RC_GR_READ, NULL);
+  emith_ctx_write(sr, SHR_SR * 4);
+  rcache_invalidate();
+#endif
+  emith_move_r_r_ptr(arg0, CONTEXT_REG);
+  emith_abicall(sh2_translate_hot);
+#ifdef SH2_THREADS
+  sr = rcache_get_reg(SHR_SR, RC_GR_WRITE, NULL);
+  emith_ctx_read(sr, SHR_SR * 4);
+  rcache_flush();
+#endif
+  emith_ctx_read(arg0, SHR_PC * 4);
+  emith_jump(sh2_drc_dispatcher);
+  emith_flush();
+#endif
+
 #if CALL_STACK
   // pc = sh2_drc_dispatcher_call(u32 pc)
   sh2_drc_dispatcher_call = (void *)tcache_ptr;
@@ -5579,6 +6192,12 @@ static void sh2_generate_utils(void)
   host_dasm_new_symbol(sh2_drc_dispatcher_return);
 #endif
   host_dasm_new_symbol(sh2_drc_exit);
+#ifdef USE_THREADS
+  host_dasm_new_symbol(sh2_drc_exit_async);
+#endif
+#if SUPERBLOCKS
+  host_dasm_new_symbol(sh2_drc_dispatcher_hot);
+#endif
   host_dasm_new_symbol(sh2_drc_test_irq);
   host_dasm_new_symbol(sh2_drc_write8);
   host_dasm_new_symbol(sh2_drc_write16);
@@ -5662,20 +6281,149 @@ static void sh2_smc_rm_blocks(u32 a, int len, int tcache_id, u32 shift)
 #endif
 }
 
+#ifdef USE_THREADS
+// queue a write check while the jit worker owns the drc data
+static void dr_jit_wcheck(u32 a, unsigned len, int tcache_id)
+{
+  if (jit.wcheck_count < JIT_WCHECKS) {
+    jit.wcheck[jit.wcheck_count].a = a;
+    jit.wcheck[jit.wcheck_count].len = len;
+    jit.wcheck[jit.wcheck_count].tcache_id = tcache_id;
+    jit.wcheck_count++;
+  } else
+    jit.wcheck_flush |= 1 << tcache_id;
+}
+
+// take back the drc data from the jit worker after a job is done
+static void dr_jit_collect(void)
+{
+  static u8 op_flags[BLOCK_INSN_LIMIT];
+  struct block_desc *bd;
+  u32 end_pc, base_lit, end_lit;
+  int tcid, i;
+
+  // the code may have been written while it was translated. Writes are only
+  // checked against blocks already marked in the drcblk maps, hence verify
+  // the blocks added by the job
+  for (tcid = 0; tcid < TCACHE_BUFFERS; tcid++) {
+    for (i = jit.blk_next[tcid]; i != block_ring[tcid].next;
+          i = (i+1) % block_ring[tcid].size) {
+      bd = &block_tables[tcid][i];
+      if (!bd->active || (!jit.illegal && dr_is_rom(bd->addr)))
+        continue;
+      if (jit.illegal || scan_block(bd->addr, jit.sh2.is_slave, op_flags,
+            &end_pc, &base_lit, &end_lit) != bd->crc)
+        dr_rm_block_entry(bd, tcid, 0, 0);
+    }
+  }
+
+  for (i = 0; i < jit.wcheck_count; i++) {
+    tcid = jit.wcheck[i].tcache_id;
+    sh2_smc_rm_blocks(jit.wcheck[i].a, jit.wcheck[i].len, tcid,
+      tcid ? SH2_DRCBLK_DA_SHIFT : SH2_DRCBLK_RAM_SHIFT);
+  }
+  for (tcid = 0; tcid < TCACHE_BUFFERS; tcid++)
+    if (jit.wcheck_flush & (1 << tcid))
+      dr_flush_tcache(tcid);
+  jit.wcheck_count = jit.wcheck_flush = 0;
+
+  pico_atomic_store(&jit.state, JIT_IDLE);
+}
+
+// wait for a pending job before accessing the drc data
+static void dr_jit_wait(void)
+{
+  if (!jit.running)
+    return;
+
+  pico_mutex_lock(&jit.lock);
+  while (jit.state == JIT_BUSY)
+    pico_cond_wait(&jit.cond, &jit.lock);
+  pico_mutex_unlock(&jit.lock);
+  if (jit.state == JIT_DONE)
+    dr_jit_collect();
+}
+
+// interpret at most n of the cycles left in the slice
+static int dr_interpret(SH2 *sh2, int cycles, int n)
+{
+  int rest = (cycles > n ? cycles - n : 0);
+  unsigned int timeslice;
+
+  sh2->cycles_timeslice -= rest;
+  timeslice = sh2->cycles_timeslice;
+  cycles = sh2_execute_interpreter(sh2, cycles - rest);
+  // the rest is dropped if sh2_end_run was called
+  if (sh2->cycles_timeslice == timeslice) {
+    sh2->cycles_timeslice += rest;
+    cycles += rest;
+  }
+  return cycles;
+}
+
+// run the interpreter while the jit worker is busy, and after it is done up
+// to the next branch to continue in the drc at a block entry.
+static int dr_jit_interpret(SH2 *sh2, int cycles)
+{
+  while (cycles > 0) {
+    if (pico_atomic_load(&jit.state) == JIT_DONE) {
+      P32X_PAR_ENTER(sh2, sh2->m68krcycles_done +
+        C_SH2_TO_M68K(sh2, sh2->cycles_timeslice - cycles));
+      if (jit.state == JIT_DONE && P32X_PAR_DRC_SAFE(sh2))
+        dr_jit_collect();
+      P32X_PAR_LEAVE(sh2);
+    }
+    if (pico_atomic_load(&jit.state) != JIT_IDLE)
+      cycles = dr_interpret(sh2, cycles, JIT_INTERPRET);
+    else {
+      cycles = dr_interpret(sh2, cycles, 1);
+      if (sh2->pc != sh2->ppc + 2)
+        break;
+    }
+  }
+  return cycles;
+}
+#endif
+
+// SR has been saved by the memory handler. Removing blocks doesn't reuse their
+// code space, hence this is safe while the other sh2 is inside a block.
 void sh2_drc_wcheck_ram(u32 a, unsigned len, SH2 *sh2)
 {
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
+#ifdef USE_THREADS
+  if (pico_atomic_load(&jit.state) != JIT_IDLE)
+    dr_jit_wcheck(a, len, 0);
+  else
+#endif
   sh2_smc_rm_blocks(a, len, 0, SH2_DRCBLK_RAM_SHIFT);
+  P32X_PAR_LEAVE(sh2);
 }
 
 void sh2_drc_wcheck_da(u32 a, unsigned len, SH2 *sh2)
 {
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
+#ifdef USE_THREADS
+  if (pico_atomic_load(&jit.state) != JIT_IDLE)
+    dr_jit_wcheck(a, len, 1 + sh2->is_slave);
+  else
+#endif
   sh2_smc_rm_blocks(a, len, 1 + sh2->is_slave, SH2_DRCBLK_DA_SHIFT);
+  P32X_PAR_LEAVE(sh2);
 }
 
 int sh2_execute_drc(SH2 *sh2c, int cycles)
 {
   int ret_cycles;
 
+#ifdef USE_THREADS
+  // the drc data belongs to the jit worker while a job is pending
+  if (unlikely(pico_atomic_load(&jit.state) != JIT_IDLE)) {
+    cycles = dr_jit_interpret(sh2c, cycles);
+    if (cycles <= 0)
+      return cycles;
+  }
+again:
+#endif
   // cycles are kept in SHR_SR unused bits (upper 20)
   // bit11 contains T saved for delay slot
   // others are usual SH2 flags
@@ -5691,6 +6439,17 @@ int sh2_execute_drc(SH2 *sh2c, int cycles)
 
   // TODO: irq cycles
   ret_cycles = (int32_t)sh2c->sr >> 12;
+#ifdef USE_THREADS
+  if (jit.miss[sh2c->is_slave]) {
+    // left the drc for a background translation, interpret meanwhile
+    jit.miss[sh2c->is_slave] = 0;
+    sh2c->sr &= 0x3f3;
+    cycles = dr_jit_interpret(sh2c, ret_cycles+1);
+    if (cycles > 0)
+      goto again;
+    return cycles;
+  }
+#endif
   if (ret_cycles >= 0)
     dbg(1, "warning: drc returned with cycles: %d, pc %08x", ret_cycles, sh2c->pc);
 #if (DRC_DEBUG & 8)
@@ -5860,8 +6619,194 @@ static void bcache_stats(void)
 #endif
 }
 
+#if BLOCK_HOTNESS
+static void dr_rescue_hot_blocks(SH2 *sh2, int tcache_id)
+{
+  static u8 op_flags[BLOCK_INSN_LIMIT];
+  static int rescuing;
+  struct hot_block hb[HOT_QUEUE_SIZE];
+  u32 pc = sh2->pc, end_pc, base_lit, end_lit;
+  int tcid, i, n;
+
+  // blocks translated here may cause more hot blocks to be evicted. Those are
+  // left in the queue for the next translation.
+  if (rescuing)
+    return;
+  n = hot_queue_count[tcache_id];
+  memcpy(hb, hot_queue[tcache_id], n * sizeof(hb[0]));
+  hot_queue_count[tcache_id] = 0;
+
+  rescuing = 1;
+  for (i = 0; i < n; i++) {
+    // the requested block is translated by the caller anyway
+    if (hb[i].addr == pc || dr_get_entry(hb[i].addr, sh2->is_slave, &tcid))
+      continue;
+    if (dr_get_pc_base(hb[i].addr, sh2) == (void *)-1)
+      continue;
+    // skip if the code has been overwritten in the meantime
+    if (scan_block(hb[i].addr, sh2->is_slave, op_flags, &end_pc,
+          &base_lit, &end_lit) != hb[i].crc)
+      continue;
+
+    sh2->pc = hb[i].addr;
+    sh2_translate(sh2, tcache_id);
+    drc_stats[tcache_id].rescues++;
+  }
+  sh2->pc = pc;
+  rescuing = 0;
+}
+#endif
+
+void sh2_drc_get_stats(int tcache_id, struct sh2_drc_stats *st)
+{
+  *st = drc_stats[tcache_id];
+  st->tcache_size = tcache_ring[tcache_id].size;
+  st->tcache_used = tcache_ring[tcache_id].used;
+  st->blocks = block_ring[tcache_id].used;
+}
+
+// block profile: list of translated ROM and BIOS block start addresses, which
+// is saved at the end of a session and used to pretranslate these blocks at
+// the start of the next one. RAM blocks aren't kept since RAM contents at
+// startup differ from those at translation time.
+#define DRC_PROFILE_MAGIC   "SH2P"
+#define DRC_PROFILE_VERSION 1
+#define DRC_PROFILE_MAX     (16*1024)
+
+struct drc_profile_hdr {
+  char magic[4];
+  u32 version;              // DRC_PROFILE_VERSION
+  u32 key;                  // ROM checksum
+  u32 count;                // number of PCs following, bit 0 set for ssh2
+};
+
+static u32 *profile_pcs;
+static int profile_count;
+
+static int dr_profile_block(struct block_desc *bd)
+{
+  return bd->addr && bd->entry_count && bd->active &&
+    (dr_is_rom(bd->addr) || (bd->addr & ~0xfff) == 0);
+}
+
+int sh2_drc_profile_save(const char *fname, u32 key)
+{
+  struct drc_profile_hdr hdr = { DRC_PROFILE_MAGIC, DRC_PROFILE_VERSION, key, 0 };
+  struct block_desc *bd;
+  int tcache_id, b, i, n;
+  FILE *f;
+  u32 pc;
+
+#ifdef USE_THREADS
+  dr_jit_wait();
+#endif
+  f = fopen(fname, "wb");
+  if (f == NULL)
+    return -1;
+  if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+    goto fail;
+
+  // blocks from the last profile which have been evicted in the meantime
+  for (i = 0; i < profile_count && hdr.count < DRC_PROFILE_MAX; i++) {
+    pc = profile_pcs[i];
+    if (dr_get_entry(pc & ~1, pc & 1, &tcache_id) != NULL)
+      continue;
+    if (fwrite(&pc, sizeof(pc), 1, f) != 1)
+      goto fail;
+    hdr.count++;
+  }
+
+  // currently translated blocks
+  for (b = 0; b < TCACHE_BUFFERS; b++) {
+    for (n = 0, i = block_ring[b].first; n < block_ring[b].used;
+          n++, i = (i+1) % block_ring[b].size) {
+      bd = &block_tables[b][i];
+      if (!dr_profile_block(bd) || hdr.count >= DRC_PROFILE_MAX)
+        continue;
+      pc = bd->addr | (b == 2);
+      if (fwrite(&pc, sizeof(pc), 1, f) != 1)
+        goto fail;
+      hdr.count++;
+    }
+  }
+
+  if (fseek(f, 0, SEEK_SET) || fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+    goto fail;
+  fclose(f);
+  dbg(1, "drc profile: saved %d blocks", hdr.count);
+  return 0;
+
+fail:
+  fclose(f);
+  remove(fname);
+  return -1;
+}
+
+int sh2_drc_profile_load(const char *fname, u32 key)
+{
+  struct drc_profile_hdr hdr;
+  u32 *pcs;
+  FILE *f;
+
+  f = fopen(fname, "rb");
+  if (f == NULL)
+    return -1;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, DRC_PROFILE_MAGIC, sizeof(hdr.magic)) ||
+      hdr.version != DRC_PROFILE_VERSION || hdr.key != key ||
+      hdr.count > DRC_PROFILE_MAX)
+    goto fail;
+
+  pcs = realloc(profile_pcs, (hdr.count + 1) * sizeof(*pcs));
+  if (pcs == NULL)
+    goto fail;
+  profile_pcs = pcs;
+  profile_count = fread(pcs, sizeof(*pcs), hdr.count, f);
+  fclose(f);
+
+  elprintf(EL_STATUS, "drc profile: %d blocks", profile_count);
+  sh2_drc_profile_apply();
+  return 0;
+
+fail:
+  fclose(f);
+  return -1;
+}
+
+void sh2_drc_profile_apply(void)
+{
+  int tcache_id, i;
+  SH2 *sh2;
+  u32 pc, opc;
+
+#ifdef USE_THREADS
+  dr_jit_wait();
+#endif
+  for (i = 0; i < profile_count; i++) {
+    pc = profile_pcs[i];
+    sh2 = &sh2s[pc & 1];
+    pc &= ~1;
+
+    if (dr_get_entry(pc, sh2->is_slave, &tcache_id) != NULL)
+      continue;
+    // leave room for the blocks which are actually running
+    if (tcache_ring[tcache_id].used > tcache_ring[tcache_id].size / 2)
+      continue;
+    if (dr_get_pc_base(pc, sh2) == (void *)-1)
+      continue;
+
+    opc = sh2->pc;
+    sh2->pc = pc;
+    sh2_translate(sh2, tcache_id);
+    sh2->pc = opc;
+  }
+}
+
 void sh2_drc_flush_all(void)
 {
+#ifdef USE_THREADS
+  dr_jit_wait();
+#endif
   backtrace();
   state_dump();
   block_stats();
@@ -5886,6 +6831,13 @@ int sh2_drc_init(SH2 *sh2)
 
   if (block_tables[0] == NULL)
   {
+    drc_cmn_init();
+    tcache_scale = (tcache_size + DRC_TCACHE_SIZE-1) / DRC_TCACHE_SIZE;
+    tcache_sizes[1] = tcache_sizes[2] = tcache_size / 32;
+    tcache_sizes[0] = tcache_size - tcache_sizes[1] - tcache_sizes[2];
+    memset(drc_stats, 0, sizeof(drc_stats));
+    memset(evict_map, 0, sizeof(evict_map));
+
     for (i = 0; i < TCACHE_BUFFERS; i++) {
       block_tables[i] = calloc(BLOCK_MAX_COUNT(i), sizeof(*block_tables[0]));
       if (block_tables[i] == NULL)
@@ -5925,12 +6877,12 @@ int sh2_drc_init(SH2 *sh2)
     memset(block_link_pool_counts, 0, sizeof(block_link_pool_counts));
     memset(blink_free, 0, sizeof(blink_free));
 
-    drc_cmn_init();
     rcache_init();
 
     tcache_ptr = tcache;
     sh2_generate_utils();
     host_instructions_updated(tcache, tcache_ptr, 1);
+    drc_perf_add(tcache, tcache_ptr - tcache, "sh2_drc_utils");
     emith_update_cache();
 
     i = tcache_ptr - tcache;
@@ -5970,6 +6922,9 @@ void sh2_drc_finish(SH2 *sh2)
   if (block_tables[0] == NULL)
     return;
 
+#ifdef USE_THREADS
+  dr_jit_stop();
+#endif
 #if (DRC_DEBUG & (256|512))
    if (trace[0]) fclose(trace[0]);
    if (trace[1]) fclose(trace[1]);
@@ -6032,6 +6987,11 @@ void sh2_drc_finish(SH2 *sh2)
   block_list_pool = NULL;
   blist_free = NULL;
 
+  if (profile_pcs != NULL)
+    free(profile_pcs);
+  profile_pcs = NULL;
+  profile_count = 0;
+
   drc_cmn_cleanup();
 }
 
@@ -3,12 +3,29 @@ void sh2_drc_finish(SH2 *sh2);
 void sh2_drc_wcheck_ram(u32 a, unsigned len, SH2 *sh2);
 void sh2_drc_wcheck_da(u32 a, unsigned len, SH2 *sh2);
 
+// per tcache_id statistics
+struct sh2_drc_stats {
+  unsigned int tcache_size;    // bytes in translation cache
+  unsigned int tcache_used;    // ..of which are in use
+  unsigned int blocks;         // blocks currently in cache
+  unsigned int translations;   // blocks translated since init
+  unsigned int retranslations; // ..of which had been evicted before
+  unsigned int evictions;      // blocks deleted to make room for new ones
+  unsigned int rescues;        // evicted hot blocks translated again at once
+  unsigned int superblocks;    // hot blocks translated again as superblock
+};
+
 #ifdef DRC_SH2
 void sh2_drc_mem_setup(SH2 *sh2);
 void sh2_drc_flush_all(void);
+int  sh2_drc_profile_save(const char *fname, u32 key);
+int  sh2_drc_profile_load(const char *fname, u32 key);
+void sh2_drc_profile_apply(void);
+void sh2_drc_get_stats(int tcache_id, struct sh2_drc_stats *st);
 #else
 #define sh2_drc_mem_setup(x)
 #define sh2_drc_flush_all()
+#define sh2_drc_profile_apply()
 #define sh2_drc_frame()
 #endif
 
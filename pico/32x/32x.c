@@ -8,12 +8,30 @@
 #include "../pico_int.h"
 #include "../sound/ym2612.h"
 #include <cpu/sh2/compiler.h>
+#include <zlib.h>
+#ifdef SH2_THREADS
+#include "../pico_thread.h"
+static void par_stop(void);
+#endif
 
 struct Pico32x Pico32x;
 SH2 sh2s[2];
 
 #define SH2_IDLE_STATES (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL|SH2_STATE_SLEEP)
 
+#define STEP_LS 24
+#define STEP_N 528 // at least one line (488)
+#define STEP_MIN (STEP_N/2) // adaptive slice length range
+#define STEP_MAX (STEP_N*4)
+
+struct p32x_sync_stats p32x_sync_stats = { STEP_N }, p32x_sync_stats_last;
+
+static void p32x_sync_stats_reset(void)
+{
+  memset(&p32x_sync_stats, 0, sizeof(p32x_sync_stats));
+  p32x_sync_stats.step = STEP_N;
+}
+
 static int REGPARM(2) sh2_irq_cb(SH2 *sh2, int level)
 {
   if (sh2->pending_irl > sh2->pending_int_irq) {
@@ -53,6 +71,7 @@ void p32x_update_irls(SH2 *active_sh2, unsigned int m68k_cycles)
   if (irqs >= 0x02)     slvl += 2, irqs >>= 1;
 
   mrun = sh2_irl_irq(&msh2, mlvl, msh2.state & SH2_STATE_RUN);
+  p32x_sync_stats_add(irqs, mrun);
   if (mrun) {
     p32x_sh2_poll_event(&msh2, SH2_IDLE_STATES, m68k_cycles);
     if (msh2.state & SH2_STATE_RUN)
@@ -60,6 +79,7 @@ void p32x_update_irls(SH2 *active_sh2, unsigned int m68k_cycles)
   }
 
   srun = sh2_irl_irq(&ssh2, slvl, ssh2.state & SH2_STATE_RUN);
+  p32x_sync_stats_add(irqs, srun);
   if (srun) {
     p32x_sh2_poll_event(&ssh2, SH2_IDLE_STATES, m68k_cycles);
     if (ssh2.state & SH2_STATE_RUN)
@@ -111,6 +131,8 @@ void Pico32xStartup(void)
   p32x_pwm_ctl_changed();
   p32x_timers_recalc();
 
+  p32x_sync_stats_reset();
+
   Pico32x.sh2_regs[0] = P32XS2_ADEN;
   if (Pico.m.ncart_in)
     Pico32x.sh2_regs[0] |= P32XS_nCART;
@@ -195,6 +217,9 @@ void PicoPower32x(void)
 
 void PicoUnload32x(void)
 {
+#ifdef SH2_THREADS
+  par_stop();
+#endif
   sh2_finish(&msh2);
   sh2_finish(&ssh2);
   if (Pico32xMem != NULL)
@@ -293,16 +318,15 @@ static void hint_event(unsigned int now)
   p32x_schedule_hint(NULL, now);
 }
 
-typedef void (event_cb)(unsigned int now);
-
 /* times are in m68k (7.6MHz) cycles */
 unsigned int p32x_event_times[P32X_EVENT_COUNT];
-static unsigned int event_time_next;
-static event_cb *p32x_event_cbs[P32X_EVENT_COUNT] = {
+static event_cb * const p32x_event_cbs[P32X_EVENT_COUNT] = {
   p32x_pwm_irq_event, // P32X_EVENT_PWM
   fillend_event,      // P32X_EVENT_FILLEND
   hint_event,         // P32X_EVENT_HINT
 };
+static struct event_queue p32x_events =
+  EVENT_QUEUE(p32x_event_times, p32x_event_cbs, P32X_EVENT_COUNT, EL_32X, "32x");
 
 // schedule event at some time 'after', in m68k clocks
 void p32x_event_schedule(unsigned int now, enum p32x_event event, int after)
@@ -312,10 +336,7 @@ void p32x_event_schedule(unsigned int now, enum p32x_event event, int after)
   when = (now + after) | 1;
 
   elprintf(EL_32X, "32x: new event #%u %u->%u", event, now, when);
-  p32x_event_times[event] = when;
-
-  if (event_time_next == 0 || CYCLES_GT(event_time_next, when))
-    event_time_next = when;
+  evq_set(&p32x_events, event, when);
 }
 
 void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after)
@@ -325,7 +346,7 @@ void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after)
 
   p32x_event_schedule(now, event, after);
 
-  left_to_next = C_M68K_TO_SH2(sh2, (int)(event_time_next - now));
+  left_to_next = C_M68K_TO_SH2(sh2, (int)(p32x_events.next - now));
   if (sh2_cycles_left(sh2) > left_to_next) {
     if (left_to_next < 1)
       left_to_next = 0;
@@ -335,41 +356,7 @@ void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after)
 
 static void p32x_run_events(unsigned int until)
 {
-  int oldest, oldest_diff, time;
-  int i, diff;
-
-  while (1) {
-    oldest = -1, oldest_diff = 0x7fffffff;
-
-    for (i = 0; i < P32X_EVENT_COUNT; i++) {
-      if (p32x_event_times[i]) {
-        diff = p32x_event_times[i] - until;
-        if (diff < oldest_diff) {
-          oldest_diff = diff;
-          oldest = i;
-        }
-      }
-    }
-
-    if (oldest_diff <= 0) {
-      time = p32x_event_times[oldest];
-      p32x_event_times[oldest] = 0;
-      elprintf(EL_32X, "32x: run event #%d %u", oldest, time);
-      p32x_event_cbs[oldest](time);
-    }
-    else if (oldest_diff < 0x7fffffff) {
-      event_time_next = p32x_event_times[oldest];
-      break;
-    }
-    else {
-      event_time_next = 0;
-      break;
-    }
-  }
-
-  if (oldest != -1)
-    elprintf(EL_32X, "32x: next event #%d at %u",
-      oldest, event_time_next);
+  evq_run(&p32x_events, until);
 }
 
 static void run_sh2(SH2 *sh2, unsigned int m68k_cycles)
@@ -401,9 +388,15 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
 
   if (osh2->state & SH2_STATE_RUN)
     return;
+#ifdef SH2_THREADS
+  // the other sh2 is running on its own thread
+  if (p32x_par_active)
+    return;
+#endif
 
+  // not worth it if the other sh2 is less than about 3/8 of a slice behind
   m68k_cycles = m68k_target - osh2->m68krcycles_done;
-  if (m68k_cycles < 200)
+  if (m68k_cycles < (int)(p32x_sync_stats.step * 3 / 8))
     return;
 
   if (osh2->state & SH2_IDLE_STATES) {
@@ -413,12 +406,13 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
 
   elprintf_sh2(osh2, EL_32X, "sync to %u %d",
     m68k_target, m68k_cycles);
+  p32x_sync_stats.others++;
 
   run_sh2(osh2, m68k_cycles);
 
   // there might be new event to schedule current sh2 to
-  if (event_time_next) {
-    left_to_event = C_M68K_TO_SH2(sh2, (int)(event_time_next - m68k_target));
+  if (p32x_events.next) {
+    left_to_event = C_M68K_TO_SH2(sh2, (int)(p32x_events.next - m68k_target));
     if (sh2_cycles_left(sh2) > left_to_event) {
       if (left_to_event < 1)
         left_to_event = 0;
@@ -427,11 +421,10 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
   }
 }
 
-#define STEP_LS 24
-#define STEP_N 528 // at least one line (488)
-
+#ifndef SH2_THREADS
 #define sync_sh2s_normal p32x_sync_sh2s
 //#define sync_sh2s_lockstep p32x_sync_sh2s
+#endif
 
 /* most timing is in 68k clock */
 void sync_sh2s_normal(unsigned int m68k_target)
@@ -440,6 +433,7 @@ void sync_sh2s_normal(unsigned int m68k_target)
   int cycles;
 
   elprintf(EL_32X, "sh2 sync to %u", m68k_target);
+  p32x_sync_stats.syncs++;
 
   if (!(Pico32x.regs[0] & P32XS_nRES)) {
     msh2.m68krcycles_done = ssh2.m68krcycles_done = m68k_target;
@@ -454,17 +448,18 @@ void sync_sh2s_normal(unsigned int m68k_target)
   pprof_start(m68k);
   while (CYCLES_GT(m68k_target, now))
   {
-    if (event_time_next && CYCLES_GE(now, event_time_next))
+    if (p32x_events.next && CYCLES_GE(now, p32x_events.next))
       p32x_run_events(now);
 
     target = m68k_target;
-    if (event_time_next && CYCLES_GT(target, event_time_next))
-      target = event_time_next;
+    if (p32x_events.next && CYCLES_GT(target, p32x_events.next))
+      target = p32x_events.next;
     while (CYCLES_GT(target, now))
     {
       next = target;
-      if (CYCLES_GT(target, now + STEP_N))
-        next = now + STEP_N;
+      if (CYCLES_GT(target, now + p32x_sync_stats.step))
+        next = now + p32x_sync_stats.step;
+      p32x_sync_stats.slices++;
       elprintf(EL_32X, "sh2 exec to %u %d,%d/%d, flags %x", next,
         next - msh2.m68krcycles_done, next - ssh2.m68krcycles_done,
         m68k_target - now, Pico32x.emu_flags);
@@ -475,8 +470,8 @@ void sync_sh2s_normal(unsigned int m68k_target)
         if (cycles > 0) {
           run_sh2(&ssh2, cycles > 20U ? cycles : 20U);
 
-          if (event_time_next && CYCLES_GT(target, event_time_next))
-            target = event_time_next;
+          if (p32x_events.next && CYCLES_GT(target, p32x_events.next))
+            target = p32x_events.next;
           if (CYCLES_GT(next, target))
             next = target;
         }
@@ -489,8 +484,8 @@ void sync_sh2s_normal(unsigned int m68k_target)
         if (cycles > 0) {
           run_sh2(&msh2, cycles > 20U ? cycles : 20U);
 
-          if (event_time_next && CYCLES_GT(target, event_time_next))
-            target = event_time_next;
+          if (p32x_events.next && CYCLES_GT(target, p32x_events.next))
+            target = p32x_events.next;
           if (CYCLES_GT(next, target))
             next = target;
         }
@@ -551,6 +546,382 @@ void sync_sh2s_lockstep(unsigned int m68k_target)
   }
 }
 
+#ifdef SH2_THREADS
+/* Parallel execution: msh2 runs on the emulator thread, ssh2 on a worker.
+ * Both run freely until accessing shared state (32X regs, VDP, poll fifo,
+ * irqs, DRC cache...) between p32x_sh2_par_enter/leave. This waits until the
+ * other sh2 is stopped at a later point in time, so that shared accesses are
+ * done in the same order as with serial execution. Everything else (events,
+ * timers, 68k side) is done on the emulator thread in between slices.
+ * SDRAM isn't ordered that way; if both write the same SDRAM page in a slice,
+ * the rest of the sync and the next few are done in serial mode. */
+enum { PAR_RUN, PAR_WAIT, PAR_PARKED, PAR_IDLE, PAR_DONE };
+
+#define PAR_SPIN      4000 // spins before sleeping on the condition variable
+#define PAR_MAX_WAITS 64   // if more accesses waited for the other sh2 in a
+#define PAR_BACKOFF   16   // sync, do that many syncs in serial mode
+#define PAR_PAGE_SHIFT 8   // SDRAM write tracking granularity
+
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;
+  pico_cond_t cond;
+  unsigned int seq;     // bumped on every state change
+  unsigned int slice;   // bumped for every slice given to the worker
+  unsigned int target;  // end of slice in 68k cycles
+  int state[2];         // PAR_*
+  unsigned int time[2]; // 68k cycles when the state was entered
+  int waits, backoff;
+  int running, failed, quit;
+  int conflict;         // both sh2s wrote the same SDRAM page in this slice
+  unsigned char sdram_pages[0x40000 >> PAR_PAGE_SHIFT]; // bit n: sh2 n wrote
+} par;
+
+int p32x_par_active;
+static PICO_THREAD_LOCAL int par_depth;
+
+// tell the other thread about a state change. Must hold par.lock
+static void par_notify(void)
+{
+  pico_atomic_store(&par.seq, par.seq + 1);
+  pico_cond_broadcast(&par.cond);
+}
+
+// wait for a state change of the other thread. Must hold par.lock
+static void par_wait(void)
+{
+  unsigned int seq = par.seq;
+  int i;
+
+  // the other thread is usually quick, avoid the sleep/wakeup latency
+  pico_mutex_unlock(&par.lock);
+  for (i = 0; i < PAR_SPIN && pico_atomic_load(&par.seq) == seq; i++)
+    pico_cpu_relax();
+  pico_mutex_lock(&par.lock);
+
+  while (par.seq == seq)
+    pico_cond_wait(&par.cond, &par.lock);
+}
+
+// run sh2 up to the slice end or the next event. Must hold par.lock
+static void par_run_cpu(SH2 *sh2)
+{
+  int i = sh2->is_slave, o = i ^ 1;
+  unsigned int now, target, next;
+
+  for (;;) {
+    if (pico_atomic_load(&par.conflict))
+      break;
+    now = sh2->m68krcycles_done;
+    target = par.target;
+    if (p32x_events.next && CYCLES_GT(target, p32x_events.next))
+      target = p32x_events.next;
+    if (!CYCLES_GT(target, now))
+      break;
+
+    if (sh2->state & SH2_IDLE_STATES) {
+      // nothing to do until the other sh2 wakes this one up
+      if (par.state[o] == PAR_IDLE || par.state[o] == PAR_DONE)
+        break;
+      par.state[i] = PAR_IDLE;
+      par_notify();
+      par_wait();
+      continue;
+    }
+    if (par.state[o] == PAR_WAIT && !CYCLES_GT(par.time[o], now)) {
+      // other sh2 is waiting to access shared state at an earlier time
+      par.state[i] = PAR_PARKED;
+      par.time[i] = now;
+      par_notify();
+      par_wait();
+      continue;
+    }
+
+    next = target;
+    if (CYCLES_GT(next, now + p32x_sync_stats.step))
+      next = now + p32x_sync_stats.step;
+    if (i == 0)
+      p32x_sync_stats.slices++;
+    if (par.state[o] == PAR_WAIT && CYCLES_GT(next, par.time[o]))
+      next = par.time[o];
+    par.state[i] = PAR_RUN;
+    par.time[i] = now;
+    pico_mutex_unlock(&par.lock);
+
+    run_sh2(sh2, next - now > 20U ? next - now : 20U);
+
+    pico_mutex_lock(&par.lock);
+  }
+
+  par.state[i] = PAR_DONE;
+  par.time[i] = sh2->m68krcycles_done;
+  par_notify();
+}
+
+void p32x_sh2_par_enter(SH2 *sh2, unsigned int m68k_cycles)
+{
+  int i = sh2->is_slave, o = i ^ 1;
+  int waited = 0;
+
+  // recursion, or access to the other sh2 while holding the lock
+  if (par_depth++)
+    return;
+
+  pico_mutex_lock(&par.lock);
+  par.state[i] = PAR_WAIT;
+  par.time[i] = m68k_cycles;
+  par_notify();
+
+  // wait until the other sh2 can't access shared state before this one
+  for (;;) {
+    int so = par.state[o];
+    if (so == PAR_IDLE || so == PAR_DONE)
+      break;
+    if (so == PAR_PARKED && !CYCLES_GT(m68k_cycles, par.time[o]))
+      break;
+    if (so == PAR_WAIT && (CYCLES_GT(par.time[o], m68k_cycles) ||
+                           (par.time[o] == m68k_cycles && i == 0)))
+      break;
+    waited = 1;
+    par_wait();
+  }
+  par.waits += waited;
+  // keep the lock until p32x_sh2_par_leave
+}
+
+void p32x_sh2_par_leave(SH2 *sh2)
+{
+  int i = sh2->is_slave, o = i ^ 1;
+
+  if (--par_depth)
+    return;
+
+  // don't keep the other sh2 waiting longer than necessary
+  if (par.state[o] == PAR_WAIT && !CYCLES_GT(par.time[o], par.time[i]))
+    sh2_end_run(sh2, 0);
+
+  par.state[i] = PAR_RUN;
+  par_notify();
+  pico_mutex_unlock(&par.lock);
+}
+
+// Changing the drc cache needs the other sh2 to be outside of translated
+// code. It may be stopped in a memory handler halfway through a block, whose
+// code would be overwritten by a new translation. Call between enter/leave.
+int p32x_sh2_par_drc_safe(SH2 *sh2)
+{
+  int o = sh2->is_slave ^ 1;
+
+  // waiting in the dispatcher clears SH2_IN_DRC, see dr_par_enter
+  return par.state[o] != PAR_WAIT || !(sh2->other_sh2->state & SH2_IN_DRC);
+}
+
+// SDRAM write in parallel mode, returns 1 if the other sh2 has written the
+// same page in this slice. The order of such writes can't be known, so the
+// slice is ended and the rest of the sync is done serially.
+int p32x_sh2_par_sdram_write(SH2 *sh2, unsigned int a)
+{
+  unsigned char *page = &par.sdram_pages[(a & 0x3ffff) >> PAR_PAGE_SHIFT];
+  int bit = 1 << sh2->is_slave;
+
+  // the sh2 writing the page second sees the first one's bit
+  if (pico_atomic_load(page) & bit)
+    return 0;
+  if (!(pico_atomic_or(page, bit) & (bit ^ 3)))
+    return 0;
+
+  pico_atomic_store(&par.conflict, 1);
+  return 1;
+}
+
+static void *par_worker(void *arg)
+{
+  unsigned int slice = 0;
+
+  pico_mutex_lock(&par.lock);
+  for (;;) {
+    while (par.slice == slice && !par.quit)
+      par_wait();
+    if (par.quit)
+      break;
+    slice = par.slice;
+    par_run_cpu(&ssh2);
+  }
+  pico_mutex_unlock(&par.lock);
+  return NULL;
+}
+
+static int par_start(void)
+{
+  if (par.running)
+    return 1;
+  if (par.failed)
+    return 0;
+
+  pico_mutex_init(&par.lock);
+  pico_cond_init(&par.cond);
+  par.slice = par.quit = 0;
+  par.state[0] = par.state[1] = PAR_DONE;
+  if (pico_thread_create(&par.thread, par_worker, NULL) != 0) {
+    elprintf(EL_STATUS, "32x: failed to create sh2 thread");
+    pico_cond_destroy(&par.cond);
+    pico_mutex_destroy(&par.lock);
+    par.failed = 1;
+    return 0;
+  }
+  par.running = 1;
+  return 1;
+}
+
+static void par_stop(void)
+{
+  if (!par.running)
+    return;
+
+  pico_mutex_lock(&par.lock);
+  par.quit = 1;
+  par_notify();
+  pico_mutex_unlock(&par.lock);
+  pico_thread_join(par.thread);
+
+  pico_cond_destroy(&par.cond);
+  pico_mutex_destroy(&par.lock);
+  par.running = 0;
+}
+
+// run both sh2s up to target in parallel
+static void par_run_slice(unsigned int target)
+{
+  pico_mutex_lock(&par.lock);
+  par.target = target;
+  par.state[0] = par.state[1] = PAR_RUN;
+  par.time[0] = msh2.m68krcycles_done;
+  par.time[1] = ssh2.m68krcycles_done;
+  par.slice++;
+  par.conflict = 0;
+  memset(par.sdram_pages, 0, sizeof(par.sdram_pages));
+  // the drc calls the SDRAM write handlers for the tracking
+  msh2.state |= SH2_PAR_SDRAM;
+  ssh2.state |= SH2_PAR_SDRAM;
+  p32x_par_active = 1;
+  par_notify();
+
+  par_run_cpu(&msh2);
+  while (par.state[1] != PAR_DONE)
+    par_wait();
+
+  p32x_par_active = 0;
+  msh2.state &= ~SH2_PAR_SDRAM;
+  ssh2.state &= ~SH2_PAR_SDRAM;
+  pico_mutex_unlock(&par.lock);
+}
+
+static void sync_sh2s_parallel(unsigned int m68k_target)
+{
+  unsigned int now, target, timer_cycles;
+
+  elprintf(EL_32X, "sh2 parallel sync to %u", m68k_target);
+  p32x_sync_stats.syncs++;
+
+  now = msh2.m68krcycles_done;
+  if (CYCLES_GT(now, ssh2.m68krcycles_done))
+    now = ssh2.m68krcycles_done;
+  timer_cycles = now;
+
+  while (CYCLES_GT(m68k_target, now))
+  {
+    if (p32x_events.next && CYCLES_GE(now, p32x_events.next))
+      p32x_run_events(now);
+
+    target = m68k_target;
+    if (p32x_events.next && CYCLES_GT(target, p32x_events.next))
+      target = p32x_events.next;
+    par_run_slice(target);
+
+    // sh2s stop early if an event has been scheduled in the slice
+    now = target;
+    if (p32x_events.next && CYCLES_GT(now, p32x_events.next))
+      now = p32x_events.next;
+    if (CYCLES_GT(now, msh2.m68krcycles_done)) {
+      if (!(msh2.state & SH2_IDLE_STATES))
+        now = msh2.m68krcycles_done;
+    }
+    if (CYCLES_GT(now, ssh2.m68krcycles_done)) {
+      if (!(ssh2.state & SH2_IDLE_STATES))
+        now = ssh2.m68krcycles_done;
+    }
+
+    if  (msh2.state & SH2_TIMER_RUN)
+      p32x_timer_do(&msh2, now - timer_cycles);
+    if  (ssh2.state & SH2_TIMER_RUN)
+      p32x_timer_do(&ssh2, now - timer_cycles);
+    timer_cycles = now;
+
+    // SDRAM shared by both sh2s, see p32x_sh2_par_sdram_write
+    if (par.conflict) {
+      elprintf(EL_32X, "sh2 parallel: SDRAM write conflict at %u", now);
+      par.backoff = PAR_BACKOFF;
+      par.waits = 0;
+      sync_sh2s_normal(m68k_target);
+      return;
+    }
+  }
+
+  // advance idle CPUs
+  if (msh2.state & SH2_IDLE_STATES) {
+    if (CYCLES_GT(m68k_target, msh2.m68krcycles_done))
+      msh2.m68krcycles_done = m68k_target;
+  }
+  if (ssh2.state & SH2_IDLE_STATES) {
+    if (CYCLES_GT(m68k_target, ssh2.m68krcycles_done))
+      ssh2.m68krcycles_done = m68k_target;
+  }
+
+  // too much contention, the serial mode is faster for a while
+  if (par.waits > PAR_MAX_WAITS)
+    par.backoff = PAR_BACKOFF;
+  par.waits = 0;
+
+  // everyone is in sync now
+  Pico32x.comm_dirty = 0;
+}
+
+void p32x_sync_sh2s(unsigned int m68k_target)
+{
+  // only worth the thread handover if both sh2s have something to do
+  if ((PicoIn.opt & POPT_EN_SH2_THREADS) && (Pico32x.regs[0] & P32XS_nRES) &&
+      !((msh2.state | ssh2.state) & SH2_IDLE_STATES) && par_start())
+  {
+    if (par.backoff == 0) {
+      sync_sh2s_parallel(m68k_target);
+      return;
+    }
+    par.backoff--;
+  }
+  sync_sh2s_normal(m68k_target);
+}
+#endif
+
+// Adapt the slice length to the sh2 communication rate in the last frame.
+// Many events per slice need shorter slices to keep the CPUs close, while
+// rare events allow longer slices with less overhead for switching CPUs.
+static void p32x_sync_adapt(void)
+{
+  struct p32x_sync_stats *st = &p32x_sync_stats;
+  unsigned int events = st->comm + st->polls + st->irqs;
+
+  if (st->slices >= 16) {
+    if (events > st->slices && st->step > STEP_MIN)
+      st->step /= 2;
+    else if (events * 4 < st->slices && st->step < STEP_MAX)
+      st->step *= 2;
+  }
+
+  p32x_sync_stats_last = *st;
+  memset(st, 0, sizeof(*st));
+  st->step = p32x_sync_stats_last.step;
+}
+
 #define CPUS_RUN(m68k_cycles) do { \
   if (PicoIn.AHW & PAHW_MCD) \
     pcd_run_cpus(m68k_cycles); \
@@ -589,6 +960,7 @@ void PicoFrame32x(void)
 
   PicoFrameStart();
   PicoFrameHints();
+  p32x_sync_adapt();
 
   elprintf(EL_32X, "poll: %02x %02x %02x",
     Pico32x.emu_flags & 3, msh2.state, ssh2.state);
@@ -610,16 +982,51 @@ void Pico32xSetClocks(int msh2_hz, int ssh2_hz)
   }
 }
 
+// SH2 DRC block profile, keyed by ROM checksum
+#ifdef DRC_SH2
+static u32 p32x_rom_key(void)
+{
+  // only used as a key, so no need to unbyteswap like for rom_crc32
+  return crc32(0, Pico.rom, Pico.romsize);
+}
+#endif
+
+int Pico32xDrcProfileLoad(const char *fname)
+{
+#ifdef DRC_SH2
+  if ((PicoIn.AHW & PAHW_32X) && (PicoIn.opt & POPT_EN_DRC))
+    return sh2_drc_profile_load(fname, p32x_rom_key());
+#endif
+  return -1;
+}
+
+int Pico32xDrcProfileSave(const char *fname)
+{
+#ifdef DRC_SH2
+  if ((PicoIn.AHW & PAHW_32X) && (PicoIn.opt & POPT_EN_DRC))
+    return sh2_drc_profile_save(fname, p32x_rom_key());
+#endif
+  return -1;
+}
+
 void Pico32xStateLoaded(int is_early)
 {
+  unsigned int step;
+
   if (is_early) {
     Pico32xMemStateLoaded();
     return;
   }
 
   sh2s[0].m68krcycles_done = sh2s[1].m68krcycles_done = SekCyclesDone();
+  // continue with the saved slice length, older states have none
+  step = p32x_sync_stats.step;
+  p32x_sync_stats_reset();
+  if (STEP_MIN <= step && step <= STEP_MAX)
+    p32x_sync_stats.step = step;
   p32x_update_irls(NULL, SekCyclesDone());
   p32x_pwm_state_loaded();
+  evq_reload(&p32x_events);
   p32x_run_events(SekCyclesDone());
 }
 
@@ -43,6 +43,9 @@
 #include "../memory.h"
 
 #include <cpu/sh2/compiler.h>
+#ifdef SH2_THREADS
+#include "../pico_thread.h"
+#endif
 DRC_DECLARE_SR;
 
 static const char str_mars[] = "MARS";
@@ -61,90 +64,85 @@ static void (*m68k_write16_io)(u32 a, u32 d);
 // poll detection
 #define POLL_THRESHOLD 5
 
-static struct {
-  u32 addr1, addr2, cycles;
-  int cnt;
-} m68k_poll;
+static struct poll_det m68k_poll;
 
 static int m68k_poll_detect(u32 a, u32 cycles, u32 flags)
 {
-  int ret = 0;
-  // support polling on 2 addresses - seen in Wolfenstein
-  int match = (a - m68k_poll.addr1 <= 2 || a - m68k_poll.addr2 <= 2);
+  // support polling on 2 addresses - seen in Wolfenstein.
+  // detect split 32bit access by same cycle count, and ignore those
+  int cnt = poll_detect(&m68k_poll, a, cycles, 1, 64);
 
-  if (match && cycles - m68k_poll.cycles <= 64 && !SekNotPolling)
-  {
-    // detect split 32bit access by same cycle count, and ignore those
-    if (cycles != m68k_poll.cycles && ++m68k_poll.cnt >= POLL_THRESHOLD) {
-      if (!(Pico32x.emu_flags & flags)) {
-        elprintf(EL_32X, "m68k poll addr %08x, cyc %u",
-          a, cycles - m68k_poll.cycles);
-      }
-      Pico32x.emu_flags |= flags;
-      ret = 1;
-    }
-  }
-  else {
+  if (SekNotPolling || cnt == 0) {
     // reset poll state in case of restart by interrupt
     Pico32x.emu_flags &= ~(P32XF_68KCPOLL|P32XF_68KVPOLL);
     SekSetStop(0);
-    m68k_poll.cnt = 0;
-    if (!match) {
-      m68k_poll.addr2 = m68k_poll.addr1;
-      m68k_poll.addr1 = a;
-    }
+    poll_reset(&m68k_poll);
     SekNotPolling = 0;
+    return 0;
   }
-  m68k_poll.cycles = cycles;
 
-  return ret;
+  if (cnt >= POLL_THRESHOLD) {
+    if (!(Pico32x.emu_flags & flags)) {
+      elprintf(EL_32X, "m68k poll addr %08x, cnt %d", a, cnt);
+    }
+    Pico32x.emu_flags |= flags;
+    return 1;
+  }
+  return 0;
 }
 
-void p32x_m68k_poll_event(u32 flags)
+// a was written by an sh2, wake the 68k if it polls there
+void p32x_m68k_poll_event(u32 a, u32 flags)
 {
+  if (!poll_watching(&m68k_poll, a))
+    return;
   if (Pico32x.emu_flags & flags) {
     elprintf(EL_32X, "m68k poll %02x -> %02x", Pico32x.emu_flags,
       Pico32x.emu_flags & ~flags);
     Pico32x.emu_flags &= ~flags;
     SekSetStop(0);
   }
-  m68k_poll.addr1 = m68k_poll.addr2 = m68k_poll.cnt = 0;
+  poll_clear(&m68k_poll);
 }
 
 void NOINLINE p32x_sh2_poll_detect(u32 a, SH2 *sh2, u32 flags, int maxcnt)
 {
   u32 cycles_done = sh2_cycles_done_t(sh2);
-  u32 cycles_diff = cycles_done - sh2->poll_cycles;
+  int cnt;
+
+  if (sh2->state & (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL)) {
+    // already waiting, keep the watched address for the wakeup event
+    sh2->poll.cycles = cycles_done;
+    sh2_set_polling(sh2);
+    return;
+  }
 
   // reading 2 consecutive 16bit values is probably a 32bit access. detect this
   // by checking address (max 2 bytes away) and cycles (max 2 cycles later).
   // no polling if more than 20 cycles have passed since last detect call.
-  if (a - sh2->poll_addr <= 2 && CYCLES_GE(20, cycles_diff)) {
-    if (!sh2_not_polling(sh2) && CYCLES_GT(cycles_diff, 2) &&
-                ++sh2->poll_cnt >= maxcnt) {
-      if (!(sh2->state & flags))
-        elprintf_sh2(sh2, EL_32X, "state: %02x->%02x",
-          sh2->state, sh2->state | flags);
-
-      sh2->state |= flags;
-      sh2_end_run(sh2, 0);
-      pevt_log_sh2(sh2, EVT_POLL_START);
+  if (sh2_not_polling(sh2)) {
+    // something else was done meanwhile, this access doesn't count
+    cnt = sh2->poll.cnt;
+    if (poll_detect(&sh2->poll, a, cycles_done, 3, 20))
+      sh2->poll.cnt = cnt;
+  } else if (poll_detect(&sh2->poll, a, cycles_done, 3, 20) >= maxcnt) {
+    elprintf_sh2(sh2, EL_32X, "state: %02x->%02x",
+      sh2->state, sh2->state | flags);
+    p32x_sync_stats_add(polls, 1);
+
+    sh2->state |= flags;
+    sh2_end_run(sh2, 0);
+    pevt_log_sh2(sh2, EVT_POLL_START);
 #ifdef DRC_SH2
-      // mark this as an address used for polling if SDRAM
-      if ((a & 0xc6000000) == 0x06000000) {
-        unsigned char *p = sh2->p_drcblk_ram;
-        p[(a & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] |= 0x80;
-        // mark next word too to enable poll fifo for 32bit access
-        p[((a+2) & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] |= 0x80;
-      }
-#endif
+    // mark this as an address used for polling if SDRAM
+    if ((a & 0xc6000000) == 0x06000000) {
+      unsigned char *p = sh2->p_drcblk_ram;
+      p[(a & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] |= 0x80;
+      // mark next word too to enable poll fifo for 32bit access
+      p[((a+2) & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] |= 0x80;
     }
+#endif
   }
-  else if (!(sh2->state & (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL))) {
-    sh2->poll_cnt = 0;
-    sh2->poll_addr = a;
-  }
-  sh2->poll_cycles = cycles_done;
   sh2_set_polling(sh2);
 }
 
@@ -162,14 +160,29 @@ void NOINLINE p32x_sh2_poll_event(SH2 *sh2, u32 flags, u32 m68k_cycles)
   }
 
   if (!(sh2->state & (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL)))
-    sh2->poll_addr = sh2->poll_cycles = sh2->poll_cnt = 0;
+    poll_clear(&sh2->poll);
+}
+
+// a was written by another cpu, wake the sh2 if it polls there
+static void p32x_sh2_poll_wake(SH2 *sh2, u32 a, u32 flags, u32 m68k_cycles)
+{
+  if (poll_watching(&sh2->poll, a))
+    p32x_sh2_poll_event(sh2, flags, m68k_cycles);
 }
 
+// poll tracker key of an address read by a drc poll loop. SDRAM is keyed
+// without the cache area bits and mirrors, like the writes waking it.
+#define SDRAM_POLL_KEY(a) (0x06000000 | ((a) & 0x3ffff))
+#define SH2_POLL_KEY(a) \
+  (((a) & 0xc6000000) == 0x06000000 ? SDRAM_POLL_KEY(a) : (a))
+
 static NOINLINE void sh2s_sync_on_read(SH2 *sh2, unsigned cycles)
 {
-  if (sh2->poll_cnt != 0)
+  if (sh2->poll.cnt != 0)
     return;
 
+  p32x_sync_stats_add(comm, 1);
+
   if (p32x_sh2_ready(sh2->other_sh2, cycles-250))
     p32x_sync_other_sh2(sh2, cycles);
 }
@@ -270,6 +283,7 @@ u32 REGPARM(3) p32x_sh2_poll_memory16(u32 a, u32 d, SH2 *sh2)
   unsigned int cycles;
 
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
   // is this a synchronisation address?
   if(p[(a & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] & 0x80) {
     cycles = sh2_cycles_done_m68k(sh2);
@@ -278,8 +292,9 @@ u32 REGPARM(3) p32x_sh2_poll_memory16(u32 a, u32 d, SH2 *sh2)
     d = (s16)sh2_poll_read(a, d, cycles, sh2);
   }
 
-  p32x_sh2_poll_detect(a, sh2, SH2_STATE_RPOLL, 5);
+  p32x_sh2_poll_detect(SH2_POLL_KEY(a), sh2, SH2_STATE_RPOLL, 5);
 
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
   return d;
 }
@@ -290,6 +305,7 @@ u32 REGPARM(3) p32x_sh2_poll_memory32(u32 a, u32 d, SH2 *sh2)
   unsigned int cycles;
 
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
   // is this a synchronisation address?
   if(p[(a & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT] & 0x80) {
     cycles = sh2_cycles_done_m68k(sh2);
@@ -299,8 +315,9 @@ u32 REGPARM(3) p32x_sh2_poll_memory32(u32 a, u32 d, SH2 *sh2)
         ((u16)sh2_poll_read(a+2, d, cycles, sh2));
   }
 
-  p32x_sh2_poll_detect(a, sh2, SH2_STATE_RPOLL, 5);
+  p32x_sh2_poll_detect(SH2_POLL_KEY(a), sh2, SH2_STATE_RPOLL, 5);
 
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
   return d;
 }
@@ -405,7 +422,7 @@ static void p32x_reg_write8(u32 a, u32 d)
   a &= 0x3f;
 
   // for things like bset on comm port
-  m68k_poll.cnt = 0;
+  poll_reset(&m68k_poll);
 
   switch (a) {
     case 0x00: // adapter ctl: FM writable
@@ -520,8 +537,8 @@ static void p32x_reg_write8(u32 a, u32 d)
 
         if (REG8IN16(r, a) != (u8)d) {
           REG8IN16(r, a) = d;
-          p32x_sh2_poll_event(&sh2s[0], SH2_STATE_CPOLL, cycles);
-          p32x_sh2_poll_event(&sh2s[1], SH2_STATE_CPOLL, cycles);
+          p32x_sh2_poll_wake(&sh2s[0], a & ~1, SH2_STATE_CPOLL, cycles);
+          p32x_sh2_poll_wake(&sh2s[1], a & ~1, SH2_STATE_CPOLL, cycles);
           sh2_poll_write(a & ~1, r[a / 2], cycles, NULL);
         }
       }
@@ -573,7 +590,7 @@ static void p32x_reg_write16(u32 a, u32 d)
   a &= 0x3e;
 
   // for things like bset on comm port
-  m68k_poll.cnt = 0;
+  poll_reset(&m68k_poll);
 
   switch (a/2) {
     case 0x00/2: // adapter ctl
@@ -618,8 +635,8 @@ static void p32x_reg_write16(u32 a, u32 d)
 
         if (r[a / 2] != (u16)d) {
           r[a / 2] = d;
-          p32x_sh2_poll_event(&sh2s[0], SH2_STATE_CPOLL, cycles);
-          p32x_sh2_poll_event(&sh2s[1], SH2_STATE_CPOLL, cycles);
+          p32x_sh2_poll_wake(&sh2s[0], a, SH2_STATE_CPOLL, cycles);
+          p32x_sh2_poll_wake(&sh2s[1], a, SH2_STATE_CPOLL, cycles);
           sh2_poll_write(a, (u16)d, cycles, NULL);
         }
       }
@@ -800,7 +817,7 @@ static void p32x_sh2reg_write8(u32 a, u32 d, SH2 *sh2)
   u32 old;
 
   a &= 0x3f;
-  sh2->poll_cnt = 0;
+  poll_reset(&sh2->poll);
 
   switch (a) {
     case 0x00: // FM
@@ -830,7 +847,7 @@ static void p32x_sh2reg_write8(u32 a, u32 d, SH2 *sh2)
       if (Pico32x.sh2_regs[4 / 2] != (u8)d) {
         unsigned int cycles = sh2_cycles_done_m68k(sh2);
         Pico32x.sh2_regs[4 / 2] = d;
-        p32x_sh2_poll_event(sh2->other_sh2, SH2_STATE_CPOLL, cycles);
+        p32x_sh2_poll_wake(sh2->other_sh2, a & ~1, SH2_STATE_CPOLL, cycles);
         if (p32x_sh2_ready(sh2->other_sh2, cycles+8))
           sh2_end_run(sh2, 4);
         sh2_poll_write(a & ~1, d, cycles, sh2);
@@ -856,8 +873,9 @@ static void p32x_sh2reg_write8(u32 a, u32 d, SH2 *sh2)
         unsigned int cycles = sh2_cycles_done_m68k(sh2);
 
         REG8IN16(r, a) = d;
-        p32x_m68k_poll_event(P32XF_68KCPOLL);
-        p32x_sh2_poll_event(sh2->other_sh2, SH2_STATE_CPOLL, cycles);
+        p32x_sync_stats_add(comm, 1);
+        p32x_m68k_poll_event(a & ~1, P32XF_68KCPOLL);
+        p32x_sh2_poll_wake(sh2->other_sh2, a & ~1, SH2_STATE_CPOLL, cycles);
         if (p32x_sh2_ready(sh2->other_sh2, cycles+8))
           sh2_end_run(sh2, 0);
         sh2_poll_write(a & ~1, r[a / 2], cycles, sh2);
@@ -912,7 +930,7 @@ static void p32x_sh2reg_write16(u32 a, u32 d, SH2 *sh2)
 {
   a &= 0x3e;
 
-  sh2->poll_cnt = 0;
+  poll_reset(&sh2->poll);
 
   switch (a/2) {
     case 0x00/2: // FM
@@ -949,8 +967,9 @@ static void p32x_sh2reg_write16(u32 a, u32 d, SH2 *sh2)
         unsigned int cycles = sh2_cycles_done_m68k(sh2);
 
         Pico32x.regs[a / 2] = d;
-        p32x_m68k_poll_event(P32XF_68KCPOLL);
-        p32x_sh2_poll_event(sh2->other_sh2, SH2_STATE_CPOLL, cycles);
+        p32x_sync_stats_add(comm, 1);
+        p32x_m68k_poll_event(a, P32XF_68KCPOLL);
+        p32x_sh2_poll_wake(sh2->other_sh2, a, SH2_STATE_CPOLL, cycles);
         if (p32x_sh2_ready(sh2->other_sh2, cycles+8))
           sh2_end_run(sh2, 0);
         sh2_poll_write(a, d, cycles, sh2);
@@ -1450,6 +1469,7 @@ static u32 REGPARM(2) sh2_read8_cs0(u32 a, SH2 *sh2)
 {
   u32 d = 0;
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
 
   sh2_burn_cycles(sh2, 1*2);
 
@@ -1488,6 +1508,7 @@ out_16to8:
 out:
   elprintf_sh2(sh2, EL_32X, "r8  [%08x]       %02x @%06x",
     a, d, sh2_pc(sh2));
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
   return (s8)d;
 }
@@ -1512,6 +1533,7 @@ static u32 REGPARM(2) sh2_read16_cs0(u32 a, SH2 *sh2)
 {
   u32 d = 0;
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
 
   sh2_burn_cycles(sh2, 1*2);
 
@@ -1544,6 +1566,7 @@ out:
   elprintf_sh2(sh2, EL_32X, "r16 [%08x]     %04x @%06x",
     a, d, sh2_pc(sh2));
 out_noprint:
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
   return (s16)d;
 }
@@ -1584,37 +1607,62 @@ static void sh2_sdram_poll(u32 a, u32 d, SH2 *sh2)
 
   DRC_SAVE_SR(sh2);
   cycles = sh2_cycles_done_m68k(sh2);
+  P32X_PAR_ENTER(sh2, cycles);
   sh2_poll_write(a, d, cycles, sh2);
-  p32x_sh2_poll_event(sh2->other_sh2, SH2_STATE_RPOLL, cycles);
+  // the drcblk marks only select writes to addresses polled at some time
+  p32x_sh2_poll_wake(sh2->other_sh2, SDRAM_POLL_KEY(a), SH2_STATE_RPOLL,
+    cycles);
   if (p32x_sh2_ready(sh2->other_sh2, cycles+8))
     sh2_end_run(sh2, 0);
+  P32X_PAR_LEAVE(sh2);
+  DRC_RESTORE_SR(sh2);
+}
+
+// the drc checks may wait for the other sh2, which needs the current time
+static void sh2_sdram_wcheck(u32 a, unsigned len, SH2 *sh2)
+{
+  DRC_SAVE_SR(sh2);
+  sh2_drc_wcheck_ram(a, len, sh2);
   DRC_RESTORE_SR(sh2);
 }
 
 void NOINLINE sh2_sdram_checks(u32 a, u32 d, SH2 *sh2, u32 t)
 {
   if (t & 0x80)         sh2_sdram_poll(a, d, sh2);
-  if (t & 0x7f)         sh2_drc_wcheck_ram(a, 2, sh2);
+  if (t & 0x7f)         sh2_sdram_wcheck(a, 2, sh2);
 }
 
 void NOINLINE sh2_sdram_checks_l(u32 a, u32 d, SH2 *sh2, u32 t)
 {
   if (t & 0x000080)     sh2_sdram_poll(a, d>>16, sh2);
   if (t & 0x800000)     sh2_sdram_poll(a+2, d, sh2);
-  if (t & ~0x800080)    sh2_drc_wcheck_ram(a, 4, sh2);
+  if (t & ~0x800080)    sh2_sdram_wcheck(a, 4, sh2);
 }
 
-#ifndef _ASM_32X_MEMORY_C
-static void sh2_da_checks(u32 a, u32 t, SH2 *sh2)
+void NOINLINE sh2_da_checks(u32 a, unsigned len, SH2 *sh2)
 {
-  sh2_drc_wcheck_da(a, 2, sh2);
+  DRC_SAVE_SR(sh2);
+  sh2_drc_wcheck_da(a, len, sh2);
+  DRC_RESTORE_SR(sh2);
 }
+#endif
 
-static void sh2_da_checks_l(u32 a, u32 t, SH2 *sh2)
+#ifdef SH2_THREADS
+// parallel mode: if the other sh2 wrote this SDRAM page in the slice too, the
+// order of the writes isn't known. Stop here, the slice is ended.
+static NOINLINE void sh2_sdram_par_write(u32 a, SH2 *sh2)
 {
-  sh2_drc_wcheck_da(a, 4, sh2);
+  if (p32x_sh2_par_sdram_write(sh2, a)) {
+    DRC_SAVE_SR(sh2);
+    sh2_end_run(sh2, 0);
+    DRC_RESTORE_SR(sh2);
+  }
 }
-#endif
+#define SDRAM_PAR_WRITE(a, sh2) \
+  if (unlikely(p32x_par_active)) \
+    sh2_sdram_par_write(a, sh2)
+#else
+#define SDRAM_PAR_WRITE(a, sh2)
 #endif
 
 static void REGPARM(3) sh2_write_ignore(u32 a, u32 d, SH2 *sh2)
@@ -1631,6 +1679,7 @@ static void REGPARM(3) sh2_write8_unmapped(u32 a, u32 d, SH2 *sh2)
 static void REGPARM(3) sh2_write8_cs0(u32 a, u32 d, SH2 *sh2)
 {
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
   elprintf_sh2(sh2, EL_32X, "w8  [%08x]       %02x @%06x",
     a, d & 0xff, sh2_pc(sh2));
 
@@ -1641,13 +1690,13 @@ static void REGPARM(3) sh2_write8_cs0(u32 a, u32 d, SH2 *sh2)
 
   if (Pico32x.regs[0] & P32XS_FM) {
     if ((a & 0x3fff0) == 0x4100) {
-      sh2->poll_cnt = 0;
+      poll_reset(&sh2->poll);
       p32x_vdp_write8(a, d);
       goto out;
     }
 
     if ((a & 0x3fe00) == 0x4200) {
-      sh2->poll_cnt = 0;
+      poll_reset(&sh2->poll);
       ((u8 *)Pico32xMem->pal)[MEM_BE2(a & 0x1ff)] = d;
       Pico32x.dirty_pal = 1;
       goto out;
@@ -1656,6 +1705,7 @@ static void REGPARM(3) sh2_write8_cs0(u32 a, u32 d, SH2 *sh2)
 
   sh2_write8_unmapped(a, d, sh2);
 out:
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
 }
 
@@ -1679,6 +1729,7 @@ static void REGPARM(3) sh2_write8_sdram(u32 a, u32 d, SH2 *sh2)
   if (t)
     sh2_sdram_checks(a & ~1, ((u16 *)sh2->p_sdram)[a1 / 2], sh2, t);
 #endif
+  SDRAM_PAR_WRITE(a, sh2);
 }
 
 static void REGPARM(3) sh2_write8_da(u32 a, u32 d, SH2 *sh2)
@@ -1689,7 +1740,7 @@ static void REGPARM(3) sh2_write8_da(u32 a, u32 d, SH2 *sh2)
   u8 *p = sh2->p_drcblk_da;
   u32 t = p[a1 >> SH2_DRCBLK_DA_SHIFT];
   if (t)
-    sh2_da_checks(a, t, sh2);
+    sh2_da_checks(a, 2, sh2);
 #endif
 }
 #endif
@@ -1721,6 +1772,7 @@ static void REGPARM(3) sh2_write16_unmapped(u32 a, u32 d, SH2 *sh2)
 static void REGPARM(3) sh2_write16_cs0(u32 a, u32 d, SH2 *sh2)
 {
   DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
   if (((EL_LOGMASK & EL_PWM) || (a & 0x30) != 0x30)) // hide PWM
     elprintf_sh2(sh2, EL_32X, "w16 [%08x]     %04x @%06x",
       a, d & 0xffff, sh2_pc(sh2));
@@ -1732,13 +1784,13 @@ static void REGPARM(3) sh2_write16_cs0(u32 a, u32 d, SH2 *sh2)
 
   if (Pico32x.regs[0] & P32XS_FM) {
     if ((a & 0x3fff0) == 0x4100) {
-      sh2->poll_cnt = 0;
+      poll_reset(&sh2->poll);
       p32x_vdp_write16(a, d, sh2);
       goto out;
     }
 
     if ((a & 0x3fe00) == 0x4200) {
-      sh2->poll_cnt = 0;
+      poll_reset(&sh2->poll);
       Pico32xMem->pal[(a & 0x1ff) / 2] = d;
       Pico32x.dirty_pal = 1;
       goto out;
@@ -1747,6 +1799,7 @@ static void REGPARM(3) sh2_write16_cs0(u32 a, u32 d, SH2 *sh2)
 
   sh2_write16_unmapped(a, d, sh2);
 out:
+  P32X_PAR_LEAVE(sh2);
   DRC_RESTORE_SR(sh2);
 }
 
@@ -1770,6 +1823,7 @@ static void REGPARM(3) sh2_write16_sdram(u32 a, u32 d, SH2 *sh2)
   if (t)
     sh2_sdram_checks(a, d, sh2, t);
 #endif
+  SDRAM_PAR_WRITE(a, sh2);
 }
 
 static void REGPARM(3) sh2_write16_da(u32 a, u32 d, SH2 *sh2)
@@ -1780,7 +1834,7 @@ static void REGPARM(3) sh2_write16_da(u32 a, u32 d, SH2 *sh2)
   u8 *p = sh2->p_drcblk_da;
   u32 t = p[a1 >> SH2_DRCBLK_DA_SHIFT];
   if (t)
-    sh2_da_checks(a, t, sh2);
+    sh2_da_checks(a, 2, sh2);
 #endif
 }
 #endif
@@ -1846,6 +1900,7 @@ static void REGPARM(3) sh2_write32_sdram(u32 a, u32 d, SH2 *sh2)
   if (t|(u<<16))
     sh2_sdram_checks_l(a, d, sh2, t|(u<<16));
 #endif
+  SDRAM_PAR_WRITE(a, sh2);
 }
 
 static void REGPARM(3) sh2_write32_da(u32 a, u32 d, SH2 *sh2)
@@ -1857,7 +1912,7 @@ static void REGPARM(3) sh2_write32_da(u32 a, u32 d, SH2 *sh2)
   u32 t = p[a1 >> SH2_DRCBLK_DA_SHIFT];
   u32 u = p[(a1+2) >> SH2_DRCBLK_DA_SHIFT];
   if (t|(u<<16))
-    sh2_da_checks_l(a, t|(u<<16), sh2);
+    sh2_da_checks(a, 4, sh2);
 #endif
 }
 #endif
@@ -2306,6 +2361,11 @@ void PicoMemSetup32x(void)
     return;
   }
 
+  // 2nd halves of split 32bit accesses are the same location
+  poll_init(&m68k_poll, 2, 2, 0);
+  poll_init(&msh2.poll, 1, 2, 0);
+  poll_init(&ssh2.poll, 1, 2, 0);
+
   get_bios();
 
   // cartridge area becomes unmapped
@@ -2485,13 +2545,14 @@ void Pico32xMemStateLoaded(void)
   Pico32x.dirty_pal = 1;
 
   Pico32x.emu_flags &= ~(P32XF_68KCPOLL | P32XF_68KVPOLL);
-  memset(&m68k_poll, 0, sizeof(m68k_poll));
+  poll_clear(&m68k_poll);
   msh2.state = 0;
-  msh2.poll_addr = msh2.poll_cycles = msh2.poll_cnt = 0;
+  poll_clear(&msh2.poll);
   ssh2.state = 0;
-  ssh2.poll_addr = ssh2.poll_cycles = ssh2.poll_cnt = 0;
+  poll_clear(&ssh2.poll);
 
   sh2_drc_flush_all();
+  sh2_drc_profile_apply();
 }
 
 // vim:shiftwidth=2:ts=2:expandtab
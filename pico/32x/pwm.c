@@ -6,6 +6,7 @@
  * See COPYING file in the top-level directory.
  */
 #include "../pico_int.h"
+#include "../sound/resampler.h"
 
 static struct {
   int cycles;
@@ -16,9 +17,28 @@ static struct {
   int silent;
   int irq_timer;
   int irq_state;
+  int rs_cycles;
+  int rs_idle;
   short current[2];
 } pwm;
 
+// sample rate is the sh2 clock / cycle register -> sndRate
+static struct resampler pwm_resampler;
+
+static int pwm_rate(void)
+{
+  int clk = (Pico.m.pal ? OSC_PAL : OSC_NTSC) / 7 * 3;
+
+  pwm.rs_cycles = pwm.cycles;
+  return clk / (pwm.cycles ? pwm.cycles : 0x1000);
+}
+
+void p32x_pwm_rerate(void)
+{
+  resampler_init_paced(&pwm_resampler, pwm_rate(), PicoIn.sndRate);
+  pwm.rs_idle = 1;
+}
+
 enum { PWM_IRQ_LOCKED, PWM_IRQ_STOPPED, PWM_IRQ_LOW, PWM_IRQ_HIGH };
 
 void p32x_pwm_ctl_changed(void)
@@ -29,6 +49,8 @@ void p32x_pwm_ctl_changed(void)
 
   cycles = (cycles - 1) & 0x0fff;
   pwm.cycles = cycles;
+  if (pwm.cycles != pwm.rs_cycles && PicoIn.sndRate != 0)
+    resampler_set_rate(&pwm_resampler, pwm_rate(), PicoIn.sndRate);
 
   // supposedly we should stop FIFO when xMd is 0,
   // but mars test disagrees
@@ -269,75 +291,48 @@ void p32x_pwm_write16(u32 a, unsigned int d, SH2 *sh2, unsigned int m68k_cycles)
 void p32x_pwm_update(int *buf32, int length, int stereo)
 {
   short *pwmb;
-  int step;
-  int p = 0;
+  int frames;
   int xmd;
+  int i, t;
 
   consume_fifo(NULL, SekCyclesDone());
 
   xmd = Pico32x.regs[0x30 / 2] & 0x0f;
   if (xmd == 0 || xmd == 0x06 || xmd == 0x09 || xmd == 0x0f)
     goto out; // invalid?
-  if (pwm.silent)
-    return;
+  if (pwm.silent) {
+    // run one frame of silence to play out the filter, then stay idle
+    if (pwm.rs_idle)
+      goto out;
+    pwm.rs_idle = 1;
+  }
+  else
+    pwm.rs_idle = 0;
 
-  step = (pwm.ptr << 16) / length;
+  frames = pwm.ptr;
   pwmb = Pico32xMem->pwm;
 
-  if (stereo)
-  {
-    if (xmd == 0x05) {
-      // normal
-      while (length-- > 0) {
-        *buf32++ += pwmb[0];
-        *buf32++ += pwmb[1];
-
-        p += step;
-        pwmb += (p >> 16) * 2;
-        p &= 0xffff;
-      }
-    }
-    else if (xmd == 0x0a) {
-      // channel swap
-      while (length-- > 0) {
-        *buf32++ += pwmb[1];
-        *buf32++ += pwmb[0];
-
-        p += step;
-        pwmb += (p >> 16) * 2;
-        p &= 0xffff;
-      }
-    }
-    else {
-      // mono - LMD, RMD specify dst
-      if (xmd & 0x06) // src is R
-        pwmb++;
-      if (xmd & 0x0c) // dst is R
-        buf32++;
-      while (length-- > 0) {
-        *buf32 += *pwmb;
-
-        p += step;
-        pwmb += (p >> 16) * 2;
-        p &= 0xffff;
-        buf32 += 2;
-      }
-    }
+  // route channels in place, the buffer is refilled next frame
+  if (stereo && xmd == 0x0a) {
+    // channel swap
+    for (i = 0; i < frames; i++, pwmb += 2)
+      t = pwmb[0], pwmb[0] = pwmb[1], pwmb[1] = t;
   }
-  else
-  {
-    // mostly unused
-    while (length-- > 0) {
-      *buf32++ += pwmb[0];
-
-      p += step;
-      pwmb += (p >> 16) * 2;
-      p &= 0xffff;
+  else if (stereo && xmd != 0x05) {
+    // mono - LMD, RMD specify dst
+    int src = (xmd & 0x06) ? 1 : 0; // src is R
+    int dst = (xmd & 0x0c) ? 1 : 0; // dst is R
+    for (i = 0; i < frames; i++, pwmb += 2) {
+      t = pwmb[src];
+      pwmb[dst] = t, pwmb[dst ^ 1] = 0;
     }
   }
+  // mono output mixes just the left channel, mostly unused
+
+  resampler_push(&pwm_resampler, Pico32xMem->pwm, frames);
+  resampler_mix_paced(&pwm_resampler, buf32, length, frames, 14, stereo);
 
-  elprintf(EL_PWM, "pwm_update: pwm.ptr %d, len %d, step %04x, done %d",
-    pwm.ptr, length, step, (pwmb - Pico32xMem->pwm) / 2);
+  elprintf(EL_PWM, "pwm_update: pwm.ptr %d, len %d", pwm.ptr, length);
 
 out:
   pwm.ptr = 0;
@@ -314,7 +314,7 @@ u32 REGPARM(2) sh2_peripheral_read32(u32 a, SH2 *sh2)
     a | ~0x1ff, d, sh2_pc(sh2));
   if (a == 0x18c)
     // kludge for polling COMM while polling for end of DMA
-    sh2->poll_cnt = 0;
+    poll_reset(&sh2->poll);
   else if ((a & 0x1c0) == 0x140) {
     // abused as comm area
     DRC_SAVE_SR(sh2);
@@ -359,6 +359,16 @@ static void sci_trigger(SH2 *sh2, u8 *r)
   }
 }
 
+// SCI transfers go to the other sh2
+static void sci_trigger_sync(SH2 *sh2, u8 *r)
+{
+  DRC_SAVE_SR(sh2);
+  P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
+  sci_trigger(sh2, r);
+  P32X_PAR_LEAVE(sh2);
+  DRC_RESTORE_SR(sh2);
+}
+
 void REGPARM(3) sh2_peripheral_write8(u32 a, u32 d, SH2 *sh2)
 {
   u8 *r = (void *)sh2->peri_regs;
@@ -374,7 +384,7 @@ void REGPARM(3) sh2_peripheral_write8(u32 a, u32 d, SH2 *sh2)
   case 0x002: // SCR - serial control
     if (!(PREG8(r, a) & 0x20) && (d & 0x20)) { // TE being set
       PREG8(r, a) = d;
-      sci_trigger(sh2, r);
+      sci_trigger_sync(sh2, r);
     }
     break;
   case 0x003: // TDR - transmit data
@@ -382,7 +392,7 @@ void REGPARM(3) sh2_peripheral_write8(u32 a, u32 d, SH2 *sh2)
   case 0x004: // SSR - serial status
     d = (old & (d | 0x06)) | (d & 1);
     PREG8(r, a) = d;
-    sci_trigger(sh2, r);
+    sci_trigger_sync(sh2, r);
     return;
   case 0x005: // RDR - receive data
     break;
@@ -412,8 +422,12 @@ void REGPARM(3) sh2_peripheral_write16(u32 a, u32 d, SH2 *sh2)
   // evil WDT
   if (a == 0x80) {
     if ((d & 0xff00) == 0xa500) { // WTCSR
+      DRC_SAVE_SR(sh2);
+      P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
       PREG8(r, 0x80) = d;
       p32x_timers_recalc();
+      P32X_PAR_LEAVE(sh2);
+      DRC_RESTORE_SR(sh2);
     }
     if ((d & 0xff00) == 0x5a00) // WTCNT
       PREG8(r, 0x81) = d;
@@ -481,10 +495,12 @@ void REGPARM(3) sh2_peripheral_write32(u32 a, u32 d, SH2 *sh2)
         return;
 
       DRC_SAVE_SR(sh2);
+      P32X_PAR_ENTER(sh2, sh2_cycles_done_m68k(sh2));
       if ((dmac->chan[0].chcr & (DMA_TE|DMA_DE)) == DMA_DE)
         dmac_trigger(sh2, &dmac->chan[0]);
       if ((dmac->chan[1].chcr & (DMA_TE|DMA_DE)) == DMA_DE)
         dmac_trigger(sh2, &dmac->chan[1]);
+      P32X_PAR_LEAVE(sh2);
       DRC_RESTORE_SR(sh2);
       break;
   }
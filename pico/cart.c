@@ -8,6 +8,7 @@
  */
 
 #include "pico_int.h"
+#include "pico_thread.h"
 #include <cpu/debug.h>
 
 #ifdef USE_LIBRETRO_VFS
@@ -22,6 +23,13 @@
 #include <unzip/unzip.h>
 #include <zlib.h>
 
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static int rom_alloc_size;
 static const char *rom_exts[] = { "bin", "gen", "smd", "iso", "sms", "gg", "sg" };
 
@@ -108,7 +116,61 @@ struct zip_file {
   unsigned int pos;
 };
 
+#ifdef USE_MMAP
+struct mmap_file {
+  pm_file file;
+  u8 *data;
+  size_t len;
+  size_t pos;
+};
+
+// map a plain file, reads are then copies from the page cache
+static pm_file *pm_open_mmap(const char *path, const char *ext)
+{
+  struct mmap_file *m;
+  struct stat st;
+  void *data;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0
+      || st.st_size != (size_t)st.st_size) {
+    close(fd);
+    return NULL;
+  }
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  m = calloc(1, sizeof(*m));
+  if (m == NULL) {
+    munmap(data, st.st_size);
+    return NULL;
+  }
+  m->data = data;
+  m->len = st.st_size;
+  m->file.file = m;
+  m->file.size = st.st_size;
+  m->file.type = PMT_MMAP;
+  strncpy(m->file.ext, ext, sizeof(m->file.ext) - 1);
+  return &m->file;
+}
+#endif
+
 #if defined(USE_LIBCHDR)
+#define CHD_CACHE_MB   4  // default hunk cache size
+#define CHD_READAHEAD  4  // hunks decompressed ahead of the read position
+
+struct chd_hunk {
+  int hunknum;            // -1 if empty
+  int busy;               // being decompressed
+  unsigned int used;      // LRU stamp
+  u8 *data;
+};
+
 struct chd_struct {
   pm_file file;
   int fpos;
@@ -116,9 +178,244 @@ struct chd_struct {
   chd_file *chd;
   int unitbytes;
   int hunkunits;
-  u8 *hunk;
+  int hunkcount;
+  u8 *hunk;               // data of hunknum, in cache slot cur
   int hunknum;
+  // decompressed hunks, LRU replacement
+  struct chd_hunk *cache;
+  u8 *cachemem;
+  int cachesize, cur;
+  unsigned int stamp;
+  struct pm_cache_stats stats;
+#ifdef USE_THREADS
+  // the read-ahead worker decompresses hunks ra_next..ra_end-1
+  pico_mutex_t io_lock;   // chd_file
+  int ra_next, ra_end;
+  struct chd_struct *ra_link;
+#endif
 };
+
+#ifdef USE_THREADS
+// one read-ahead worker for all open images
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;      // cache slots and read-ahead ranges of all images
+  pico_cond_t cond;
+  int running, quit;
+  struct chd_struct *list; // open images
+} chd_ra;
+
+#define chd_lock(chd)       pico_mutex_lock(&chd_ra.lock)
+#define chd_unlock(chd)     pico_mutex_unlock(&chd_ra.lock)
+#define chd_io_lock(chd)    pico_mutex_lock(&(chd)->io_lock)
+#define chd_io_unlock(chd)  pico_mutex_unlock(&(chd)->io_lock)
+#else
+#define chd_lock(chd)
+#define chd_unlock(chd)
+#define chd_io_lock(chd)
+#define chd_io_unlock(chd)
+#endif
+
+// find hunknum in the cache, else the least recently used free slot for it.
+// The slot being read from and slots being decompressed are never replaced.
+static struct chd_hunk *chd_cache_find(struct chd_struct *chd, int hunknum)
+{
+  struct chd_hunk *h, *victim = NULL;
+  int i;
+
+  for (i = 0; i < chd->cachesize; i++) {
+    h = &chd->cache[i];
+    if (h->hunknum == hunknum)
+      return h;
+    if (h->busy || i == chd->cur)
+      continue;
+    if (victim == NULL || h->used < victim->used)
+      victim = h;
+  }
+  return victim;
+}
+
+// get a hunk for reading, decompressing it if it isn't cached
+static u8 *chd_get_hunk(struct chd_struct *chd, int hunknum)
+{
+  struct chd_hunk *h;
+  int ret;
+
+  chd_lock(chd);
+  h = chd_cache_find(chd, hunknum);
+#ifdef USE_THREADS
+  while (h->hunknum == hunknum && h->busy) {
+    // being read ahead, wait for it
+    pico_cond_wait(&chd_ra.cond, &chd_ra.lock);
+    h = chd_cache_find(chd, hunknum);
+  }
+#endif
+  if (h->hunknum == hunknum)
+    chd->stats.hits++;
+  else {
+    chd->stats.misses++;
+    h->hunknum = hunknum;
+    h->busy = 1;
+    chd_unlock(chd);
+
+    chd_io_lock(chd);
+    ret = chd_read(chd->chd, hunknum, h->data);
+    chd_io_unlock(chd);
+
+    chd_lock(chd);
+    if (ret != CHDERR_NONE)
+      h->hunknum = -1;
+    h->busy = 0;
+  }
+  h->used = ++chd->stamp;
+  chd->cur = h - chd->cache;
+
+#ifdef USE_THREADS
+  if (chd_ra.running) {
+    chd->ra_next = hunknum + 1;
+    chd->ra_end = hunknum + 1 + CHD_READAHEAD;
+    if (chd->ra_end > chd->hunkcount)
+      chd->ra_end = chd->hunkcount;
+    pico_cond_broadcast(&chd_ra.cond);
+  }
+#endif
+  chd_unlock(chd);
+  return h->data;
+}
+
+#ifdef USE_THREADS
+static void *chd_worker(void *arg)
+{
+  struct chd_struct *chd;
+  struct chd_hunk *h;
+  int hunknum, ret;
+
+  pico_mutex_lock(&chd_ra.lock);
+  while (!chd_ra.quit) {
+    for (chd = chd_ra.list; chd != NULL; chd = chd->ra_link)
+      if (chd->ra_next < chd->ra_end)
+        break;
+    if (chd == NULL) {
+      pico_cond_wait(&chd_ra.cond, &chd_ra.lock);
+      continue;
+    }
+    hunknum = chd->ra_next++;
+    h = chd_cache_find(chd, hunknum);
+    if (h == NULL || h->hunknum == hunknum)
+      continue;
+    h->hunknum = hunknum;
+    h->busy = 1;
+    h->used = ++chd->stamp;
+    chd_unlock(chd);
+
+    chd_io_lock(chd);
+    ret = chd_read(chd->chd, hunknum, h->data);
+    chd_io_unlock(chd);
+
+    chd_lock(chd);
+    if (ret != CHDERR_NONE)
+      h->hunknum = -1;
+    h->busy = 0;
+    chd->stats.prefetched++;
+    pico_cond_broadcast(&chd_ra.cond);
+  }
+  pico_mutex_unlock(&chd_ra.lock);
+  return NULL;
+}
+
+// add an image to the worker, starting it with the first one
+static void chd_ra_add(struct chd_struct *chd)
+{
+  pico_mutex_init(&chd->io_lock);
+  if (chd_ra.list == NULL) {
+    pico_mutex_init(&chd_ra.lock);
+    pico_cond_init(&chd_ra.cond);
+    chd_ra.quit = 0;
+    if (pico_thread_create(&chd_ra.thread, chd_worker, NULL) == 0)
+      chd_ra.running = 1;
+    else
+      elprintf(EL_STATUS, "chd: failed to create read-ahead thread");
+  }
+  pico_mutex_lock(&chd_ra.lock);
+  chd->ra_link = chd_ra.list;
+  chd_ra.list = chd;
+  pico_mutex_unlock(&chd_ra.lock);
+}
+
+// remove an image once the worker is done with it, stopping it with the last
+static void chd_ra_remove(struct chd_struct *chd)
+{
+  struct chd_struct **pp;
+  int i;
+
+  pico_mutex_lock(&chd_ra.lock);
+  for (pp = &chd_ra.list; *pp != NULL; pp = &(*pp)->ra_link)
+    if (*pp == chd) {
+      *pp = chd->ra_link;
+      break;
+    }
+  for (i = 0; i < chd->cachesize; i++)
+    while (chd->cache[i].busy)
+      pico_cond_wait(&chd_ra.cond, &chd_ra.lock);
+  if (chd_ra.list == NULL)
+    chd_ra.quit = 1;
+  pico_cond_broadcast(&chd_ra.cond);
+  pico_mutex_unlock(&chd_ra.lock);
+
+  if (chd_ra.list == NULL) {
+    if (chd_ra.running)
+      pico_thread_join(chd_ra.thread);
+    chd_ra.running = 0;
+    pico_cond_destroy(&chd_ra.cond);
+    pico_mutex_destroy(&chd_ra.lock);
+  }
+  pico_mutex_destroy(&chd->io_lock);
+}
+#endif
+
+static int chd_cache_init(struct chd_struct *chd, int hunkbytes)
+{
+  unsigned int size = PicoIn.chdCacheSize ? PicoIn.chdCacheSize : CHD_CACHE_MB;
+  int i;
+
+  chd->cachesize = (size << 20) / hunkbytes;
+  if (chd->cachesize > chd->hunkcount)
+    chd->cachesize = chd->hunkcount;
+  if (chd->cachesize < CHD_READAHEAD + 2)
+    chd->cachesize = CHD_READAHEAD + 2;
+  chd->cache = calloc(chd->cachesize, sizeof(*chd->cache));
+  chd->cachemem = malloc(chd->cachesize * hunkbytes);
+  if (chd->cache == NULL || chd->cachemem == NULL) {
+    free(chd->cachemem);
+    free(chd->cache);
+    chd->cachemem = NULL;
+    chd->cache = NULL;
+    return -1;
+  }
+  for (i = 0; i < chd->cachesize; i++) {
+    chd->cache[i].hunknum = -1;
+    chd->cache[i].data = chd->cachemem + i * hunkbytes;
+  }
+  chd->cur = -1;
+
+#ifdef USE_THREADS
+  chd_ra_add(chd);
+#endif
+  return 0;
+}
+
+static void chd_cache_free(struct chd_struct *chd)
+{
+#ifdef USE_THREADS
+  if (chd->cache != NULL)
+    chd_ra_remove(chd);
+#endif
+  if (chd->stats.hits + chd->stats.misses)
+    elprintf(EL_STATUS, "chd: cache hits %u, misses %u, read ahead %u",
+      chd->stats.hits, chd->stats.misses, chd->stats.prefetched);
+  free(chd->cachemem);
+  free(chd->cache);
+}
 #endif
 
 pm_file *pm_open(const char *path)
@@ -267,13 +564,13 @@ cso_failed:
     chd = calloc(1, sizeof(*chd));
     if (chd == NULL)
       goto chd_failed;
-    chd->hunk = (u8 *)malloc(head->hunkbytes);
-    if (!chd->hunk)
-      goto chd_failed;
 
     chd->chd = cf;
     chd->unitbytes = head->unitbytes;
     chd->hunkunits = head->hunkbytes / head->unitbytes;
+    chd->hunkcount = head->totalhunks;
+    if (chd_cache_init(chd, head->hunkbytes))
+      goto chd_failed;
     chd->sectorsize = CD_MAX_SECTOR_DATA; // default to RAW mode
 
     chd->fpos = 0;
@@ -288,13 +585,21 @@ cso_failed:
 
 chd_failed:
     /* invalid CHD file */
-    if (chd != NULL) free(chd);
+    if (chd != NULL) {
+      chd_cache_free(chd);
+      free(chd);
+    }
     if (cf != NULL) chd_close(cf);
     return NULL;
   }
 #endif
 
   /* not a zip, treat as uncompressed file */
+#ifdef USE_MMAP
+  file = pm_open_mmap(path, ext);
+  if (file != NULL)
+    return file;
+#endif
   f = fopen(path, "rb");
   if (f == NULL) return NULL;
 
@@ -355,7 +660,7 @@ static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audi
 
       // update hunk cache if needed
       if (hunknum != chd->hunknum) {
-        chd_read(chd->chd, hunknum, chd->hunk);
+        chd->hunk = chd_get_hunk(chd, hunknum);
         chd->hunknum = hunknum;
       }
       if (len > bytes)
@@ -507,6 +812,19 @@ size_t pm_read(void *ptr, size_t bytes, pm_file *stream)
   {
     ret = _pm_read_chd(ptr, bytes, stream, 0);
   }
+#endif
+#ifdef USE_MMAP
+  else if (stream->type == PMT_MMAP)
+  {
+    struct mmap_file *m = stream->file;
+
+    ret = 0;
+    if (m->pos < m->len) {
+      ret = m->len - m->pos < bytes ? m->len - m->pos : bytes;
+      memcpy(ptr, m->data + m->pos, ret);
+      m->pos += ret;
+    }
+  }
 #endif
   else
     ret = 0;
@@ -517,7 +835,7 @@ size_t pm_read(void *ptr, size_t bytes, pm_file *stream)
 size_t pm_read_audio(void *ptr, size_t bytes, pm_file *stream)
 {
 #if !(CPU_IS_LE)
-  if (stream->type == PMT_UNCOMPRESSED)
+  if (stream->type == PMT_UNCOMPRESSED || stream->type == PMT_MMAP)
   {
     // convert little endian audio samples from WAV file
     int ret = pm_read(ptr, bytes, stream);
@@ -614,11 +932,67 @@ int pm_seek(pm_file *stream, long offset, int whence)
     }
     return chd->fpos;
   }
+#endif
+#ifdef USE_MMAP
+  else if (stream->type == PMT_MMAP)
+  {
+    struct mmap_file *m = stream->file;
+    long pos = m->pos;
+    switch (whence)
+    {
+      case SEEK_CUR: pos += offset; break;
+      case SEEK_SET: pos  = offset; break;
+      case SEEK_END: pos  = m->len + offset; break;
+    }
+    if (pos >= 0)
+      m->pos = pos;
+    return m->pos;
+  }
 #endif
   else
     return -1;
 }
 
+// the stream is about to be read sequentially from offset on
+void pm_sequential(pm_file *stream, long offset)
+{
+#ifdef USE_MMAP
+  if (stream->type == PMT_MMAP)
+  {
+    struct mmap_file *m = stream->file;
+    long page = sysconf(_SC_PAGESIZE);
+    long start = offset & ~(page - 1);
+
+    if (start < 0 || start >= m->len)
+      return;
+    madvise(m->data + start, m->len - start, MADV_SEQUENTIAL);
+    // fault in the first part now, not on the emulator's first read
+    madvise(m->data + start, m->len - start < 256*1024 ? m->len - start :
+      256*1024, MADV_WILLNEED);
+  }
+#endif
+}
+
+int pm_cache_stats(pm_file *stream, struct pm_cache_stats *st)
+{
+#if defined(USE_LIBCHDR)
+  if (stream != NULL && stream->type == PMT_CHD) {
+    struct chd_struct *chd = stream->file;
+    int i;
+
+    chd_lock(chd);
+    *st = chd->stats;
+    st->size = chd->cachesize;
+    for (i = 0, st->used = 0; i < chd->cachesize; i++)
+      st->used += chd->cache[i].hunknum >= 0;
+    chd_unlock(chd);
+    return 0;
+  }
+#endif
+  memset(st, 0, sizeof(*st));
+  return -1;
+}
+
 int pm_close(pm_file *fp)
 {
   int ret = 0;
@@ -644,9 +1018,15 @@ int pm_close(pm_file *fp)
   else if (fp->type == PMT_CHD)
   {
     struct chd_struct *chd = fp->file;
+    chd_cache_free(chd);
     chd_close(chd->chd);
-    if (chd->hunk)
-      free(chd->hunk);
+  }
+#endif
+#ifdef USE_MMAP
+  else if (fp->type == PMT_MMAP)
+  {
+    struct mmap_file *m = fp->file;
+    munmap(m->data, m->len);
   }
 #endif
   else
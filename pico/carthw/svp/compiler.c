@@ -141,35 +141,6 @@ void ssp_pm_write(u32 d, int reg)
 }
 
 
-// -----------------------------------------------------
-
-// 14 IRAM blocks
-static unsigned char iram_context_map[] =
-{
-	 0, 0, 0, 0, 1, 0, 0, 0, // 04
-	 0, 0, 0, 0, 0, 0, 2, 0, // 0e
-	 0, 0, 0, 0, 0, 3, 0, 4, // 15 17
-	 5, 0, 0, 6, 0, 7, 0, 0, // 18 1b 1d
-	 8, 9, 0, 0, 0,10, 0, 0, // 20 21 25
-	 0, 0, 0, 0, 0, 0, 0, 0,
-	 0, 0,11, 0, 0,12, 0, 0, // 32 35
-	13,14, 0, 0, 0, 0, 0, 0  // 38 39
-};
-
-int ssp_get_iram_context(void)
-{
-	unsigned char *ir = (unsigned char *)svp->iram_rom;
-	int val1, val = ir[0x083^1] + ir[0x4FA^1] + ir[0x5F7^1] + ir[0x47B^1];
-	val1 = iram_context_map[(val>>1)&0x3f];
-
-	if (val1 == 0) {
-		elprintf(EL_ANOMALY, "svp: iram ctx val: %02x PC=%04x\n", (val>>1)&0x3f, rPC);
-		//debug_dump2file(name, svp->iram_rom, 0x800);
-		//exit(1);
-	}
-	return val1;
-}
-
 // -----------------------------------------------------
 
 /* regs with known values */
@@ -1747,6 +1718,7 @@ void *ssp_translate_block(int pc)
 	unsigned int op, op1, imm, ccount = 0;
 	unsigned int *block_start, *block_end;
 	int ret, end_cond = A_COND_AL, jump_pc = -1;
+	int start_pc = pc;
 
 	//printf("translate %04x -> %04x\n", pc<<1, (tcache_ptr-tcache)<<2);
 
@@ -1791,12 +1763,14 @@ void *ssp_translate_block(int pc)
 	emith_pool_commit(0);
 	emith_flush();
 
-	if (tcache_ptr - (u32 *)tcache > DRC_TCACHE_SIZE/4) {
+	if (tcache_ptr - (u32 *)tcache > tcache_size/4) {
 		elprintf(EL_ANOMALY|EL_STATUS|EL_SVP, "tcache overflow!\n");
 		fflush(stdout);
 		exit(1);
 	}
 
+	drc_perf_add(block_start, (tcache_ptr - block_start) * 4, "ssp_%04x", start_pc);
+
 	// stats
 	nblocks++;
 	//printf("%i blocks, %i bytes, k=%.3f\n", nblocks, (tcache_ptr - tcache)*4,
@@ -1851,7 +1825,7 @@ int ssp1601_dyn_startup(void)
 		return -1;
 	}
 
-	memset(tcache, 0, DRC_TCACHE_SIZE);
+	memset(tcache, 0, tcache_size);
 	tcache_ptr = (void *)tcache;
 
 	PicoLoadStateHook = ssp1601_state_load;
@@ -12,6 +12,8 @@ void ssp_hle_11_12c(void);
 void ssp_hle_11_384(void);
 void ssp_hle_11_38a(void);
 
+int  ssp_get_iram_context(void);
+
 int  ssp1601_dyn_startup(void);
 void ssp1601_dyn_exit(void);
 void ssp1601_dyn_reset(ssp1601_t *ssp);
@@ -0,0 +1,1083 @@
+/*
+ * SSP1601 recompiler for hosts supported by the common drc code emitters
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * Translation follows the interpreter in ssp16.c rather than the ARM
+ * recompiler: A and the flags live in host registers, everything else
+ * stays in the ssp1601_t context. PMx/XST/PMC accesses are done by the
+ * interpreter's handlers, so the programmable memory and the wait loop
+ * detection behave exactly like there. There is no HLE.
+ *
+ * Flags: only Z and N are kept, as a value which is 0 if Z is set and
+ * negative if N is set. ALU results never have both, but a write to ST can
+ * set both; the block is left then and the interpreter runs until one of
+ * them is cleared. L and V are never set, only cleared by add, sub, cmp
+ * and mld as in ssp16.c, which is done once per block and ST write.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pico/pico_int.h>
+#include <cpu/drc/cmn.h>
+#include "compiler.h"
+
+#define SSP_BLOCKTAB_ENTS       (0x5090/2)
+#define SSP_BLOCKTAB_IRAM_ONE   (0x800/2) // table entries
+#define SSP_BLOCKTAB_IRAM_ENTS  (15*SSP_BLOCKTAB_IRAM_ONE)
+
+#define SSP_BLOCK_CYCLES        100       // max. cycles per block
+#define SSP_BLOCK_SIZE_MAX      0x8000    // tcache space needed for a block
+#define SSP_LINKS_MAX           0x400
+
+static u8 **ssp_block_table; // [0x5090/2];
+static u8 **ssp_block_table_iram; // [15][0x800/2];
+
+static u8 *tcache_ptr;
+static u8 *tcache_blocks; // start of the block area, after the stubs
+
+// unresolved jumps to blocks not yet translated
+static struct {
+	u8 *jump;
+	unsigned short pc;
+	unsigned short ctx;
+} links[SSP_LINKS_MAX];
+static int link_count;
+
+extern ssp1601_t *ssp;
+
+#define rPC    ssp->gr[SSP_PC].h
+#define rST    ssp->gr[SSP_ST].h
+
+#define SSP_FLAG_L (1<<0xc)
+#define SSP_FLAG_Z (1<<0xd)
+#define SSP_FLAG_V (1<<0xe)
+#define SSP_FLAG_N (1<<0xf)
+
+#define PROGRAM(x) ((unsigned short *)svp->iram_rom)[x]
+
+#define OFS_GR(r)   (offsetof(ssp1601_t, gr) + (r)*sizeof(ssp_reg_t) + offsetof(ssp_reg_t, h))
+#define OFS_R(ri)   (offsetof(ssp1601_t, r) + (ri))
+#define OFS_RAM(ri) (((ri) & 4) ? offsetof(ssp1601_t, RAM1) : offsetof(ssp1601_t, RAM0))
+
+// needed by the code emitters
+static int rcache_get_tmp(void);
+static void rcache_free_tmp(int hr);
+
+#define COUNT_OP
+#if defined(__arm__) || defined(_M_ARM)
+#include <cpu/drc/emit_arm.c>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <cpu/drc/emit_arm64.c>
+#elif defined(__mips__)
+#include <cpu/drc/emit_mips.c>
+#elif defined(__riscv__) || defined(__riscv)
+#include <cpu/drc/emit_riscv.c>
+#elif defined(__powerpc__) || defined(__ppc__) || defined(_M_PPC)
+#include <cpu/drc/emit_ppc.c>
+#elif defined(__i386__) || defined(_M_X86)
+#include <cpu/drc/emit_x86.c>
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <cpu/drc/emit_x86.c>
+#else
+#error unsupported arch
+#endif
+
+static void REGPARM(1) (*ssp_drc_enter)(ssp1601_t *ssp);
+static u8 *ssp_drc_dispatch; // pc in arg0
+static u8 *ssp_drc_exit;     // pc in arg0
+
+// -----------------------------------------------------
+// host registers
+
+static const signed char hregs_param[] = PARAM_REGS;
+static const signed char hregs_temp [] = TEMPORARY_REGS;
+static const signed char hregs_saved[] = PRESERVED_REGS;
+
+// A and the flag value are kept in callee saved registers. The temporaries
+// are the first helper arguments and don't survive helper calls.
+static int hr_a, hr_fv;
+static int hr_t0, hr_t1, hr_t2;
+
+// scratch registers for the emitters and tr_* functions
+static signed char tmp_regs[8];
+static int tmp_count, tmp_used;
+
+static int rcache_get_tmp(void)
+{
+	int i;
+
+	for (i = 0; i < tmp_count; i++) {
+		if (!(tmp_used & (1 << i))) {
+			tmp_used |= 1 << i;
+			return tmp_regs[i];
+		}
+	}
+
+	elprintf(EL_ANOMALY|EL_STATUS|EL_SVP, "ssp drc: out of temporary regs\n");
+	exit(1);
+}
+
+static void rcache_free_tmp(int hr)
+{
+	int i;
+
+	for (i = 0; i < tmp_count; i++)
+		if (tmp_regs[i] == hr)
+			tmp_used &= ~(1 << i);
+}
+
+static void hregs_init(void)
+{
+	int i, n;
+
+	host_arg2reg(hr_t0, 0);
+	host_arg2reg(hr_t1, 1);
+	host_arg2reg(hr_t2, 2);
+
+	for (i = n = 0; i < ARRAY_SIZE(hregs_saved); i++) {
+		if (hregs_saved[i] == CONTEXT_REG)
+			continue;
+		if (n++ == 0)
+			hr_a = hregs_saved[i];
+		else {
+			hr_fv = hregs_saved[i];
+			break;
+		}
+	}
+
+	tmp_count = tmp_used = 0;
+	for (i = 0; i < ARRAY_SIZE(hregs_param) + ARRAY_SIZE(hregs_temp); i++) {
+		int r = i < ARRAY_SIZE(hregs_param) ? hregs_param[i] :
+			hregs_temp[i - ARRAY_SIZE(hregs_param)];
+		if (r == hr_t0 || r == hr_t1 || r == hr_t2 || r == CONTEXT_REG)
+			continue;
+		if (tmp_count < ARRAY_SIZE(tmp_regs))
+			tmp_regs[tmp_count++] = r;
+	}
+}
+
+// -----------------------------------------------------
+// helpers called from generated code
+
+static u32 REGPARM(2) ssp_drc_reg_read(u32 r, u32 pc)
+{
+	u32 d = ssp1601_reg_read(r, pc);
+
+	// wait loop detected, leave at the next block
+	if (ssp->emu_status & SSP_WAIT_MASK)
+		ssp->drc.cycles = 0;
+	return d & 0xffff;
+}
+
+static void REGPARM(3) ssp_drc_reg_write(u32 d, u32 r, u32 pc)
+{
+	ssp1601_reg_write(r, d, pc);
+}
+
+static u8 *ssp_translate_block(int pc);
+
+static u8 * REGPARM(1) ssp_drc_lookup(u32 pc)
+{
+	u8 *block;
+
+	if (pc < 0x400) {
+		if (ssp->drc.iram_dirty) {
+			ssp->drc.iram_context = ssp_get_iram_context();
+			ssp->drc.iram_dirty = 0;
+		}
+		block = ssp_block_table_iram[ssp->drc.iram_context * SSP_BLOCKTAB_IRAM_ONE + pc];
+	}
+	else if (pc < SSP_BLOCKTAB_ENTS)
+		block = ssp_block_table[pc];
+	else
+		block = NULL;
+
+	if (block == NULL)
+		block = ssp_translate_block(pc);
+	return block;
+}
+
+// -----------------------------------------------------
+// translation state
+
+static int tr_start_pc;
+static int tr_ctx;		// IRAM context of the block
+static int tr_rpl;		// ST RPL bits if known, else -1
+static int tr_st_written;	// ST written by the current op
+static int tr_lv_clear;		// ST L and V known to be clear
+
+enum { END_NONE = 0, END_INDIRECT, END_DIRECT, END_COND };
+
+typedef struct {
+	int type;		// END_*
+	int cond, ncond;	// END_COND: host condition and its inverse
+	int pc;			// END_DIRECT/END_COND: jump target
+} tr_end_t;
+
+static const unsigned char rpl_mask[8] = { 0xff, 1, 3, 7, 15, 31, 63, 127 };
+
+// d = P = X * Y * 2
+static void tr_calc_p(int d)
+{
+	emith_read16s_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_X));
+	emith_read16s_r_r_offs(hr_t2, CONTEXT_REG, OFS_GR(SSP_Y));
+	emith_mul(d, hr_t1, hr_t2);
+	emith_lsl(d, d, 1);
+}
+
+// t0 = ST with the flags merged in
+static void tr_read_st(void)
+{
+	emith_read16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_ST));
+	emith_and_r_imm(hr_t0, ~(SSP_FLAG_Z|SSP_FLAG_N) & 0xffff);
+	emith_lsr(hr_t1, hr_fv, 16);
+	emith_and_r_imm(hr_t1, SSP_FLAG_N);
+	emith_or_r_r(hr_t0, hr_t1);
+	emith_tst_r_r(hr_fv, hr_fv);
+	EMITH_SJMP_START(DCOND_NE);
+	emith_or_r_imm_c(DCOND_EQ, hr_t0, SSP_FLAG_Z);
+	EMITH_SJMP_END(DCOND_NE);
+}
+
+static void tr_write_st(void)
+{
+	emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_ST));
+	tr_st_written = 1;
+	tr_lv_clear = 0;
+	emith_lsl(hr_fv, hr_t0, 16);
+	emith_and_r_imm(hr_fv, 0x80000000);
+	emith_or_r_imm(hr_fv, 1);
+	emith_tst_r_imm(hr_t0, SSP_FLAG_Z);
+	EMITH_SJMP_START(DCOND_EQ);
+	emith_move_r_imm_c(DCOND_NE, hr_fv, 0);
+	EMITH_SJMP_END(DCOND_EQ);
+	tr_rpl = -1;
+}
+
+// t0 = stack[--STACK]
+static void tr_stack_pop(void)
+{
+	emith_read16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_STACK));
+	emith_sub_r_imm(hr_t1, 1);
+	emith_cmp_r_imm(hr_t1, 0);
+	EMITH_SJMP_START(DCOND_GE);
+	emith_move_r_imm_c(DCOND_LT, hr_t1, 5); // underflow
+	EMITH_SJMP_END(DCOND_GE);
+	emith_write16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_STACK));
+	emith_lsl(hr_t2, hr_t1, 1);
+	emith_add_r_r_ptr(hr_t2, CONTEXT_REG);
+	emith_read16_r_r_offs(hr_t0, hr_t2, offsetof(ssp1601_t, stack));
+}
+
+// stack[STACK++] = t0
+static void tr_stack_push(void)
+{
+	emith_read16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_STACK));
+	emith_cmp_r_imm(hr_t1, 6);
+	EMITH_SJMP_START(DCOND_LO);
+	emith_move_r_imm_c(DCOND_HS, hr_t1, 0); // overflow
+	EMITH_SJMP_END(DCOND_LO);
+	emith_lsl(hr_t2, hr_t1, 1);
+	emith_add_r_r_ptr(hr_t2, CONTEXT_REG);
+	emith_write16_r_r_offs(hr_t0, hr_t2, offsetof(ssp1601_t, stack));
+	emith_add_r_imm(hr_t1, 1);
+	emith_write16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_STACK));
+}
+
+// t0 = register r. pc is the address after the instruction
+static void tr_read_reg(int r, int pc)
+{
+	switch (r) {
+	case SSP_GR0:
+		emith_move_r_imm(hr_t0, 0xffff);
+		break;
+	case SSP_X:
+	case SSP_Y:
+		emith_read16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(r));
+		break;
+	case SSP_A:
+		emith_lsr(hr_t0, hr_a, 16);
+		break;
+	case SSP_ST:
+		tr_read_st();
+		break;
+	case SSP_STACK:
+		tr_stack_pop();
+		break;
+	case SSP_PC:
+		emith_move_r_imm(hr_t0, pc);
+		break;
+	case SSP_P:
+		tr_calc_p(hr_t0);
+		emith_lsr(hr_t0, hr_t0, 16);
+		break;
+	case SSP_AL:
+		emith_ctx_read(hr_t1, offsetof(ssp1601_t, emu_status));
+		emith_bic_r_imm(hr_t1, SSP_PMC_SET|SSP_PMC_HAVE_ADDR);
+		emith_ctx_write(hr_t1, offsetof(ssp1601_t, emu_status));
+		emith_and_r_r_imm(hr_t0, hr_a, 0xffff);
+		break;
+	default: // PMx, XST, PMC, gr13
+		emith_move_r_imm(hr_t0, r);
+		emith_move_r_imm(hr_t1, pc);
+		emith_abicall(ssp_drc_reg_read);
+		emith_move_r_r(hr_t0, RET_REG);
+		break;
+	}
+}
+
+// register r = t0, returns extra cycles
+static int tr_write_reg(int r, int pc, tr_end_t *end)
+{
+	switch (r) {
+	case SSP_GR0:
+		break;
+	case SSP_X:
+	case SSP_Y:
+		emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(r));
+		break;
+	case SSP_A:
+		emith_and_r_imm(hr_a, 0xffff);
+		emith_or_r_r_lsl(hr_a, hr_t0, 16);
+		break;
+	case SSP_ST:
+		tr_write_st();
+		break;
+	case SSP_STACK:
+		tr_stack_push();
+		break;
+	case SSP_PC:
+		end->type = END_INDIRECT;
+		return 1;
+	case SSP_P:
+		elprintf(EL_ANOMALY|EL_SVP, "ssp FIXME: unknown write @ %04x", (pc-1)*2);
+		break;
+	case SSP_AL:
+		emith_and_r_imm(hr_a, 0xffff0000);
+		emith_or_r_r(hr_a, hr_t0);
+		break;
+	default: // PMx, XST, PMC, gr13
+		emith_move_r_imm(hr_t1, r);
+		emith_move_r_imm(hr_t2, pc);
+		emith_abicall(ssp_drc_reg_write);
+		break;
+	}
+	return 0;
+}
+
+// t1 = &RAMx[rx] - RAMx, ri: 0-2, 4-6
+static void tr_ptr_addr(int ri)
+{
+	emith_read8_r_r_offs(hr_t1, CONTEXT_REG, OFS_R(ri));
+	emith_lsl(hr_t1, hr_t1, 1);
+	emith_add_r_r_ptr(hr_t1, CONTEXT_REG);
+}
+
+// post modification of pointer register ri, mod 1 "+!", 2 "-", 3 "+"
+static void tr_ptr_mod(int ri, int mod, int modulo)
+{
+	int tmp;
+
+	if (mod == 0)
+		return;
+
+	emith_read8_r_r_offs(hr_t1, CONTEXT_REG, OFS_R(ri));
+	if (mod == 1 || !modulo || tr_rpl == 0) {
+		if (mod == 2)
+			emith_sub_r_imm(hr_t1, 1);
+		else	emith_add_r_imm(hr_t1, 1);
+	}
+	else {
+		// r = (r & ~mask) | ((r + add) & mask), mask from RPL in ST
+		tmp = rcache_get_tmp();
+		if (tr_rpl > 0)
+			emith_move_r_imm(hr_t2, rpl_mask[tr_rpl]);
+		else {
+			emith_read16_r_r_offs(hr_t2, CONTEXT_REG, OFS_GR(SSP_ST));
+			emith_and_r_imm(hr_t2, 7);
+			emith_move_r_ptr_imm(tmp, rpl_mask);
+			emith_read8_r_r_r(hr_t2, tmp, hr_t2);
+		}
+		if (mod == 2)
+			emith_sub_r_r_imm(tmp, hr_t1, 1);
+		else	emith_add_r_r_imm(tmp, hr_t1, 1);
+		emith_eor_r_r(tmp, hr_t1);
+		emith_and_r_r(tmp, hr_t2);
+		emith_eor_r_r(hr_t1, tmp);
+		rcache_free_tmp(tmp);
+	}
+	emith_write8_r_r_offs(hr_t1, CONTEXT_REG, OFS_R(ri));
+}
+
+// t0 = (ri), ri: 0-7 (bit2 is the bank)
+static void tr_ptr1_read(int ri, int mod)
+{
+	if ((ri & 3) == 3) {
+		emith_read16_r_r_offs(hr_t0, CONTEXT_REG, OFS_RAM(ri) + mod*2);
+		return;
+	}
+	tr_ptr_addr(ri);
+	emith_read16_r_r_offs(hr_t0, hr_t1, OFS_RAM(ri));
+	tr_ptr_mod(ri, mod, 1);
+}
+
+// (ri) = t0, the write doesn't do modulo addressing
+static void tr_ptr1_write(int ri, int mod)
+{
+	if ((ri & 3) == 3) {
+		emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_RAM(ri) + mod*2);
+		return;
+	}
+	tr_ptr_addr(ri);
+	emith_write16_r_r_offs(hr_t0, hr_t1, OFS_RAM(ri));
+	tr_ptr_mod(ri, mod, 0);
+}
+
+// t0 = ((ri)), program memory at (ri), which is incremented
+static void tr_ptr2_read(int ri, int mod, int pc)
+{
+	int base, offs, tmp;
+
+	if ((ri & 3) == 3) {
+		base = CONTEXT_REG;
+		offs = OFS_RAM(ri) + mod*2;
+	}
+	else if (mod == 0) {
+		tr_ptr_addr(ri);
+		base = hr_t1;
+		offs = OFS_RAM(ri);
+	}
+	else {
+		elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: invalid mod in ((rX))? @ %04x", (pc-1)*2);
+		emith_move_r_imm(hr_t0, 0);
+		return;
+	}
+
+	emith_read16_r_r_offs(hr_t0, base, offs);
+	emith_add_r_r_imm(hr_t2, hr_t0, 1);
+	emith_write16_r_r_offs(hr_t2, base, offs);
+
+	tmp = rcache_get_tmp();
+	emith_lsl(hr_t0, hr_t0, 1);
+	emith_move_r_ptr_imm(tmp, svp->iram_rom);
+	emith_read16_r_r_r(hr_t0, tmp, hr_t0);
+	rcache_free_tmp(tmp);
+}
+
+// add, sub, cmp and mld clear L and V
+static void tr_clear_lv(void)
+{
+	if (tr_lv_clear)
+		return;
+	emith_read16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_ST));
+	emith_and_r_imm(hr_t1, ~(SSP_FLAG_L|SSP_FLAG_V) & 0xffff);
+	emith_write16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_ST));
+	tr_lv_clear = 1;
+}
+
+// ALU op on A with 32 bit operand in host reg s
+static void tr_alu(int aop, int s)
+{
+	if (aop == 1 || aop == 3 || aop == 4)
+		tr_clear_lv();
+	switch (aop) {
+	case 1: emith_sub_r_r(hr_a, s); break;
+	case 3: emith_sub_r_r_r(hr_fv, hr_a, s); return;
+	case 4: emith_add_r_r(hr_a, s); break;
+	case 5: emith_and_r_r(hr_a, s); break;
+	case 6: emith_or_r_r(hr_a, s); break;
+	case 7: emith_eor_r_r(hr_a, s); break;
+	}
+	emith_move_r_r(hr_fv, hr_a);
+}
+
+static void tr_alu_imm(int aop, u32 imm)
+{
+	if (aop == 1 || aop == 3 || aop == 4)
+		tr_clear_lv();
+	switch (aop) {
+	case 1: emith_sub_r_imm(hr_a, imm); break;
+	case 3: emith_sub_r_r_imm(hr_fv, hr_a, imm); return;
+	case 4: emith_add_r_imm(hr_a, imm); break;
+	case 5: emith_and_r_imm(hr_a, imm); break;
+	case 6: emith_or_r_imm(hr_a, imm); break;
+	case 7: emith_eor_r_imm(hr_a, imm); break;
+	}
+	emith_move_r_r(hr_fv, hr_a);
+}
+
+// 1 if always true, 0 if never, -1 if cond/ncond must be tested
+static int tr_cond_check(int op, int *cond, int *ncond, int pc)
+{
+	switch (op & 0xf0) {
+	case 0x00:
+		return 1;
+	case 0x50: // Z matches bit 8
+		*cond  = (op & 0x100) ? DCOND_EQ : DCOND_NE;
+		*ncond = (op & 0x100) ? DCOND_NE : DCOND_EQ;
+		return -1;
+	case 0x70: // N matches bit 8
+		*cond  = (op & 0x100) ? DCOND_LT : DCOND_GE;
+		*ncond = (op & 0x100) ? DCOND_GE : DCOND_LT;
+		return -1;
+	default:
+		elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: unimplemented cond @ %04x", (pc-1)*2);
+		return 0;
+	}
+}
+
+static void tr_set_end(tr_end_t *end, int check, int cond, int ncond, int pc)
+{
+	end->type = (check > 0 ? END_DIRECT : END_COND);
+	end->cond = cond;
+	end->ncond = ncond;
+	end->pc = pc;
+}
+
+static void tr_mod(unsigned int op, int pc)
+{
+	switch (op & 7) {
+		case 2: emith_asr(hr_a, hr_a, 1); break; // shr (arithmetic)
+		case 3: emith_lsl(hr_a, hr_a, 1); break; // shl
+		case 6: emith_neg_r_r(hr_a, hr_a); break; // neg
+		case 7: // abs
+			emith_asr(hr_t0, hr_a, 31);
+			emith_eor_r_r(hr_a, hr_t0);
+			emith_sub_r_r(hr_a, hr_t0);
+			break;
+		default: elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: unhandled mod %i @ %04x",
+				op&7, (pc-1)*2);
+	}
+	emith_move_r_r(hr_fv, hr_a);
+}
+
+// X = (rj), Y = (ri) for the multiply-accumulate ops
+static void tr_mac_load(unsigned int op)
+{
+	tr_ptr1_read(op & 3, (op >> 2) & 3);
+	emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_X));
+	tr_ptr1_read(4 | ((op >> 4) & 3), (op >> 6) & 3);
+	emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_Y));
+}
+
+// returns cycles used, *pc is advanced past immediates
+static int translate_op(unsigned int op, int *pc, tr_end_t *end)
+{
+	int ret = 1, check, cond = 0, ncond = 0;
+	int rs = op & 0x0f, rd = (op & 0xf0) >> 4;
+	int ri = (op & 3) | ((op >> 6) & 4), mod = (op >> 2) & 3;
+	u32 imm;
+
+	switch (op >> 9)
+	{
+		// ld d, s
+		case 0x00:
+			if (op == 0) break; // nop
+			if (op == ((SSP_A<<4)|SSP_P)) { // A <- P
+				tr_calc_p(hr_a);
+				break;
+			}
+			tr_read_reg(rs, *pc);
+			ret += tr_write_reg(rd, *pc, end);
+			break;
+
+		// ld d, (ri)
+		case 0x01:
+			tr_ptr1_read(ri, mod);
+			ret += tr_write_reg(rd, *pc, end);
+			break;
+
+		// ld (ri), s
+		case 0x02:
+			tr_read_reg(rd, *pc);
+			tr_ptr1_write(ri, mod);
+			break;
+
+		// ldi d, imm
+		case 0x04:
+			imm = PROGRAM((*pc)++);
+			ret++;
+			if (rd == SSP_PC) {
+				tr_set_end(end, 1, 0, 0, imm);
+				ret++;
+				break;
+			}
+			emith_move_r_imm(hr_t0, imm);
+			ret += tr_write_reg(rd, *pc, end);
+			if (rd == SSP_ST)
+				tr_rpl = imm & 7;
+			break;
+
+		// ld d, ((ri))
+		case 0x05:
+			tr_ptr2_read(ri, mod, *pc);
+			ret += 2 + tr_write_reg(rd, *pc, end);
+			break;
+
+		// ldi (ri), imm
+		case 0x06:
+			imm = PROGRAM((*pc)++);
+			emith_move_r_imm(hr_t0, imm);
+			tr_ptr1_write(ri, mod);
+			ret++;
+			break;
+
+		// ld adr, a
+		case 0x07:
+			emith_lsr(hr_t0, hr_a, 16);
+			emith_write16_r_r_offs(hr_t0, CONTEXT_REG, offsetof(ssp1601_t, RAM) + (op & 0x1ff)*2);
+			break;
+
+		// ld d, ri
+		case 0x09:
+			emith_read8_r_r_offs(hr_t0, CONTEXT_REG, OFS_R(ri));
+			ret += tr_write_reg(rd, *pc, end);
+			break;
+
+		// ld ri, s
+		case 0x0a:
+			tr_read_reg(rd, *pc);
+			emith_write8_r_r_offs(hr_t0, CONTEXT_REG, OFS_R(ri));
+			break;
+
+		// ldi ri, simm
+		case 0x0c:
+		case 0x0d:
+		case 0x0e:
+		case 0x0f:
+			emith_move_r_imm(hr_t0, op & 0xff);
+			emith_write8_r_r_offs(hr_t0, CONTEXT_REG, OFS_R((op >> 8) & 7));
+			break;
+
+		// call cond, addr
+		case 0x24:
+			imm = PROGRAM((*pc)++);
+			ret++;
+			check = tr_cond_check(op, &cond, &ncond, *pc);
+			if (check == 0)
+				break;
+			if (check < 0) {
+				emith_cmp_r_imm(hr_fv, 0);
+				EMITH_JMP_START(ncond);
+				emith_move_r_imm(hr_t0, *pc);
+				tr_stack_push();
+				EMITH_JMP_END(ncond);
+			} else {
+				emith_move_r_imm(hr_t0, *pc);
+				tr_stack_push();
+			}
+			tr_set_end(end, check, cond, ncond, imm);
+			break;
+
+		// ld d, (a)
+		case 0x25: {
+			int tmp = rcache_get_tmp();
+			emith_lsr(hr_t0, hr_a, 16);
+			emith_lsl(hr_t0, hr_t0, 1);
+			emith_move_r_ptr_imm(tmp, svp->iram_rom);
+			emith_read16_r_r_r(hr_t0, tmp, hr_t0);
+			rcache_free_tmp(tmp);
+			ret += 2 + tr_write_reg(rd, *pc, end);
+			break;
+		}
+
+		// bra cond, addr
+		case 0x26:
+			imm = PROGRAM((*pc)++);
+			ret++;
+			check = tr_cond_check(op, &cond, &ncond, *pc);
+			if (check != 0)
+				tr_set_end(end, check, cond, ncond, imm);
+			break;
+
+		// mod cond, op
+		case 0x48:
+			check = tr_cond_check(op, &cond, &ncond, *pc);
+			if (check == 0)
+				break;
+			if (check < 0) {
+				emith_cmp_r_imm(hr_fv, 0);
+				EMITH_JMP_START(ncond);
+				tr_mod(op, *pc);
+				EMITH_JMP_END(ncond);
+			} else
+				tr_mod(op, *pc);
+			break;
+
+		// mpys?
+		case 0x1b:
+			tr_calc_p(hr_t0);
+			emith_sub_r_r(hr_a, hr_t0);
+			emith_move_r_r(hr_fv, hr_a);
+			tr_mac_load(op);
+			break;
+
+		// mpya (rj), (ri), b
+		case 0x4b:
+			tr_calc_p(hr_t0);
+			emith_add_r_r(hr_a, hr_t0);
+			emith_move_r_r(hr_fv, hr_a);
+			tr_mac_load(op);
+			break;
+
+		// mld (rj), (ri), b
+		case 0x5b:
+			emith_move_r_imm(hr_a, 0);
+			emith_move_r_imm(hr_fv, 0);
+			tr_clear_lv();
+			tr_mac_load(op);
+			break;
+
+		// ld a, adr
+		case 0x03:
+			emith_read16_r_r_offs(hr_t0, CONTEXT_REG, offsetof(ssp1601_t, RAM) + (op & 0x1ff)*2);
+			tr_write_reg(SSP_A, *pc, end);
+			break;
+
+		// OP a, s
+		case 0x10: case 0x30: case 0x40: case 0x50: case 0x60: case 0x70:
+			if (rs == SSP_P) {
+				tr_calc_p(hr_t0);
+				tr_alu(op >> 13, hr_t0);
+			}
+			else if (rs == SSP_A)
+				tr_alu(op >> 13, hr_a);
+			else {
+				tr_read_reg(rs, *pc);
+				emith_lsl(hr_t0, hr_t0, 16);
+				tr_alu(op >> 13, hr_t0);
+			}
+			break;
+
+		// OP a, (ri)
+		case 0x11: case 0x31: case 0x41: case 0x51: case 0x61: case 0x71:
+			tr_ptr1_read(ri, mod);
+			emith_lsl(hr_t0, hr_t0, 16);
+			tr_alu(op >> 13, hr_t0);
+			break;
+
+		// OP a, adr
+		case 0x13: case 0x33: case 0x43: case 0x53: case 0x63: case 0x73:
+			emith_read16_r_r_offs(hr_t0, CONTEXT_REG, offsetof(ssp1601_t, RAM) + (op & 0x1ff)*2);
+			emith_lsl(hr_t0, hr_t0, 16);
+			tr_alu(op >> 13, hr_t0);
+			break;
+
+		// OP a, imm
+		case 0x14: case 0x34: case 0x44: case 0x54: case 0x64: case 0x74:
+			imm = PROGRAM((*pc)++);
+			tr_alu_imm(op >> 13, imm << 16);
+			ret++;
+			break;
+
+		// OP a, ((ri))
+		case 0x15: case 0x35: case 0x45: case 0x55: case 0x65: case 0x75:
+			tr_ptr2_read(ri, mod, *pc);
+			emith_lsl(hr_t0, hr_t0, 16);
+			tr_alu(op >> 13, hr_t0);
+			ret += 2;
+			break;
+
+		// OP a, ri
+		case 0x19: case 0x39: case 0x49: case 0x59: case 0x69: case 0x79:
+			emith_read8_r_r_offs(hr_t0, CONTEXT_REG, OFS_R(ri));
+			emith_lsl(hr_t0, hr_t0, 16);
+			tr_alu(op >> 13, hr_t0);
+			break;
+
+		// OP simm
+		case 0x1c: case 0x3c: case 0x4c: case 0x5c: case 0x6c: case 0x7c:
+			tr_alu_imm(op >> 13, (op & 0xff) << 16);
+			break;
+
+		default:
+			elprintf(EL_ANOMALY|EL_SVP, "ssp FIXME unhandled op %04x @ %04x", op, (*pc-1)*2);
+			break;
+	}
+
+	return ret;
+}
+
+// -----------------------------------------------------
+// blocks
+
+static u8 **tr_block_slot(int pc, int ctx)
+{
+	if (pc < 0x400)
+		return &ssp_block_table_iram[ctx * SSP_BLOCKTAB_IRAM_ONE + pc];
+	if (pc < SSP_BLOCKTAB_ENTS)
+		return &ssp_block_table[pc];
+	return NULL;
+}
+
+// jump to block at pc. ROM blocks can't link to IRAM, since the IRAM context
+// may have changed by the time the jump is taken
+static void tr_link(int pc)
+{
+	u8 **slot = NULL;
+
+	if (pc >= 0x400)
+		slot = tr_block_slot(pc, 0);
+	else if (tr_start_pc < 0x400)
+		slot = tr_block_slot(pc, tr_ctx);
+
+	if (slot != NULL && *slot != NULL) {
+		emith_jump(*slot);
+		return;
+	}
+
+	// jump to the dispatcher for now, overwritten once the target exists
+	emith_flush();
+	if (slot != NULL && link_count < SSP_LINKS_MAX) {
+		links[link_count].jump = tcache_ptr;
+		links[link_count].pc = pc;
+		links[link_count].ctx = pc < 0x400 ? tr_ctx : 0;
+		link_count++;
+	}
+	emith_move_r_imm(hr_t0, pc);
+	emith_jump_patchable(ssp_drc_dispatch);
+}
+
+static void tr_resolve_links(u8 *block, int pc, int ctx)
+{
+	int i;
+
+	for (i = 0; i < link_count; ) {
+		if (links[i].pc == pc && links[i].ctx == ctx) {
+			u8 *jump = links[i].jump;
+			emith_jump_at(jump, block);
+			host_instructions_updated(jump, jump + emith_jump_at_size(), 1);
+			links[i] = links[--link_count];
+		}
+		else
+			i++;
+	}
+}
+
+static void tcache_flush(void)
+{
+	elprintf(EL_SVP, "ssp drc: tcache flush");
+	memset(ssp_block_table, 0, sizeof(ssp_block_table[0]) * SSP_BLOCKTAB_ENTS);
+	memset(ssp_block_table_iram, 0, sizeof(ssp_block_table_iram[0]) * SSP_BLOCKTAB_IRAM_ENTS);
+	link_count = 0;
+	tcache_ptr = tcache_blocks;
+}
+
+static void emit_block_prologue(int pc)
+{
+	// out of cycles?
+	emith_ctx_read(hr_t1, offsetof(ssp1601_t, drc.cycles));
+	emith_cmp_r_imm(hr_t1, 0);
+	EMITH_JMP_START(DCOND_GT);
+	emith_move_r_imm(hr_t0, pc);
+	emith_jump(ssp_drc_exit);
+	EMITH_JMP_END(DCOND_GT);
+}
+
+// after an op writing ST: if both Z and N are set, fv can't hold them,
+// leave at pc with the cycles so far and let ssp1601_dyn_run interpret
+static void emit_st_check(int cycles, int pc)
+{
+	emith_read16_r_r_offs(hr_t1, CONTEXT_REG, OFS_GR(SSP_ST));
+	emith_and_r_imm(hr_t1, SSP_FLAG_Z|SSP_FLAG_N);
+	emith_cmp_r_imm(hr_t1, SSP_FLAG_Z|SSP_FLAG_N);
+	EMITH_JMP_START(DCOND_NE);
+	emith_ctx_read(hr_t1, offsetof(ssp1601_t, drc.cycles));
+	emith_sub_r_imm(hr_t1, cycles);
+	emith_ctx_write(hr_t1, offsetof(ssp1601_t, drc.cycles));
+	emith_move_r_imm(hr_t0, pc);
+	emith_jump(ssp_drc_exit);
+	EMITH_JMP_END(DCOND_NE);
+}
+
+static void emit_block_epilogue(int cycles, tr_end_t *end, int pc)
+{
+	emith_ctx_read(hr_t1, offsetof(ssp1601_t, drc.cycles));
+	emith_sub_r_imm(hr_t1, cycles);
+	emith_ctx_write(hr_t1, offsetof(ssp1601_t, drc.cycles));
+
+	switch (end->type) {
+	case END_INDIRECT: // new pc in t0
+		emith_jump(ssp_drc_dispatch);
+		break;
+	case END_COND:
+		emith_cmp_r_imm(hr_fv, 0);
+		EMITH_JMP_START(end->ncond);
+		tr_link(end->pc);
+		EMITH_JMP_END(end->ncond);
+		tr_link(pc);
+		break;
+	default:
+		tr_link(end->pc);
+		break;
+	}
+}
+
+static u8 *ssp_translate_block(int pc)
+{
+	tr_end_t end = { END_NONE };
+	u8 *block_start, **slot;
+	int ccount = 0;
+
+	if (tcache_ptr + SSP_BLOCK_SIZE_MAX > tcache + tcache_size)
+		tcache_flush();
+
+	tr_start_pc = pc;
+	tr_ctx = pc < 0x400 ? ssp->drc.iram_context : 0;
+	tr_rpl = -1;
+	tr_lv_clear = 0;
+	block_start = tcache_ptr;
+
+	emit_block_prologue(pc);
+
+	while (ccount < SSP_BLOCK_CYCLES && end.type == END_NONE) {
+		unsigned int op = PROGRAM(pc++);
+		tr_st_written = 0;
+		ccount += translate_op(op, &pc, &end);
+		pc &= 0xffff;
+		if (tr_st_written)
+			emit_st_check(ccount, pc);
+	}
+
+	if (end.type == END_NONE) {
+		end.type = END_DIRECT;
+		end.pc = pc;
+	}
+
+	emit_block_epilogue(ccount, &end, pc);
+	emith_flush();
+	emith_pool_commit(0);
+
+	host_instructions_updated(block_start, tcache_ptr, 1);
+	drc_perf_add(block_start, tcache_ptr - block_start, "ssp_%04x", tr_start_pc);
+
+	slot = tr_block_slot(tr_start_pc, tr_ctx);
+	if (slot != NULL)
+		*slot = block_start;
+	else
+		elprintf(EL_ANOMALY|EL_SVP, "ssp drc: block @ %04x not cached", tr_start_pc*2);
+	tr_resolve_links(block_start, tr_start_pc, tr_ctx);
+
+	return block_start;
+}
+
+// entry, exit and dispatcher
+static void emit_stubs(void)
+{
+	tcache_ptr = tcache;
+
+	// exit: pc in t0
+	ssp_drc_exit = tcache_ptr;
+	emith_write16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_PC));
+	emith_ctx_write(hr_a, offsetof(ssp1601_t, gr[SSP_A].v));
+	emith_ctx_write(hr_fv, offsetof(ssp1601_t, drc.flags));
+	emith_sh2_drc_exit();
+	emith_flush();
+	emith_pool_commit(0);
+
+	// dispatcher: pc in t0, find or translate the block and go there
+	ssp_drc_dispatch = tcache_ptr;
+	emith_abicall(ssp_drc_lookup);
+	emith_jump_reg(RET_REG);
+	emith_flush();
+	emith_pool_commit(0);
+
+	// entry: ssp context in arg0
+	ssp_drc_enter = (void *)tcache_ptr;
+	emith_sh2_drc_entry();
+	emith_move_r_r_ptr(CONTEXT_REG, hr_t0);
+	emith_ctx_read(hr_a, offsetof(ssp1601_t, gr[SSP_A].v));
+	emith_ctx_read(hr_fv, offsetof(ssp1601_t, drc.flags));
+	emith_read16_r_r_offs(hr_t0, CONTEXT_REG, OFS_GR(SSP_PC));
+	emith_jump(ssp_drc_dispatch);
+	emith_flush();
+	emith_pool_commit(0);
+
+	host_instructions_updated(tcache, tcache_ptr, 1);
+	drc_perf_add(tcache, tcache_ptr - tcache, "ssp_stubs");
+	tcache_blocks = tcache_ptr;
+}
+
+// -----------------------------------------------------
+
+static void ssp1601_state_load(void)
+{
+	ssp->drc.iram_dirty = 1;
+	ssp->drc.iram_context = 0;
+}
+
+void ssp1601_dyn_exit(void)
+{
+	free(ssp_block_table);
+	free(ssp_block_table_iram);
+	ssp_block_table = ssp_block_table_iram = NULL;
+
+	drc_cmn_cleanup();
+}
+
+int ssp1601_dyn_startup(void)
+{
+	drc_cmn_init();
+
+	ssp_block_table = calloc(sizeof(ssp_block_table[0]), SSP_BLOCKTAB_ENTS);
+	if (ssp_block_table == NULL)
+		return -1;
+	ssp_block_table_iram = calloc(sizeof(ssp_block_table_iram[0]), SSP_BLOCKTAB_IRAM_ENTS);
+	if (ssp_block_table_iram == NULL) {
+		free(ssp_block_table);
+		return -1;
+	}
+
+	hregs_init();
+	emit_stubs();
+	link_count = 0;
+
+	PicoLoadStateHook = ssp1601_state_load;
+
+	return 0;
+}
+
+
+void ssp1601_dyn_reset(ssp1601_t *ssp)
+{
+	ssp1601_reset(ssp);
+	ssp->drc.iram_dirty = 1;
+	ssp->drc.iram_context = 0;
+
+	// prevent new versions of IRAM from appearing
+	memset(svp->iram_rom, 0, 0x800);
+}
+
+
+void ssp1601_dyn_run(int cycles)
+{
+	const u32 zn = SSP_FLAG_Z|SSP_FLAG_N;
+	u32 fv;
+
+	ssp->drc.cycles = cycles;
+	while (ssp->drc.cycles > 0 && !(ssp->emu_status & SSP_WAIT_MASK))
+	{
+		if ((rST & zn) == zn) {
+			// not representable in fv, see emit_st_check
+			ssp->drc.cycles -= 1 - ssp1601_run(1);
+			continue;
+		}
+
+		fv = (rST & SSP_FLAG_Z) ? 0 : (rST & SSP_FLAG_N) ? 0x80000000 : 1;
+		ssp->drc.flags = fv;
+
+		ssp_drc_enter(ssp);
+
+		// both set only if the drc left right after writing them to ST
+		if ((rST & zn) != zn) {
+			fv = ssp->drc.flags;
+			rST &= ~zn;
+			rST |= (fv ? (fv >> 16) & SSP_FLAG_N : SSP_FLAG_Z);
+		}
+	}
+	// update P
+	ssp->gr[SSP_P].v = (signed short)ssp->gr[SSP_X].h * (signed short)ssp->gr[SSP_Y].h * 2;
+}
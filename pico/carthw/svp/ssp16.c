@@ -542,6 +542,7 @@ static u32 pm_io(int reg, int write, u32 d)
 				elprintf(EL_SVP, "ssp IRAM w [%06x] %04x (inc %i)", (addr<<1)&0x7ff, d, inc);
 				((unsigned short *)svp->iram_rom)[addr&0x3ff] = d;
 				ssp->pmac_write[reg] += inc;
+				ssp->drc.iram_dirty = 1;
 			}
 			else
 			{
@@ -1039,7 +1040,22 @@ void ssp1601_reset(ssp1601_t *l_ssp)
 }
 
 
-void ssp1601_run(int cycles)
+// register access for the recompiler. pc is the address following the
+// instruction and its immediate, like PC in the interpreter loop
+u32 ssp1601_reg_read(int r, int pc)
+{
+	SET_PC(pc);
+	return read_handlers[r]();
+}
+
+void ssp1601_reg_write(int r, u32 d, int pc)
+{
+	SET_PC(pc);
+	write_handlers[r](d);
+}
+
+
+int ssp1601_run(int cycles)
 {
 	SET_PC(rPC);
 
@@ -1246,5 +1262,7 @@ void ssp1601_run(int cycles)
 
 	rPC = GET_PC();
 	read_P(); // update P
+
+	return g_cycles;
 }
 
@@ -88,10 +88,14 @@ typedef struct
 		unsigned int tmp0;		// 4a4
 		unsigned int tmp1;		// 4a8
 		unsigned int tmp2;		// 4ac
+		int cycles;			// 4b0 portable recompiler
+		unsigned int flags;		// 4b4 ZN as a 32 bit value
 	} drc;
 } ssp1601_t;
 
 
 void ssp1601_reset(ssp1601_t *ssp);
-void ssp1601_run(int cycles);
+int  ssp1601_run(int cycles); // returns cycles left, <= 0 if all used
+u32  ssp1601_reg_read(int r, int pc);
+void ssp1601_reg_write(int r, u32 d, int pc);
 
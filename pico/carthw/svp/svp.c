@@ -51,6 +51,36 @@ static carthw_state_chunk svp_states[] =
 };
 
 
+#ifdef _SVP_DRC
+// 14 IRAM blocks
+static unsigned char iram_context_map[] =
+{
+	 0, 0, 0, 0, 1, 0, 0, 0, // 04
+	 0, 0, 0, 0, 0, 0, 2, 0, // 0e
+	 0, 0, 0, 0, 0, 3, 0, 4, // 15 17
+	 5, 0, 0, 6, 0, 7, 0, 0, // 18 1b 1d
+	 8, 9, 0, 0, 0,10, 0, 0, // 20 21 25
+	 0, 0, 0, 0, 0, 0, 0, 0,
+	 0, 0,11, 0, 0,12, 0, 0, // 32 35
+	13,14, 0, 0, 0, 0, 0, 0  // 38 39
+};
+
+int ssp_get_iram_context(void)
+{
+	unsigned char *ir = (unsigned char *)svp->iram_rom;
+	int val1, val = ir[0x083^1] + ir[0x4FA^1] + ir[0x5F7^1] + ir[0x47B^1];
+	val1 = iram_context_map[(val>>1)&0x3f];
+
+	if (val1 == 0) {
+		elprintf(EL_ANOMALY, "svp: iram ctx val: %02x PC=%04x\n", (val>>1)&0x3f, svp->ssp1601.gr[SSP_PC].h);
+		//debug_dump2file(name, svp->iram_rom, 0x800);
+		//exit(1);
+	}
+	return val1;
+}
+#endif
+
+
 static void PicoSVPReset(void)
 {
 	elprintf(EL_SVP, "SVP reset");
@@ -373,6 +373,7 @@ void cdc_dma_update(void)
 
     /* clear DSR bit & set EDT bit (SCD register $04) */
     Pico_mcd->s68k_regs[0x04+0] = (Pico_mcd->s68k_regs[0x04+0] & 0x07) | 0x80;
+    pcd_s68k_poll_release(0x04);
 
     /* disable DMA transfer */
     cdc.dma_w = 0;
@@ -832,6 +833,7 @@ unsigned short cdc_host_r(void)
 
       /* clear DSR bit & set EDT bit (SCD register $04) */
       Pico_mcd->s68k_regs[0x04+0] = (Pico_mcd->s68k_regs[0x04+0] & 0x07) | 0x80;
+      pcd_s68k_poll_release(0x04);
     }
 
     return data;
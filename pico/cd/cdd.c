@@ -174,6 +174,15 @@ void cdd_reset(void)
   cdd.audio[0] = cdd.audio[1] = 0;
 }
 
+/* data track access, the image file may be shared with the CD-DA prefetch */
+static void cdd_seek_data(int offset)
+{
+  cdda_io_lock();
+  pm_seek(cdd.toc.tracks[0].fd, offset, SEEK_SET);
+  cdda_io_unlock();
+  pm_sequential(cdd.toc.tracks[0].fd, offset);
+}
+
 /* FIXME: use cdd_read_audio() instead */
 static void cdd_change_track(int index, int lba)
 {
@@ -244,7 +253,7 @@ int cdd_context_load(uint8 *state)
     /* DATA track */
     if (cdd.toc.tracks[0].fd)
     {
-      pm_seek(cdd.toc.tracks[0].fd, lba * cdd.sectorSize, SEEK_SET);
+      cdd_seek_data(lba * cdd.sectorSize);
     }
   }
 #ifdef USE_LIBTREMOR
@@ -446,6 +455,7 @@ int cdd_unload(void)
 
     /* stop audio streaming */
     Pico_mcd->cdda_stream = NULL;
+    cdda_stop_play();
 
     /* close CD tracks */
     if (cdd.toc.tracks[0].fd)
@@ -509,6 +519,8 @@ void cdd_read_data(uint8 *dst)
   /* only read DATA track sectors */
   if ((cdd.lba >= 0) && (cdd.lba < cdd.toc.tracks[0].end))
   {
+    cdda_io_lock();
+
     /* BIN format ? */
     if (cdd.sectorSize == 2352)
     {
@@ -518,6 +530,8 @@ void cdd_read_data(uint8 *dst)
 
     /* read sector data (Mode 1 = 2048 bytes) */
     pm_read(dst, 2048, cdd.toc.tracks[0].fd);
+
+    cdda_io_unlock();
   }
 }
 
@@ -852,7 +866,7 @@ void cdd_update(void)
       Pico_mcd->s68k_regs[0x36+0] = 0x01;
 
       /* DATA track */
-      pm_seek(cdd.toc.tracks[0].fd, cdd.lba * cdd.sectorSize, SEEK_SET);
+      cdd_seek_data(cdd.lba * cdd.sectorSize);
     }
 #ifdef USE_LIBTREMOR
     else if (cdd.toc.tracks[cdd.index].vf.seekable)
@@ -1094,7 +1108,7 @@ void cdd_process(void)
       if (!index)
       {
         /* DATA track */
-        pm_seek(cdd.toc.tracks[0].fd, lba * cdd.sectorSize, SEEK_SET);
+        cdd_seek_data(lba * cdd.sectorSize);
       }
 #ifdef USE_LIBTREMOR
       else if (cdd.toc.tracks[index].vf.seekable)
@@ -1193,7 +1207,7 @@ void cdd_process(void)
       if (!index)
       {
         /* DATA track */
-        pm_seek(cdd.toc.tracks[0].fd, lba * cdd.sectorSize, SEEK_SET);
+        cdd_seek_data(lba * cdd.sectorSize);
       }
 #ifdef USE_LIBTREMOR
       else if (cdd.toc.tracks[index].vf.seekable)
@@ -1298,8 +1312,10 @@ void cdd_process(void)
       set_reg16(0x3e, 0x0000);
       set_reg16(0x40, 0x000f);
 
-      if (PicoIn.mcdTrayClose)
+      if (PicoIn.mcdTrayClose) {
+        PCD_THR_SHARED();
         PicoIn.mcdTrayClose();
+      }
 
       return;
     }
@@ -1317,8 +1333,10 @@ void cdd_process(void)
       set_reg16(0x3e, 0x0000);
       set_reg16(0x40, ~CD_OPEN & 0x0f);
 
-      if (PicoIn.mcdTrayOpen)
+      if (PicoIn.mcdTrayOpen) {
+        PCD_THR_SHARED();
         PicoIn.mcdTrayOpen();
+      }
       return;
     }
 
@@ -38,6 +38,10 @@
 #include "../pico_int.h"
 #include "genplus_macros.h"
 
+#if defined(GFX_SIMD) && !defined(__GNUC__)
+#undef GFX_SIMD /* needs gcc vector extensions */
+#endif
+
 typedef struct
 {
   //uint32 cycles;                    /* current cycles count for graphics operation */
@@ -53,6 +57,9 @@ typedef struct
   uint8 lut_prio[4][0x10][0x10];    /* WORD-RAM data writes priority lookup table */
   uint8 lut_pixel[0x200];           /* Graphics operation dot offset lookup table */
   uint8 lut_cell[0x100];            /* Graphics operation stamp offset lookup table */
+#ifdef GFX_SIMD
+  uint16 lut_dot[2][0x2000];        /* Merged stamp and dot offset lookup table */
+#endif
 } gfx_t;
 
 static gfx_t gfx;
@@ -125,6 +132,24 @@ void gfx_init(void)
     /* pixel offset (0-63) */
     gfx.lut_pixel[i] = col + row * 8;
   }
+
+#ifdef GFX_SIMD
+  /* Initialize merged cell and pixel lookup table  */
+  /* table entry = shrryyyyyxxxxx (14 bits)          */
+  /* with:     s = stamp size (0=16x16, 1=32x32)     */
+  /*         hrr = HFLIP & ROTATION bits             */
+  /*       yyyyy = cell row and pixel row (0-31)     */
+  /*       xxxxx = cell column and pixel column      */
+  for (i=0; i<0x4000; i++)
+  {
+    int s = i >> 13, hrr = (i >> 10) & 7, y = (i >> 5) & 0x1f, x = i & 0x1f;
+
+    /* stamp offset (0-1023) */
+    gfx.lut_dot[s][i & 0x1fff] =
+      (gfx.lut_cell[hrr | (s << 3) | ((y << 3) & 0xc0) | ((x << 1) & 0x30)] << 6) |
+      gfx.lut_pixel[hrr | ((x << 3) & 0x38) | ((y << 6) & 0x1c0)];
+  }
+#endif
 }
 
 int gfx_context_save(uint8 *state)
@@ -175,6 +200,7 @@ int gfx_context_load(const uint8 *state)
   return bufferptr;
 }
 
+#ifndef GFX_SIMD
 static void gfx_render(uint32 bufferIndex, uint32 width)
 {
   uint8 pixel_in, pixel_out;
@@ -310,6 +336,95 @@ static void gfx_render(uint32 bufferIndex, uint32 width)
     ypos += yoffset;
   }
 }
+#endif
+
+#ifdef GFX_SIMD
+/* PicoDrive specific: gfx_render with the trace positions, stamp map indexes */
+/* and stamp offsets for VL dots computed at once in the lanes of a vector.   */
+/* Memory is still accessed per dot and in the same order, cell and pixel     */
+/* lookups are merged in lut_dot. The output is the same.                     */
+#ifdef __AVX2__
+#define VL 8
+#else
+#define VL 4
+#endif
+
+typedef uint32 vu32 __attribute__((vector_size(VL*4)));
+
+static void gfx_render_v(uint32 bufferIndex, uint32 width)
+{
+  const uint16 *lut_dot;
+  uint8 (*lut_prio)[0x10];
+  uint8 *ram = Pico_mcd->word_ram2M;
+  uint8 pixel, pixel_in, pixel_out;
+  uint32 stamp_data, stamp_index;
+  uint32 mask, xoffset, yoffset, i, n;
+  vu32 xpos, ypos, x, y, map, dot, out;
+
+  /* pixel map start position and offset values for current line */
+  xpos = (vu32){} + (*gfx.tracePtr++ << 8);
+  ypos = (vu32){} + (*gfx.tracePtr++ << 8);
+  xoffset = (int16) *gfx.tracePtr++;
+  yoffset = (int16) *gfx.tracePtr++;
+
+  /* positions of the dots in this group */
+  for (i = 0; i < VL; i++)
+  {
+    xpos[i] += i * xoffset;
+    ypos[i] += i * yoffset;
+  }
+
+  i = (Pico_mcd->s68k_regs[2] << 8) | Pico_mcd->s68k_regs[3];
+  lut_prio = gfx.lut_prio[(i >> 3) & 0x03];
+  lut_dot = gfx.lut_dot[(Pico_mcd->s68k_regs[0x58+1] >> 1) & 1];
+
+  /* stamp map range if repeated, else 24-bit range */
+  mask = (Pico_mcd->s68k_regs[0x58+1] & 0x01) ? gfx.dotMask : 0xffffff;
+
+  for (; width != 0; width -= n)
+  {
+    x = xpos & mask;
+    y = ypos & mask;
+
+    /* pixels outside stamp map are 0 */
+    out = (x | y) & ~gfx.dotMask;
+    map = (x >> gfx.stampShift) | ((y >> gfx.stampShift) << gfx.mapShift);
+    dot = ((y >> 6) & 0x3e0) | ((x >> 11) & 0x1f);
+
+    n = width < VL ? width : VL;
+    for (i = 0; i < n; i++)
+    {
+      /* pixels outside the stamp map and of stamp 0 are 0 */
+      pixel = 0;
+      if (!out[i])
+      {
+        stamp_data = gfx.mapPtr[map[i]];
+        stamp_index = (stamp_data & 0x7ff) << 8;
+        if (stamp_index)
+        {
+          stamp_index |= lut_dot[((stamp_data >> 3) & 0x1c00) | dot[i]];
+          pixel = READ_BYTE(ram, stamp_index >> 1);
+          pixel = (stamp_index & 1) ? pixel & 0x0f : pixel >> 4;
+        }
+      }
+
+      /* priority mode write to left or right pixel */
+      pixel_in = READ_BYTE(ram, bufferIndex >> 1);
+      if (bufferIndex & 1)
+        pixel_out = lut_prio[pixel_in & 0x0f][pixel] | (pixel_in & 0xf0);
+      else
+        pixel_out = (lut_prio[pixel_in >> 4][pixel] << 4) | (pixel_in & 0x0f);
+      WRITE_BYTE(ram, bufferIndex >> 1, pixel_out);
+
+      /* next pixel, or next cell at the end of a cell row */
+      bufferIndex += ((bufferIndex & 7) != 7) ? 1 : gfx.bufferOffset;
+    }
+
+    xpos += VL * xoffset;
+    ypos += VL * yoffset;
+  }
+}
+#endif
 
 void gfx_start(uint32 base)
 {
@@ -418,6 +533,7 @@ void gfx_update(unsigned int cycles)
     Pico_mcd->s68k_regs[0x58] = 0;
     Pico_mcd->s68k_regs[0x64] =
     Pico_mcd->s68k_regs[0x65] = 0;
+    pcd_s68k_poll_release(0x58);
 
     if (Pico_mcd->s68k_regs[0x33] & PCDS_IEN1) {
       elprintf(EL_INTS|EL_CD, "s68k: gfx_cd irq 1");
@@ -440,7 +556,11 @@ void gfx_update(unsigned int cycles)
     while (lines--)
     {
       /* process dots to image buffer */
+#ifdef GFX_SIMD
+      gfx_render_v(gfx.bufferStart, w);
+#else
       gfx_render(gfx.bufferStart, w);
+#endif
 
       /* increment image buffer start index for next line (8 pixels/line) */
       gfx.bufferStart += 8;
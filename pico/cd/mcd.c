@@ -8,6 +8,10 @@
 
 #include "../pico_int.h"
 #include "../sound/ym2612.h"
+#ifdef PCD_THREADS
+#include "../pico_thread.h"
+static void pcd_thr_stop(void);
+#endif
 
 extern unsigned char formatted_bram[4*0x10];
 
@@ -24,6 +28,9 @@ PICO_INTERNAL void PicoInitMCD(void)
 
 PICO_INTERNAL void PicoExitMCD(void)
 {
+#ifdef PCD_THREADS
+  pcd_thr_stop();
+#endif
   cdd_unload();
 }
 
@@ -43,6 +50,8 @@ PICO_INTERNAL void PicoPowerMCD(void)
   memset(Pico_mcd->s68k_regs, 0, sizeof(Pico_mcd->s68k_regs));
   memset(&Pico_mcd->pcm, 0, sizeof(Pico_mcd->pcm));
   memset(&Pico_mcd->m, 0, sizeof(Pico_mcd->m));
+  poll_init(&pcd_m68k_poll, 1, 0, POLL_MIN_RESET);
+  poll_init(&pcd_s68k_poll, 1, 0, 0);
 
   cdc_init();
   gfx_init();
@@ -198,17 +207,16 @@ static void pcd_dma_event(unsigned int now)
   cdc_dma_update();
 }
 
-typedef void (event_cb)(unsigned int now);
-
 /* times are in s68k (12.5MHz) cycles */
 unsigned int pcd_event_times[PCD_EVENT_COUNT];
-static unsigned int event_time_next;
-static event_cb *pcd_event_cbs[PCD_EVENT_COUNT] = {
+static event_cb * const pcd_event_cbs[PCD_EVENT_COUNT] = {
   pcd_cdc_event,            // PCD_EVENT_CDC
   pcd_int3_timer_event,     // PCD_EVENT_TIMER3
   gfx_update,               // PCD_EVENT_GFX
   pcd_dma_event,            // PCD_EVENT_DMA
 };
+static struct event_queue pcd_events =
+  EVENT_QUEUE(pcd_event_times, pcd_event_cbs, PCD_EVENT_COUNT, EL_CD, "cd");
 
 void pcd_event_schedule(unsigned int now, enum pcd_event event, int after)
 {
@@ -217,17 +225,14 @@ void pcd_event_schedule(unsigned int now, enum pcd_event event, int after)
   when = now + after;
   if (when == 0) {
     // event cancelled
-    pcd_event_times[event] = 0;
+    evq_set(&pcd_events, event, 0);
     return;
   }
 
   when |= 1;
 
   elprintf(EL_CD, "cd: new event #%u %u->%u", event, now, when);
-  pcd_event_times[event] = when;
-
-  if (event_time_next == 0 || CYCLES_GT(event_time_next, when))
-    event_time_next = when;
+  evq_set(&pcd_events, event, when);
 }
 
 void pcd_event_schedule_s68k(enum pcd_event event, int after)
@@ -240,41 +245,7 @@ void pcd_event_schedule_s68k(enum pcd_event event, int after)
 
 static void pcd_run_events(unsigned int until)
 {
-  int oldest, oldest_diff, time;
-  int i, diff;
-
-  while (1) {
-    oldest = -1, oldest_diff = 0x7fffffff;
-
-    for (i = 0; i < PCD_EVENT_COUNT; i++) {
-      if (pcd_event_times[i]) {
-        diff = pcd_event_times[i] - until;
-        if (diff < oldest_diff) {
-          oldest_diff = diff;
-          oldest = i;
-        }
-      }
-    }
-
-    if (oldest_diff <= 0) {
-      time = pcd_event_times[oldest];
-      pcd_event_times[oldest] = 0;
-      elprintf(EL_CD, "cd: run event #%d %u", oldest, time);
-      pcd_event_cbs[oldest](time);
-    }
-    else if (oldest_diff < 0x7fffffff) {
-      event_time_next = pcd_event_times[oldest];
-      break;
-    }
-    else {
-      event_time_next = 0;
-      break;
-    }
-  }
-
-  if (oldest != -1)
-    elprintf(EL_CD, "cd: next event #%d at %u",
-      oldest, event_time_next);
+  evq_run(&pcd_events, until);
 }
 
 void pcd_irq_s68k(int irq, int state)
@@ -283,12 +254,12 @@ void pcd_irq_s68k(int irq, int state)
     SekInterruptS68k(irq);
     if (SekIsStoppedS68k())
       SekSetStopS68k(0);
-    Pico_mcd->m.s68k_poll_a = 0;
+    poll_clear(&pcd_s68k_poll);
   } else
     SekInterruptClearS68k(irq);
 }
 
-int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
+static int sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
 {
   #define now SekCycleCntS68k
   unsigned int s68k_target;
@@ -308,19 +279,19 @@ int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
   }
 
   while (CYCLES_GT(s68k_target, now)) {
-    if (event_time_next && CYCLES_GE(now, event_time_next))
+    if (pcd_events.next && CYCLES_GE(now, pcd_events.next))
       pcd_run_events(now);
 
     target = s68k_target;
-    if (event_time_next && CYCLES_GT(target, event_time_next))
-      target = event_time_next;
+    if (pcd_events.next && CYCLES_GT(target, pcd_events.next))
+      target = pcd_events.next;
 
     if (SekIsStoppedS68k())
       SekCycleCntS68k = SekCycleAimS68k = target;
     else
       SekRunS68k(target);
 
-    if (m68k_poll_sync && Pico_mcd->m.m68k_poll_cnt == 0)
+    if (m68k_poll_sync && pcd_m68k_poll.cnt == 0)
       break;
   }
 
@@ -328,6 +299,166 @@ int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
   #undef now
 }
 
+int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
+{
+  PCD_THR_PARK();
+  return sync_s68k(m68k_target, m68k_poll_sync);
+}
+
+#ifdef PCD_THREADS
+/* Sub cpu thread (POPT_EN_S68K_THREAD). The s68k runs one line behind the
+ * m68k on a worker: at each line start the m68k waits until the worker is
+ * done with the previous line, then lets it run up to the current one.
+ * Gate array accesses and other syncs also wait for the worker and then catch
+ * up the s68k on the emulator thread as before. s68k code touching m68k side
+ * state (word RAM switches, comm writes releasing the polling m68k, tray
+ * callbacks) waits in PCD_THR_SHARED until the m68k is stopped at one of
+ * these points. Everything the two sides see of each other thus changes at
+ * the same emulated times on every run, so replays and netplay stay
+ * deterministic. The s68k runs a bit more often than single threaded, so
+ * timing is not exactly the same as with the thread disabled. */
+#define PCD_THR_SPIN 4000 // spins before sleeping on the condition variable
+
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;
+  pico_cond_t cond;
+  unsigned int seq;     // bumped on every state change
+  unsigned int target;  // m68k cycles to run the s68k to
+  int busy;             // worker has a target to run to
+  int parked;           // emulator thread waits for the worker
+  int spin;             // spin count in pcd_thr_wait, 0 on single cpu hosts
+  int running, failed, quit;
+} pcd_thr;
+
+int pcd_thr_active;
+static PICO_THREAD_LOCAL int pcd_thr_self;
+
+// tell the other thread about a state change. Must hold pcd_thr.lock
+static void pcd_thr_notify(void)
+{
+  pico_atomic_store(&pcd_thr.seq, pcd_thr.seq + 1);
+  pico_cond_broadcast(&pcd_thr.cond);
+}
+
+// wait for a state change of the other thread. Must hold pcd_thr.lock
+static void pcd_thr_wait(void)
+{
+  unsigned int seq = pcd_thr.seq;
+  int i;
+
+  // lines are short, avoid the sleep/wakeup latency if possible
+  pico_mutex_unlock(&pcd_thr.lock);
+  for (i = 0; i < pcd_thr.spin && pico_atomic_load(&pcd_thr.seq) == seq; i++)
+    pico_cpu_relax();
+  pico_mutex_lock(&pcd_thr.lock);
+
+  while (pcd_thr.seq == seq)
+    pico_cond_wait(&pcd_thr.cond, &pcd_thr.lock);
+}
+
+static void *pcd_thr_worker(void *arg)
+{
+  pcd_thr_self = 1;
+
+  pico_mutex_lock(&pcd_thr.lock);
+  for (;;) {
+    while (!pcd_thr.busy && !pcd_thr.quit)
+      pcd_thr_wait();
+    if (pcd_thr.quit)
+      break;
+
+    pico_mutex_unlock(&pcd_thr.lock);
+    sync_s68k(pcd_thr.target, 0);
+    pico_mutex_lock(&pcd_thr.lock);
+
+    pico_atomic_store(&pcd_thr.busy, 0);
+    pcd_thr_notify();
+  }
+  pico_mutex_unlock(&pcd_thr.lock);
+  return NULL;
+}
+
+// called on the worker, wait until the m68k is stopped
+void pcd_thr_shared(void)
+{
+  if (!pcd_thr_self)
+    return;
+
+  pico_mutex_lock(&pcd_thr.lock);
+  while (!pcd_thr.parked)
+    pcd_thr_wait();
+  pico_mutex_unlock(&pcd_thr.lock);
+}
+
+// called on the emulator thread, wait until the worker is done
+void pcd_thr_park(void)
+{
+  if (!pico_atomic_load(&pcd_thr.busy))
+    return;
+
+  pico_mutex_lock(&pcd_thr.lock);
+  pcd_thr.parked = 1;
+  pcd_thr_notify();
+  while (pcd_thr.busy)
+    pcd_thr_wait();
+  pcd_thr.parked = 0;
+  pico_mutex_unlock(&pcd_thr.lock);
+}
+
+// let the worker run the s68k up to m68k_target
+static void pcd_thr_run(unsigned int m68k_target)
+{
+  pcd_thr_park();
+
+  pico_mutex_lock(&pcd_thr.lock);
+  pcd_thr.target = m68k_target;
+  pico_atomic_store(&pcd_thr.busy, 1);
+  pcd_thr_notify();
+  pico_mutex_unlock(&pcd_thr.lock);
+}
+
+static int pcd_thr_start(void)
+{
+  if (pcd_thr.running)
+    return 1;
+  if (pcd_thr.failed)
+    return 0;
+
+  pico_mutex_init(&pcd_thr.lock);
+  pico_cond_init(&pcd_thr.cond);
+  pcd_thr.busy = pcd_thr.parked = pcd_thr.quit = 0;
+  pcd_thr.spin = pico_cpu_count() > 1 ? PCD_THR_SPIN : 0;
+  if (pico_thread_create(&pcd_thr.thread, pcd_thr_worker, NULL) != 0) {
+    elprintf(EL_STATUS, "cd: failed to create s68k thread");
+    pico_cond_destroy(&pcd_thr.cond);
+    pico_mutex_destroy(&pcd_thr.lock);
+    pcd_thr.failed = 1;
+    return 0;
+  }
+  pcd_thr.running = 1;
+  return 1;
+}
+
+static void pcd_thr_stop(void)
+{
+  pcd_thr_active = 0;
+  if (!pcd_thr.running)
+    return;
+
+  pcd_thr_park();
+  pico_mutex_lock(&pcd_thr.lock);
+  pcd_thr.quit = 1;
+  pcd_thr_notify();
+  pico_mutex_unlock(&pcd_thr.lock);
+  pico_thread_join(pcd_thr.thread);
+
+  pico_cond_destroy(&pcd_thr.cond);
+  pico_mutex_destroy(&pcd_thr.lock);
+  pcd_thr.running = 0;
+}
+#endif
+
 #define pcd_run_cpus_normal pcd_run_cpus
 //#define pcd_run_cpus_lockstep pcd_run_cpus
 
@@ -335,16 +466,22 @@ static void SekSyncM68k(void);
 
 void pcd_run_cpus_normal(int m68k_cycles)
 {
+#ifdef PCD_THREADS
+  // PRG RAM may be accessed by the m68k if the s68k is halted
+  if (pcd_thr_active && Pico_mcd->m.busreq == 1)
+    pcd_thr_run(Pico.t.m68c_aim);
+#endif
   Pico.t.m68c_aim += m68k_cycles;
 
   while (CYCLES_GT(Pico.t.m68c_aim, Pico.t.m68c_cnt)) {
     if (SekShouldInterrupt())
-      Pico_mcd->m.m68k_poll_cnt = 0;
+      poll_reset(&pcd_m68k_poll);
 
 #ifdef USE_POLL_DETECT
-    if (Pico_mcd->m.m68k_poll_cnt >= 16) {
+    if (pcd_m68k_poll.cnt >= 16) {
       int s68k_left;
       // main CPU is polling, (wake and) run sub only
+      PCD_THR_PARK();
       if (SekIsStoppedS68k())
         SekSetStopS68k(0);
       s68k_left = pcd_sync_s68k(Pico.t.m68c_aim, 1);
@@ -354,10 +491,10 @@ void pcd_run_cpus_normal(int m68k_cycles)
         Pico.t.m68c_cnt -= ((long long)s68k_left * mcd_s68k_cycle_mult >> 16);
       if (SekIsStoppedS68k()) {
         // slave has stopped, wake master to avoid lockups
-        Pico_mcd->m.m68k_poll_cnt = 0;
+        poll_reset(&pcd_m68k_poll);
       }
-      elprintf(EL_CDPOLL, "m68k poll [%02x] x%d @%06x",
-        Pico_mcd->m.m68k_poll_a, Pico_mcd->m.m68k_poll_cnt, SekPc);
+      elprintf(EL_CDPOLL, "m68k poll x%d @%06x",
+        pcd_m68k_poll.cnt, SekPc);
     } else
 #endif
       SekRunM68kOnce();
@@ -389,6 +526,12 @@ void pcd_run_cpus_lockstep(int m68k_cycles)
 
 void pcd_prepare_frame(void)
 {
+#ifdef PCD_THREADS
+  if (PicoIn.opt & POPT_EN_S68K_THREAD)
+    pcd_thr_active = pcd_thr_start();
+  else
+    pcd_thr_stop();
+#endif
   pcd_set_cycle_mult();
 
   // need this because we can't have direct mapping between
@@ -437,7 +580,7 @@ void pcd_state_loaded(void)
     Pico_mcd->pcm.update_cycles = cycles;
 
   // reschedule
-  event_time_next = 0;
+  evq_reload(&pcd_events);
   pcd_run_events(SekCycleCntS68k);
 }
 
@@ -62,14 +62,20 @@ void PicoWriteS68k16_dec_m2b1(u32 a, u32 d);
 static void remap_prg_window(u32 r1, u32 r3);
 static void remap_word_ram(u32 r3);
 
-// poller detection
+// poller detection. Besides the comm regs, the word RAM flags (reg 2) and the
+// gate array status in regs 4 (CDC) and 0x58 (ASIC) are polled. A cpu is only
+// woken by a change of the register it polls, keys are word addresses.
 #define POLL_LIMIT 16
 #define POLL_CYCLES 64
 
+struct poll_det pcd_m68k_poll, pcd_s68k_poll;
+
 void m68k_comm_check(u32 a)
 {
   u32 cycles = SekCyclesDone();
-  u32 clkdiff = cycles - Pico_mcd->m.m68k_poll_clk;
+  int cnt;
+
+  a &= ~1; // the asm handlers pass byte addresses
   pcd_sync_s68k(cycles, 0);
   if (a >= 0x0e && !Pico_mcd->m.need_sync) {
     // there are cases when slave updates comm and only switches RAM
@@ -77,15 +83,14 @@ void m68k_comm_check(u32 a)
     SekEndRun(64);
     Pico_mcd->m.need_sync = 1;
   }
-  Pico_mcd->m.m68k_poll_clk = cycles;
-  if (SekNotPolling || a != Pico_mcd->m.m68k_poll_a || clkdiff > POLL_CYCLES || clkdiff <= 16) {
-    Pico_mcd->m.m68k_poll_a = a;
-    Pico_mcd->m.m68k_poll_cnt = 0;
+  // accesses up to 16 cycles apart aren't a poll loop, restart counting
+  cnt = poll_detect(&pcd_m68k_poll, a, cycles, 17, POLL_CYCLES);
+  if (SekNotPolling) {
+    poll_reset(&pcd_m68k_poll);
     SekNotPolling = 0;
     return;
   }
-  Pico_mcd->m.m68k_poll_cnt++;
-  if(Pico_mcd->m.m68k_poll_cnt == POLL_LIMIT)
+  if (cnt == POLL_LIMIT)
     SekEndRun(0);
 }
 
@@ -107,6 +112,7 @@ static u32 m68k_reg_read16(u32 a)
       elprintf(EL_CDREG3, "m68k_regs r3: %02x @%06x", (u8)d, SekPc);
       goto end;
     case 4:
+      m68k_comm_check(a);
       d = Pico_mcd->s68k_regs[4]<<8;
       goto end;
     case 6:
@@ -149,7 +155,7 @@ void m68k_reg_write8(u32 a, u32 d)
   u32 dold;
   a &= 0x3f;
 
-  Pico_mcd->m.m68k_poll_cnt = 0;
+  poll_reset(&pcd_m68k_poll);
 
   switch (a) {
     case 0:
@@ -243,39 +249,48 @@ write_comm:
     // Delay slave a bit to make sure master can check before slave changes.
     SekCycleCntS68k += 24;
   }
-  if (Pico_mcd->m.s68k_poll_a == (a & ~1))
+  pcd_s68k_poll_release(a);
+}
+
+// register a was changed by the m68k or by the hardware
+void pcd_s68k_poll_release(u32 a)
+{
+  if (poll_watching(&pcd_s68k_poll, a & ~1))
   {
-    if (Pico_mcd->m.s68k_poll_cnt > POLL_LIMIT) {
+    if (pcd_s68k_poll.cnt > POLL_LIMIT) {
       elprintf(EL_CDPOLL, "s68k poll release, a=%02x", a);
       SekSetStopS68k(0);
     }
-    Pico_mcd->m.s68k_poll_a = 0;
+    poll_clear(&pcd_s68k_poll);
+  }
+}
+
+// register a was changed by the s68k, must be done after PCD_THR_SHARED
+static void m68k_poll_release(u32 a)
+{
+  if (poll_watching(&pcd_m68k_poll, a & ~1))
+  {
+    if (pcd_m68k_poll.cnt)
+      SekEndRunS68k(0);
+    poll_reset(&pcd_m68k_poll);
   }
 }
 
 u32 s68k_poll_detect(u32 a, u32 d)
 {
 #ifdef USE_POLL_DETECT
-  u32 cycles, cnt = 0;
+  int cnt;
   if (SekIsStoppedS68k())
     return d;
 
-  cycles = SekCyclesDoneS68k();
-  if (!SekNotPollingS68k && a == Pico_mcd->m.s68k_poll_a) {
-    u32 clkdiff = cycles - Pico_mcd->m.s68k_poll_clk;
-    if (clkdiff <= POLL_CYCLES) {
-      cnt = Pico_mcd->m.s68k_poll_cnt + 1;
-      //printf("-- diff: %u, cnt = %i\n", clkdiff, cnt);
-      if (Pico_mcd->m.s68k_poll_cnt > POLL_LIMIT) {
-        SekSetStopS68k(1);
-        elprintf(EL_CDPOLL, "s68k poll detected @%06x, a=%02x",
-          SekPcS68k, a);
-      }
-    }
+  cnt = poll_detect(&pcd_s68k_poll, a, SekCyclesDoneS68k(), 0, POLL_CYCLES);
+  if (SekNotPollingS68k)
+    poll_reset(&pcd_s68k_poll);
+  else if (cnt > POLL_LIMIT + 1) { // more than POLL_LIMIT before this one
+    SekSetStopS68k(1);
+    elprintf(EL_CDPOLL, "s68k poll detected @%06x, a=%02x",
+      SekPcS68k, a);
   }
-  Pico_mcd->m.s68k_poll_a = a;
-  Pico_mcd->m.s68k_poll_clk = cycles;
-  Pico_mcd->m.s68k_poll_cnt = cnt;
   SekNotPollingS68k = 0;
 #endif
   return d;
@@ -337,7 +352,7 @@ u32 s68k_reg_read16(u32 a)
 
   d = (Pico_mcd->s68k_regs[a]<<8) | Pico_mcd->s68k_regs[a+1];
 
-  if (a >= 0x0e && a < 0x30)
+  if ((a >= 0x0e && a < 0x30) || a == 0x04 || a == 0x58)
     return s68k_poll_detect(a, d);
 
   return d;
@@ -357,7 +372,10 @@ void s68k_reg_write8(u32 a, u32 d)
     case 2:
       return; // only m68k can change WP
     case 3: {
-      int dold = Pico_mcd->s68k_regs[3];
+      int dold;
+      // word RAM mode/owner change, remaps m68k memory
+      PCD_THR_SHARED();
+      dold = Pico_mcd->s68k_regs[3];
       elprintf(EL_CDREG3, "s68k_regs w3: %02x @%06x", (u8)d, SekPcS68k);
       d &= 0x1d;
       d |= dold & 0xc2;
@@ -399,9 +417,16 @@ void s68k_reg_write8(u32 a, u32 d)
     case 5:
       //dprintf("s68k CDC reg addr: %x", d&0xf);
       break;
-    case 7:
+    case 7: {
+      u32 dold = Pico_mcd->s68k_regs[4];
       cdc_reg_w(d & 0xff);
+      if (Pico_mcd->s68k_regs[4] != dold) {
+        // DSR/EDT, possibly polled by the m68k for a host read
+        PCD_THR_SHARED();
+        m68k_poll_release(4);
+      }
       return;
+    }
     case 0xa:
       elprintf(EL_CDREGS, "s68k set CDC dma addr");
       break;
@@ -491,16 +516,15 @@ void s68k_reg_write8(u32 a, u32 d)
 
 write_comm:
   Pico_mcd->s68k_regs[a] = (u8) d;
-  if (Pico_mcd->m.m68k_poll_cnt)
-    SekEndRunS68k(0);
-  Pico_mcd->m.m68k_poll_cnt = 0;
+  PCD_THR_SHARED();
+  m68k_poll_release(a);
 }
 
 void s68k_reg_write16(u32 a, u32 d)
 {
   u8 *r = Pico_mcd->s68k_regs;
 
-  Pico_mcd->m.s68k_poll_cnt = 0;
+  poll_reset(&pcd_s68k_poll);
 
   if ((a & 0x1f0) == 0x20)
     goto write_comm;
@@ -552,9 +576,8 @@ void s68k_reg_write16(u32 a, u32 d)
 write_comm:
   r[a] = d >> 8;
   r[a + 1] = d;
-  if (Pico_mcd->m.m68k_poll_cnt)
-    SekEndRunS68k(0);
-  Pico_mcd->m.m68k_poll_cnt = 0;
+  PCD_THR_SHARED();
+  m68k_poll_release(a);
 }
 
 // -----------------------------------------------------------------
@@ -675,6 +698,7 @@ u32 PicoRead8_mcd_io(u32 a)
 {
   u32 d;
   if ((a & 0xff00) == 0x2000) { // a12000 - a120ff
+    PCD_THR_PARK();
     d = m68k_reg_read16(a); // TODO: m68k_reg_read8
     if (!(a & 1))
       d >>= 8;
@@ -692,6 +716,7 @@ u32 PicoRead16_mcd_io(u32 a)
 {
   u32 d;
   if ((a & 0xff00) == 0x2000) {
+    PCD_THR_PARK();
     d = m68k_reg_read16(a);
     elprintf(EL_CDREGS, "m68k_regs r16: [%02x] %04x @%06x",
       a & 0x3f, d, SekPc);
@@ -706,6 +731,7 @@ void PicoWrite8_mcd_io(u32 a, u32 d)
   if ((a & 0xff00) == 0x2000) { // a12000 - a120ff
     elprintf(EL_CDREGS, "m68k_regs w8:  [%02x]   %02x @%06x",
       a & 0x3f, d, SekPc);
+    PCD_THR_PARK();
     m68k_reg_write8(a, d);
     return;
   }
@@ -718,6 +744,7 @@ void PicoWrite16_mcd_io(u32 a, u32 d)
   if ((a & 0xff00) == 0x2000) { // a12000 - a120ff
     elprintf(EL_CDREGS, "m68k_regs w16: [%02x] %04x @%06x",
       a & 0x3f, d, SekPc);
+    PCD_THR_PARK();
 
     m68k_reg_write8(a, d >> 8);
     if ((a & 0x3e) != 0x0e) // special case
@@ -1090,6 +1117,17 @@ static void remap_word_ram(u32 r3)
   }
 }
 
+// the poll trackers watch one address, which fits in the old mcd_misc fields
+void pcd_state_save_mem(void)
+{
+  Pico_mcd->m.m68k_poll_a = pcd_m68k_poll.addr[0];
+  Pico_mcd->m.m68k_poll_cnt = pcd_m68k_poll.cnt;
+  Pico_mcd->m.m68k_poll_clk = pcd_m68k_poll.cycles;
+  Pico_mcd->m.s68k_poll_a = pcd_s68k_poll.addr[0];
+  Pico_mcd->m.s68k_poll_cnt = pcd_s68k_poll.cnt;
+  Pico_mcd->m.s68k_poll_clk = pcd_s68k_poll.cycles;
+}
+
 void pcd_state_loaded_mem(void)
 {
   u32 r3 = Pico_mcd->s68k_regs[3];
@@ -1100,6 +1138,14 @@ void pcd_state_loaded_mem(void)
   remap_word_ram(r3);
   remap_prg_window(Pico_mcd->m.busreq, r3);
   Pico_mcd->m.dmna_ret_2m &= 3;
+  poll_clear(&pcd_m68k_poll);
+  pcd_m68k_poll.addr[0] = Pico_mcd->m.m68k_poll_a;
+  pcd_m68k_poll.cnt = Pico_mcd->m.m68k_poll_cnt;
+  pcd_m68k_poll.cycles = Pico_mcd->m.m68k_poll_clk;
+  poll_clear(&pcd_s68k_poll);
+  pcd_s68k_poll.addr[0] = Pico_mcd->m.s68k_poll_a;
+  pcd_s68k_poll.cnt = Pico_mcd->m.s68k_poll_cnt;
+  pcd_s68k_poll.cycles = Pico_mcd->m.s68k_poll_clk;
 
   // restore hint vector
   *(u16 *)(Pico_mcd->bios + 0x72) = Pico_mcd->m.hint_vector;
@@ -8,6 +8,10 @@
 
 #include "../pico_int.h"
 
+#if defined(GFX_SIMD) && !((__GNUC__ >= 5 || defined(__clang__)) && CPU_IS_LE)
+#undef GFX_SIMD /* needs gcc vector shuffles, word order as on LE hosts */
+#endif
+
 unsigned char formatted_bram[4*0x10] =
 {
 #if 0
@@ -30,6 +34,60 @@ unsigned char formatted_bram[4*0x10] =
 // 256K | unused | bank1  |
 
 #ifndef _ASM_MISC_C
+#ifdef GFX_SIMD
+/*
+ * The 2M layout interleaves the words of both 1M banks. Deinterleave and
+ * interleave 16 words at a time with vector shuffles (SSE2 on x86, NEON on
+ * arm64). Blocks are loaded completely before they are stored, so the in
+ * place conversion works like the word by word version.
+ */
+typedef unsigned short v8hu __attribute__((vector_size(16)));
+typedef unsigned short v8hu_u __attribute__((vector_size(16), aligned(2)));
+
+#ifdef __clang__
+#define SHUFFLE(a, b, ...) __builtin_shufflevector(a, b, __VA_ARGS__)
+#else
+#define SHUFFLE(a, b, ...) __builtin_shuffle(a, b, (v8hu){ __VA_ARGS__ })
+#endif
+
+PICO_INTERNAL_ASM void wram_2M_to_1M(unsigned char *m)
+{
+	v8hu_u *m2M, *m1M_b0, *m1M_b1;
+	v8hu a, b;
+	unsigned int i;
+
+	m2M = (v8hu_u *) (m + 0x40000);
+	m1M_b0 = (v8hu_u *) m2M;
+	m1M_b1 = (v8hu_u *) (m + 0x60000);
+
+	for (i = 0x40000/32; i; i--)
+	{
+		b = *(--m2M);
+		a = *(--m2M);
+		*(--m1M_b0) = SHUFFLE(a, b, 0, 2, 4, 6, 8, 10, 12, 14);
+		*(--m1M_b1) = SHUFFLE(a, b, 1, 3, 5, 7, 9, 11, 13, 15);
+	}
+}
+
+PICO_INTERNAL_ASM void wram_1M_to_2M(unsigned char *m)
+{
+	v8hu_u *m2M, *m1M_b0, *m1M_b1;
+	v8hu a, b;
+	unsigned int i;
+
+	m2M = (v8hu_u *) m;
+	m1M_b0 = (v8hu_u *) (m + 0x20000);
+	m1M_b1 = (v8hu_u *) (m + 0x40000);
+
+	for (i = 0x40000/32; i; i--)
+	{
+		a = *m1M_b0++;
+		b = *m1M_b1++;
+		*m2M++ = SHUFFLE(a, b, 0, 8, 1, 9, 2, 10, 3, 11);
+		*m2M++ = SHUFFLE(a, b, 4, 12, 5, 13, 6, 14, 7, 15);
+	}
+}
+#else
 PICO_INTERNAL_ASM void wram_2M_to_1M(unsigned char *m)
 {
 	unsigned short *m1M_b0, *m1M_b1;
@@ -63,4 +121,5 @@ PICO_INTERNAL_ASM void wram_1M_to_2M(unsigned char *m)
 	}
 }
 #endif
+#endif
 
@@ -7,6 +7,7 @@
  */
 
 #include "../pico_int.h"
+#include "../sound/resampler.h"
 
 #define PCM_STEP_SHIFT 11
 
@@ -120,39 +121,36 @@ end:
   Pico_mcd->pcm_mixpos += steps;
 }
 
-void pcd_pcm_update(s32 *buf32, int length, int stereo)
+// native rate, 12.5MHz / 384 -> sndRate
+static struct resampler pcm_resampler;
+static int pcm_rs_idle;
+
+void pcd_pcm_rerate(void)
 {
-  int step, *pcm;
-  int p = 0;
+  resampler_init_paced(&pcm_resampler, 12500000 / 384, PicoIn.sndRate);
+  pcm_rs_idle = 1;
+}
 
+void pcd_pcm_update(s32 *buf32, int length, int stereo)
+{
   pcd_pcm_sync(SekCyclesDoneS68k());
 
-  if (!Pico_mcd->pcm_mixbuf_dirty || !(PicoIn.opt & POPT_EN_MCD_PCM))
+  if (!(PicoIn.opt & POPT_EN_MCD_PCM))
     goto out;
-
-  step = (Pico_mcd->pcm_mixpos << 16) / length;
-  pcm = Pico_mcd->pcm_mixbuf;
-
-  if (stereo) {
-    while (length-- > 0) {
-      *buf32++ += pcm[0];
-      *buf32++ += pcm[1];
-
-      p += step;
-      pcm += (p >> 16) * 2;
-      p &= 0xffff;
-    }
-  }
-  else {
-    while (length-- > 0) {
-      // mostly unused
-      *buf32++ += pcm[0];
-
-      p += step;
-      pcm += (p >> 16) * 2;
-      p &= 0xffff;
-    }
+  if (!Pico_mcd->pcm_mixbuf_dirty) {
+    // run one frame of silence to play out the filter, then stay idle
+    if (pcm_rs_idle)
+      goto out;
+    pcm_rs_idle = 1;
   }
+  else
+    pcm_rs_idle = 0;
+
+  // 8 channels add up to 17 bits, halve them for the dot product
+  resampler_push_32(&pcm_resampler, Pico_mcd->pcm_mixbuf,
+    Pico_mcd->pcm_mixpos, 1);
+  resampler_mix_paced(&pcm_resampler, buf32, length,
+    Pico_mcd->pcm_mixpos, 13, stereo);
 
   memset(Pico_mcd->pcm_mixbuf, 0,
     Pico_mcd->pcm_mixpos * 2 * sizeof(Pico_mcd->pcm_mixbuf[0]));
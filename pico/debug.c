@@ -10,6 +10,9 @@
 #include "sound/ym2612.h"
 #include "memory.h"
 #include "debug.h"
+#include <cpu/sh2/compiler.h>
+#include "cd/genplus_macros.h"
+#include "cd/cdd.h"
 
 #define bit(r, x) ((r>>x)&1)
 #define MVP dstrp+=strlen(dstrp)
@@ -56,6 +59,13 @@ char *PDebugMain(void)
   }
   sprintf(dstrp, "z80Run: %i, z80_reset: %i, z80_bnk: %06x\n", Pico.m.z80Run, Pico.m.z80_reset, Pico.m.z80_bank68k<<15); MVP;
   z80_debug(dstrp); MVP;
+  if (PicoIn.AHW & PAHW_MCD) {
+    struct pm_cache_stats st;
+    if (pm_cache_stats(cdd.toc.tracks[0].fd, &st) == 0) {
+      sprintf(dstrp, "chd cache: hits %u, misses %u, read ahead %u, hunks %u/%u\n",
+        st.hits, st.misses, st.prefetched, st.used, st.size); MVP;
+    }
+  }
   if (strlen(dstr) > sizeof(dstr))
     elprintf(EL_STATUS, "warning: debug buffer overflow (%i/%i)\n", strlen(dstr), sizeof(dstr));
 
@@ -94,6 +104,24 @@ char *PDebug32x(void)
   sprintf(dstrp, "gb,vb %08lx,%08lx %08lx,%08lx\n", (ulong)sh2_gbr(0), (ulong)sh2_vbr(0), (ulong)sh2_gbr(1), (ulong)sh2_vbr(1)); MVP;
   sprintf(dstrp, "IRQs/mask:        %02x/%02x             %02x/%02x\n",
     Pico32x.sh2irqi[0], Pico32x.sh2irq_mask[0], Pico32x.sh2irqi[1], Pico32x.sh2irq_mask[1]); MVP;
+  sprintf(dstrp, "sync: step %u, %u syncs, %u slices, %u other\n",
+    p32x_sync_stats_last.step, p32x_sync_stats_last.syncs,
+    p32x_sync_stats_last.slices, p32x_sync_stats_last.others); MVP;
+  sprintf(dstrp, "      %u comm, %u polls, %u irqs\n",
+    p32x_sync_stats_last.comm, p32x_sync_stats_last.polls,
+    p32x_sync_stats_last.irqs); MVP;
+#ifdef DRC_SH2
+  if (PicoIn.opt & POPT_EN_DRC) {
+    struct sh2_drc_stats st;
+    sprintf(dstrp, "tcache  used/size  blks  trans retrans  evict rescue super\n"); MVP;
+    for (i = 0; i < 3; i++) {
+      sh2_drc_get_stats(i, &st);
+      sprintf(dstrp, "%d %5uk/%5uk %5u %6u %7u %6u %6u %5u\n", i,
+        st.tcache_used >> 10, st.tcache_size >> 10, st.blocks, st.translations,
+        st.retranslations, st.evictions, st.rescues, st.superblocks); MVP;
+    }
+  }
+#endif
 #else
   dstr[0] = 0;
 #endif
@@ -0,0 +1,66 @@
+/*
+ * PicoDrive
+ * event scheduling for the add-on hardware, shared by 32X and MCD
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * There are only a few events per queue, each scheduled at most once. The
+ * earliest one is cached, which makes scheduling and asking for the next
+ * event O(1). Only if the earliest event is run, cancelled or moved to a
+ * later time the times need to be scanned again.
+ */
+
+#include "pico_int.h"
+
+// is a earlier than b? at equal times the lower event number goes first
+#define EARLIER(ta, a, tb, b) \
+  (CYCLES_GT(tb, ta) || ((ta) == (tb) && (a) < (b)))
+
+void evq_reload(struct event_queue *q)
+{
+  int ev;
+
+  q->next = 0, q->next_ev = -1;
+  for (ev = 0; ev < q->count; ev++) {
+    if (q->times[ev] == 0)
+      continue;
+    if (q->next == 0 || EARLIER(q->times[ev], ev, q->next, q->next_ev))
+      q->next = q->times[ev], q->next_ev = ev;
+  }
+}
+
+void evq_set(struct event_queue *q, int ev, unsigned int when)
+{
+  q->times[ev] = when;
+
+  if (when && (q->next == 0 || EARLIER(when, ev, q->next, q->next_ev)))
+    q->next = when, q->next_ev = ev;
+  else if (ev == q->next_ev)
+    evq_reload(q); // earliest event cancelled or moved later
+}
+
+void evq_run(struct event_queue *q, unsigned int until)
+{
+  unsigned int time;
+  int ev;
+
+  while (q->next && CYCLES_GE(until, q->next)) {
+    ev = q->next_ev, time = q->next;
+    if (q->times[ev] != time) {
+      // times changed behind our back (savestate loading)
+      evq_reload(q);
+      continue;
+    }
+
+    q->times[ev] = 0;
+    evq_reload(q);
+    elprintf(q->log, "%s: run event #%d %u", q->name, ev, time);
+    q->cbs[ev](time);
+  }
+
+  if (q->next)
+    elprintf(q->log, "%s: next event #%d at %u", q->name, q->next_ev, q->next);
+}
+
+// vim:shiftwidth=2:ts=2:expandtab
@@ -0,0 +1,36 @@
+/*
+ * PicoDrive
+ * event scheduling for the add-on hardware, shared by 32X and MCD
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#ifndef PICO_EVENT_INCLUDED
+#define PICO_EVENT_INCLUDED
+
+typedef void (event_cb)(unsigned int now);
+
+// Times are in the clock of the owner and always odd, 0 means not scheduled.
+// The owner keeps the times array (it's part of the savestate), the queue
+// caches the earliest event so that cpu loops can run straight to it.
+struct event_queue {
+  unsigned int *times;
+  event_cb * const *cbs;
+  int count;
+  int log;                // elprintf mask
+  const char *name;
+  unsigned int next;      // time of the earliest event, 0 if none
+  int next_ev;            // the earliest event, -1 if none
+};
+
+#define EVENT_QUEUE(times, cbs, count, log, name) \
+  { times, cbs, count, log, name, 0, -1 }
+
+// schedule event ev at time when, or cancel it if when is 0
+void evq_set(struct event_queue *q, int ev, unsigned int when);
+// run all events up to and including time until
+void evq_run(struct event_queue *q, unsigned int until);
+// find the earliest event again after the times have been changed directly
+void evq_reload(struct event_queue *q);
+
+#endif // PICO_EVENT_INCLUDED
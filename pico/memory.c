@@ -382,8 +382,7 @@ void NOINLINE ctl_write_z80reset(u32 d)
         PicoSyncZ80(SekCyclesDone());
         pprof_end_sub(m68k);
       }
-      YM2612ResetChip();
-      timers_reset();
+      PsndResetFM();
     }
     else
     {
@@ -399,20 +398,17 @@ static int get_scanline(int is_from_z80);
 static void psg_write_68k(u32 d)
 {
   // look for volume write and update if needed
-  if ((d & 0x90) == 0x90)
-    PsndDoPSG(Pico.m.scanline);
-
-  SN76496Write(d);
+  PsndWritePSG((d & 0x90) == 0x90 ? Pico.m.scanline : -1, d);
 }
 
 static void psg_write_z80(u32 d)
 {
-  if ((d & 0x90) == 0x90) {
-    int scanline = get_scanline(1);
-    PsndDoPSG(scanline);
-  }
+  int scanline = -1;
 
-  SN76496Write(d);
+  if ((d & 0x90) == 0x90)
+    scanline = get_scanline(1);
+
+  PsndWritePSG(scanline, d);
 }
 
 // -----------------------------------------------------------------
@@ -1034,8 +1030,7 @@ static int ym2612_write_local(u32 a, u32 d, int is_from_z80)
 #ifdef __GP2X__
             if (PicoIn.opt & POPT_EXT_FM) return YM2612Write_940(a, d, get_scanline(is_from_z80));
 #endif
-            PsndDoFM(cycles);
-            return 1;
+            return PsndWriteFM(cycles, -1, d);
           }
           return 0;
         }
@@ -1070,8 +1065,8 @@ static int ym2612_write_local(u32 a, u32 d, int is_from_z80)
   if (PicoIn.opt & POPT_EXT_FM)
     return YM2612Write_940(a, d, get_scanline(is_from_z80));
 #endif
-  PsndDoFM(is_from_z80 ? z80_cyclesDone() : z80_cycles_from_68k());
-  return YM2612Write_(a, d);
+  return PsndWriteFM(is_from_z80 ? z80_cyclesDone() : z80_cycles_from_68k(),
+                     addr, d);
 }
 
 
@@ -1109,6 +1104,8 @@ void ym2612_pack_state(void)
 {
   // timers are saved as tick counts, in 16.16 int format
   int tac, tat = 0, tbc, tbt = 0;
+
+  PsndFlushLog();
   tac = 1024 - ym2612.OPN.ST.TA;
   tbc = 256  - ym2612.OPN.ST.TB;
   if (Pico.t.timer_a_next_oflow != TIMER_NO_OFLOW)
@@ -1131,6 +1128,8 @@ void ym2612_pack_state(void)
 void ym2612_unpack_state(void)
 {
   int i, ret, tac, tat, tbc, tbt;
+
+  PsndFlushLog();
   YM2612PicoStateLoad();
 
   // feed all the registers and update internal state
@@ -1154,6 +1153,7 @@ void ym2612_unpack_state(void)
     ym2612_write_local(2, i, 0);
     ym2612_write_local(3, ym2612.REGS[i|0x100], 0);
   }
+  PsndFlushLog();
 
 #ifdef __GP2X__
   if (PicoIn.opt & POPT_EXT_FM)
@@ -228,6 +228,28 @@ void PicoLoopPrepare(void)
 
 #include "pico_cmn.c"
 
+/* run z80 in short slices, skipping idle loops in between */
+static void PicoSyncZ80Idle(unsigned int aim)
+{
+  int cnt, skip;
+
+  while ((cnt = aim - Pico.t.z80c_cnt) > 0) {
+    skip = z80_idle_skip(Pico.t.z80c_cnt, cnt);
+    if (skip > 0) {
+      Pico.t.z80c_cnt += skip;
+      continue;
+    }
+    if (skip < 0)
+      cnt = 1; // step to the loop start
+    else if (cnt > Z80_IDLE_SLICE)
+      cnt = Z80_IDLE_SLICE;
+
+    Pico.t.z80c_aim = Pico.t.z80c_cnt + cnt;
+    Pico.t.z80c_cnt += z80_run(cnt);
+  }
+  Pico.t.z80c_aim = aim;
+}
+
 /* sync z80 to 68k */
 PICO_INTERNAL void PicoSyncZ80(unsigned int m68k_cycles_done)
 {
@@ -244,8 +266,12 @@ PICO_INTERNAL void PicoSyncZ80(unsigned int m68k_cycles_done)
     Pico.t.z80c_cnt, Pico.t.z80c_cnt * 15 / 7 / 488,
     Pico.t.z80c_aim, Pico.t.z80c_aim * 15 / 7 / 488);
 
-  if (cnt > 0)
-    Pico.t.z80c_cnt += z80_run(cnt);
+  if (cnt > 0) {
+    if (PicoIn.opt & POPT_DIS_IDLE_DET)
+      Pico.t.z80c_cnt += z80_run(cnt);
+    else
+      PicoSyncZ80Idle(Pico.t.z80c_aim);
+  }
 
   pprof_end(z80);
 }
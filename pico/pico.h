@@ -24,6 +24,7 @@ extern void lprintf(const char *fmt, ...);
 extern int  mp3_get_bitrate(void *f, int size);
 extern void mp3_start_play(void *f, int pos);
 extern void mp3_update(int *buffer, int length, int stereo);
+extern int mp3_read(short *buffer, int frames); // -1 if not supported
 
 // this function should write-back d-cache and invalidate i-cache
 // on a mem region [start_addr, end_addr)
@@ -75,6 +76,12 @@ extern void *p32x_bios_g, *p32x_bios_m, *p32x_bios_s;
 #define POPT_EN_PWM         (1<<21)
 #define POPT_PWM_IRQ_OPT    (1<<22)
 #define POPT_DIS_FM_SSGEG   (1<<23)
+#define POPT_EN_SH2_THREADS (1<<24) // x00 0000
+#define POPT_EN_DRC_ASYNC   (1<<25)
+#define POPT_EN_SND_LOG     (1<<26)
+#define POPT_EN_SND_THREAD  (1<<27)
+#define POPT_EN_CDDA_THREAD (1<<28)
+#define POPT_EN_S68K_THREAD (1<<29)
 
 #define PAHW_MCD  (1<<0)
 #define PAHW_32X  (1<<1)
@@ -110,6 +117,9 @@ typedef struct
 
 	void (*mcdTrayOpen)(void);
 	void (*mcdTrayClose)(void);
+
+	unsigned int drcTcacheSize;    // dynarec translation cache size in bytes, 0: default
+	unsigned int chdCacheSize;     // CHD image hunk cache size in MiB, 0: default
 } PicoInterface;
 
 extern PicoInterface PicoIn;
@@ -161,7 +171,8 @@ typedef enum
 	PMT_UNCOMPRESSED = 0,
 	PMT_ZIP,
 	PMT_CSO,
-	PMT_CHD
+	PMT_CHD,
+	PMT_MMAP
 } pm_type;
 typedef struct
 {
@@ -177,6 +188,13 @@ size_t   pm_read(void *ptr, size_t bytes, pm_file *stream);
 size_t   pm_read_audio(void *ptr, size_t bytes, pm_file *stream);
 int      pm_seek(pm_file *stream, long offset, int whence);
 int      pm_close(pm_file *fp);
+void     pm_sequential(pm_file *stream, long offset);
+struct pm_cache_stats {
+	unsigned int hits, misses;	/* hunk lookups */
+	unsigned int prefetched;	/* hunks decompressed by read-ahead */
+	unsigned int size, used;	/* cache slots */
+};
+int      pm_cache_stats(pm_file *stream, struct pm_cache_stats *st);
 int PicoCartLoad(pm_file *f, const unsigned char *rom, unsigned int romsize,
   unsigned char **prom, unsigned int *psize, int is_sms);
 int PicoCartInsert(unsigned char *rom, unsigned int romsize, const char *carthw_cfg);
@@ -231,10 +249,15 @@ extern void (*PicoPrepareCram)();    // prepares PicoCramHigh for renderer to us
 #ifndef NO_32X
 
 void Pico32xSetClocks(int msh2_hz, int ssh2_hz);
+// SH2 DRC block profile, pretranslates code used in an earlier session
+int Pico32xDrcProfileLoad(const char *fname);
+int Pico32xDrcProfileSave(const char *fname);
 
 #else
 
 #define Pico32xSetClocks(msh2_khz, ssh2_khz)
+#define Pico32xDrcProfileLoad(fname) -1
+#define Pico32xDrcProfileSave(fname) -1
 
 #endif
 
@@ -246,6 +269,7 @@ void Pico32xSetClocks(int msh2_hz, int ssh2_hz);
 // sound.c
 extern void (*PsndMix_32_to_16l)(short *dest, int *src, int count);
 void PsndRerate(int preserve_state);
+int  PsndActiveVoices(void);
 
 // media.c
 enum media_type_e {
@@ -14,6 +14,8 @@
 #include "pico_types.h"
 #include "pico_port.h"
 #include "pico.h"
+#include "poll.h"
+#include "event.h"
 #include "carthw/carthw.h"
 
 //
@@ -206,6 +208,9 @@ extern struct DrZ80 drZ80;
 
 #define cycles_68k_to_z80(x) ((x) * 3822 >> 13)
 
+// slice length for z80 idle loop detection, about a scanline
+#define Z80_IDLE_SLICE 228
+
 // ----------------------- SH2 CPU -----------------------
 
 #include <cpu/sh2/sh2.h>
@@ -486,7 +491,7 @@ struct mcd_misc
   unsigned char  s68k_pend_ints;
   unsigned int   state_flags;     // 04
   unsigned int   stopwatch_base_c;
-  unsigned short m68k_poll_a;
+  unsigned short m68k_poll_a;     // poll state, see pcd_state_save_mem
   unsigned short m68k_poll_cnt;
   unsigned short s68k_poll_a;
   unsigned short s68k_poll_cnt;
@@ -742,6 +747,9 @@ u32 PicoRead16_mcd_io(u32 a);
 void PicoWrite8_mcd_io(u32 a, u32 d);
 void PicoWrite16_mcd_io(u32 a, u32 d);
 void pcd_state_loaded_mem(void);
+void pcd_state_save_mem(void);
+extern struct poll_det pcd_m68k_poll, pcd_s68k_poll;
+void pcd_s68k_poll_release(u32 a);
 
 // pico.c
 extern struct Pico Pico;
@@ -784,9 +792,30 @@ void pcd_run_cpus(int m68k_cycles);
 void pcd_soft_reset(void);
 void pcd_state_loaded(void);
 
+// sub cpu thread, s68k code must call PCD_THR_SHARED before touching m68k
+// side state, m68k code PCD_THR_PARK before touching s68k side state
+#if defined(USE_THREADS) && !defined(EMU_M68K) && !defined(_ASM_CD_MEMORY_C)
+#define PCD_THREADS
+extern int pcd_thr_active;
+void pcd_thr_shared(void);
+void pcd_thr_park(void);
+#define PCD_THR_SHARED() do { \
+  if (unlikely(pcd_thr_active)) \
+    pcd_thr_shared(); \
+} while (0)
+#define PCD_THR_PARK() do { \
+  if (unlikely(pcd_thr_active)) \
+    pcd_thr_park(); \
+} while (0)
+#else
+#define PCD_THR_SHARED()
+#define PCD_THR_PARK()
+#endif
+
 // cd/pcm.c
 void pcd_pcm_sync(unsigned int to);
 void pcd_pcm_update(s32 *buffer, int length, int stereo);
+void pcd_pcm_rerate(void);
 void pcd_pcm_write(unsigned int a, unsigned int d);
 unsigned int pcd_pcm_read(unsigned int a);
 
@@ -823,8 +852,12 @@ void SekInterruptClearS68k(int irq);
 
 // sound/sound.c
 extern short cdda_out_buffer[2*1152];
+extern struct resampler cdda_resampler;
 
 void cdda_start_play(int lba_base, int lba_offset, int lb_len);
+void cdda_stop_play(void);
+void cdda_io_lock(void);
+void cdda_io_unlock(void);
 
 void ym2612_sync_timers(int z80_cycles, int mode_old, int mode_new);
 void ym2612_pack_state(void);
@@ -902,6 +935,7 @@ PICO_INTERNAL void z80_pack(void *data);
 PICO_INTERNAL int  z80_unpack(const void *data);
 PICO_INTERNAL void z80_reset(void);
 PICO_INTERNAL void z80_exit(void);
+PICO_INTERNAL int  z80_idle_skip(unsigned int cycles, int cnt);
 
 // cd/misc.c
 PICO_INTERNAL_ASM void wram_2M_to_1M(unsigned char *m);
@@ -916,6 +950,10 @@ PICO_INTERNAL void PsndDoDAC(int cycle_to);
 PICO_INTERNAL void PsndDoPSG(int line_to);
 PICO_INTERNAL void PsndDoYM2413(int line_to);
 PICO_INTERNAL void PsndDoFM(int line_to);
+PICO_INTERNAL int  PsndWriteFM(int cyc_to, int reg, int d);
+PICO_INTERNAL void PsndWritePSG(int line_to, int d);
+PICO_INTERNAL void PsndFlushLog(void);
+PICO_INTERNAL void PsndResetFM(void);
 PICO_INTERNAL void PsndClear(void);
 PICO_INTERNAL void PsndGetSamples(int y);
 PICO_INTERNAL void PsndGetSamplesMS(int y);
@@ -948,6 +986,24 @@ enum p32x_event {
 };
 extern unsigned int p32x_event_times[P32X_EVENT_COUNT];
 
+// sh2 scheduling statistics, counts are per frame
+struct p32x_sync_stats {
+  unsigned int step;    // sh2 slice length in 68k cycles
+  unsigned int syncs;   // sh2 syncs to the 68k
+  unsigned int slices;  // slices run by the sh2 scheduler
+  unsigned int others;  // syncs of the other sh2 from a memhandler
+  unsigned int comm;    // comm port writes and synchronizing reads
+  unsigned int polls;   // poll loops detected
+  unsigned int irqs;    // irqs raised
+};
+extern struct p32x_sync_stats p32x_sync_stats, p32x_sync_stats_last;
+// for counts of sh2 side events, both sh2s may be running in parallel mode
+#ifdef SH2_THREADS
+#define p32x_sync_stats_add(f, n) pico_atomic_add(&p32x_sync_stats.f, n)
+#else
+#define p32x_sync_stats_add(f, n) (p32x_sync_stats.f += (n))
+#endif
+
 void Pico32xInit(void);
 void PicoPower32x(void);
 void PicoReset32x(void);
@@ -965,6 +1021,34 @@ void p32x_event_schedule(unsigned int now, enum p32x_event event, int after);
 void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after);
 void p32x_schedule_hint(SH2 *sh2, unsigned int m68k_cycles);
 
+// parallel SH2 execution, shared state must only be accessed between these.
+// Experimental (sh2_threads=1), runs can't be reproduced. SDRAM accesses
+// aren't ordered; if both sh2s write the same SDRAM page in a slice, the
+// slice is ended and the serial scheduler is used for a while. Reads aren't
+// tracked, a page written by one sh2 and read by the other goes unnoticed.
+#ifdef SH2_THREADS
+extern int p32x_par_active;
+void p32x_sh2_par_enter(SH2 *sh2, unsigned int m68k_cycles);
+void p32x_sh2_par_leave(SH2 *sh2);
+int  p32x_sh2_par_drc_safe(SH2 *sh2);
+int  p32x_sh2_par_sdram_write(SH2 *sh2, unsigned int a);
+#define P32X_PAR_ENTER(sh2, m68k_cycles) do { \
+  if (unlikely(p32x_par_active)) \
+    p32x_sh2_par_enter(sh2, m68k_cycles); \
+} while (0)
+#define P32X_PAR_LEAVE(sh2) do { \
+  if (unlikely(p32x_par_active)) \
+    p32x_sh2_par_leave(sh2); \
+} while (0)
+// the drc cache may be changed, the other sh2 isn't halfway through a block
+#define P32X_PAR_DRC_SAFE(sh2) \
+  (likely(!p32x_par_active) || p32x_sh2_par_drc_safe(sh2))
+#else
+#define P32X_PAR_ENTER(sh2, m68k_cycles)
+#define P32X_PAR_LEAVE(sh2)
+#define P32X_PAR_DRC_SAFE(sh2) 1
+#endif
+
 #define p32x_sh2_ready(sh2, cycles) \
   (CYCLES_GT(cycles,sh2->m68krcycles_done) && \
   !(sh2->state&(SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL)))
@@ -979,7 +1063,7 @@ void PicoMemSetup32x(void);
 void Pico32xSwapDRAM(int b);
 void Pico32xMemStateLoaded(void);
 void p32x_update_banks(void);
-void p32x_m68k_poll_event(u32 flags);
+void p32x_m68k_poll_event(u32 a, u32 flags);
 u32 REGPARM(3) p32x_sh2_poll_memory8(u32 a, u32 d, SH2 *sh2);
 u32 REGPARM(3) p32x_sh2_poll_memory16(u32 a, u32 d, SH2 *sh2);
 u32 REGPARM(3) p32x_sh2_poll_memory32(u32 a, u32 d, SH2 *sh2);
@@ -1007,6 +1091,7 @@ extern int Pico32xDrawMode;
 unsigned int p32x_pwm_read16(u32 a, SH2 *sh2, unsigned int m68k_cycles);
 void p32x_pwm_write16(u32 a, unsigned int d, SH2 *sh2, unsigned int m68k_cycles);
 void p32x_pwm_update(int *buf32, int length, int stereo);
+void p32x_pwm_rerate(void);
 void p32x_pwm_ctl_changed(void);
 void p32x_pwm_schedule(unsigned int m68k_now);
 void p32x_pwm_schedule_sh2(SH2 *sh2);
@@ -1036,7 +1121,10 @@ void REGPARM(3) sh2_peripheral_write32(u32 a, u32 d, SH2 *sh2);
 #define Pico32xStateLoaded()
 #define FinalizeLine32xRGB555 NULL
 #define p32x_pwm_update(...)
+#define p32x_pwm_rerate()
 #define p32x_timers_recalc()
+#define P32X_PAR_ENTER(sh2, m68k_cycles)
+#define P32X_PAR_LEAVE(sh2)
 #endif
 
 /* avoid dependency on newer glibc */
@@ -0,0 +1,72 @@
+/*
+ * PicoDrive
+ * host thread primitives for optional worker threads (USE_THREADS)
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#ifndef PICO_THREAD_INCLUDED
+#define PICO_THREAD_INCLUDED
+
+#ifdef USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t       pico_thread_t;
+typedef pthread_mutex_t pico_mutex_t;
+typedef pthread_cond_t  pico_cond_t;
+
+#define PICO_THREAD_LOCAL __thread
+
+static __inline int pico_thread_create(pico_thread_t *t, void *(*fn)(void *), void *arg)
+{
+  return pthread_create(t, NULL, fn, arg);
+}
+
+static __inline void pico_thread_join(pico_thread_t t)
+{
+  pthread_join(t, NULL);
+}
+
+#define pico_mutex_init(m)      pthread_mutex_init(m, NULL)
+#define pico_mutex_destroy(m)   pthread_mutex_destroy(m)
+#define pico_mutex_lock(m)      pthread_mutex_lock(m)
+#define pico_mutex_unlock(m)    pthread_mutex_unlock(m)
+
+#define pico_cond_init(c)       pthread_cond_init(c, NULL)
+#define pico_cond_destroy(c)    pthread_cond_destroy(c)
+#define pico_cond_wait(c, m)    pthread_cond_wait(c, m)
+#define pico_cond_signal(c)     pthread_cond_signal(c)
+#define pico_cond_broadcast(c)  pthread_cond_broadcast(c)
+
+// for lock-free polling of variables which are changed under a mutex
+#define pico_atomic_load(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define pico_atomic_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+// for counters which are updated by several threads
+#define pico_atomic_add(p, v)   __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+// returns the old value, all such updates to *p are seen in the same order
+#define pico_atomic_or(p, v)    __atomic_fetch_or(p, v, __ATOMIC_RELAXED)
+
+// hint to the host cpu that this is a spin-wait loop
+static __inline void pico_cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__ ("pause");
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+  __asm__ __volatile__ ("yield");
+#endif
+}
+
+// number of online host cpus, spinning makes no sense if there's only one
+static __inline int pico_cpu_count(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 1 ? n : 1;
+#else
+  return 2;
+#endif
+}
+
+#endif // USE_THREADS
+#endif // PICO_THREAD_INCLUDED
@@ -0,0 +1,65 @@
+/*
+ * PicoDrive
+ * poll loop detection, shared by all cpus accessing shared resources
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * A cpu is considered polling if it repeatedly reads from a small set of
+ * addresses in short intervals. Most cpus only watch one address, the 32X
+ * 68k needs two for loops alternating between a comm reg and another flag.
+ * Only a write to a watched address wakes a polling cpu. The reads tracked
+ * are comm and status regs in the memory handlers, and on the sh2 the reads
+ * in loops the drc has found to be poll loops, which may be in SDRAM.
+ */
+
+#include "poll.h"
+
+void poll_init(struct poll_det *pd, int watch, int span, int flags)
+{
+  pd->watch = watch;
+  pd->span = span;
+  pd->flags = flags;
+  poll_clear(pd);
+}
+
+int poll_watching(const struct poll_det *pd, u32 a)
+{
+  int i;
+
+  for (i = 0; i < pd->watch; i++)
+    if (a - pd->addr[i] <= pd->span)
+      return 1;
+  return 0;
+}
+
+int poll_detect(struct poll_det *pd, u32 a, u32 cycles, u32 min, u32 max)
+{
+  u32 diff = cycles - pd->cycles;
+
+  if (!poll_watching(pd, a)) {
+    pd->addr[pd->idx] = a;
+    pd->idx = (pd->idx + 1) % pd->watch;
+    pd->cnt = 0;
+  } else if (diff > max || (diff < min && (pd->flags & POLL_MIN_RESET))) {
+    // restart counting, a single address tracker moves to this access
+    if (pd->watch == 1)
+      pd->addr[0] = a;
+    pd->cnt = 0;
+  } else if (diff >= min)
+    pd->cnt++;
+  pd->cycles = cycles;
+
+  return pd->cnt;
+}
+
+void poll_clear(struct poll_det *pd)
+{
+  int i;
+
+  pd->cycles = pd->cnt = pd->idx = 0;
+  // 0 may be a valid address, use something no caller uses as key. Not at the
+  // very end, a + span would wrap around to 0.
+  for (i = 0; i < POLL_WATCH; i++)
+    pd->addr[i] = 0xfffffff0;
+}
@@ -0,0 +1,48 @@
+/*
+ * PicoDrive
+ * poll loop detection, shared by all cpus accessing shared resources
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#ifndef PICO_POLL_INCLUDED
+#define PICO_POLL_INCLUDED
+
+#include "pico_types.h"
+
+// max number of addresses a polling cpu may cycle through
+#define POLL_WATCH 4
+
+// poll_init flags
+#define POLL_MIN_RESET 1 // accesses within min cycles restart counting
+
+// addresses are keys chosen by the caller (register offset or cpu address),
+// a key up to span above a watched one is regarded as the same location.
+struct poll_det {
+  u32 addr[POLL_WATCH];   // watch set: recently polled addresses
+  u32 cycles;             // time of last access
+  int cnt;                // number of poll accesses in a row
+  u8  idx;                // next watch set entry to replace
+  u8  watch;              // watch set size used by this cpu
+  u8  span;               // bytes above a watched address matching it
+  u8  flags;              // POLL_*
+};
+
+// set up a tracker watching up to watch (1..POLL_WATCH) addresses
+void poll_init(struct poll_det *pd, int watch, int span, int flags);
+// account an access to address a at time cycles. Accesses less than min
+// cycles after the last one are ignored (e.g. split 32 bit access), or restart
+// counting with POLL_MIN_RESET. Accesses to a watched address within max
+// cycles count as polling, anything else restarts counting, and a tracker for
+// a single address moves to a. Returns the new poll count.
+int  poll_detect(struct poll_det *pd, u32 a, u32 cycles, u32 min, u32 max);
+// is address a in the watch set of a (possibly) polling cpu? Writers wake a
+// polling cpu, or restart its counting, only if this is true for the address.
+int  poll_watching(const struct poll_det *pd, u32 a);
+// forget the watch set, e.g. after a wakeup
+void poll_clear(struct poll_det *pd);
+
+// cpu did something else than polling, restart counting
+#define poll_reset(pd) (pd)->cnt = 0
+
+#endif // PICO_POLL_INCLUDED
@@ -202,9 +202,7 @@ static void z80_sms_out(unsigned short a, unsigned char d)
 
       case 0x40:
       case 0x41:
-        if ((d & 0x90) == 0x90)
-          PsndDoPSG(Pico.m.scanline);
-        SN76496Write(d);
+        PsndWritePSG((d & 0x90) == 0x90 ? Pico.m.scanline : -1, d);
         break;
 
       case 0x80:
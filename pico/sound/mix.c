@@ -9,6 +9,10 @@
 
 #include <string.h>
 
+#if defined(MIX_SIMD) && !(__GNUC__ >= 9 || defined(__clang__))
+#undef MIX_SIMD /* needs gcc vector extensions with __builtin_convertvector */
+#endif
+
 #define MAXOUT		(+32767)
 #define MINOUT		(-32768)
 
@@ -81,6 +85,7 @@ static inline int filter_null(struct iir *fi2, int x)
 	lfi2 = lf, rfi2 = rf;					\
 }
 
+#ifndef MIX_SIMD
 void mix_32_to_16l_stereo_lvl(short *dest, int *src, int count)
 {
 	mix_32_to_16l_stereo_core(dest, src, count, mix_32_to_16l_level, filter);
@@ -108,6 +113,185 @@ void mix_32_to_16_mono(short *dest, int *src, int count)
 }
 
 
+#else
+/*
+ * Blocked versions of the above. The adds, the level shift and the limiter
+ * work on whole vectors (gcc vector extensions, SSE2 on x86, NEON on arm64);
+ * only the recursive IIR runs per sample, with both channels in the lanes of
+ * one 2 lane vector. Output is identical to the C versions.
+ * The IIR is most of the time, wider vectors don't gain anything. On x86 the
+ * mixers are built once more for SSE4.1, which has 16 bit sign extending
+ * loads, and that one is used if the cpu has it.
+ */
+#define VL	4	/* lanes per vector */
+#define BLK	(32*VL)	/* samples per block, multiple of VL */
+
+typedef int   vsi  __attribute__((vector_size(VL*4)));
+typedef int   vsiu __attribute__((vector_size(VL*4), aligned(4)));
+typedef short vssu __attribute__((vector_size(VL*2), aligned(2)));
+typedef int   v2si __attribute__((vector_size(8)));
+
+#define LD16(p)		__builtin_convertvector(*(const vssu *)(p), vsi)
+#define ST16(p, v)	*(vssu *)(p) = __builtin_convertvector(v, vssu)
+
+/* left sample of each frame in both lanes */
+#define LEFT2(p) (vsi) { p[0], p[0], p[2], p[2] }
+
+static inline vsi limit16_v(vsi v)
+{
+	vsi hi, lo;
+
+	v -= v >> 3; /* reduce level to avoid clipping */
+	hi = v > MAXOUT;
+	lo = v < MINOUT;
+	return (v & ~(hi | lo)) | (MAXOUT & hi) | (MINOUT & lo);
+}
+
+/* filter_band, both channels at once */
+#define filter_band_v(y0, y1, alpha, x) ( \
+	y0 += (x - (y0 >> QB)) * alpha, \
+	y1 += (y0 - y1) >> QB, \
+	(y0 - y1) >> QB)
+
+static inline __attribute__((always_inline))
+void mix_32_to_16l_stereo_v(short *dest, int *src, int count, int lv)
+{
+	int x[BLK] __attribute__((aligned(VL*4)));
+	v2si y0 = { lfi2.y[0], rfi2.y[0] }, y1 = { lfi2.y[1], rfi2.y[1] };
+	v2si alpha = { lfi2.alpha, rfi2.alpha }, v;
+	int i, n, l;
+
+	for (count *= 2; count > 0; count -= n, dest += n, src += n) {
+		n = count < BLK ? count : BLK;
+
+		/* the left output sample is the base for both channels */
+		for (i = 0; i + VL <= n; i += VL)
+			*(vsi *)(x + i) = LEFT2((dest + i)) + (*(vsiu *)(src + i) >> lv);
+		for (; i < n; i += 2) {
+			x[i]   = dest[i] + (src[i]   >> lv);
+			x[i+1] = dest[i] + (src[i+1] >> lv);
+		}
+
+		if (alpha[0] == 1<<QB && alpha[1] == 1<<QB) {
+			/* low pass off: y0 is just x<<QB, only the DC filter is left */
+			for (i = 0; i < n; i += 2) {
+				y0 = (v2si) { x[i], x[i+1] } << QB;
+				y1 += (y0 - y1) >> QB;
+				v = (y0 - y1) >> QB;
+				x[i] = v[0], x[i+1] = v[1];
+			}
+		} else
+		for (i = 0; i < n; i += 2) {
+			v = (v2si) { x[i], x[i+1] };
+			v = filter_band_v(y0, y1, alpha, v);
+			x[i] = v[0], x[i+1] = v[1];
+		}
+
+		for (i = 0; i + VL <= n; i += VL)
+			ST16(dest + i, limit16_v(*(vsi *)(x + i)));
+		for (; i < n; i++) {
+			l = x[i];
+			Limit16(l);
+			dest[i] = l;
+		}
+	}
+	lfi2.y[0] = y0[0], lfi2.y[1] = y1[0];
+	rfi2.y[0] = y0[1], rfi2.y[1] = y1[1];
+}
+
+static inline __attribute__((always_inline))
+void mix_32_to_16_mono_v(short *dest, int *src, int count)
+{
+	int x[BLK] __attribute__((aligned(VL*4)));
+	struct iir lf = lfi2;
+	int i, n, l;
+
+	for (; count > 0; count -= n, dest += n, src += n) {
+		n = count < BLK ? count : BLK;
+
+		for (i = 0; i + VL <= n; i += VL)
+			*(vsi *)(x + i) = LD16(dest + i) + *(vsiu *)(src + i);
+		for (; i < n; i++)
+			x[i] = dest[i] + src[i];
+
+		if (lf.alpha == 1<<QB) {
+			for (i = 0; i < n; i++) {
+				lf.y[0] = x[i] << QB;
+				lf.y[1] += (lf.y[0] - lf.y[1]) >> QB;
+				x[i] = (lf.y[0] - lf.y[1]) >> QB;
+			}
+		} else
+		for (i = 0; i < n; i++)
+			x[i] = filter(&lf, x[i]);
+
+		for (i = 0; i + VL <= n; i += VL)
+			ST16(dest + i, limit16_v(*(vsi *)(x + i)));
+		for (; i < n; i++) {
+			l = x[i];
+			Limit16(l);
+			dest[i] = l;
+		}
+	}
+	lfi2 = lf;
+}
+
+static void mix_stereo(short *dest, int *src, int count, int lv)
+{
+	mix_32_to_16l_stereo_v(dest, src, count, lv);
+}
+
+static void mix_mono(short *dest, int *src, int count)
+{
+	mix_32_to_16_mono_v(dest, src, count);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+static __attribute__((target("sse4.1")))
+void mix_stereo_sse41(short *dest, int *src, int count, int lv)
+{
+	mix_32_to_16l_stereo_v(dest, src, count, lv);
+}
+
+static __attribute__((target("sse4.1")))
+void mix_mono_sse41(short *dest, int *src, int count)
+{
+	mix_32_to_16_mono_v(dest, src, count);
+}
+#endif
+
+/* chosen in mix_reset */
+static void (*mix_stereo_f)(short *dest, int *src, int count, int lv) = mix_stereo;
+static void (*mix_mono_f)(short *dest, int *src, int count) = mix_mono;
+
+static void mix_select(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1")) {
+		mix_stereo_f = mix_stereo_sse41;
+		mix_mono_f = mix_mono_sse41;
+	}
+#endif
+}
+
+void mix_32_to_16l_stereo_lvl(short *dest, int *src, int count)
+{
+	mix_stereo_f(dest, src, count, mix_32_to_16l_level);
+}
+
+void mix_32_to_16l_stereo(short *dest, int *src, int count)
+{
+	mix_stereo_f(dest, src, count, 0);
+}
+
+void mix_32_to_16_mono(short *dest, int *src, int count)
+{
+	mix_mono_f(dest, src, count);
+}
+
+#endif /* MIX_SIMD */
+
+
 void mix_16h_to_32(int *dest_buf, short *mp3_buf, int count)
 {
 	while (count--)
@@ -143,4 +327,7 @@ void mix_reset(int alpha_q16)
 	memset(&lfi2, 0, sizeof(lfi2));
 	memset(&rfi2, 0, sizeof(rfi2));
 	lfi2.alpha = rfi2.alpha = (0x10000-alpha_q16) >> 4; // filter alpha, Q12
+#ifdef MIX_SIMD
+	mix_select();
+#endif
 }
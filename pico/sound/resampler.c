@@ -0,0 +1,234 @@
+/*
+ * PicoDrive
+ * band-limited polyphase resampler for sample based sound sources
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * Each output sample is a RS_TAPS dot product of the input with a windowed
+ * sinc for the nearest of RS_PHASES sub-sample positions.
+ *
+ * Streaming sources (CD-DA) deliver stereo 16bit frames at a fixed rate as
+ * needed, output is added at half level into the 32bit mix buffer (like
+ * mix_16h_to_32). Stepping is exact in units of 1/out_rate, so arbitrary rate
+ * pairs don't drift. With equal rates the input is just copied, identical to
+ * mix_16h_to_32.
+ *
+ * Paced sources (Mega-CD PCM, 32X PWM) are emulated along with the CPUs and
+ * deliver however many frames the emulated time held. Each update stretches
+ * exactly those frames over the output length, so the source and the output
+ * stay in sync even if the source rate changes or isn't exactly known. The
+ * rate given at init only sets the filter cutoff. This costs RS_TAPS-1 frames
+ * of lookahead, about 1/4ms for the PCM.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "resampler.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+#define CENTER	(RS_TAPS/2 - 1)	// tap for an output exactly on an input frame
+
+void resampler_set_rate(struct resampler *r, int in_rate, int out_rate)
+{
+	double fc = 0.9, x, w, sum;
+	int p, t, c;
+
+	r->in_rate = in_rate;
+	r->out_rate = out_rate;
+	r->step = in_rate / out_rate;
+	r->step_rem = in_rate % out_rate;
+	// cutoff at 90% of the lower Nyquist frequency
+	if (out_rate < in_rate)
+		fc = 0.9 * out_rate / in_rate;
+
+	for (p = 0; p <= RS_PHASES; p++) {
+		double h[RS_TAPS];
+		for (t = 0, sum = 0; t < RS_TAPS; t++) {
+			x = t - CENTER - (double)p / RS_PHASES;
+			// Blackman window, zero at +/- RS_TAPS/2
+			w = 0.42 + 0.5 * cos(M_PI * x / (RS_TAPS/2))
+				+ 0.08 * cos(2 * M_PI * x / (RS_TAPS/2));
+			h[t] = (x == 0 ? 1.0 : sin(M_PI * fc * x) / (M_PI * fc * x)) * w;
+			sum += h[t];
+		}
+		// normalize to unity DC gain, put rounding residue on the center tap
+		for (t = 0, c = 0; t < RS_TAPS; t++) {
+			r->coef[p][t] = (int)floor(h[t] / sum * (1 << 14) + 0.5);
+			c += r->coef[p][t];
+		}
+		r->coef[p][CENTER + (p >= RS_PHASES/2)] += (1 << 14) - c;
+	}
+}
+
+void resampler_init(struct resampler *r, int in_rate, int out_rate)
+{
+	resampler_set_rate(r, in_rate, out_rate);
+	// first output sample is centered on input frame 0
+	r->lead = CENTER;
+	resampler_reset(r);
+}
+
+void resampler_init_paced(struct resampler *r, int in_rate, int out_rate)
+{
+	resampler_set_rate(r, in_rate, out_rate);
+	// the last output sample of an update needs RS_TAPS-1 frames after it
+	r->lead = RS_TAPS - 1;
+	resampler_reset(r);
+}
+
+void resampler_reset(struct resampler *r)
+{
+	memset(r->hist, 0, sizeof(r->hist));
+	r->frac = 0;
+	r->pos = 0;
+	r->fill = r->lead;
+}
+
+// number of input frames to push before out_len samples can be produced
+int resampler_need(struct resampler *r, int out_len)
+{
+	int last;
+
+	if (out_len <= 0)
+		return 0;
+	out_len--;
+	last = r->pos + out_len * r->step
+		+ (r->frac + out_len * r->step_rem) / r->out_rate;
+	last += RS_TAPS - r->fill;
+	return last > 0 ? last : 0;
+}
+
+// make room for frames more input frames, return how many fit
+static int make_room(struct resampler *r, int frames)
+{
+	if (r->fill + frames > RS_HIST) {
+		// move the still needed part of the history to the start
+		int keep = r->fill - r->pos;
+		memmove(r->hist[0], r->hist[0] + r->pos, keep * sizeof(int));
+		memmove(r->hist[1], r->hist[1] + r->pos, keep * sizeof(int));
+		r->fill = keep;
+		r->pos = 0;
+		if (frames > RS_HIST - keep)
+			frames = RS_HIST - keep;
+	}
+	return frames;
+}
+
+void resampler_push(struct resampler *r, const short *src, int frames)
+{
+	int *l, *rt;
+
+	frames = make_room(r, frames);
+	l  = r->hist[0] + r->fill;
+	rt = r->hist[1] + r->fill;
+	r->fill += frames;
+	while (frames--) {
+		*l++  = *src++;
+		*rt++ = *src++;
+	}
+}
+
+// 32bit frames, scaled down by shift to keep the dot product in range
+void resampler_push_32(struct resampler *r, const int *src, int frames, int shift)
+{
+	int *l, *rt;
+
+	frames = make_room(r, frames);
+	l  = r->hist[0] + r->fill;
+	rt = r->hist[1] + r->fill;
+	r->fill += frames;
+	while (frames--) {
+		*l++  = *src++ >> shift;
+		*rt++ = *src++ >> shift;
+	}
+}
+
+#if defined(__GNUC__)
+// unaligned int vectors; SSE2/AVX on x86, NEON on arm
+typedef int v4si __attribute__((vector_size(16), aligned(4)));
+
+static inline int dot(const int *c, const int *h)
+{
+	const v4si *cv = (const v4si *)c, *hv = (const v4si *)h;
+	v4si s = cv[0] * hv[0];
+	int i;
+
+	for (i = 1; i < RS_TAPS/4; i++)
+		s += cv[i] * hv[i];
+	return s[0] + s[1] + s[2] + s[3];
+}
+#else
+static inline int dot(const int *c, const int *h)
+{
+	int t, s = 0;
+
+	for (t = 0; t < RS_TAPS; t++)
+		s += c[t] * h[t];
+	return s;
+}
+#endif
+
+static void mix_run(struct resampler *r, int *dest, int out_len, int step,
+	int step_rem, int den, int shift, int stereo)
+{
+	int pos = r->pos, frac = r->frac;
+	const int *c;
+
+	for (; out_len > 0; out_len--) {
+		if (pos + RS_TAPS > r->fill)
+			break; // underrun, source didn't deliver enough
+		// nearest phase, the last one is phase 0 of the next frame
+		c = r->coef[(frac * RS_PHASES + den/2) / den];
+		*dest++ += dot(c, r->hist[0] + pos) >> shift;
+		if (stereo)
+			*dest++ += dot(c, r->hist[1] + pos) >> shift;
+
+		pos += step;
+		frac += step_rem;
+		if (frac >= den) {
+			frac -= den;
+			pos++;
+		}
+	}
+	r->pos = pos;
+	r->frac = frac;
+}
+
+void resampler_mix_16h_to_32(struct resampler *r, int *dest, int out_len)
+{
+	int pos = r->pos;
+
+	if (r->in_rate == r->out_rate) {
+		// just copy the center tap
+		if (out_len > r->fill - RS_TAPS + 1 - pos)
+			out_len = r->fill - RS_TAPS + 1 - pos;
+		for (; out_len > 0; out_len--, pos++) {
+			*dest++ += r->hist[0][pos + CENTER] >> 1;
+			*dest++ += r->hist[1][pos + CENTER] >> 1;
+		}
+		r->pos = pos;
+		return;
+	}
+
+	mix_run(r, dest, out_len, r->step, r->step_rem, r->out_rate, 15, 1);
+}
+
+// stretch the frames pushed since the last call over out_len samples. Output
+// is dot >> shift, 14 for full level of the pushed values. For mono output
+// (stereo == 0) only the left channel is mixed.
+void resampler_mix_paced(struct resampler *r, int *dest, int out_len,
+	int frames, int shift, int stereo)
+{
+	if (out_len > 0) {
+		r->frac = 0;
+		mix_run(r, dest, out_len, frames / out_len, frames % out_len, out_len,
+			shift, stereo);
+	}
+	// normally a no-op, resync if the source skipped an update or pushed
+	// a different count than it passed here
+	r->pos = r->fill - r->lead;
+}
@@ -0,0 +1,31 @@
+#ifndef RESAMPLER_INCLUDED
+#define RESAMPLER_INCLUDED
+
+#define RS_TAPS		16	/* FIR length per phase */
+#define RS_PHASES	64	/* sub-sample phases */
+#define RS_HIST		(2*1152+RS_TAPS)	/* input history, in frames */
+
+/* stereo -> 32bit resampler, streaming or paced by the source */
+struct resampler {
+	int	in_rate, out_rate;
+	int	step;		// input frames per output sample, integer part
+	int	step_rem;	// remainder, in 1/out_rate units
+	int	frac;		// position between input frames, in 1/out_rate units
+	int	pos, fill;	// current and last+1 input frame in hist
+	int	lead;		// fill after reset
+	int	coef[RS_PHASES+1][RS_TAPS];	// Q14, last is phase 0 of pos+1
+	int	hist[2][RS_HIST];		// deinterleaved L/R input
+};
+
+void resampler_init(struct resampler *r, int in_rate, int out_rate);
+void resampler_init_paced(struct resampler *r, int in_rate, int out_rate);
+void resampler_set_rate(struct resampler *r, int in_rate, int out_rate);
+void resampler_reset(struct resampler *r);
+int  resampler_need(struct resampler *r, int out_len);
+void resampler_push(struct resampler *r, const short *src, int frames);
+void resampler_push_32(struct resampler *r, const int *src, int frames, int shift);
+void resampler_mix_16h_to_32(struct resampler *r, int *dest, int out_len);
+void resampler_mix_paced(struct resampler *r, int *dest, int out_len,
+	int frames, int shift, int stereo);
+
+#endif
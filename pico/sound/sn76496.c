@@ -133,9 +133,10 @@ WRITE8_HANDLER( SN76496_4_w ) {	SN76496Write(4,data); }
 */
 
 //static
-void SN76496Update(short *buffer, int length, int stereo)
+// returns a mask of the voices with a non-zero volume
+int SN76496Update(short *buffer, int length, int stereo)
 {
-	int i;
+	int i, active = 0, run = 0;
 	struct SN76496 *R = &ono_sn;
 
 	/* If the volume is 0, increase the counter */
@@ -147,8 +148,19 @@ void SN76496Update(short *buffer, int length, int stereo)
 			/* it's the same since the volume is 0, but doing the latter could cause */
 			/* interferencies when the program is rapidly modulating the volume. */
 			if (R->Count[i] <= length*STEP) R->Count[i] += length*STEP;
+			/* If the counter can't run out in this update, the voice would only */
+			/* count down without changing its state. Do that in one go. */
+			if (R->Count[i] > length*STEP) {
+				R->Count[i] -= length*STEP;
+				continue;
+			}
 		}
+		else
+			active |= 1 << i;
+		run |= 1 << i;
 	}
+	if (!run)
+		return 0;
 
 	while (length > 0)
 	{
@@ -163,6 +175,7 @@ void SN76496Update(short *buffer, int length, int stereo)
 
 		for (i = 0;i < 3;i++)
 		{
+			if (!(run & (1 << i))) continue;
 			if (R->Output[i]) vol[i] += R->Count[i];
 			R->Count[i] -= STEP;
 			/* Period[i] is the half period of the square wave. Here, in each */
@@ -195,7 +208,7 @@ void SN76496Update(short *buffer, int length, int stereo)
 		}
 
 		left = STEP;
-		do
+		if (run & 8) do
 		{
 			int nextevent;
 
@@ -229,6 +242,8 @@ void SN76496Update(short *buffer, int length, int stereo)
 
 		length--;
 	}
+
+	return active;
 }
 
 
@@ -11,7 +11,9 @@
 #include "ym2612.h"
 #include "sn76496.h"
 #include "../pico_int.h"
+#include "../pico_thread.h"
 #include "mix.h"
+#include "resampler.h"
 #include "emu2413/emu2413.h"
 
 void (*PsndMix_32_to_16l)(short *dest, int *src, int count) = mix_32_to_16l_stereo;
@@ -21,16 +23,27 @@ static s32 PsndBuffer[2*(44100+100)/50];
 
 // cdda output buffer
 s16 cdda_out_buffer[2*1152];
+// cdda 44.1kHz -> sndRate
+struct resampler cdda_resampler;
 
 // sn76496
 extern int *sn76496_regs;
 
+// FM channels and PSG voices which had output, this and the last frame
+static int snd_fm_active, snd_psg_active;
+static int snd_voices;
+
 // ym2413
 #define YM2413_CLK 3579545
 OPLL old_opll;
 static OPLL *opll = NULL;
 unsigned YM2413_reg;
 
+#ifdef USE_THREADS
+static void snd_thr_stop(void);
+static void cdda_thr_stop(void);
+#endif
+
 
 PICO_INTERNAL void PsndInit(void)
 {
@@ -41,6 +54,10 @@ PICO_INTERNAL void PsndInit(void)
 
 PICO_INTERNAL void PsndExit(void)
 {
+#ifdef USE_THREADS
+  snd_thr_stop();
+  cdda_thr_stop();
+#endif
   OPLL_delete(opll);
   opll = NULL;
 }
@@ -60,6 +77,8 @@ void PsndRerate(int preserve_state)
   int target_fps = Pico.m.pal ? 50 : 60;
   int target_lines = Pico.m.pal ? 313 : 262;
 
+  PsndFlushLog();
+
   if (preserve_state) {
     state = malloc(0x204);
     if (state == NULL) return;
@@ -99,6 +118,9 @@ void PsndRerate(int preserve_state)
   // clear all buffers
   memset32(PsndBuffer, 0, sizeof(PsndBuffer)/4);
   memset(cdda_out_buffer, 0, sizeof(cdda_out_buffer));
+  resampler_init(&cdda_resampler, 44100, PicoIn.sndRate);
+  pcd_pcm_rerate();
+  p32x_pwm_rerate();
   if (PicoIn.sndOut)
     PsndClear();
 
@@ -161,7 +183,7 @@ PICO_INTERNAL void PsndDoDAC(int cyc_to)
   Pico.snd.dac_val = dout;
 }
 
-PICO_INTERNAL void PsndDoPSG(int line_to)
+static void do_psg(int line_to, short *out)
 {
   int pos, len;
   int stereo = 0;
@@ -176,14 +198,19 @@ PICO_INTERNAL void PsndDoPSG(int line_to)
   Pico.snd.psg_pos += len;
   len = ((Pico.snd.psg_pos+0x8000) >> 16) - pos;
 
-  if (!PicoIn.sndOut || !(PicoIn.opt & POPT_EN_PSG))
+  if (!out || !(PicoIn.opt & POPT_EN_PSG))
     return;
 
   if (PicoIn.opt & POPT_EN_STEREO) {
     stereo = 1;
     pos <<= 1;
   }
-  SN76496Update(PicoIn.sndOut + pos, len, stereo);
+  snd_psg_active |= SN76496Update(out + pos, len, stereo);
+}
+
+PICO_INTERNAL void PsndDoPSG(int line_to)
+{
+  do_psg(line_to, PicoIn.sndOut);
 }
 
 #if 0
@@ -228,7 +255,8 @@ void YM2413_dataWrite(unsigned data){
 }
 
 
-PICO_INTERNAL void PsndDoFM(int cyc_to)
+// st: FM ch3 mode and DAC enable, see YM2612UpdateOneSt_
+static void do_fm(int cyc_to, int st)
 {
   int pos, len;
   int stereo = 0;
@@ -251,18 +279,517 @@ PICO_INTERNAL void PsndDoFM(int cyc_to)
     pos <<= 1;
   }
   if (PicoIn.opt & POPT_EN_FM)
-    YM2612UpdateOne(PsndBuffer + pos, len, stereo, 1);
+    snd_fm_active |= YM2612UpdateOneSt(PsndBuffer + pos, len, stereo, 1, st);
+}
+
+#define FM_ST() ((ym2612.OPN.ST.mode & 0xc0) | !!ym2612.dacen)
+
+PICO_INTERNAL void PsndDoFM(int cyc_to)
+{
+  do_fm(cyc_to, FM_ST());
+}
+
+// chip register write log for POPT_EN_SND_LOG. Writes are stored with their
+// timestamps and replayed before mixing, so that chip rendering is deferred to
+// frame end instead of interleaved with the cpus. Rendering is still split at
+// each write like with immediate rendering, so this alone isn't faster. Rendering
+// state which the memory handlers write directly (FM ch3 mode and DAC enable)
+// is recorded with each entry, so the output is the same as with immediate
+// rendering. tools/sndlogtest checks this.
+// With POPT_EN_SND_THREAD the log is a single producer/consumer ring, which a
+// worker thread replays while the frame is being emulated.
+#define SND_LOG_SIZE    1024  // power of 2
+#define SND_LOG_WAKE    64    // entries to collect before waking the worker
+#define SND_LOG_PSG     0x200 // SN76496 write
+#define SND_LOG_SYNC    0x400 // no write, FM sync only
+
+static struct {
+  int time;                   // FM: z80 cycles, PSG: scanline or -1
+  unsigned short reg;         // FM register incl. A1, or SND_LOG_*
+  unsigned char d;
+  unsigned char st;           // FM: ST.mode & 0xc0, dacen in bit 0
+} snd_log[SND_LOG_SIZE];
+static unsigned int snd_log_head, snd_log_tail; // free running
+
+#ifndef USE_THREADS
+#define pico_atomic_load(p)     (*(p))
+#define pico_atomic_store(p, v) (*(p) = (v))
+#endif
+
+// apply the logged writes, rendering up to each of them first
+static void snd_log_replay(short *psg_out)
+{
+  unsigned int head, tail = snd_log_tail;
+
+  while ((head = pico_atomic_load(&snd_log_head)) != tail) {
+    for (; tail != head; tail++) {
+      int i = tail & (SND_LOG_SIZE-1);
+      int reg = snd_log[i].reg;
+
+      if (reg & SND_LOG_PSG) {
+        if (snd_log[i].time >= 0)
+          do_psg(snd_log[i].time, psg_out);
+        SN76496Write(snd_log[i].d);
+      } else {
+        do_fm(snd_log[i].time, snd_log[i].st);
+        if (!(reg & SND_LOG_SYNC))
+          YM2612WriteReg_(reg, snd_log[i].d);
+      }
+      pico_atomic_store(&snd_log_tail, tail + 1);
+    }
+  }
+}
+
+#ifdef USE_THREADS
+// PSG output of the worker, added to PicoIn.sndOut at frame end since the DAC
+// is rendered there by the emulator thread
+static short psg_buf[2*(44100+100)/50];
+
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;
+  pico_cond_t cond;
+  int running, failed;
+  int idle;                   // worker is waiting, with the log empty
+  int quit;
+} snd_thr;
+
+static void *snd_worker(void *arg)
+{
+  pico_mutex_lock(&snd_thr.lock);
+  for (;;) {
+    // the producer checks idle after adding to the log, and this checks the
+    // log after setting idle, so one of them sees the other's update
+    __atomic_store_n(&snd_thr.idle, 1, __ATOMIC_SEQ_CST);
+    pico_cond_broadcast(&snd_thr.cond);
+    while (__atomic_load_n(&snd_log_head, __ATOMIC_SEQ_CST) == snd_log_tail
+           && !snd_thr.quit)
+      pico_cond_wait(&snd_thr.cond, &snd_thr.lock);
+    if (snd_thr.quit)
+      break;
+    __atomic_store_n(&snd_thr.idle, 0, __ATOMIC_SEQ_CST);
+    pico_mutex_unlock(&snd_thr.lock);
+
+    snd_log_replay(psg_buf);
+
+    pico_mutex_lock(&snd_thr.lock);
+  }
+  pico_mutex_unlock(&snd_thr.lock);
+  return NULL;
+}
+
+static void snd_thr_start(void)
+{
+  pico_mutex_init(&snd_thr.lock);
+  pico_cond_init(&snd_thr.cond);
+  snd_thr.idle = 0;
+  snd_thr.quit = 0;
+  if (pico_thread_create(&snd_thr.thread, snd_worker, NULL) != 0) {
+    elprintf(EL_STATUS, "sound: failed to create worker thread");
+    pico_cond_destroy(&snd_thr.cond);
+    pico_mutex_destroy(&snd_thr.lock);
+    snd_thr.failed = 1;
+    return;
+  }
+  snd_thr.running = 1;
+}
+
+// wait until the worker has applied all logged writes
+static void snd_thr_sync(void)
+{
+  pico_mutex_lock(&snd_thr.lock);
+  pico_cond_broadcast(&snd_thr.cond);
+  while (!snd_thr.idle || snd_log_head != snd_log_tail)
+    pico_cond_wait(&snd_thr.cond, &snd_thr.lock);
+  pico_mutex_unlock(&snd_thr.lock);
+}
+
+static void snd_thr_stop(void)
+{
+  if (!snd_thr.running)
+    return;
+
+  snd_thr_sync();
+  pico_mutex_lock(&snd_thr.lock);
+  snd_thr.quit = 1;
+  pico_cond_broadcast(&snd_thr.cond);
+  pico_mutex_unlock(&snd_thr.lock);
+  pico_thread_join(snd_thr.thread);
+
+  pico_cond_destroy(&snd_thr.cond);
+  pico_mutex_destroy(&snd_thr.lock);
+  snd_thr.running = 0;
+}
+#endif
+
+PICO_INTERNAL void PsndFlushLog(void)
+{
+#ifdef USE_THREADS
+  if (snd_thr.running) {
+    snd_thr_sync();
+    return;
+  }
+#endif
+  snd_log_replay(PicoIn.sndOut);
+}
+
+// called before mixing, all chip output is in the buffers after this
+static void snd_log_end_frame(void)
+{
+  PsndFlushLog();
+#ifdef USE_THREADS
+  if (snd_thr.running) {
+    int stereo = (PicoIn.opt & POPT_EN_STEREO) ? 1 : 0;
+    int i, n = ((Pico.snd.psg_pos+0x8000) >> 16) << stereo;
+    short *d = PicoIn.sndOut;
+
+    if (n > sizeof(psg_buf)/sizeof(psg_buf[0]))
+      n = sizeof(psg_buf)/sizeof(psg_buf[0]);
+    if (d != NULL)
+      for (i = 0; i < n; i++)
+        d[i] += psg_buf[i];
+    memset(psg_buf, 0, n * sizeof(psg_buf[0]));
+
+    if (!(PicoIn.opt & POPT_EN_SND_THREAD))
+      snd_thr_stop();
+  }
+#endif
+}
+
+static void snd_log_add(int time, int reg, int d)
+{
+  unsigned int head = snd_log_head;
+  int i = head & (SND_LOG_SIZE-1);
+
+  if (head - pico_atomic_load(&snd_log_tail) >= SND_LOG_SIZE)
+    PsndFlushLog();
+
+  snd_log[i].time = time;
+  snd_log[i].reg = reg;
+  snd_log[i].d = d;
+  snd_log[i].st = FM_ST();
+#ifdef USE_THREADS
+  if (!snd_thr.running && !snd_thr.failed && (PicoIn.opt & POPT_EN_SND_THREAD))
+    snd_thr_start();
+  if (snd_thr.running) {
+    __atomic_store_n(&snd_log_head, head + 1, __ATOMIC_SEQ_CST);
+    if (head + 1 - pico_atomic_load(&snd_log_tail) >= SND_LOG_WAKE
+        && __atomic_load_n(&snd_thr.idle, __ATOMIC_SEQ_CST))
+    {
+      pico_mutex_lock(&snd_thr.lock);
+      pico_cond_broadcast(&snd_thr.cond);
+      pico_mutex_unlock(&snd_thr.lock);
+    }
+    return;
+  }
+#endif
+  snd_log_head = head + 1;
+}
+
+#define SND_LOG_ACTIVE() \
+  ((PicoIn.opt & (POPT_EN_SND_LOG|POPT_EN_SND_THREAD)) && PicoIn.sndOut)
+
+// YM2612 data write to reg (A1 in bit 8) at z80 cycle cyc_to,
+// reg -1 only syncs output (CSM/ch3 mode change)
+PICO_INTERNAL int PsndWriteFM(int cyc_to, int reg, int d)
+{
+  if (SND_LOG_ACTIVE()) {
+    snd_log_add(cyc_to, reg < 0 ? SND_LOG_SYNC : reg, d);
+    return 0;
+  }
+  PsndFlushLog();
+
+  PsndDoFM(cyc_to);
+  if (reg < 0)
+    return 1;
+  return YM2612WriteReg_(reg, d);
+}
+
+// SN76496 write, with line_to -1 if no sync is needed
+PICO_INTERNAL void PsndWritePSG(int line_to, int d)
+{
+  if (SND_LOG_ACTIVE()) {
+    snd_log_add(line_to, SND_LOG_PSG, d);
+    return;
+  }
+  PsndFlushLog();
+
+  if (line_to >= 0)
+    PsndDoPSG(line_to);
+  SN76496Write(d);
+}
+
+// YM2612 reset, along with the z80. This also clears the registers, timers
+// and status owned by the memory handlers, so it isn't logged. Logged writes
+// from before the reset are applied first, like with immediate rendering.
+PICO_INTERNAL void PsndResetFM(void)
+{
+  PsndFlushLog();
+  YM2612ResetChip();
+  timers_reset();
 }
 
 // cdda
+#ifdef USE_THREADS
+// CD-DA prefetch for POPT_EN_CDDA_THREAD. A worker thread reads, and for mp3
+// decodes, the current track into a single producer/consumer ring ahead of the
+// play position, so that disc I/O, CHD decompression and mp3 decoding are off
+// the emulator thread. Seeks are passed to the worker as requests with a
+// generation number. Until the worker has started on the latest one CD-DA is
+// silent, the emulator never waits for it.
+#define CDDA_RING   16384               // stereo frames, about 370ms
+#define CDDA_CHUNK  1152                // frames fetched at once (an mp3 frame)
+
+static s16 cdda_ring[2*CDDA_RING];
+
+static struct {
+  pico_thread_t thread;
+  pico_mutex_t lock;
+  pico_mutex_t io_lock;       // disc image access, see cdda_io_lock
+  pico_cond_t cond;
+  int running, failed;
+  int active;                 // current track is played from the ring
+  int idle, quit;
+  // request, written by the emulator thread with lock held
+  int req_gen;
+  void *req_stream;
+  int req_type, req_pos;      // byte offset, or position in 1/1024 for mp3
+  // published by the worker
+  unsigned int head;          // ring write position
+  unsigned int start;         // where the data for gen starts in the ring
+  int gen, eof_gen;
+  // emulator thread, tail is also read by the worker
+  unsigned int tail;
+  int tail_gen;
+} cdda_thr;
+
+// the worker seeks in the image file, which may be shared with the data track
+void cdda_io_lock(void)
+{
+  if (cdda_thr.running)
+    pico_mutex_lock(&cdda_thr.io_lock);
+}
+
+void cdda_io_unlock(void)
+{
+  if (cdda_thr.running)
+    pico_mutex_unlock(&cdda_thr.io_lock);
+}
+
+// read up to CDDA_CHUNK frames, returns the number of frames read
+static int cdda_fetch(s16 *buf, void *stream, int type, int *pos)
+{
+  int ret, old;
+
+  if (type == CT_MP3)
+    return mp3_read(buf, CDDA_CHUNK);
+
+  // keep the file position of the emulator side intact
+  pico_mutex_lock(&cdda_thr.io_lock);
+  old = pm_seek(stream, 0, SEEK_CUR);
+  pm_seek(stream, *pos, SEEK_SET);
+  ret = pm_read_audio(buf, CDDA_CHUNK*4, stream);
+  pm_seek(stream, old, SEEK_SET);
+  pico_mutex_unlock(&cdda_thr.io_lock);
+
+  *pos += ret;
+  return ret / 4;
+}
+
+static int cdda_ring_full(unsigned int head)
+{
+  return head - __atomic_load_n(&cdda_thr.tail, __ATOMIC_SEQ_CST)
+         > CDDA_RING - CDDA_CHUNK;
+}
+
+static void *cdda_worker(void *arg)
+{
+  static s16 buf[2*CDDA_CHUNK];
+  unsigned int head = cdda_thr.head;
+  int gen = cdda_thr.gen, type = 0, pos = 0, eof = 1, n, i;
+  void *stream = NULL;
+
+  pico_mutex_lock(&cdda_thr.lock);
+  for (;;) {
+    if (cdda_thr.quit)
+      break;
+    if (cdda_thr.req_gen != gen) {
+      gen = cdda_thr.req_gen;
+      stream = cdda_thr.req_stream;
+      type = cdda_thr.req_type;
+      pos = cdda_thr.req_pos;
+      pico_mutex_unlock(&cdda_thr.lock);
+
+      if (type == CT_MP3)
+        mp3_start_play(stream, pos);
+      eof = 0;
+      cdda_thr.start = head;
+      pico_atomic_store(&cdda_thr.gen, gen);
+
+      pico_mutex_lock(&cdda_thr.lock);
+      continue;
+    }
+    if (eof || cdda_ring_full(head)) {
+      // the consumer checks idle after moving tail, and this checks tail
+      // after setting idle, so one of them sees the other's update
+      __atomic_store_n(&cdda_thr.idle, 1, __ATOMIC_SEQ_CST);
+      if ((eof || cdda_ring_full(head)) && cdda_thr.req_gen == gen
+          && !cdda_thr.quit)
+        pico_cond_wait(&cdda_thr.cond, &cdda_thr.lock);
+      __atomic_store_n(&cdda_thr.idle, 0, __ATOMIC_SEQ_CST);
+      continue;
+    }
+    pico_mutex_unlock(&cdda_thr.lock);
+
+    n = cdda_fetch(buf, stream, type, &pos);
+    for (i = 0; i < n; i++, head++) {
+      cdda_ring[2*(head % CDDA_RING)  ] = buf[2*i  ];
+      cdda_ring[2*(head % CDDA_RING)+1] = buf[2*i+1];
+    }
+    pico_atomic_store(&cdda_thr.head, head);
+    if (n < CDDA_CHUNK) {
+      eof = 1;
+      pico_atomic_store(&cdda_thr.eof_gen, gen);
+    }
+
+    pico_mutex_lock(&cdda_thr.lock);
+  }
+  pico_mutex_unlock(&cdda_thr.lock);
+  return NULL;
+}
+
+static void cdda_thr_start(void)
+{
+  pico_mutex_init(&cdda_thr.lock);
+  pico_mutex_init(&cdda_thr.io_lock);
+  pico_cond_init(&cdda_thr.cond);
+  cdda_thr.head = cdda_thr.start = cdda_thr.tail = 0;
+  cdda_thr.gen = cdda_thr.req_gen = cdda_thr.tail_gen = 0;
+  cdda_thr.eof_gen = -1;
+  cdda_thr.idle = cdda_thr.quit = 0;
+  if (pico_thread_create(&cdda_thr.thread, cdda_worker, NULL) != 0) {
+    elprintf(EL_STATUS, "cdda: failed to create prefetch thread");
+    pico_cond_destroy(&cdda_thr.cond);
+    pico_mutex_destroy(&cdda_thr.io_lock);
+    pico_mutex_destroy(&cdda_thr.lock);
+    cdda_thr.failed = 1;
+    return;
+  }
+  cdda_thr.running = 1;
+}
+
+static void cdda_thr_stop(void)
+{
+  cdda_thr.active = 0;
+  if (!cdda_thr.running)
+    return;
+
+  pico_mutex_lock(&cdda_thr.lock);
+  cdda_thr.quit = 1;
+  pico_cond_broadcast(&cdda_thr.cond);
+  pico_mutex_unlock(&cdda_thr.lock);
+  pico_thread_join(cdda_thr.thread);
+
+  pico_cond_destroy(&cdda_thr.cond);
+  pico_mutex_destroy(&cdda_thr.io_lock);
+  pico_mutex_destroy(&cdda_thr.lock);
+  cdda_thr.running = 0;
+}
+
+static int cdda_thr_play(int lba_base, int lba_offset, int pos1024)
+{
+  void *stream = Pico_mcd->cdda_stream;
+  int type = Pico_mcd->cdda_type;
+
+  // seeking back in compressed zip members means decompressing again. mp3
+  // needs a decoder which can hand out samples, else mp3_update plays it.
+  if (!(PicoIn.opt & POPT_EN_CDDA_THREAD) || stream == NULL
+      || (type != CT_MP3 && ((pm_file *)stream)->type == PMT_ZIP)
+      || (type == CT_MP3 && mp3_read(NULL, 0) < 0))
+    return 0;
+
+  if (!cdda_thr.running && !cdda_thr.failed)
+    cdda_thr_start();
+  if (!cdda_thr.running)
+    return 0;
+
+  pico_mutex_lock(&cdda_thr.lock);
+  cdda_thr.req_gen++;
+  cdda_thr.req_stream = stream;
+  cdda_thr.req_type = type;
+  if (type == CT_MP3)
+    cdda_thr.req_pos = pos1024;
+  else
+    cdda_thr.req_pos = (lba_base + lba_offset) * 2352 + (type == CT_WAV ? 44 : 0);
+  pico_cond_broadcast(&cdda_thr.cond);
+  pico_mutex_unlock(&cdda_thr.lock);
+
+  cdda_thr.active = 1;
+  return 1;
+}
+
+static void cdda_ring_update(int *buffer, int length)
+{
+  unsigned int head, tail;
+  int gen, eof, n, k;
+
+  gen = pico_atomic_load(&cdda_thr.gen);
+  if (gen != cdda_thr.req_gen)
+    return; // worker hasn't started on the last seek yet
+  if (cdda_thr.tail_gen != gen) {
+    __atomic_store_n(&cdda_thr.tail, cdda_thr.start, __ATOMIC_SEQ_CST);
+    cdda_thr.tail_gen = gen;
+  }
+
+  eof = pico_atomic_load(&cdda_thr.eof_gen) == gen;
+  head = pico_atomic_load(&cdda_thr.head);
+  tail = cdda_thr.tail;
+  n = resampler_need(&cdda_resampler, length);
+  if (n > head - tail)
+    n = head - tail;
+  if (n == 0 && eof) {
+    if (Pico_mcd->cdda_type != CT_MP3)
+      Pico_mcd->cdda_stream = NULL;
+    return;
+  }
+
+  while (n > 0) {
+    k = CDDA_RING - tail % CDDA_RING;
+    if (k > n)
+      k = n;
+    resampler_push(&cdda_resampler, cdda_ring + 2*(tail % CDDA_RING), k);
+    tail += k;
+    n -= k;
+  }
+  __atomic_store_n(&cdda_thr.tail, tail, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&cdda_thr.idle, __ATOMIC_SEQ_CST)) {
+    pico_mutex_lock(&cdda_thr.lock);
+    pico_cond_broadcast(&cdda_thr.cond);
+    pico_mutex_unlock(&cdda_thr.lock);
+  }
+
+  resampler_mix_16h_to_32(&cdda_resampler, buffer, length);
+}
+#else
+void cdda_io_lock(void) {}
+void cdda_io_unlock(void) {}
+#endif
+
+// stop reading from the track files, before they are closed
+void cdda_stop_play(void)
+{
+#ifdef USE_THREADS
+  cdda_thr_stop();
+#endif
+}
+
 static void cdda_raw_update(int *buffer, int length)
 {
-  int ret, cdda_bytes, mult = 1;
+  int ret, cdda_bytes;
 
-  cdda_bytes = length*4;
-  if (PicoIn.sndRate <= 22050 + 100) mult = 2;
-  if (PicoIn.sndRate <  22050 - 100) mult = 4;
-  cdda_bytes *= mult;
+  cdda_bytes = resampler_need(&cdda_resampler, length) * 4;
+  if (cdda_bytes > sizeof(cdda_out_buffer))
+    cdda_bytes = sizeof(cdda_out_buffer);
 
   ret = pm_read_audio(cdda_out_buffer, cdda_bytes, Pico_mcd->cdda_stream);
   if (ret < cdda_bytes) {
@@ -271,23 +798,30 @@ static void cdda_raw_update(int *buffer, int length)
     return;
   }
 
-  // now mix
-  switch (mult) {
-    case 1: mix_16h_to_32(buffer, cdda_out_buffer, length*2); break;
-    case 2: mix_16h_to_32_s1(buffer, cdda_out_buffer, length*2); break;
-    case 4: mix_16h_to_32_s2(buffer, cdda_out_buffer, length*2); break;
-  }
+  // now resample and mix
+  resampler_push(&cdda_resampler, cdda_out_buffer, cdda_bytes / 4);
+  resampler_mix_16h_to_32(&cdda_resampler, buffer, length);
 }
 
 void cdda_start_play(int lba_base, int lba_offset, int lb_len)
 {
-  if (Pico_mcd->cdda_type == CT_MP3)
-  {
-    int pos1024 = 0;
+  int pos1024 = 0;
+
+  resampler_reset(&cdda_resampler);
 
-    if (lba_offset)
-      pos1024 = lba_offset * 1024 / lb_len;
+  if (lba_offset)
+    pos1024 = lba_offset * 1024 / lb_len;
+  if (Pico_mcd->cdda_type != CT_MP3 && Pico_mcd->cdda_stream != NULL)
+    pm_sequential(Pico_mcd->cdda_stream, (lba_base + lba_offset) * 2352);
+
+#ifdef USE_THREADS
+  if (cdda_thr_play(lba_base, lba_offset, pos1024))
+    return;
+  cdda_thr_stop(); // back to reading on the emulator thread
+#endif
 
+  if (Pico_mcd->cdda_type == CT_MP3)
+  {
     mp3_start_play(Pico_mcd->cdda_stream, pos1024);
     return;
   }
@@ -355,7 +889,7 @@ static int PsndRender(int offset, int length)
     short *psgbuf = PicoIn.sndOut + (psglen << stereo);
     Pico.snd.psg_pos += (length-psglen) << 16;
     if (PicoIn.opt & POPT_EN_PSG)
-      SN76496Update(psgbuf, length-psglen, stereo);
+      snd_psg_active |= SN76496Update(psgbuf, length-psglen, stereo);
   }
 
   // Add in parts of the FM buffer not yet done
@@ -363,7 +897,7 @@ static int PsndRender(int offset, int length)
     int *fmbuf = buf32 + ((fmlen-offset) << stereo);
     Pico.snd.fm_pos += (length-fmlen) << 20;
     if (PicoIn.opt & POPT_EN_FM)
-      YM2612UpdateOne(fmbuf, length-fmlen, stereo, 1);
+      snd_fm_active |= YM2612UpdateOne(fmbuf, length-fmlen, stereo, 1);
   }
 
   // CD: PCM sound
@@ -377,7 +911,12 @@ static int PsndRender(int offset, int length)
       && Pico_mcd->cdda_stream != NULL
       && !(Pico_mcd->s68k_regs[0x36] & 1))
   {
-    // note: only 44, 22 and 11 kHz supported, with forced stereo
+    // note: forced stereo, resampled from 44.1 kHz
+#ifdef USE_THREADS
+    if (cdda_thr.active)
+      cdda_ring_update(buf32, length-offset);
+    else
+#endif
     if (Pico_mcd->cdda_type == CT_MP3)
       mp3_update(buf32, length-offset, stereo);
     else
@@ -395,11 +934,33 @@ static int PsndRender(int offset, int length)
   return length;
 }
 
+static int count_bits(unsigned int v)
+{
+  int n;
+  for (n = 0; v; v &= v - 1)
+    n++;
+  return n;
+}
+
+static void snd_count_voices(void)
+{
+  snd_voices = count_bits(snd_fm_active) + count_bits(snd_psg_active);
+  snd_fm_active = snd_psg_active = 0;
+}
+
+// number of FM channels and PSG voices which had output in the last frame
+int PsndActiveVoices(void)
+{
+  return snd_voices;
+}
+
 PICO_INTERNAL void PsndGetSamples(int y)
 {
   static int curr_pos = 0;
 
+  snd_log_end_frame();
   curr_pos  = PsndRender(0, Pico.snd.len_use);
+  snd_count_voices();
 
   if (PicoIn.writeSound)
     PicoIn.writeSound(curr_pos * ((PicoIn.opt & POPT_EN_STEREO) ? 4 : 2));
@@ -420,7 +981,7 @@ static int PsndRenderMS(int offset, int length)
     short *psgbuf = PicoIn.sndOut + (psglen << stereo);
     Pico.snd.psg_pos += (length-psglen) << 16;
     if (PicoIn.opt & POPT_EN_PSG)
-      SN76496Update(psgbuf, length-psglen, stereo);
+      snd_psg_active |= SN76496Update(psgbuf, length-psglen, stereo);
   }
 
   if (length-ym2413len > 0) {
@@ -453,7 +1014,9 @@ PICO_INTERNAL void PsndGetSamplesMS(int y)
 {
   static int curr_pos = 0;
 
+  snd_log_end_frame();
   curr_pos  = PsndRenderMS(0, Pico.snd.len_use);
+  snd_count_voices();
 
   if (PicoIn.writeSound != NULL)
     PicoIn.writeSound(curr_pos * ((PicoIn.opt & POPT_EN_STEREO) ? 4 : 2));
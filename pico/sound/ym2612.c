@@ -143,6 +143,11 @@ void memset32(void *dest, int c, int count);
 #define INLINE static __inline
 #endif
 
+#if defined(YM2612_SIMD) && (!defined(__GNUC__) || \
+    (defined(_ASM_YM2612_C) && !defined(EXTERNAL_YM2612)))
+#undef YM2612_SIMD /* needs gcc vector extensions and the C channel loop */
+#endif
+
 #ifndef M_PI
 #define M_PI    3.14159265358979323846
 #endif
@@ -1264,7 +1269,7 @@ static void chan_render_finish(void)
 	ym2612.OPN.lfo_cnt = crct.lfo_cnt;
 }
 
-static UINT32 update_lfo_phase(FM_SLOT *SLOT, UINT32 block_fnum)
+static UINT32 update_lfo_phase(chan_rend_context *ct, FM_SLOT *SLOT, UINT32 block_fnum)
 {
 	UINT32 fnum_lfo;
 	INT32  lfo_fn_table_index_offset;
@@ -1273,7 +1278,7 @@ static UINT32 update_lfo_phase(FM_SLOT *SLOT, UINT32 block_fnum)
 	int fc,fdt;
 
 	fnum_lfo   = ((block_fnum & 0x7f0) >> 4) * 32 * 8;
-	lfo_fn_table_index_offset = lfo_pm_table[ fnum_lfo + crct.CH->pms + ((crct.pack>>16)&0xff) ];
+	lfo_fn_table_index_offset = lfo_pm_table[ fnum_lfo + ct->CH->pms + ((ct->pack>>16)&0xff) ];
 	if (lfo_fn_table_index_offset)	/* LFO phase modulation active */
 	{
 		block_fnum = block_fnum*2 + lfo_fn_table_index_offset;
@@ -1283,7 +1288,7 @@ static UINT32 update_lfo_phase(FM_SLOT *SLOT, UINT32 block_fnum)
 		/* phase increment counter */
 		fc = (fn_table[fn]>>(7-blk));
 
-		fdt = fc + SLOT->DT[crct.CH->kcode];
+		fdt = fc + SLOT->DT[ct->CH->kcode];
 		if (fdt < 0) fdt += fn_table[0x7ff*2] >> 2;
 
 		return (fdt * SLOT->mul) >> 1;
@@ -1291,75 +1296,171 @@ static UINT32 update_lfo_phase(FM_SLOT *SLOT, UINT32 block_fnum)
 		return SLOT->Incr;
 }
 
-static int chan_render(int *buffer, int length, int c, UINT32 flags) // flags: stereo, ?, disabled, ?, pan_r, pan_l
+static void chan_render_setup(chan_rend_context *ct, int c, UINT32 flags) // flags: stereo, ?, disabled, 3slot, pan_r, pan_l
 {
-	crct.CH = &ym2612.CH[c];
-	crct.mem = crct.CH->mem_value;		/* one sample delay memory */
-	crct.lfo_cnt = ym2612.OPN.lfo_cnt;
+	int sl3 = flags & 8;
+
+	ct->CH = &ym2612.CH[c];
+	ct->mem = ct->CH->mem_value;		/* one sample delay memory */
+	ct->lfo_cnt = ym2612.OPN.lfo_cnt;
 
 	flags &= 0x37;
 
-	if (crct.lfo_inc) {
+	if (ct->lfo_inc) {
 		flags |= 8;
 		flags |= g_lfo_ampm << 16;
-		flags |= crct.CH->AMmasks << 8;
-		if (crct.CH->ams == 8) // no ams
+		flags |= ct->CH->AMmasks << 8;
+		if (ct->CH->ams == 8) // no ams
 		     flags &= ~0xf00;
-		else flags |= (crct.CH->ams&3)<<6;
+		else flags |= (ct->CH->ams&3)<<6;
 	}
-	flags |= (crct.CH->FB&0xf)<<12;				/* feedback shift */
-	crct.pack = flags;
+	flags |= (ct->CH->FB&0xf)<<12;				/* feedback shift */
+	ct->pack = flags;
 
-	crct.eg_cnt = ym2612.OPN.eg_cnt;			/* envelope generator counter */
-	crct.eg_timer = ym2612.OPN.eg_timer;
+	ct->eg_cnt = ym2612.OPN.eg_cnt;			/* envelope generator counter */
+	ct->eg_timer = ym2612.OPN.eg_timer;
 
 	/* precalculate phase modulation incr */
-	crct.phase1 = crct.CH->SLOT[SLOT1].phase;
-	crct.phase2 = crct.CH->SLOT[SLOT2].phase;
-	crct.phase3 = crct.CH->SLOT[SLOT3].phase;
-	crct.phase4 = crct.CH->SLOT[SLOT4].phase;
+	ct->phase1 = ct->CH->SLOT[SLOT1].phase;
+	ct->phase2 = ct->CH->SLOT[SLOT2].phase;
+	ct->phase3 = ct->CH->SLOT[SLOT3].phase;
+	ct->phase4 = ct->CH->SLOT[SLOT4].phase;
 
-	crct.op1_out = crct.CH->op1_out;
-	crct.algo = crct.CH->ALGO & 7;
+	ct->op1_out = ct->CH->op1_out;
+	ct->algo = ct->CH->ALGO & 7;
 
-	if(crct.CH->pms && (ym2612.OPN.ST.mode & 0xC0) && c == 2) {
+	if(ct->CH->pms && sl3 && c == 2) {
 		/* 3 slot mode */
-		crct.incr1 = update_lfo_phase(&crct.CH->SLOT[SLOT1], ym2612.OPN.SL3.block_fnum[1]);
-		crct.incr2 = update_lfo_phase(&crct.CH->SLOT[SLOT2], ym2612.OPN.SL3.block_fnum[2]);
-		crct.incr3 = update_lfo_phase(&crct.CH->SLOT[SLOT3], ym2612.OPN.SL3.block_fnum[0]);
-		crct.incr4 = update_lfo_phase(&crct.CH->SLOT[SLOT4], crct.CH->block_fnum);
+		ct->incr1 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT1], ym2612.OPN.SL3.block_fnum[1]);
+		ct->incr2 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT2], ym2612.OPN.SL3.block_fnum[2]);
+		ct->incr3 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT3], ym2612.OPN.SL3.block_fnum[0]);
+		ct->incr4 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT4], ct->CH->block_fnum);
 	}
-	else if(crct.CH->pms)
+	else if(ct->CH->pms)
 	{
-		crct.incr1 = update_lfo_phase(&crct.CH->SLOT[SLOT1], crct.CH->block_fnum);
-		crct.incr2 = update_lfo_phase(&crct.CH->SLOT[SLOT2], crct.CH->block_fnum);
-		crct.incr3 = update_lfo_phase(&crct.CH->SLOT[SLOT3], crct.CH->block_fnum);
-		crct.incr4 = update_lfo_phase(&crct.CH->SLOT[SLOT4], crct.CH->block_fnum);
+		ct->incr1 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT1], ct->CH->block_fnum);
+		ct->incr2 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT2], ct->CH->block_fnum);
+		ct->incr3 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT3], ct->CH->block_fnum);
+		ct->incr4 = update_lfo_phase(ct, &ct->CH->SLOT[SLOT4], ct->CH->block_fnum);
 	}
 	else	/* no LFO phase modulation */
 	{
-		crct.incr1 = crct.CH->SLOT[SLOT1].Incr;
-		crct.incr2 = crct.CH->SLOT[SLOT2].Incr;
-		crct.incr3 = crct.CH->SLOT[SLOT3].Incr;
-		crct.incr4 = crct.CH->SLOT[SLOT4].Incr;
+		ct->incr1 = ct->CH->SLOT[SLOT1].Incr;
+		ct->incr2 = ct->CH->SLOT[SLOT2].Incr;
+		ct->incr3 = ct->CH->SLOT[SLOT3].Incr;
+		ct->incr4 = ct->CH->SLOT[SLOT4].Incr;
 	}
+}
 
-	chan_render_loop(&crct, buffer, length);
-
-	crct.CH->op1_out = crct.op1_out;
-	crct.CH->mem_value = crct.mem;
-	if (crct.CH->SLOT[SLOT1].state | crct.CH->SLOT[SLOT2].state | crct.CH->SLOT[SLOT3].state | crct.CH->SLOT[SLOT4].state)
+static int chan_render_done(chan_rend_context *ct, int c)
+{
+	ct->CH->op1_out = ct->op1_out;
+	ct->CH->mem_value = ct->mem;
+	if (ct->CH->SLOT[SLOT1].state | ct->CH->SLOT[SLOT2].state | ct->CH->SLOT[SLOT3].state | ct->CH->SLOT[SLOT4].state)
 	{
-		crct.CH->SLOT[SLOT1].phase = crct.phase1;
-		crct.CH->SLOT[SLOT2].phase = crct.phase2;
-		crct.CH->SLOT[SLOT3].phase = crct.phase3;
-		crct.CH->SLOT[SLOT4].phase = crct.phase4;
+		ct->CH->SLOT[SLOT1].phase = ct->phase1;
+		ct->CH->SLOT[SLOT2].phase = ct->phase2;
+		ct->CH->SLOT[SLOT3].phase = ct->phase3;
+		ct->CH->SLOT[SLOT4].phase = ct->phase4;
 	}
 	else
 		ym2612.slot_mask &= ~(0xf << (c*4));
 
-	return (crct.algo & 8) >> 3; // had output
+	return (ct->algo & 8) >> 3; // had output
+}
+
+static int chan_render(int *buffer, int length, int c, UINT32 flags)
+{
+	chan_render_setup(&crct, c, flags);
+	chan_render_loop(&crct, buffer, length);
+	return chan_render_done(&crct, c);
+}
+
+#ifdef YM2612_SIMD
+/*
+ * Vector channel renderers, see ym2612_vec.c. On x86 one for SSE4.1 and one
+ * for AVX2 are built, the one to use is chosen by the cpu at init. The vector
+ * renderer has a fixed cost per sample, it's only used if enough channels
+ * are playing and C rendering them one by one is slower.
+ */
+
+/* operator connections, see chan_render_loop */
+enum {
+	CN_M3_MEM,	/* SLOT3 modulated by MEM */
+	CN_M2_C1,	/* SLOT2 modulated by SLOT1 */
+	CN_M4_OP3,	/* SLOT4 modulated by SLOT3 */
+	CN_M4_C1,	/* SLOT4 modulated by SLOT1 */
+	CN_M4_MEM,	/* SLOT4 modulated by MEM */
+	CN_MEM_OP2,	/* MEM gets SLOT2 */
+	CN_MEM_C1,	/* MEM gets SLOT1 */
+	CN_MEM_KEEP,	/* MEM not used */
+	CN_OUT_C1,	/* SLOT1 to output */
+	CN_OUT_OP2,	/* SLOT2 to output */
+	CN_OUT_OP3,	/* SLOT3 to output */
+	CN_COUNT
+};
+
+#define CN(x) (1<<CN_##x)
+static const UINT16 algo_conn[8] = {
+	CN(M3_MEM) | CN(M2_C1) | CN(M4_OP3) | CN(MEM_OP2),
+	CN(M3_MEM) | CN(M4_OP3) | CN(MEM_OP2) | CN(MEM_C1),
+	CN(M3_MEM) | CN(M4_OP3) | CN(M4_C1) | CN(MEM_OP2),
+	CN(M2_C1) | CN(M4_OP3) | CN(M4_MEM) | CN(MEM_OP2),
+	CN(M2_C1) | CN(M4_OP3) | CN(MEM_KEEP) | CN(OUT_OP2),
+	CN(M3_MEM) | CN(M2_C1) | CN(M4_C1) | CN(MEM_C1) | CN(OUT_OP2) | CN(OUT_OP3),
+	CN(M2_C1) | CN(MEM_KEEP) | CN(OUT_OP2) | CN(OUT_OP3),
+	CN(MEM_KEEP) | CN(OUT_C1) | CN(OUT_OP2) | CN(OUT_OP3),
+};
+#undef CN
+
+static chan_rend_context simd_ct[6];
+
+#define EG_MASK(SLOT) ((SLOT)->state == EG_OFF ? ~0 : \
+	(1 << ((SLOT)->eg_pack[(SLOT)->state - 1] >> 24)) - 1)
+
+#if defined(__i386__) || defined(__x86_64__)
+#define VL 4
+#define VEC_TARGET __attribute__((target("sse4.1")))
+#include "ym2612_vec.c"
+#define VL 8
+#define VEC_TARGET __attribute__((target("avx2")))
+#include "ym2612_vec.c"
+#else
+#define VL 4
+#define VEC_TARGET
+#include "ym2612_vec.c"
+#endif
+
+/* vector renderer and the playing channels needed for using it */
+static int (*chan_render_vec)(int *buffer, int length, UINT32 flags, int pan);
+static int chan_render_vec_min;
+
+static void chan_render_vec_init(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		chan_render_vec = chan_render_v8;
+	else if (__builtin_cpu_supports("sse4.1"))
+		chan_render_vec = chan_render_v4;
+#else
+	chan_render_vec = chan_render_v4;
+#endif
+	chan_render_vec_min = 3;
+}
+
+/* channels which would be rendered in vector lanes */
+static int chan_render_vec_count(void)
+{
+	int c, n = 0;
+
+	for (c = 0; c < 6; c++)
+		if ((ym2612.slot_mask & (0xf << (c*4))) &&
+		    !(ym2612.ssg_mask & (0xf << (c*4))))
+			n++;
+	return n;
 }
+#endif
 
 /* update phase increment and envelope generator */
 INLINE void refresh_fc_eg_slot(FM_SLOT *SLOT, int fc, int kc)
@@ -1777,7 +1878,8 @@ static int OPNWriteReg(int r, int v)
 /*******************************************************************************/
 
 /* Generate samples for YM2612 */
-int YM2612UpdateOne_(int *buffer, int length, int stereo, int is_buf_empty)
+/* st: 3slot/CSM mode bits of reg 0x27, dac enable in bit 0 */
+int YM2612UpdateOneSt_(int *buffer, int length, int stereo, int is_buf_empty, int st)
 {
 	int pan;
 	int active_chs = 0;
@@ -1807,7 +1909,7 @@ int YM2612UpdateOne_(int *buffer, int length, int stereo, int is_buf_empty)
 	/* refresh PG and EG */
 	refresh_fc_eg_chan( &ym2612.CH[0] );
 	refresh_fc_eg_chan( &ym2612.CH[1] );
-	if( (ym2612.OPN.ST.mode & 0xc0) )
+	if( (st & 0xc0) )
 		/* 3SLOT MODE */
 		refresh_fc_eg_chan_sl3();
 	else
@@ -1821,31 +1923,47 @@ int YM2612UpdateOne_(int *buffer, int length, int stereo, int is_buf_empty)
 	/* mix to 32bit dest */
 	// flags: stereo, ssg_enabled, disabled, _, pan_r, pan_l
 	chan_render_prep();
+#ifdef YM2612_SIMD
+	if (chan_render_vec != NULL && chan_render_vec_count() >= chan_render_vec_min)
+		active_chs = chan_render_vec(buffer, length, flags|((st&1)<<2)|((st&0xc0)?8:0), pan);
+	else
+#endif
+	{
 #define	BIT_IF(v,b,c)	{ v &= ~(1<<(b)); if (c) v |= 1<<(b); }
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0x00000f) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0x00000f) active_chs |= chan_render(buffer, length, 0, flags|((pan&0x003)<<4)) << 0;
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0x0000f0) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0x0000f0) active_chs |= chan_render(buffer, length, 1, flags|((pan&0x00c)<<2)) << 1;
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0x000f00) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0x000f00) active_chs |= chan_render(buffer, length, 2, flags|((pan&0x030)   )) << 2;
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0x00f000) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0x00f000) active_chs |= chan_render(buffer, length, 3, flags|((pan&0x0c0)>>2)) << 3;
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0x0f0000) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0x0f0000) active_chs |= chan_render(buffer, length, 4, flags|((pan&0x300)>>4)) << 4;
-	BIT_IF(flags, 1, (ym2612.ssg_mask & 0xf00000) && (ym2612.OPN.ST.flags & 1));
-	if (ym2612.slot_mask & 0xf00000) active_chs |= chan_render(buffer, length, 5, flags|((pan&0xc00)>>6)|(!!ym2612.dacen<<2)) << 5;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0x00000f) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0x00000f) active_chs |= chan_render(buffer, length, 0, flags|((pan&0x003)<<4)) << 0;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0x0000f0) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0x0000f0) active_chs |= chan_render(buffer, length, 1, flags|((pan&0x00c)<<2)) << 1;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0x000f00) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0x000f00) active_chs |= chan_render(buffer, length, 2, flags|((pan&0x030)   )|((st&0xc0)?8:0)) << 2;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0x00f000) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0x00f000) active_chs |= chan_render(buffer, length, 3, flags|((pan&0x0c0)>>2)) << 3;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0x0f0000) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0x0f0000) active_chs |= chan_render(buffer, length, 4, flags|((pan&0x300)>>4)) << 4;
+		BIT_IF(flags, 1, (ym2612.ssg_mask & 0xf00000) && (ym2612.OPN.ST.flags & 1));
+		if (ym2612.slot_mask & 0xf00000) active_chs |= chan_render(buffer, length, 5, flags|((pan&0xc00)>>6)|((st&1)<<2)) << 5;
 #undef	BIT_IF
+	}
 	chan_render_finish();
 
 	return active_chs; // 1 if buffer updated
 }
 
+int YM2612UpdateOne_(int *buffer, int length, int stereo, int is_buf_empty)
+{
+	return YM2612UpdateOneSt_(buffer, length, stereo, is_buf_empty,
+			(ym2612.OPN.ST.mode & 0xc0) | !!ym2612.dacen);
+}
+
 
 /* initialize YM2612 emulator */
 void YM2612Init_(int clock, int rate, int ssg)
 {
 	memset(&ym2612, 0, sizeof(ym2612));
 	init_tables();
+#ifdef YM2612_SIMD
+	chan_render_vec_init();
+#endif
 
 	ym2612.OPN.ST.clock = clock;
 	ym2612.OPN.ST.rate = rate;
@@ -1897,12 +2015,107 @@ void YM2612ResetChip_(void)
 
 
 /* YM2612 write */
+/* write v to register addr (A1 in bit 8), bypassing the address latch */
+/* returns 1 if sample affecting state changed */
+int YM2612WriteReg_(unsigned int addr, unsigned int v)
+{
+	int ret=1;
+
+	v &= 0xff;	/* adjust to 8 bit bus */
+
+	switch( addr & 0x1f0 )
+	{
+	case 0x20:	/* 0x20-0x2f Mode */
+		switch( addr )
+		{
+		case 0x22:	/* LFO FREQ (YM2608/YM2610/YM2610B/YM2612) */
+			if (v&0x08) /* LFO enabled ? */
+			{
+				ym2612.OPN.lfo_inc = ym2612.OPN.lfo_freq[v&7];
+			}
+			else
+			{
+				ym2612.OPN.lfo_inc = 0;
+				ym2612.OPN.lfo_cnt = 0;
+				g_lfo_ampm = 126 << 8;
+			}
+			break;
+#if 0 // handled elsewhere
+		case 0x24: { // timer A High 8
+				int TAnew = (ym2612.OPN.ST.TA & 0x03)|(((int)v)<<2);
+				if(ym2612.OPN.ST.TA != TAnew) {
+					// we should reset ticker only if new value is written. Outrun requires this.
+					ym2612.OPN.ST.TA = TAnew;
+					ym2612.OPN.ST.TAC = (1024-TAnew)*18;
+					ym2612.OPN.ST.TAT = 0;
+				}
+			}
+			ret=0;
+			break;
+		case 0x25: { // timer A Low 2
+				int TAnew = (ym2612.OPN.ST.TA & 0x3fc)|(v&3);
+				if(ym2612.OPN.ST.TA != TAnew) {
+					ym2612.OPN.ST.TA = TAnew;
+					ym2612.OPN.ST.TAC = (1024-TAnew)*18;
+					ym2612.OPN.ST.TAT = 0;
+				}
+			}
+			ret=0;
+			break;
+		case 0x26: // timer B
+			if(ym2612.OPN.ST.TB != v) {
+				ym2612.OPN.ST.TB = v;
+				ym2612.OPN.ST.TBC  = (256-v)<<4;
+				ym2612.OPN.ST.TBC *= 18;
+				ym2612.OPN.ST.TBT  = 0;
+			}
+			ret=0;
+			break;
+#endif
+		case 0x27:	/* mode, timer control */
+			set_timers( v );
+			ret=0;
+			break;
+		case 0x28:	/* key on / off */
+			{
+				UINT8 c;
+
+				c = v & 0x03;
+				if( c == 3 ) { ret=0; break; }
+				if( v&0x04 ) c+=3;
+				if(v&0x10) FM_KEYON(c,SLOT1); else FM_KEYOFF(c,SLOT1);
+				if(v&0x20) FM_KEYON(c,SLOT2); else FM_KEYOFF(c,SLOT2);
+				if(v&0x40) FM_KEYON(c,SLOT3); else FM_KEYOFF(c,SLOT3);
+				if(v&0x80) FM_KEYON(c,SLOT4); else FM_KEYOFF(c,SLOT4);
+				break;
+			}
+		case 0x2a:	/* DAC data (YM2612) */
+			ym2612.dacout = ((int)v - 0x80) << 6;	/* level unknown (notaz: 8 seems to be too much) */
+			ret=0;
+			break;
+		case 0x2b:	/* DAC Sel  (YM2612) */
+			/* b7 = dac enable */
+			ym2612.dacen = v & 0x80;
+			ret=0;
+			break;
+		default:
+			break;
+		}
+		break;
+	default:	/* 0x30-0xff OPN section */
+		/* write register */
+		ret = OPNWriteReg(addr,v);
+	}
+
+	return ret;
+}
+
 /* a = address */
 /* v = value   */
 /* returns 1 if sample affecting state changed */
 int YM2612Write_(unsigned int a, unsigned int v)
 {
-	int addr, ret=1;
+	int ret=1;
 
 	v &= 0xff;	/* adjust to 8 bit bus */
 
@@ -1916,91 +2129,7 @@ int YM2612Write_(unsigned int a, unsigned int v)
 
 	case 1:
 	case 3:	/* data port */
-		addr = ym2612.OPN.ST.address | ((int)ym2612.addr_A1 << 8);
-
-		switch( addr & 0x1f0 )
-		{
-		case 0x20:	/* 0x20-0x2f Mode */
-			switch( addr )
-			{
-			case 0x22:	/* LFO FREQ (YM2608/YM2610/YM2610B/YM2612) */
-				if (v&0x08) /* LFO enabled ? */
-				{
-					ym2612.OPN.lfo_inc = ym2612.OPN.lfo_freq[v&7];
-				}
-				else
-				{
-					ym2612.OPN.lfo_inc = 0;
-					ym2612.OPN.lfo_cnt = 0;
-					g_lfo_ampm = 126 << 8;
-				}
-				break;
-#if 0 // handled elsewhere
-			case 0x24: { // timer A High 8
-					int TAnew = (ym2612.OPN.ST.TA & 0x03)|(((int)v)<<2);
-					if(ym2612.OPN.ST.TA != TAnew) {
-						// we should reset ticker only if new value is written. Outrun requires this.
-						ym2612.OPN.ST.TA = TAnew;
-						ym2612.OPN.ST.TAC = (1024-TAnew)*18;
-						ym2612.OPN.ST.TAT = 0;
-					}
-				}
-				ret=0;
-				break;
-			case 0x25: { // timer A Low 2
-					int TAnew = (ym2612.OPN.ST.TA & 0x3fc)|(v&3);
-					if(ym2612.OPN.ST.TA != TAnew) {
-						ym2612.OPN.ST.TA = TAnew;
-						ym2612.OPN.ST.TAC = (1024-TAnew)*18;
-						ym2612.OPN.ST.TAT = 0;
-					}
-				}
-				ret=0;
-				break;
-			case 0x26: // timer B
-				if(ym2612.OPN.ST.TB != v) {
-					ym2612.OPN.ST.TB = v;
-					ym2612.OPN.ST.TBC  = (256-v)<<4;
-					ym2612.OPN.ST.TBC *= 18;
-					ym2612.OPN.ST.TBT  = 0;
-				}
-				ret=0;
-				break;
-#endif
-			case 0x27:	/* mode, timer control */
-				set_timers( v );
-				ret=0;
-				break;
-			case 0x28:	/* key on / off */
-				{
-					UINT8 c;
-
-					c = v & 0x03;
-					if( c == 3 ) { ret=0; break; }
-					if( v&0x04 ) c+=3;
-					if(v&0x10) FM_KEYON(c,SLOT1); else FM_KEYOFF(c,SLOT1);
-					if(v&0x20) FM_KEYON(c,SLOT2); else FM_KEYOFF(c,SLOT2);
-					if(v&0x40) FM_KEYON(c,SLOT3); else FM_KEYOFF(c,SLOT3);
-					if(v&0x80) FM_KEYON(c,SLOT4); else FM_KEYOFF(c,SLOT4);
-					break;
-				}
-			case 0x2a:	/* DAC data (YM2612) */
-				ym2612.dacout = ((int)v - 0x80) << 6;	/* level unknown (notaz: 8 seems to be too much) */
-				ret=0;
-				break;
-			case 0x2b:	/* DAC Sel  (YM2612) */
-				/* b7 = dac enable */
-				ym2612.dacen = v & 0x80;
-				ret=0;
-				break;
-			default:
-				break;
-			}
-			break;
-		default:	/* 0x30-0xff OPN section */
-			/* write register */
-			ret = OPNWriteReg(addr,v);
-		}
+		ret = YM2612WriteReg_(ym2612.OPN.ST.address | ((int)ym2612.addr_A1 << 8), v);
 		break;
 	}
 
@@ -165,8 +165,10 @@ extern YM2612 ym2612;
 void YM2612Init_(int baseclock, int rate, int ssg);
 void YM2612ResetChip_(void);
 int  YM2612UpdateOne_(int *buffer, int length, int stereo, int is_buf_empty);
+int  YM2612UpdateOneSt_(int *buffer, int length, int stereo, int is_buf_empty, int st);
 
 int  YM2612Write_(unsigned int a, unsigned int v);
+int  YM2612WriteReg_(unsigned int addr, unsigned int v);
 //unsigned char YM2612Read_(void);
 
 int  YM2612PicoTick_(int n);
@@ -180,6 +182,7 @@ int  YM2612PicoStateLoad2(int *tat, int *tbt);
 #define YM2612Init          YM2612Init_
 #define YM2612ResetChip     YM2612ResetChip_
 #define YM2612UpdateOne     YM2612UpdateOne_
+#define YM2612UpdateOneSt   YM2612UpdateOneSt_
 #define YM2612PicoStateLoad YM2612PicoStateLoad_
 #else
 /* GP2X specific */
@@ -192,10 +195,12 @@ int  YM2612PicoStateLoad2(int *tat, int *tbt);
 	if (PicoIn.opt&POPT_EXT_FM) YM2612ResetChip_940(); \
 	else               YM2612ResetChip_(); \
 } while (0)
-#define YM2612UpdateOne(buffer,length,stereo,is_buf_empty) do { \
+#define YM2612UpdateOne(buffer,length,stereo,is_buf_empty) ( \
 	(PicoIn.opt&POPT_EXT_FM) ? YM2612UpdateOne_940(buffer, length, stereo, is_buf_empty) : \
-				YM2612UpdateOne_(buffer, length, stereo, is_buf_empty); \
-} while (0)
+				YM2612UpdateOne_(buffer, length, stereo, is_buf_empty) )
+#define YM2612UpdateOneSt(buffer,length,stereo,is_buf_empty,st) ( \
+	(PicoIn.opt&POPT_EXT_FM) ? YM2612UpdateOne_940(buffer, length, stereo, is_buf_empty) : \
+				YM2612UpdateOneSt_(buffer, length, stereo, is_buf_empty, st) )
 #define YM2612PicoStateLoad() do { \
 	if (PicoIn.opt&POPT_EXT_FM) YM2612PicoStateLoad_940(); \
 	else               YM2612PicoStateLoad_(); \
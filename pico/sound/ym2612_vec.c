@@ -0,0 +1,301 @@
+/*
+ * YM2612 vector channel renderer, included by ym2612.c once per vector
+ * width. VL is the number of 32 bit lanes per vector, VEC_TARGET the
+ * function attribute enabling the instruction set for it. The renderer is
+ * named chan_render_v<VL>, its types and state get the same suffix.
+ *
+ * All channels are rendered at once, one vector lane per channel. Envelope,
+ * LFO and operator calculations are done for all channels in parallel, the
+ * algorithm is given by per-lane connection masks. The playing channels are
+ * packed into the lowest lanes, vectors without one are skipped. The
+ * FM_SLOT envelope state is only accessed on EG timer ticks, the output is
+ * identical to chan_render_loop. Channels using SSG-EG are still rendered by
+ * the latter.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+
+#define VEC__(n, l)	n##_v##l
+#define VEC_(n, l)	VEC__(n, l)
+
+#define vsi		VEC_(vsi, VL)
+#define vsu		VEC_(vsu, VL)
+#define vr		VEC_(vr, VL)
+#define chan_render_v	VEC_(chan_render, VL)
+
+#define VN ((6+VL-1)/VL)	/* vectors for 6 channels */
+#define LANE(v, l) (v)[(l)/VL][(l)%VL]
+
+typedef INT32  vsi __attribute__((vector_size(VL*4)));
+typedef UINT32 vsu __attribute__((vector_size(VL*4)));
+
+#if VL == 8
+#define TL_GATHER(i) (vsi) { ym_tl_tab[i[0]], ym_tl_tab[i[1]], ym_tl_tab[i[2]], \
+	ym_tl_tab[i[3]], ym_tl_tab[i[4]], ym_tl_tab[i[5]], 0, 0 }
+#define HSUM(v) (v[0] + v[1] + v[2] + v[3] + v[4] + v[5])
+#else
+#define TL_GATHER(i) (vsi) { ym_tl_tab[i[0]], ym_tl_tab[i[1]], \
+	ym_tl_tab[i[2]], ym_tl_tab[i[3]] }
+#define HSUM(v) (v[0] + v[1] + v[2] + v[3])
+#endif
+
+/* op_calc/op_calc1 with the phase already added up, 0 in lanes not in on */
+#define OP_CALC_V(ret, sin, env, on) do { \
+	vsi neg_ = -((sin >> 9) & 1), idx_; \
+	idx_ = (sin ^ -((sin >> 8) & 1)) & 0xff; \
+	idx_ = (idx_ | ((env & ~1) << 7)) & on; \
+	ret = TL_GATHER(idx_); \
+	ret = ((ret ^ neg_) - neg_) & on; \
+} while (0)
+
+static struct {
+	vsi en[VN], pan_l[VN], pan_r[VN], fb_mul[VN], am_sh[VN], am[VN];
+	vsi op1_lo[VN], op1_hi[VN], mem[VN], had[VN];
+	vsi cn[CN_COUNT][VN];
+	vsi volume[4][VN], state[4][VN], tl[4][VN], am_mask[4][VN];
+	vsi vol_out[4][VN], vol_ipol[4][VN];
+	vsu phase[4][VN], incr[4][VN];
+	UINT32 eg_mask[6*4];	/* EG is updated if !(eg_cnt & eg_mask) */
+} vr;
+
+static VEC_TARGET int chan_render_v(int *buffer, int length, UINT32 flags, int pan)
+{
+	UINT32 eg_timer, eg_cnt, lfo_cnt, lfo_ampm;
+	chan_rend_context *ct = NULL;
+	int c, s, h, i, k, l, vn, chans = 0, lanes = 0, active_chs = 0;
+	UINT8 lane[6];
+
+	memset(&vr, 0, sizeof(vr));
+	memset(vr.eg_mask, 0xff, sizeof(vr.eg_mask));
+
+	for (c = 0; c < 6; c++)
+	{
+		UINT32 f = flags & ~0xe;
+
+		if (!(ym2612.slot_mask & (0xf << (c*4))))
+			continue;
+		f |= ((pan >> (c*2)) & 3) << 4;
+		if (c == 5)
+			f |= flags & 4;
+		if (c == 2)
+			f |= flags & 8;
+		if (ym2612.ssg_mask & (0xf << (c*4))) {
+			if (ym2612.OPN.ST.flags & 1)
+				f |= 2;
+			active_chs |= chan_render(buffer, length, c, f) << c;
+			continue;
+		}
+
+		ct = &simd_ct[c];
+		*ct = crct;
+		chan_render_setup(ct, c, f);
+		chans |= 1 << c;
+		lane[c] = l = lanes++;
+
+		for (s = 0; s < 4; s++) {
+			FM_SLOT *SLOT = &ct->CH->SLOT[s];
+			LANE(vr.volume[s], l) = SLOT->volume;
+			LANE(vr.state[s], l) = SLOT->state;
+			LANE(vr.tl[s], l) = SLOT->tl;
+			LANE(vr.vol_out[s], l) = SLOT->vol_out;
+			LANE(vr.vol_ipol[s], l) = SLOT->vol_ipol;
+			vr.eg_mask[c*4 + s] = EG_MASK(SLOT);
+			if ((ct->pack & 8) && (ct->pack & (1<<(s+8))))
+				LANE(vr.am_mask[s], l) = -1;
+		}
+		LANE(vr.am_sh, l) = (ct->pack & 0xc0) >> 6;
+		LANE(vr.phase[SLOT1], l) = ct->phase1; LANE(vr.incr[SLOT1], l) = ct->incr1;
+		LANE(vr.phase[SLOT2], l) = ct->phase2; LANE(vr.incr[SLOT2], l) = ct->incr2;
+		LANE(vr.phase[SLOT3], l) = ct->phase3; LANE(vr.incr[SLOT3], l) = ct->incr3;
+		LANE(vr.phase[SLOT4], l) = ct->phase4; LANE(vr.incr[SLOT4], l) = ct->incr4;
+		LANE(vr.op1_lo, l) = (INT16)ct->op1_out;
+		LANE(vr.op1_hi, l) = ct->op1_out >> 16;
+		LANE(vr.mem, l) = ct->mem;
+
+		if (ct->pack & 4) { /* output disabled */
+			LANE(vr.cn[CN_MEM_KEEP], l) = -1;
+			continue;
+		}
+		LANE(vr.en, l) = -1;
+		LANE(vr.pan_l, l) = (!(ct->pack & 1) || (ct->pack & 0x20)) ? -1 : 0;
+		LANE(vr.pan_r, l) = (ct->pack & 0x10) ? -1 : 0;
+		if (ct->pack & 0xf000)
+			LANE(vr.fb_mul, l) = 1 << ((ct->pack & 0xf000) >> 12);
+		for (i = 0; i < CN_COUNT; i++)
+			if (algo_conn[ct->algo] & (1 << i))
+				LANE(vr.cn[i], l) = -1;
+	}
+	if (!chans)
+		return active_chs;
+	vn = (lanes + VL-1) / VL;
+
+	/* EG and LFO state is the same for all channels */
+	eg_timer = ct->eg_timer;
+	eg_cnt = ct->eg_cnt;
+	lfo_cnt = ct->lfo_cnt;
+	lfo_ampm = ct->pack >> 16;
+	for (l = 0; l < lanes; l++)
+		LANE(vr.am, l) = (lfo_ampm >> 8) >> LANE(vr.am_sh, l);
+
+	for (i = 0; i < length; i++)
+	{
+		vsi acc_l = { 0 }, acc_r = { 0 };
+
+		if (ct->pack & 8) { /* LFO enabled */
+			UINT32 ampm = advance_lfo(lfo_ampm, lfo_cnt, lfo_cnt + ct->lfo_inc);
+			lfo_cnt += ct->lfo_inc;
+			if (ampm != lfo_ampm) {
+				lfo_ampm = ampm;
+				for (l = 0; l < lanes; l++)
+					LANE(vr.am, l) = (lfo_ampm >> 8) >> LANE(vr.am_sh, l);
+			}
+		}
+
+		eg_timer += ct->eg_timer_add;
+		if (eg_timer < EG_TIMER_OVERFLOW) {
+			for (s = 0; s < 4; s++)
+				for (h = 0; h < vn; h++) {
+					vsi upd = vr.state[s][h] > EG_REL; /* recalc_volout */
+					vr.vol_ipol[s][h] = vr.vol_out[s][h];
+					vr.vol_out[s][h] = ((vr.volume[s][h] + vr.tl[s][h]) & 0xffff & upd) |
+								(vr.vol_out[s][h] & ~upd);
+				}
+		}
+		else while (eg_timer >= EG_TIMER_OVERFLOW)
+		{
+			eg_timer -= EG_TIMER_OVERFLOW;
+			eg_cnt++;
+			if (eg_cnt >= 4096) eg_cnt = 1;
+
+			for (s = 0; s < 4; s++)
+				for (h = 0; h < vn; h++)
+					vr.vol_ipol[s][h] = vr.vol_out[s][h];
+			for (k = 0; k < 6*4; k++) {
+				FM_SLOT *SLOT;
+				if (eg_cnt & vr.eg_mask[k])
+					continue;
+				c = k >> 2, s = k & 3, l = lane[c];
+				SLOT = &ym2612.CH[c].SLOT[s];
+				update_eg_phase(SLOT, eg_cnt, 0);
+				LANE(vr.volume[s], l) = SLOT->volume;
+				LANE(vr.state[s], l) = SLOT->state;
+				LANE(vr.vol_out[s], l) = SLOT->vol_out;
+				vr.eg_mask[k] = EG_MASK(SLOT);
+			}
+		}
+
+		for (h = 0; h < vn; h++)
+		{
+			vsi env[4], c1, x2, x3, x4, on, sin, smp;
+			vsu out;
+
+			switch (eg_timer >> EG_SH)
+			{
+				case 0:
+					for (s = 0; s < 4; s++)
+						env[s] = vr.vol_ipol[s][h];
+					break;
+				case (EG_TIMER_OVERFLOW>>EG_SH)-1:
+					for (s = 0; s < 4; s++)
+						env[s] = vr.vol_out[s][h];
+					break;
+				default:
+					for (s = 0; s < 4; s++)
+						env[s] = (vr.vol_ipol[s][h] + vr.vol_out[s][h]) >> 1;
+					break;
+			}
+			for (s = 0; s < 4; s++)
+				env[s] += vr.am[h] & vr.am_mask[s][h];
+
+			/* SLOT 1, with self feedback */
+			out = (vsu)(vr.op1_hi[h] + vr.op1_lo[h]) * (vsu)vr.fb_mul[h];
+			sin = (vsi)((vr.phase[SLOT1][h] + out) >> 16);
+			on = (env[SLOT1] < ENV_QUIET) & vr.en[h];
+			c1 = vr.op1_lo[h];
+			vr.op1_hi[h] = (c1 & vr.en[h]) | (vr.op1_hi[h] & ~vr.en[h]);
+			OP_CALC_V(vr.op1_lo[h], sin, env[SLOT1], on);
+			vr.op1_lo[h] |= c1 & ~vr.en[h];
+
+			/* SLOT 3 */
+			sin = (vsi)(vr.phase[SLOT3][h] >> 16) + ((vr.mem[h] & vr.cn[CN_M3_MEM][h]) >> 1);
+			on = (env[SLOT3] < ENV_QUIET) & vr.en[h];
+			OP_CALC_V(x3, sin, env[SLOT3], on);
+
+			/* SLOT 2 */
+			sin = (vsi)(vr.phase[SLOT2][h] >> 16) + ((c1 & vr.cn[CN_M2_C1][h]) >> 1);
+			on = (env[SLOT2] < ENV_QUIET) & vr.en[h];
+			OP_CALC_V(x2, sin, env[SLOT2], on);
+
+			/* SLOT 4 */
+			sin = (x3 & vr.cn[CN_M4_OP3][h]) + (c1 & vr.cn[CN_M4_C1][h]) +
+				(vr.mem[h] & vr.cn[CN_M4_MEM][h]);
+			sin = (vsi)(vr.phase[SLOT4][h] >> 16) + (sin >> 1);
+			on = (env[SLOT4] < ENV_QUIET) & vr.en[h];
+			OP_CALC_V(x4, sin, env[SLOT4], on);
+
+			vr.mem[h] = (x2 & vr.cn[CN_MEM_OP2][h]) + (c1 & vr.cn[CN_MEM_C1][h]) +
+				(vr.mem[h] & vr.cn[CN_MEM_KEEP][h]);
+			smp = x4 + (x2 & vr.cn[CN_OUT_OP2][h]) + (x3 & vr.cn[CN_OUT_OP3][h]) +
+				(c1 & vr.cn[CN_OUT_C1][h]);
+			smp &= vr.en[h];
+			vr.had[h] |= smp;
+			acc_l += smp & vr.pan_l[h];
+			acc_r += smp & vr.pan_r[h];
+
+			/* update phase counters AFTER output calculations */
+			for (s = 0; s < 4; s++)
+				vr.phase[s][h] += vr.incr[s][h] & (vsu)vr.en[h];
+		}
+
+		/* mix samples to output buffer */
+		if (flags & 1) {
+			buffer[i*2]   += HSUM(acc_l);
+			buffer[i*2+1] += HSUM(acc_r);
+		} else
+			buffer[i] += HSUM(acc_l);
+	}
+
+	for (c = 0; c < 6; c++)
+	{
+		if (!(chans & (1 << c)))
+			continue;
+		ct = &simd_ct[c];
+		l = lane[c];
+		for (s = 0; s < 4; s++) {
+			ct->CH->SLOT[s].vol_out = LANE(vr.vol_out[s], l);
+			ct->CH->SLOT[s].vol_ipol = LANE(vr.vol_ipol[s], l);
+		}
+		ct->phase1 = LANE(vr.phase[SLOT1], l);
+		ct->phase2 = LANE(vr.phase[SLOT2], l);
+		ct->phase3 = LANE(vr.phase[SLOT3], l);
+		ct->phase4 = LANE(vr.phase[SLOT4], l);
+		ct->op1_out = (LANE(vr.op1_hi, l) << 16) | (UINT16)LANE(vr.op1_lo, l);
+		ct->mem = LANE(vr.mem, l);
+		if (LANE(vr.had, l))
+			ct->algo |= 8;
+		active_chs |= chan_render_done(ct, c) << c;
+	}
+
+	/* shared state for chan_render_finish */
+	crct.eg_cnt = eg_cnt;
+	crct.eg_timer = eg_timer;
+	crct.lfo_cnt = lfo_cnt;
+	crct.pack = lfo_ampm << 16;
+
+	return active_chs;
+}
+
+#undef OP_CALC_V
+#undef HSUM
+#undef TL_GATHER
+#undef LANE
+#undef VN
+#undef chan_render_v
+#undef vr
+#undef vsu
+#undef vsi
+#undef VEC_
+#undef VEC__
+#undef VEC_TARGET
+#undef VL
@@ -235,6 +235,9 @@ static int state_save(void *file)
   int retval = -1;
   int len;
 
+  // chip state must include all logged writes
+  PsndFlushLog();
+
   areaWrite("PicoSEXT", 1, 8, file);
   areaWrite(&ver, 1, 4, file);
 
@@ -282,6 +285,7 @@ static int state_save(void *file)
       wram_1M_to_2M(Pico_mcd->word_ram2M);
     memcpy(&Pico_mcd->m.hint_vector, Pico_mcd->bios + 0x72,
       sizeof(Pico_mcd->m.hint_vector));
+    pcd_state_save_mem();
 
     CHECKED_WRITE_BUFF(CHUNK_S68K,     buff);
     CHECKED_WRITE_BUFF(CHUNK_PRG_RAM,  Pico_mcd->prg_ram);
@@ -335,6 +339,7 @@ static int state_save(void *file)
 
     memset(buff, 0, 0x40);
     memcpy(buff, p32x_event_times, sizeof(p32x_event_times));
+    memcpy(buff + 0x3c, &p32x_sync_stats.step, 4); // sh2 slice length
     CHECKED_WRITE(CHUNK_32X_EVT, 0x40, buff);
   }
 #endif
@@ -421,6 +426,10 @@ static int state_load(void *file)
 
   memset(pcd_event_times, 0, sizeof(pcd_event_times));
   memset(p32x_event_times, 0, sizeof(p32x_event_times));
+  p32x_sync_stats.step = 0;
+
+  // the sound worker must be done with the chips before they are overwritten
+  PsndFlushLog();
 
   while (!areaEof(file))
   {
@@ -538,6 +547,7 @@ static int state_load(void *file)
       case CHUNK_32X_EVT:
         CHECKED_READ2(0x40, buf);
         memcpy(p32x_event_times, buf, sizeof(p32x_event_times));
+        memcpy(&p32x_sync_stats.step, buf + 0x3c, 4);
         break;
 #endif
       default:
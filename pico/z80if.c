@@ -9,6 +9,7 @@
 #include <stddef.h>
 #include "pico_int.h"
 #include "memory.h"
+#include "sound/ym2612.h"
 
 uptr z80_read_map [0x10000 >> Z80_MEM_SHIFT];
 uptr z80_write_map[0x10000 >> Z80_MEM_SHIFT];
@@ -124,6 +125,243 @@ void z80_reset(void)
 #endif
 }
 
+/*
+ * idle loop detection. Sound drivers typically spin on the YM2612 status or on
+ * a mailbox byte in z80 RAM, e.g.:
+ *   loop: ld a,(4000h) / and 1 / jr z,loop
+ * Within a z80 run slice nothing but the YM timers can change these (68k
+ * accesses need the z80 bus, which syncs the z80 before), so such a loop can
+ * be skipped in whole iterations up to the next timer overflow.
+ */
+struct z80_idle {
+  u16 start, len;   // loop code range
+  u16 addr;         // polled address
+  u8  test, op;     // test instruction kind and immediate operand
+  u8  cc;           // branch condition
+  u8  cycles;       // cycles per iteration
+};
+
+enum { ZT_OR, ZT_AND, ZT_CP, ZT_BIT, ZT_RLC, ZT_RRC };
+
+static u8 z80_code_read(u16 a)
+{
+  return PicoMem.zram[a & 0x1fff];
+}
+
+static u16 z80_idle_reg16(int r)
+{
+#if defined(_USE_DRZ80)
+  switch (r) {
+  case 0:  return drZ80.Z80BC >> 16;
+  case 1:  return drZ80.Z80DE >> 16;
+  default: return drZ80.Z80HL >> 16;
+  }
+#elif defined(_USE_CZ80)
+  static const int regs[] = { CZ80_BC, CZ80_DE, CZ80_HL };
+  return Cz80_Get_Reg(&CZ80, regs[r]);
+#else
+  return 0;
+#endif
+}
+
+// check if the code at pc is an idle loop, fill *l if it is
+static int z80_idle_decode(u16 pc, struct z80_idle *l)
+{
+  u16 p = pc;
+  u8 op;
+
+  if (pc >= 0x4000 - 8)
+    return 0;
+
+  // load
+  op = z80_code_read(p++);
+  switch (op) {
+  case 0x3a: // ld a,(nn)
+    l->addr = z80_code_read(p) | (z80_code_read(p+1) << 8);
+    l->cycles = 13; p += 2;
+    break;
+  case 0x0a: // ld a,(bc)
+  case 0x1a: // ld a,(de)
+  case 0x7e: // ld a,(hl)
+    l->addr = z80_idle_reg16(op == 0x7e ? 2 : op >> 4);
+    l->cycles = 7;
+    break;
+  default:
+    return 0;
+  }
+  // only z80 RAM and the YM2612 status are known to be stable
+  if (l->addr >= 0x6000)
+    return 0;
+
+  // test
+  op = z80_code_read(p++);
+  switch (op) {
+  case 0xb7: l->test = ZT_OR;  l->op = 0x00; l->cycles += 4; break; // or a
+  case 0xa7: l->test = ZT_AND; l->op = 0xff; l->cycles += 4; break; // and a
+  case 0x07: l->test = ZT_RLC; l->op = 0x00; l->cycles += 4; break; // rlca
+  case 0x0f: l->test = ZT_RRC; l->op = 0x00; l->cycles += 4; break; // rrca
+  case 0xf6: l->test = ZT_OR;  goto imm; // or n
+  case 0xe6: l->test = ZT_AND; goto imm; // and n
+  case 0xfe: l->test = ZT_CP;  // cp n
+  imm:
+    l->op = z80_code_read(p++);
+    l->cycles += 7;
+    break;
+  case 0xcb: // bit b,a
+    op = z80_code_read(p++);
+    if ((op & 0xc7) != 0x47)
+      return 0;
+    l->test = ZT_BIT; l->op = (op >> 3) & 7; l->cycles += 8;
+    break;
+  default:
+    return 0;
+  }
+
+  // branch back to the load
+  op = z80_code_read(p++);
+  if ((op & 0xe7) == 0x20) { // jr cc,e
+    if ((u16)(p + 1 + (s8)z80_code_read(p)) != pc)
+      return 0;
+    l->cc = (op >> 3) & 3;
+    l->cycles += 12; p += 1;
+  }
+  else if ((op & 0xc7) == 0xc2 && (op & 0x30) != 0x20) { // jp cc,nn (no p/v)
+    if ((z80_code_read(p) | (z80_code_read(p+1) << 8)) != pc)
+      return 0;
+    l->cc = (op >> 3) & 7;
+    l->cycles += 10; p += 2;
+  }
+  else
+    return 0;
+
+  // rotates only set carry, bit doesn't touch it
+  if (l->test == ZT_RLC || l->test == ZT_RRC) {
+    if (l->cc != 2 && l->cc != 3)
+      return 0;
+  } else if (l->test == ZT_BIT && (l->cc == 2 || l->cc == 3))
+    return 0;
+
+  l->start = pc;
+  l->len = p - pc;
+  return 1;
+}
+
+// evaluate the loop branch condition for value v read by the loop
+static int z80_idle_loops(const struct z80_idle *l, u8 v)
+{
+  int r = v, c = 0;
+
+  switch (l->test) {
+  case ZT_OR:  r = v | l->op; break;
+  case ZT_AND: r = v & l->op; break;
+  case ZT_CP:  r = (v - l->op) & 0xff; c = v < l->op; break;
+  case ZT_BIT: r = v & (1 << l->op); break;
+  case ZT_RLC: c = v >> 7; break;
+  case ZT_RRC: c = v & 1; break;
+  }
+
+  switch (l->cc) {
+  case 0:  return r != 0;    // nz
+  case 1:  return r == 0;    // z
+  case 2:  return !c;        // nc
+  case 3:  return c;         // c
+  case 6:  return !(r & 0x80); // p
+  default: return !!(r & 0x80); // m
+  }
+}
+
+static int z80_irq_pending(void)
+{
+#if defined(_USE_DRZ80)
+  return drZ80.Z80_IRQ && (drZ80.Z80IF & 1);
+#elif defined(_USE_CZ80)
+  return CZ80.IRQState != CLEAR_LINE && CZ80.IFF.B.L;
+#else
+  return 0;
+#endif
+}
+
+// advance R over skipped cycles like cz80 does at the end of a run
+static void z80_idle_add_r(int cycles)
+{
+#if defined(_USE_CZ80)
+  Cz80_Set_Reg(&CZ80, CZ80_R, (Cz80_Get_Reg(&CZ80, CZ80_R) + (cycles >> 2)) & 0x7f);
+#endif
+  // DrZ80 derives R from the cycle counter, nothing to do there
+}
+
+// z80 cycles until the YM2612 status changes, or cnt if it doesn't before
+static int ym2612_status_change(int cycles, int cnt)
+{
+  int xcycles = cycles << 8;
+  int limit = cnt, t;
+
+  if ((ym2612.OPN.ST.mode & 4) && !(ym2612.OPN.ST.status & 1)) {
+    t = Pico.t.timer_a_next_oflow - xcycles;
+    if (t < (limit << 8))
+      limit = (t + 255) >> 8;
+  }
+  if ((ym2612.OPN.ST.mode & 8) && !(ym2612.OPN.ST.status & 2)) {
+    t = Pico.t.timer_b_next_oflow - xcycles;
+    if (t < (limit << 8))
+      limit = (t + 255) >> 8;
+  }
+  return limit;
+}
+
+/*
+ * returns the amount of z80 cycles which can be skipped since the z80 is
+ * spinning in an idle loop, 0 if it isn't, or -1 if it's inside an idle loop
+ * but not at its start. Only whole loop iterations are skipped and R is
+ * advanced by the skipped cycles like the core does, so the z80 state after
+ * skipping is the same as after interpreting the loop.
+ */
+int z80_idle_skip(unsigned int cycles, int cnt)
+{
+  struct z80_idle l;
+  u16 pc = z80_pc();
+  int i, limit;
+  u8 v;
+
+#if defined(_USE_CZ80)
+  if (CZ80.HaltState)
+    return 0;
+#endif
+  if (z80_irq_pending())
+    return 0;
+
+  if (!z80_idle_decode(pc, &l)) {
+    // possibly somewhere inside a loop
+    for (i = 1; i < 6 && pc >= i; i++)
+      if (z80_idle_decode(pc - i, &l) && pc < l.start + l.len)
+        return -1;
+    return 0;
+  }
+
+  if (l.addr < 0x4000) {
+    v = PicoMem.zram[l.addr & 0x1fff];
+    limit = cnt;
+  } else {
+    int xcycles = cycles << 8;
+    if (xcycles >= Pico.t.timer_a_next_oflow)
+      ym2612.OPN.ST.status |= (ym2612.OPN.ST.mode >> 2) & 1;
+    if (xcycles >= Pico.t.timer_b_next_oflow)
+      ym2612.OPN.ST.status |= (ym2612.OPN.ST.mode >> 2) & 2;
+    v = ym2612.OPN.ST.status;
+    limit = ym2612_status_change(cycles, cnt);
+  }
+
+  if (!z80_idle_loops(&l, v))
+    return 0;
+
+  limit -= limit % l.cycles;
+  if (limit > 0) {
+    z80_idle_add_r(limit);
+    elprintf(EL_IDLE, "z80 idle @%04x [%04x] %i", pc, l.addr, limit);
+  }
+  return limit;
+}
+
 struct z80sr_main {
   u8 a, f;
   u8 b, c;
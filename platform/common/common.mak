@@ -46,6 +46,22 @@ ifeq "$(gperf)" "1"
 DEFINES += GPERF
 LDFLAGS += -lprofiler -lstdc++
 endif
+ifeq "$(drc_perfmap)" "1"
+DEFINES += DRC_PERFMAP
+endif
+ifeq "$(use_threads)" "1"
+DEFINES += USE_THREADS
+LDFLAGS += -lpthread
+# parallel SH2s, experimental since the results aren't reproducible
+ifeq "$(sh2_threads)" "1"
+DEFINES += SH2_THREADS
+# SDRAM writes are tracked in the C memory handlers
+asm_32xmemory = 0
+endif
+endif
+ifeq "$(use_mmap)" "1"
+DEFINES += USE_MMAP
+endif
 
 # ARM asm stuff
 ifeq "$(ARCH)" "arm"
@@ -89,7 +105,8 @@ SRCS_COMMON += $(R)pico/pico.c $(R)pico/cart.c $(R)pico/memory.c \
 	$(R)pico/state.c $(R)pico/sek.c $(R)pico/z80if.c \
 	$(R)pico/videoport.c $(R)pico/draw2.c $(R)pico/draw.c \
 	$(R)pico/mode4.c $(R)pico/misc.c $(R)pico/eeprom.c \
-	$(R)pico/patch.c $(R)pico/debug.c $(R)pico/media.c
+	$(R)pico/patch.c $(R)pico/debug.c $(R)pico/media.c \
+	$(R)pico/poll.c $(R)pico/event.c
 # SMS
 ifneq "$(no_sms)" "1"
 SRCS_COMMON += $(R)pico/sms.c
@@ -101,6 +118,9 @@ SRCS_COMMON += $(R)pico/cd/mcd.c $(R)pico/cd/memory.c $(R)pico/cd/sek.c \
 	$(R)pico/cd/cdc.c $(R)pico/cd/cdd.c $(R)pico/cd/cd_image.c \
 	$(R)pico/cd/cd_parse.c $(R)pico/cd/gfx.c $(R)pico/cd/gfx_dma.c \
 	$(R)pico/cd/misc.c $(R)pico/cd/pcm.c
+ifeq "$(simd_gfx)" "1"
+DEFINES += GFX_SIMD
+endif
 # 32X
 ifneq "$(no_32x)" "1"
 SRCS_COMMON += $(R)pico/32x/32x.c $(R)pico/32x/memory.c $(R)pico/32x/draw.c \
@@ -118,15 +138,25 @@ SRCS_COMMON += $(R)pico/carthw/svp/svp.c $(R)pico/carthw/svp/memory.c \
 	$(R)pico/carthw/svp/ssp16.c
 ifeq "$(use_svpdrc)" "1"
 DEFINES += _SVP_DRC
+ifeq "$(ARCH)" "arm"
 SRCS_COMMON += $(R)pico/carthw/svp/stub_arm.S
 SRCS_COMMON += $(R)pico/carthw/svp/compiler.c
+else
+SRCS_COMMON += $(R)pico/carthw/svp/compiler_emith.c
+endif
 endif
 # sound
-SRCS_COMMON += $(R)pico/sound/sound.c
+SRCS_COMMON += $(R)pico/sound/sound.c $(R)pico/sound/resampler.c
 SRCS_COMMON += $(R)pico/sound/sn76496.c $(R)pico/sound/ym2612.c
+ifeq "$(simd_ym2612)" "1"
+DEFINES += YM2612_SIMD
+endif
 SRCS_COMMON += $(R)pico/sound/emu2413/emu2413.c
 ifneq "$(ARCH)$(asm_mix)" "arm1"
 SRCS_COMMON += $(R)pico/sound/mix.c
+ifeq "$(simd_mix)" "1"
+DEFINES += MIX_SIMD
+endif
 endif
 
 # === CPU cores ===
@@ -165,6 +195,10 @@ SRCS_COMMON += $(R)cpu/sh2/sh2.c
 ifeq "$(use_sh2drc)" "1"
 DEFINES += DRC_SH2
 SRCS_COMMON += $(R)cpu/sh2/compiler.c
+# block entry counters, for keeping hot blocks on eviction and superblocks
+ifeq "$(drc_hotness)" "1"
+DEFINES += DRC_HOTNESS
+endif
 ifdef drc_debug
 DEFINES += DRC_DEBUG=$(drc_debug)
 SRCS_COMMON += $(R)cpu/sh2/mame/sh2dasm.c
@@ -529,6 +529,12 @@ int emu_reload_rom(const char *rom_fname_in)
 		}
 	}
 
+	// pretranslate SH2 code used in earlier sessions
+	if (currentConfig.EmuOpt & EOPT_DRC_PROFILE) {
+		romfname_ext(carthw_path, sizeof(carthw_path), "cfg"PATH_SEP, ".drc");
+		Pico32xDrcProfileLoad(carthw_path);
+	}
+
 	retval = 1;
 out:
 	if (menu_romload_started)
@@ -608,6 +614,8 @@ void emu_prep_defconfig(void)
 	defaultConfig.msh2_khz = PICO_MSH2_HZ / 1000;
 	defaultConfig.ssh2_khz = PICO_SSH2_HZ / 1000;
 	defaultConfig.max_skip = 4;
+	defaultConfig.drc_tcache_mb = 4;
+	defaultConfig.chd_cache_mb = 4;
 
 	// platform specific overrides
 	pemu_prep_defconfig();
@@ -667,6 +675,8 @@ int emu_read_config(const char *rom_fname, int no_defaults)
 
 	pemu_validate_config();
 	PicoIn.overclockM68k = currentConfig.overclock_68k;
+	PicoIn.drcTcacheSize = currentConfig.drc_tcache_mb << 20;
+	PicoIn.chdCacheSize = currentConfig.chd_cache_mb;
 
 	// some sanity checks
 	if (currentConfig.volume < 0 || currentConfig.volume > 99)
@@ -1540,6 +1550,12 @@ void emu_loop(void)
 		Pico.sv.changed = 0;
 	}
 
+	if (currentConfig.EmuOpt & EOPT_DRC_PROFILE) {
+		char drc_fname[512];
+		romfname_ext(drc_fname, sizeof(drc_fname), "cfg"PATH_SEP, ".drc");
+		Pico32xDrcProfileSave(drc_fname);
+	}
+
 	pemu_loop_end();
 	emu_sound_stop();
 }
@@ -34,6 +34,7 @@ extern int g_screen_ppitch; // pitch in pixels
 #define EOPT_NO_FRMLIMIT  (1<<18)
 #define EOPT_WIZ_TEAR_FIX (1<<19)
 #define EOPT_EXT_FRMLIMIT (1<<20) // no internal frame limiter (limited by snd, etc)
+#define EOPT_DRC_PROFILE  (1<<21) // keep SH2 DRC block profile for next session
 
 enum {
 	EOPT_SCALE_NONE = 0,
@@ -78,6 +79,8 @@ typedef struct _currentConfig_t {
 	int ssh2_khz;
 	int overclock_68k;
 	int max_skip;
+	int drc_tcache_mb;
+	int chd_cache_mb;
 } currentConfig_t;
 
 extern currentConfig_t currentConfig, defaultConfig;
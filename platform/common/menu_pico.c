@@ -438,19 +438,37 @@ static int menu_loop_keyconfig(int id, int keys)
 
 static const char h_cdleds[] = "Show power/CD LEDs of emulated console";
 static const char h_cdda[]   = "Play audio tracks from mp3s/wavs/bins";
+#ifdef USE_THREADS
+static const char h_cddathr[] = "Read and decode audio tracks on a separate thread,\n"
+				"applies from the next track start";
+static const char h_s68kthr[] = "Run the sub CPU on a separate host thread,\n"
+				"faster on multicore hosts. Timing differs slightly,\n"
+				"netplay peers must use the same setting";
+#endif
 static const char h_cdpcm[]  = "Emulate PCM audio chip for effects/voices/music";
 static const char h_srcart[] = "Emulate the save RAM cartridge accessory\n"
 				"most games don't need this";
 static const char h_scfx[]   = "Emulate scale/rotate ASIC chip for graphics effects\n"
 				"disable to improve performance";
+#ifdef USE_LIBCHDR
+static const char h_chdcache[] = "Decompressed CHD image data kept in memory,\n"
+				"used from the next disc loaded on";
+#endif
 
 static menu_entry e_menu_cd_options[] =
 {
 	mee_onoff_h("CD LEDs",              MA_CDOPT_LEDS,          currentConfig.EmuOpt, EOPT_EN_CD_LEDS, h_cdleds),
 	mee_onoff_h("CDDA audio",           MA_CDOPT_CDDA,          PicoIn.opt, POPT_EN_MCD_CDDA, h_cdda),
+#ifdef USE_THREADS
+	mee_onoff_h("CDDA prefetch",        MA_CDOPT_CDDA_THREAD,   PicoIn.opt, POPT_EN_CDDA_THREAD, h_cddathr),
+	mee_onoff_h("Sub CPU thread",       MA_CDOPT_S68K_THREAD,   PicoIn.opt, POPT_EN_S68K_THREAD, h_s68kthr),
+#endif
 	mee_onoff_h("PCM audio",            MA_CDOPT_PCM,           PicoIn.opt, POPT_EN_MCD_PCM, h_cdpcm),
 	mee_onoff_h("SaveRAM cart",         MA_CDOPT_SAVERAM,       PicoIn.opt, POPT_EN_MCD_RAMCART, h_srcart),
 	mee_onoff_h("Scale/Rot. fx",        MA_CDOPT_SCALEROT_CHIP, PicoIn.opt, POPT_EN_MCD_GFX, h_scfx),
+#ifdef USE_LIBCHDR
+	mee_range_h("CHD cache (MiB)",      MA_CDOPT_CHD_CACHE,     currentConfig.chd_cache_mb, 1, 64, h_chdcache),
+#endif
 	mee_end,
 };
 
@@ -458,6 +476,7 @@ static int menu_loop_cd_options(int id, int keys)
 {
 	static int sel = 0;
 	me_loop(e_menu_cd_options, &sel);
+	PicoIn.chdCacheSize = currentConfig.chd_cache_mb;
 	return 0;
 }
 
@@ -498,6 +517,11 @@ static const char h_pwm[]        = "Disabling may improve performance, but break
 static const char h_sh2cycles[]  = "Cycles/millisecond (similar to DOSBox)\n"
 				   "lower values speed up emulation but break games\n"
 				   "at least 11000 recommended for compatibility";
+#ifdef SH2_THREADS
+static const char h_sh2threads[] = "Run the SH2s on separate host threads,\n"
+				   "faster on multicore hosts, but experimental:\n"
+				   "runs can't be reproduced";
+#endif
 
 static menu_entry e_menu_32x_options[] =
 {
@@ -506,6 +530,9 @@ static menu_entry e_menu_32x_options[] =
 	mee_onoff_h   ("PWM sound",         MA_32XOPT_PWM,         PicoIn.opt, POPT_EN_PWM, h_pwm),
 	mee_cust_h    ("Master SH2 cycles", MA_32XOPT_MSH2_CYCLES, mh_opt_sh2cycles, mgn_opt_sh2cycles, h_sh2cycles),
 	mee_cust_h    ("Slave SH2 cycles",  MA_32XOPT_SSH2_CYCLES, mh_opt_sh2cycles, mgn_opt_sh2cycles, h_sh2cycles),
+#ifdef SH2_THREADS
+	mee_onoff_h   ("Parallel SH2s",     MA_32XOPT_SH2_THREADS, PicoIn.opt, POPT_EN_SH2_THREADS, h_sh2threads),
+#endif
 	mee_end,
 };
 
@@ -526,6 +553,13 @@ static int menu_loop_32x_options(int id, int keys)
 // ------------ adv options menu ------------
 
 static const char h_ovrclk[] = "Will break some games, keep at 0";
+static const char h_tcache[] = "More helps games with much SH2 code,\n"
+			       "used from the next game loaded on";
+#ifdef USE_THREADS
+static const char h_drcasync[] = "Translate new SH2 code on a separate host thread,\n"
+				 "interpreting it meanwhile. Avoids stutter on\n"
+				 "level changes, but not deterministic";
+#endif
 
 static menu_entry e_menu_adv_options[] =
 {
@@ -539,6 +573,11 @@ static menu_entry e_menu_adv_options[] =
 	mee_onoff     ("Disable idle loop patching",MA_OPT2_NO_IDLE_LOOPS,PicoIn.opt, POPT_DIS_IDLE_DET),
 	mee_onoff     ("Disable frame limiter",    MA_OPT2_NO_FRAME_LIMIT,currentConfig.EmuOpt, EOPT_NO_FRMLIMIT),
 	mee_onoff     ("Enable dynarecs",          MA_OPT2_DYNARECS,      PicoIn.opt, POPT_EN_DRC),
+	mee_onoff     ("Keep SH2 dynarec profile", MA_OPT2_DRC_PROFILE,   currentConfig.EmuOpt, EOPT_DRC_PROFILE),
+	mee_range_h   ("SH2 dynarec cache (MiB)",  MA_OPT2_DRC_TCACHE,    currentConfig.drc_tcache_mb, 1, 16, h_tcache),
+#ifdef USE_THREADS
+	mee_onoff_h   ("Background SH2 dynarec",   MA_OPT2_DRC_ASYNC,     PicoIn.opt, POPT_EN_DRC_ASYNC, h_drcasync),
+#endif
 	mee_range     ("Max auto frameskip",       MA_OPT2_MAX_FRAMESKIP, currentConfig.max_skip, 1, 10),
 	mee_onoff     ("PWM IRQ optimization",     MA_OPT2_PWM_IRQ_OPT,   PicoIn.opt, POPT_PWM_IRQ_OPT),
 	MENU_OPTIONS_ADV
@@ -551,6 +590,7 @@ static int menu_loop_adv_options(int id, int keys)
 
 	me_loop(e_menu_adv_options, &sel);
 	PicoIn.overclockM68k = currentConfig.overclock_68k; // int vs short
+	PicoIn.drcTcacheSize = currentConfig.drc_tcache_mb << 20;
 
 	return 0;
 }
@@ -617,6 +657,12 @@ static const char *mgn_opt_alpha(int id, int *offs)
 }
 
 static const char h_lowpass[] = "Low pass filter for sound closer to real hardware";
+static const char h_sndlog[]  = "Render sound chips at frame end from a log\n"
+				 "of register writes. Same output, not faster";
+#ifdef USE_THREADS
+static const char h_sndthread[] = "Render sound chips on a separate host thread\n"
+				  "while emulating, faster on multicore hosts";
+#endif
 
 static menu_entry e_menu_snd_options[] =
 {
@@ -624,6 +670,10 @@ static menu_entry e_menu_snd_options[] =
 	mee_cust      ("Sound Quality",   MA_OPT_SOUND_QUALITY, mh_opt_snd, mgn_opt_sound),
 	mee_onoff_h   ("Sound filter",    MA_OPT_SOUND_FILTER,  PicoIn.opt, POPT_EN_SNDFILTER, h_lowpass),
 	mee_cust      ("Filter strength", MA_OPT_SOUND_ALPHA,   mh_opt_alpha, mgn_opt_alpha),
+	mee_onoff_h   ("Sound write log", MA_OPT_SOUND_LOG,     PicoIn.opt, POPT_EN_SND_LOG, h_sndlog),
+#ifdef USE_THREADS
+	mee_onoff_h   ("Sound thread",    MA_OPT_SOUND_THREAD,  PicoIn.opt, POPT_EN_SND_THREAD, h_sndthread),
+#endif
 	mee_end,
 };
 
@@ -1334,6 +1384,12 @@ void menu_init(void)
 	i = 1;
 #endif
 	me_enable(e_menu_adv_options, MA_OPT2_DYNARECS, i);
+	i = 0;
+#if defined(DRC_SH2)
+	i = 1;
+#endif
+	me_enable(e_menu_adv_options, MA_OPT2_DRC_PROFILE, i);
+	me_enable(e_menu_adv_options, MA_OPT2_DRC_TCACHE, i);
 
 	i = me_id2offset(e_menu_gfx_options, MA_OPT_VOUT_MODE);
 	e_menu_gfx_options[i].data = plat_target.vout_methods;
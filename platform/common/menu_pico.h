@@ -43,6 +43,8 @@ typedef enum
 	MA_OPT_AUTOLOAD_SAVE,
 	MA_OPT_SOUND_FILTER,
 	MA_OPT_SOUND_ALPHA,
+	MA_OPT_SOUND_LOG,
+	MA_OPT_SOUND_THREAD,
 	MA_OPT2_GAMMA,
 	MA_OPT2_A_SN_GAMMA,
 	MA_OPT2_DBLBUFF,	/* giz */
@@ -61,6 +63,9 @@ typedef enum
 	MA_OPT2_OVERCLOCK_M68K,
 	MA_OPT2_MAX_FRAMESKIP,
 	MA_OPT2_PWM_IRQ_OPT,
+	MA_OPT2_DRC_PROFILE,
+	MA_OPT2_DRC_TCACHE,
+	MA_OPT2_DRC_ASYNC,
 	MA_OPT2_DONE,
 	MA_OPT3_SCALE,		/* psp (all OPT3) */
 	MA_OPT3_HSCALE32,
@@ -82,16 +87,20 @@ typedef enum
 	MA_CDOPT_TESTBIOS_JAP,
 	MA_CDOPT_LEDS,
 	MA_CDOPT_CDDA,
+	MA_CDOPT_CDDA_THREAD,
+	MA_CDOPT_S68K_THREAD,
 	MA_CDOPT_PCM,
 	MA_CDOPT_READAHEAD,
 	MA_CDOPT_SAVERAM,
 	MA_CDOPT_SCALEROT_CHIP,
+	MA_CDOPT_CHD_CACHE,
 	MA_CDOPT_DONE,
 	MA_32XOPT_ENABLE_32X,
 	MA_32XOPT_RENDERER,
 	MA_32XOPT_PWM,
 	MA_32XOPT_MSH2_CYCLES,
 	MA_32XOPT_SSH2_CYCLES,
+	MA_32XOPT_SH2_THREADS,
 	MA_CTRL_PLAYER1,
 	MA_CTRL_PLAYER2,
 	MA_CTRL_EMU,
@@ -9,7 +9,7 @@
 #include <string.h>
 
 #include <pico/pico_int.h>
-#include <pico/sound/mix.h>
+#include <pico/sound/resampler.h>
 #include "mp3.h"
 
 static FILE *mp3_current_file;
@@ -128,48 +128,56 @@ void mp3_start_play(void *f_, int pos1024)
 	mp3dec_decode(mp3_current_file, &mp3_file_pos, mp3_file_len);
 }
 
-void mp3_update(int *buffer, int length, int stereo)
+/* number of decoded frames left in cdda_out_buffer, decodes the next mp3
+ * frame if it's used up. 0 at the end of the file or on error */
+static int mp3_avail(void)
 {
-	int length_mp3, shr = 0;
-	void (*mix_samples)(int *dest_buf, short *mp3_buf, int count) = mix_16h_to_32;
-
-	if (mp3_current_file == NULL || mp3_file_pos >= mp3_file_len)
-		return; /* no file / EOF */
-
-	if (!decoder_active)
-		return;
-
-	length_mp3 = length;
-	if (PicoIn.sndRate <= 11025 + 100) {
-		mix_samples = mix_16h_to_32_s2;
-		length_mp3 <<= 2; shr = 2;
+	if (mp3_current_file == NULL || !decoder_active)
+		return 0;
+
+	if (cdda_out_pos >= 1152) {
+		if (mp3_file_pos >= mp3_file_len)
+			return 0; /* EOF */
+		if (mp3dec_decode(mp3_current_file, &mp3_file_pos,
+				mp3_file_len) != 0)
+			return 0;
+		cdda_out_pos = 0;
 	}
-	else if (PicoIn.sndRate <= 22050 + 100) {
-		mix_samples = mix_16h_to_32_s1;
-		length_mp3 <<= 1; shr = 1;
+	return 1152 - cdda_out_pos;
+}
+
+void mp3_update(int *buffer, int length, int stereo)
+{
+	int need, n;
+
+	/* feed the resampler from the decoded frames */
+	need = resampler_need(&cdda_resampler, length);
+	while (need > 0 && (n = mp3_avail()) > 0) {
+		if (n > need)
+			n = need;
+		resampler_push(&cdda_resampler,
+			cdda_out_buffer + cdda_out_pos * 2, n);
+		cdda_out_pos += n;
+		need -= n;
 	}
 
-	if (1152 - cdda_out_pos >= length_mp3) {
-		mix_samples(buffer, cdda_out_buffer + cdda_out_pos * 2,
-			length * 2);
-
-		cdda_out_pos += length_mp3;
-	} else {
-		int ret, left = 1152 - cdda_out_pos;
-
-		if (left > 0)
-			mix_samples(buffer, cdda_out_buffer + cdda_out_pos * 2,
-				(left >> shr) * 2);
-
-		ret = mp3dec_decode(mp3_current_file, &mp3_file_pos,
-			mp3_file_len);
-		if (ret == 0) {
-			cdda_out_pos = length_mp3 - left;
-			mix_samples(buffer + (left >> shr) * 2,
-				cdda_out_buffer,
-				(cdda_out_pos >> shr) * 2);
-		} else
-			cdda_out_pos = 0;
+	resampler_mix_16h_to_32(&cdda_resampler, buffer, length);
+}
+
+/* copy up to frames decoded stereo frames, for the CD-DA prefetch thread.
+ * mp3_read(NULL, 0) is used to check for support */
+int mp3_read(short *buffer, int frames)
+{
+	int done = 0, n;
+
+	while (done < frames && (n = mp3_avail()) > 0) {
+		if (n > frames - done)
+			n = frames - done;
+		memcpy(buffer + done * 2, cdda_out_buffer + cdda_out_pos * 2,
+			n * 4);
+		cdda_out_pos += n;
+		done += n;
 	}
+	return done;
 }
 
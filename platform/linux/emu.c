@@ -248,10 +248,22 @@ void plat_wait_till_us(unsigned int us_to)
 
 void *plat_mem_get_for_drc(size_t size)
 {
-#ifdef MAP_JIT
-	// newer versions of OSX, IOS or TvOS need this
-	return plat_mmap(0, size, 1, 0);
-#else
-	return NULL;
+	static void *mem;
+	static size_t mem_size;
+
+#ifndef MAP_JIT
+	// the dynarec has a static buffer of the default size (4 MiB)
+	if (size <= 4*1024*1024)
+		return NULL;
 #endif
+	// newer versions of OSX, IOS or TvOS always need this
+	if (mem != NULL && mem_size != size) {
+		plat_munmap(mem, mem_size);
+		mem = NULL;
+	}
+	if (mem == NULL) {
+		mem = plat_mmap(0, size, 1, 0);
+		mem_size = size;
+	}
+	return mem;
 }
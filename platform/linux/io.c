@@ -365,6 +365,11 @@ void mp3_update(int *buffer, int length, int stereo)
 {
 }
 
+int mp3_read(short *buffer, int frames)
+{
+	return -1;
+}
+
 #include <linux/input.h>
 
 struct in_default_bind in_evdev_defbinds[] =
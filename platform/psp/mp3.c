@@ -451,6 +451,13 @@ void mp3_update(int *buffer, int length, int stereo)
 	}
 }
 
+/* decoded samples are only mixed by mp3_update, the CD-DA prefetch thread
+ * isn't used with this decoder */
+int mp3_read(short *buffer, int frames)
+{
+	return -1;
+}
+
 
 void mp3_reopen_file(void)
 {
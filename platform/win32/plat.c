@@ -233,6 +233,11 @@ void mp3_update(int *buffer, int length, int stereo)
 {
 }
 
+int mp3_read(short *buffer, int frames)
+{
+	return -1;
+}
+
 // other
 void lprintf(const char *fmt, ...)
 {
@@ -1,183 +1,1262 @@
-// gcc drctest.c cpu/drc/cmn.c cpu/sh2/mame/sh2dasm.c platform/libpicofe/linux/host_dasm.c platform/libpicofe/linux/plat.c -I. -DDRC_SH2 -g -O -o drctest -lbfd-<ver>-multiarch -lopcodes-<ver>-multiarch -liberty -D<__platform__>
-
+/*
+ * SH2 recompiler test and benchmark harness
+ *
+ * Runs random or recorded SH2 code through both the recompiler and the MAME
+ * interpreter in lockstep, comparing CPU and memory state after each block
+ * executed by the recompiler. If built with DRC_HOTNESS, loops crossing the
+ * superblock threshold are run with superblocks off and on and compared. If
+ * built with SH2_THREADS, the SDRAM writes of the parallel sh2 mode must all
+ * reach the memory handlers.
+ * Optionally measures translation and execution speed of the host backend.
+ *
+ * build (from the top level directory):
+ * gcc tools/drctest.c cpu/sh2/mame/sh2pico.c cpu/sh2/mame/sh2dasm.c cpu/sh2/sh2.c cpu/drc/cmn.c -I. -DDRC_SH2 -DDRC_HOTNESS -DUSE_THREADS -DSH2_THREADS -O2 -o drctest -lpthread
+ */
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
 
 #include <cpu/sh2/compiler.c>
+#include <cpu/sh2/mame/sh2dasm.h>
+#include <pico/memory.h>
 
 struct Pico Pico;
+PicoInterface PicoIn;
 SH2 sh2s[2];
 struct Pico32xMem _Pico32xMem, *Pico32xMem = &_Pico32xMem;
 struct Pico32x Pico32x;
-char **g_argv;
 
-void memset32(void *dest_in, int c, int count) { memset(dest_in, c, 4*count); } 
+void memset32(void *dest_in, int c, int count) { memset(dest_in, c, 4*count); }
+
+#ifdef SH2_THREADS
+int p32x_par_active;
+void p32x_sh2_par_enter(SH2 *sh2, unsigned int m68k_cycles) { }
+void p32x_sh2_par_leave(SH2 *sh2) { }
+int p32x_sh2_par_drc_safe(SH2 *sh2) { return 1; }
+#endif
+
+void cache_flush_d_inval_i(void *start_addr, void *end_addr)
+{
+#if defined(__GNUC__) && !(defined(__i386__) || defined(__x86_64__))
+  __builtin___clear_cache(start_addr, end_addr);
+#endif
+}
 
-void cache_flush_d_inval_i(void *start_addr, void *end_addr) { }
 void *plat_mem_get_for_drc(size_t size) { return NULL; }
-void *p32x_sh2_get_mem_ptr(u32 a, u32 *mask, SH2 *sh2) { return NULL; }
 
-void REGPARM(3) p32x_sh2_write8 (u32 a, u32 d, SH2 *s) { }
-void REGPARM(3) p32x_sh2_write16(u32 a, u32 d, SH2 *s) { }
-void REGPARM(3) p32x_sh2_write32(u32 a, u32 d, SH2 *s) { }
+int plat_mem_set_exec(void *ptr, size_t size)
+{
+  uptr start = (uptr)ptr & ~4095, end = ((uptr)ptr + size + 4095) & ~4095;
+  return mprotect((void *)start, end - start, PROT_READ|PROT_WRITE|PROT_EXEC);
+}
 
-u32 REGPARM(2) p32x_sh2_read8 (u32 a, SH2 *s) { }
-u32 REGPARM(2) p32x_sh2_read16(u32 a, SH2 *s) { }
-u32 REGPARM(2) p32x_sh2_read32(u32 a, SH2 *s) { }
+void lprintf(const char *fmt, ...)
+{
+  va_list ap;
 
-u32 REGPARM(3) p32x_sh2_poll_memory8 (u32 a, u32 d, SH2 *s) { }
-u32 REGPARM(3) p32x_sh2_poll_memory16(u32 a, u32 d, SH2 *s) { }
-u32 REGPARM(3) p32x_sh2_poll_memory32(u32 a, u32 d, SH2 *s) { }
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+}
 
-int main(int argc, char *argv[])
+// -----------------------------------------------------------------
+// memory: ROM is shared, SDRAM and data array exist once per CPU
+
+#define ROM_BASE    0x02000000
+#define ROM_SIZE    0x40000
+#define SDRAM_BASE  0x06000000
+#define SDRAM_SIZE  0x40000
+#define DA_BASE     0xc0000000
+
+typedef u32 (sh2_read_handler)(u32 a, SH2 *sh2);
+typedef void REGPARM(3) (sh2_write_handler)(u32 a, u32 d, SH2 *sh2);
+
+struct cpu_mem {
+  sh2_memmap read8_map[0x80], read16_map[0x80], read32_map[0x80];
+  const void *write8_tab[0x80], *write16_tab[0x80], *write32_tab[0x80];
+};
+
+static u16 rom[ROM_SIZE / 2];
+
+#define drc_sh2 sh2s[0]
+static struct cpu_mem drc_mem;
+
+static SH2 ref_sh2;
+static struct cpu_mem ref_mem;
+static u8 ref_sdram[SDRAM_SIZE];
+static u8 ref_drcblk_ram[sizeof(Pico32xMem->drcblk_ram)];
+static u8 ref_drcblk_da[sizeof(Pico32xMem->drcblk_da[0])];
+
+static u32 read_unmapped(u32 a, SH2 *sh2)
+{
+  return 0;
+}
+
+static void REGPARM(3) write_unmapped(u32 a, u32 d, SH2 *sh2)
+{
+}
+
+#ifdef SH2_THREADS
+// SDRAM writes done by the handlers, [1] for the drc
+static int sdram_writes[2];
+static unsigned int drc_state; // SH2_PAR_SDRAM to test parallel mode
+#define COUNT_SDRAM_WRITE(sh2) sdram_writes[sh2 == &drc_sh2]++
+#else
+#define COUNT_SDRAM_WRITE(sh2)
+#define drc_state 0
+#endif
+
+static void REGPARM(3) write8_sdram(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = MEM_BE2(a & (SDRAM_SIZE-1));
+  COUNT_SDRAM_WRITE(sh2);
+  ((u8 *)sh2->p_sdram)[a1] = d;
+  if (((u8 *)sh2->p_drcblk_ram)[a1 >> SH2_DRCBLK_RAM_SHIFT])
+    sh2_drc_wcheck_ram(a, 2, sh2);
+}
+
+static void REGPARM(3) write16_sdram(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = a & (SDRAM_SIZE-2);
+  COUNT_SDRAM_WRITE(sh2);
+  ((u16 *)sh2->p_sdram)[a1 / 2] = d;
+  if (((u8 *)sh2->p_drcblk_ram)[a1 >> SH2_DRCBLK_RAM_SHIFT])
+    sh2_drc_wcheck_ram(a, 2, sh2);
+}
+
+static void REGPARM(3) write32_sdram(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = a & (SDRAM_SIZE-4);
+  u8 *p = sh2->p_drcblk_ram;
+  COUNT_SDRAM_WRITE(sh2);
+  *(u32 *)((u8 *)sh2->p_sdram + a1) = CPU_BE2(d);
+  if (p[a1 >> SH2_DRCBLK_RAM_SHIFT] | p[(a1+2) >> SH2_DRCBLK_RAM_SHIFT])
+    sh2_drc_wcheck_ram(a, 4, sh2);
+}
+
+static void REGPARM(3) write8_da(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = MEM_BE2(a & 0xfff);
+  sh2->data_array[a1] = d;
+  if (((u8 *)sh2->p_drcblk_da)[a1 >> SH2_DRCBLK_DA_SHIFT])
+    sh2_drc_wcheck_da(a, 2, sh2);
+}
+
+static void REGPARM(3) write16_da(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = a & 0xffe;
+  ((u16 *)sh2->data_array)[a1 / 2] = d;
+  if (((u8 *)sh2->p_drcblk_da)[a1 >> SH2_DRCBLK_DA_SHIFT])
+    sh2_drc_wcheck_da(a, 2, sh2);
+}
+
+static void REGPARM(3) write32_da(u32 a, u32 d, SH2 *sh2)
+{
+  u32 a1 = a & 0xffc;
+  u8 *p = sh2->p_drcblk_da;
+  *(u32 *)(sh2->data_array + a1) = CPU_BE2(d);
+  if (p[a1 >> SH2_DRCBLK_DA_SHIFT] | p[(a1+2) >> SH2_DRCBLK_DA_SHIFT])
+    sh2_drc_wcheck_da(a, 4, sh2);
+}
+
+static void map_mem(struct cpu_mem *m, u32 a, void *mem, u32 mask)
+{
+  int i = a >> SH2_READ_SHIFT;
+  m->read8_map[i].addr = m->read16_map[i].addr = m->read32_map[i].addr =
+    (uptr)mem >> 1;
+  m->read8_map[i].mask = m->read16_map[i].mask = m->read32_map[i].mask = mask;
+}
+
+static void map_write(struct cpu_mem *m, u32 a, sh2_write_handler *w8,
+  sh2_write_handler *w16, sh2_write_handler *w32)
+{
+  int i = a >> SH2_WRITE_SHIFT;
+  m->write8_tab[i] = w8;
+  m->write16_tab[i] = w16;
+  m->write32_tab[i] = w32;
+}
+
+static void setup_cpu(SH2 *sh2, struct cpu_mem *m, u8 *sdram)
+{
+  int i;
+
+  for (i = 0; i < 0x80; i++) {
+    m->read8_map[i].addr = m->read16_map[i].addr = m->read32_map[i].addr =
+      ((uptr)read_unmapped >> 1) | MAP_FLAG;
+    m->write8_tab[i] = m->write16_tab[i] = m->write32_tab[i] = write_unmapped;
+  }
+  // cached and cache-through areas
+  map_mem(m, ROM_BASE, rom, ROM_SIZE-1);
+  map_mem(m, ROM_BASE | 0x20000000, rom, ROM_SIZE-1);
+  map_mem(m, SDRAM_BASE, sdram, SDRAM_SIZE-1);
+  map_mem(m, SDRAM_BASE | 0x20000000, sdram, SDRAM_SIZE-1);
+  map_mem(m, DA_BASE, sh2->data_array, 0xfff);
+  map_write(m, SDRAM_BASE, write8_sdram, write16_sdram, write32_sdram);
+  map_write(m, SDRAM_BASE | 0x20000000, write8_sdram, write16_sdram, write32_sdram);
+  map_write(m, DA_BASE, write8_da, write16_da, write32_da);
+
+  sh2->read8_map = m->read8_map;
+  sh2->read16_map = m->read16_map;
+  sh2->read32_map = m->read32_map;
+  sh2->write8_tab = m->write8_tab;
+  sh2->write16_tab = m->write16_tab;
+  sh2->write32_tab = m->write32_tab;
+
+  sh2->p_rom = rom;
+  sh2->p_sdram = sdram;
+  sh2->p_da = sh2->data_array;
+}
+
+// pico memhandlers, see pico/32x/memory.c
+u32 REGPARM(2) p32x_sh2_read8(u32 a, SH2 *sh2)
+{
+  const sh2_memmap *sh2_map = sh2->read8_map;
+  uptr p;
+
+  sh2_map += a >> SH2_READ_SHIFT;
+  p = sh2_map->addr;
+  if (!map_flag_set(p))
+    return *(s8 *)((p << 1) + MEM_BE2(a & sh2_map->mask));
+  else
+    return ((sh2_read_handler *)(p << 1))(a, sh2);
+}
+
+u32 REGPARM(2) p32x_sh2_read16(u32 a, SH2 *sh2)
+{
+  const sh2_memmap *sh2_map = sh2->read16_map;
+  uptr p;
+
+  sh2_map += a >> SH2_READ_SHIFT;
+  p = sh2_map->addr;
+  if (!map_flag_set(p))
+    return *(s16 *)((p << 1) + (a & sh2_map->mask));
+  else
+    return ((sh2_read_handler *)(p << 1))(a, sh2);
+}
+
+u32 REGPARM(2) p32x_sh2_read32(u32 a, SH2 *sh2)
+{
+  const sh2_memmap *sh2_map = sh2->read32_map;
+  uptr p;
+
+  sh2_map += a >> SH2_READ_SHIFT;
+  p = sh2_map->addr;
+  if (!map_flag_set(p)) {
+    u32 *pd = (u32 *)((p << 1) + (a & sh2_map->mask));
+    return CPU_BE2(*pd);
+  } else
+    return ((sh2_read_handler *)(p << 1))(a, sh2);
+}
+
+void REGPARM(3) p32x_sh2_write8 (u32 a, u32 d, SH2 *sh2)
+{
+  ((sh2_write_handler *)sh2->write8_tab[a >> SH2_WRITE_SHIFT])(a, d, sh2);
+}
+
+void REGPARM(3) p32x_sh2_write16(u32 a, u32 d, SH2 *sh2)
+{
+  ((sh2_write_handler *)sh2->write16_tab[a >> SH2_WRITE_SHIFT])(a, d, sh2);
+}
+
+void REGPARM(3) p32x_sh2_write32(u32 a, u32 d, SH2 *sh2)
+{
+  ((sh2_write_handler *)sh2->write32_tab[a >> SH2_WRITE_SHIFT])(a, d, sh2);
+}
+
+// no polling detection here, the other CPU doesn't exist
+u32 REGPARM(3) p32x_sh2_poll_memory8 (u32 a, u32 d, SH2 *sh2) { return d; }
+u32 REGPARM(3) p32x_sh2_poll_memory16(u32 a, u32 d, SH2 *sh2) { return d; }
+u32 REGPARM(3) p32x_sh2_poll_memory32(u32 a, u32 d, SH2 *sh2) { return d; }
+
+void *p32x_sh2_get_mem_ptr(u32 a, u32 *mask, SH2 *sh2)
+{
+  const sh2_memmap *mm = sh2->read8_map;
+
+  mm += a >> SH2_READ_SHIFT;
+  if (map_flag_set(mm->addr))
+    return (void *)-1;
+  *mask = mm->mask;
+  return (void *)(mm->addr << 1);
+}
+
+// -----------------------------------------------------------------
+// random code generator
+
+static u32 rnd_state = 1;
+
+// the recompiler and the interpreter differ in how MACH is handled by MAC.W
+// in saturation mode, hence SR.S is kept clear unless requested
+static int allow_sat;
+
+static u32 rnd(void)
+{
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 17;
+  rnd_state ^= rnd_state << 5;
+  return rnd_state;
+}
+
+#define rnd_n(n) (rnd() % (n))
+
+enum {
+  FMT_0,        // no operands
+  FMT_N,        // Rn (written)
+  FMT_NR,       // Rn (read only)
+  FMT_NM,       // Rm,Rn (Rn written)
+  FMT_NMR,      // Rm,Rn (read only)
+  FMT_I,        // #imm,R0
+  FMT_NI,       // #imm,Rn
+  FMT_ST,       // Rm,@Rn / Rm,@-Rn
+  FMT_LD,       // @Rm,Rn / @Rm+,Rn
+  FMT_ST0,      // R0,@(disp,Rn)
+  FMT_LD0,      // @(disp,Rm),R0
+  FMT_STD,      // Rm,@(disp,Rn)
+  FMT_LDD,      // @(disp,Rm),Rn
+  FMT_GBR,      // R0,@(disp,GBR) / @(disp,GBR),R0
+  FMT_PCREL,    // @(disp,PC),Rn
+  FMT_MOVA,     // mova @(disp,PC),R0
+  FMT_MAC,      // @Rm+,@Rn+
+  FMT_PN,       // @Rn / @-Rn
+  FMT_PM,       // @Rm+ (in Rn position)
+  FMT_BC,       // bt/bf
+  FMT_BCS,      // bt/s, bf/s
+  FMT_BRA,      // bra
+};
+
+#define S_B       0     // memory access size
+#define S_W       1
+#define S_L       2
+#define S_MASK    3
+#define F_BENCH   4     // usable in benchmark loops, doesn't change pointers
+#define F_NODS    8     // not allowed in a delay slot
+
+static const struct insn_tmpl {
+  u16 op;
+  u8 fmt;
+  u8 flags;
+} insn_tmpl[] = {
+  // data transfer
+  { 0x6003, FMT_NM,    F_BENCH },           // mov Rm,Rn
+  { 0xe000, FMT_NI,    F_BENCH },           // mov #imm,Rn
+  { 0x2000, FMT_ST,    S_B|F_BENCH },       // mov.b Rm,@Rn
+  { 0x2001, FMT_ST,    S_W|F_BENCH },
+  { 0x2002, FMT_ST,    S_L|F_BENCH },
+  { 0x6000, FMT_LD,    S_B|F_BENCH },       // mov.b @Rm,Rn
+  { 0x6001, FMT_LD,    S_W|F_BENCH },
+  { 0x6002, FMT_LD,    S_L|F_BENCH },
+  { 0x2004, FMT_ST,    S_B },               // mov.b Rm,@-Rn
+  { 0x2005, FMT_ST,    S_W },
+  { 0x2006, FMT_ST,    S_L },
+  { 0x6004, FMT_LD,    S_B },               // mov.b @Rm+,Rn
+  { 0x6005, FMT_LD,    S_W },
+  { 0x6006, FMT_LD,    S_L },
+  { 0x8000, FMT_ST0,   S_B|F_BENCH },       // mov.b R0,@(disp,Rn)
+  { 0x8100, FMT_ST0,   S_W|F_BENCH },
+  { 0x1000, FMT_STD,   S_L|F_BENCH },       // mov.l Rm,@(disp,Rn)
+  { 0x8400, FMT_LD0,   S_B|F_BENCH },       // mov.b @(disp,Rm),R0
+  { 0x8500, FMT_LD0,   S_W|F_BENCH },
+  { 0x5000, FMT_LDD,   S_L|F_BENCH },       // mov.l @(disp,Rm),Rn
+  { 0xc000, FMT_GBR,   S_B|F_BENCH },       // mov.b R0,@(disp,GBR)
+  { 0xc100, FMT_GBR,   S_W|F_BENCH },
+  { 0xc200, FMT_GBR,   S_L|F_BENCH },
+  { 0xc400, FMT_GBR,   S_B|F_BENCH },       // mov.b @(disp,GBR),R0
+  { 0xc500, FMT_GBR,   S_W|F_BENCH },
+  { 0xc600, FMT_GBR,   S_L|F_BENCH },
+  { 0x9000, FMT_PCREL, S_W|F_BENCH|F_NODS },// mov.w @(disp,PC),Rn
+  { 0xd000, FMT_PCREL, S_L|F_BENCH|F_NODS },// mov.l @(disp,PC),Rn
+  { 0xc700, FMT_MOVA,  F_BENCH|F_NODS },    // mova @(disp,PC),R0
+  { 0x0029, FMT_N,     F_BENCH },           // movt Rn
+  { 0x6008, FMT_NM,    F_BENCH },           // swap.b Rm,Rn
+  { 0x6009, FMT_NM,    F_BENCH },           // swap.w Rm,Rn
+  { 0x200d, FMT_NM,    F_BENCH },           // xtrct Rm,Rn
+  // arithmetic
+  { 0x300c, FMT_NM,    F_BENCH },           // add Rm,Rn
+  { 0x7000, FMT_NI,    F_BENCH },           // add #imm,Rn
+  { 0x300e, FMT_NM,    F_BENCH },           // addc Rm,Rn
+  { 0x300f, FMT_NM,    F_BENCH },           // addv Rm,Rn
+  { 0x8800, FMT_I,     F_BENCH },           // cmp/eq #imm,R0
+  { 0x3000, FMT_NMR,   F_BENCH },           // cmp/eq Rm,Rn
+  { 0x3002, FMT_NMR,   F_BENCH },           // cmp/hs Rm,Rn
+  { 0x3003, FMT_NMR,   F_BENCH },           // cmp/ge Rm,Rn
+  { 0x3006, FMT_NMR,   F_BENCH },           // cmp/hi Rm,Rn
+  { 0x3007, FMT_NMR,   F_BENCH },           // cmp/gt Rm,Rn
+  { 0x4015, FMT_NR,    F_BENCH },           // cmp/pl Rn
+  { 0x4011, FMT_NR,    F_BENCH },           // cmp/pz Rn
+  { 0x200c, FMT_NMR,   F_BENCH },           // cmp/str Rm,Rn
+  { 0x3004, FMT_NM,    F_BENCH },           // div1 Rm,Rn
+  { 0x2007, FMT_NMR,   F_BENCH },           // div0s Rm,Rn
+  { 0x0019, FMT_0,     F_BENCH },           // div0u
+  { 0x300d, FMT_NMR,   F_BENCH },           // dmuls.l Rm,Rn
+  { 0x3005, FMT_NMR,   F_BENCH },           // dmulu.l Rm,Rn
+  { 0x4010, FMT_N,     F_BENCH },           // dt Rn
+  { 0x600e, FMT_NM,    F_BENCH },           // exts.b Rm,Rn
+  { 0x600f, FMT_NM,    F_BENCH },           // exts.w Rm,Rn
+  { 0x600c, FMT_NM,    F_BENCH },           // extu.b Rm,Rn
+  { 0x600d, FMT_NM,    F_BENCH },           // extu.w Rm,Rn
+  { 0x000f, FMT_MAC,   S_L },               // mac.l @Rm+,@Rn+
+  { 0x400f, FMT_MAC,   S_W },               // mac.w @Rm+,@Rn+
+  { 0x0007, FMT_NMR,   F_BENCH },           // mul.l Rm,Rn
+  { 0x200f, FMT_NMR,   F_BENCH },           // muls.w Rm,Rn
+  { 0x200e, FMT_NMR,   F_BENCH },           // mulu.w Rm,Rn
+  { 0x600b, FMT_NM,    F_BENCH },           // neg Rm,Rn
+  { 0x600a, FMT_NM,    F_BENCH },           // negc Rm,Rn
+  { 0x3008, FMT_NM,    F_BENCH },           // sub Rm,Rn
+  { 0x300a, FMT_NM,    F_BENCH },           // subc Rm,Rn
+  { 0x300b, FMT_NM,    F_BENCH },           // subv Rm,Rn
+  // logic
+  { 0x2009, FMT_NM,    F_BENCH },           // and Rm,Rn
+  { 0xc900, FMT_I,     F_BENCH },           // and #imm,R0
+  { 0x6007, FMT_NM,    F_BENCH },           // not Rm,Rn
+  { 0x200b, FMT_NM,    F_BENCH },           // or Rm,Rn
+  { 0xcb00, FMT_I,     F_BENCH },           // or #imm,R0
+  { 0x401b, FMT_PN,    S_B|F_BENCH },       // tas.b @Rn
+  { 0x2008, FMT_NMR,   F_BENCH },           // tst Rm,Rn
+  { 0xc800, FMT_I,     F_BENCH },           // tst #imm,R0
+  { 0x200a, FMT_NM,    F_BENCH },           // xor Rm,Rn
+  { 0xca00, FMT_I,     F_BENCH },           // xor #imm,R0
+  // shift
+  { 0x4004, FMT_N,     F_BENCH },           // rotl Rn
+  { 0x4005, FMT_N,     F_BENCH },           // rotr Rn
+  { 0x4024, FMT_N,     F_BENCH },           // rotcl Rn
+  { 0x4025, FMT_N,     F_BENCH },           // rotcr Rn
+  { 0x4020, FMT_N,     F_BENCH },           // shal Rn
+  { 0x4021, FMT_N,     F_BENCH },           // shar Rn
+  { 0x4000, FMT_N,     F_BENCH },           // shll Rn
+  { 0x4001, FMT_N,     F_BENCH },           // shlr Rn
+  { 0x4008, FMT_N,     F_BENCH },           // shll2 Rn
+  { 0x4009, FMT_N,     F_BENCH },           // shlr2 Rn
+  { 0x4018, FMT_N,     F_BENCH },           // shll8 Rn
+  { 0x4019, FMT_N,     F_BENCH },           // shlr8 Rn
+  { 0x4028, FMT_N,     F_BENCH },           // shll16 Rn
+  { 0x4029, FMT_N,     F_BENCH },           // shlr16 Rn
+  // system control
+  { 0x0008, FMT_0,     F_BENCH },           // clrt
+  { 0x0028, FMT_0,     F_BENCH },           // clrmac
+  { 0x0018, FMT_0,     F_BENCH },           // sett
+  { 0x0009, FMT_0,     F_BENCH },           // nop
+  { 0x400e, FMT_NR,    F_BENCH },           // ldc Rm,SR
+  { 0x402e, FMT_NR,    F_BENCH },           // ldc Rm,VBR
+  { 0x400a, FMT_NR,    F_BENCH },           // lds Rm,MACH
+  { 0x401a, FMT_NR,    F_BENCH },           // lds Rm,MACL
+  { 0x4006, FMT_PM,    S_L },               // lds.l @Rm+,MACH
+  { 0x4016, FMT_PM,    S_L },               // lds.l @Rm+,MACL
+  { 0x0002, FMT_N,     F_BENCH },           // stc SR,Rn
+  { 0x0012, FMT_N,     F_BENCH },           // stc GBR,Rn
+  { 0x0022, FMT_N,     F_BENCH },           // stc VBR,Rn
+  { 0x000a, FMT_N,     F_BENCH },           // sts MACH,Rn
+  { 0x001a, FMT_N,     F_BENCH },           // sts MACL,Rn
+  { 0x4003, FMT_PN,    S_L },               // stc.l SR,@-Rn
+  { 0x4013, FMT_PN,    S_L },               // stc.l GBR,@-Rn
+  { 0x4002, FMT_PN,    S_L },               // sts.l MACH,@-Rn
+  { 0x4012, FMT_PN,    S_L },               // sts.l MACL,@-Rn
+  // branches
+  { 0x8900, FMT_BC,    F_NODS },            // bt disp
+  { 0x8b00, FMT_BC,    F_NODS },            // bf disp
+  { 0x8d00, FMT_BCS,   F_NODS },            // bt/s disp
+  { 0x8f00, FMT_BCS,   F_NODS },            // bf/s disp
+  { 0xa000, FMT_BRA,   F_NODS },            // bra disp
+};
+
+// registers: r0-r6 are random data, r7 is a loop counter, r8-r15 are
+// pointers into SDRAM or data array, 2 for each access size
+#define LOOP_REG    7
+static const u8 ptr_regs[3][3] = { { 8, 9, 9 }, { 10, 11, 11 }, { 12, 13, 14 } };
+#define data_reg()  rnd_n(LOOP_REG)
+#define any_reg()   rnd_n(16)
+#define ptr_reg(s)  ptr_regs[s][rnd_n(3)]
+
+#define PROG_MAX    512
+#define POOL_MAX    64
+
+struct prog {
+  u32 base;                 // SH2 address
+  int len;                  // in insns
+  int halt;                 // index of the final idle loop
+  u16 code[PROG_MAX + 2*POOL_MAX];
+  int target[PROG_MAX];     // branch target or literal index, or -1
+  u8 in_loop[PROG_MAX];     // not a valid branch target
+  int pool_len;             // in words
+  u32 pool[POOL_MAX];
+  int pool_size[POOL_MAX];
+};
+
+static void gen_insn(struct prog *p, int flags)
+{
+  const struct insn_tmpl *t;
+  int i = p->len;
+  u32 op, s;
+
+  do
+    t = &insn_tmpl[rnd_n(ARRAY_SIZE(insn_tmpl))];
+  while ((t->flags & flags & F_BENCH) != (flags & F_BENCH) ||
+         ((flags & F_NODS) && (t->flags & F_NODS)) ||
+         ((flags & F_BENCH) && t->fmt >= FMT_BC) ||
+         (!allow_sat && t->op == 0x400e));
+
+  op = t->op;
+  s = t->flags & S_MASK;
+  p->target[i] = -1;
+  p->in_loop[i] = 0;
+  switch (t->fmt) {
+  case FMT_0:     break;
+  case FMT_N:     op |= data_reg() << 8; break;
+  case FMT_NR:    op |= any_reg() << 8; break;
+  case FMT_NM:    op |= (data_reg() << 8) | (any_reg() << 4); break;
+  case FMT_NMR:   op |= (any_reg() << 8) | (any_reg() << 4); break;
+  case FMT_I:     op |= rnd_n(0x100); break;
+  case FMT_NI:    op |= (data_reg() << 8) | rnd_n(0x100); break;
+  case FMT_ST:    op |= (ptr_reg(s) << 8) | (data_reg() << 4); break;
+  case FMT_LD:    op |= (data_reg() << 8) | (ptr_reg(s) << 4); break;
+  case FMT_ST0:
+  case FMT_LD0:   op |= (ptr_reg(s) << 4) | rnd_n(0x10); break;
+  case FMT_STD:   op |= (ptr_reg(s) << 8) | (any_reg() << 4) | rnd_n(0x10); break;
+  case FMT_LDD:   op |= (data_reg() << 8) | (ptr_reg(s) << 4) | rnd_n(0x10); break;
+  case FMT_GBR:   op |= rnd_n(0x100); break;
+  case FMT_MOVA:  op |= rnd_n(0x100); break;
+  case FMT_PN:    op |= ptr_reg(s) << 8; break;
+  case FMT_PM:    op |= ptr_reg(s) << 8; break;
+  case FMT_MAC:
+    do
+      op = t->op | (ptr_reg(s) << 8) | (ptr_reg(s) << 4);
+    while (((op >> 8) & 0xf) == ((op >> 4) & 0xf));
+    break;
+  case FMT_PCREL:
+    // displacement is set when the literal pool is placed
+    op |= data_reg() << 8;
+    if (p->pool_len < POOL_MAX) {
+      p->pool_size[p->pool_len] = s;
+      p->pool[p->pool_len] = s == S_W ? (s16)rnd() : rnd();
+      p->target[i] = p->pool_len++;
+    } else
+      op = 0x0009; // nop
+    break;
+  case FMT_BC:
+  case FMT_BCS:
+  case FMT_BRA:
+    // forward only, resolved when the program end is known
+    p->target[i] = i + 2 + rnd_n(32);
+    break;
+  }
+  p->code[p->len++] = op;
+
+  if (t->fmt == FMT_BCS || t->fmt == FMT_BRA)
+    gen_insn(p, (flags & ~F_BENCH) | F_NODS); // delay slot
+}
+
+// counted loop with a straight body
+static void gen_loop(struct prog *p, int body_len)
+{
+  int start, i;
+
+  p->target[p->len] = -1;
+  p->code[p->len++] = 0xe000 | (LOOP_REG << 8) | (1 + rnd_n(8)); // mov #n,r7
+  start = p->len;
+  for (i = 0; i < body_len; i++)
+    gen_insn(p, F_BENCH);
+  p->target[p->len] = -1;
+  p->code[p->len++] = 0x4010 | (LOOP_REG << 8);                  // dt r7
+  p->target[p->len] = -1;
+  p->code[p->len] = 0x8b00 | ((start - p->len - 2) & 0xff);      // bf start
+  p->len++;
+  // jumping into the body would skip the counter setup
+  for (i = start; i < p->len; i++)
+    p->in_loop[i] = 1;
+}
+
+// end with an idle loop, followed by the literal pool
+static void gen_end(struct prog *p)
+{
+  int halt, i, d;
+  u32 pc, a;
+
+  halt = p->halt = p->len;
+  p->in_loop[halt] = 0;
+  p->target[p->len] = -1;
+  p->code[p->len++] = 0xaffe;   // bra .
+  p->target[p->len] = -1;
+  p->code[p->len++] = 0x0009;   // nop
+
+  // pool: align to long, longs first
+  pc = p->base + p->len*2;
+  if (pc & 2)
+    p->code[p->len++] = 0x0009;
+  for (i = 0; i < p->pool_len; i++)
+    if (p->pool_size[i] == S_L) {
+      a = p->base + p->len*2;
+      p->code[p->len++] = p->pool[i] >> 16;
+      p->code[p->len++] = p->pool[i];
+      p->pool[i] = a;
+    }
+  for (i = 0; i < p->pool_len; i++)
+    if (p->pool_size[i] == S_W) {
+      a = p->base + p->len*2;
+      p->code[p->len++] = p->pool[i];
+      p->pool[i] = a;
+    }
+
+  // resolve references
+  for (i = 0; i < halt; i++) {
+    u16 op = p->code[i];
+    if (p->target[i] < 0)
+      continue;
+    pc = p->base + i*2;
+    if ((op & 0xb000) == 0x9000) {        // mov.w/mov.l @(disp,PC),Rn
+      a = p->pool[p->target[i]];
+      d = (op & 0x4000) ? (a - ((pc & ~3) + 4)) / 4 : (a - (pc + 4)) / 2;
+      if (d > 0xff) {
+        p->code[i] = 0x0009;
+        continue;
+      }
+      p->code[i] = (op & 0xff00) | d;
+    } else {                              // branches
+      d = p->target[i] < halt ? p->target[i] : halt;
+      if ((op & 0xf000) != 0xa000 && d > i + 2 + 0x7f)
+        d = i + 2 + 0x7f;
+      while (p->in_loop[d])
+        d--;
+      d = d - (i + 2);
+      if ((op & 0xf000) == 0xa000)
+        p->code[i] = 0xa000 | (d & 0xfff);
+      else
+        p->code[i] = (op & 0xff00) | (d & 0xff);
+    }
+  }
+}
+
+static void gen_prog(struct prog *p, u32 base, int len)
 {
+  p->base = base;
+  p->len = p->pool_len = 0;
+  while (p->len < len) {
+    if (rnd_n(16) == 0)
+      gen_loop(p, 1 + rnd_n(8));
+    else
+      gen_insn(p, 0);
+  }
+  gen_end(p);
+}
+
+static void gen_bench_prog(struct prog *p, u32 base, int len)
+{
+  int start, i;
+
+  p->base = base;
+  p->len = p->pool_len = 0;
+  start = p->len;
+  for (i = 0; i < len; i++)
+    gen_insn(p, F_BENCH);
+  p->target[p->len] = -1;
+  p->code[p->len++] = 0x4010 | (LOOP_REG << 8);                  // dt r7
+  p->target[p->len] = -1;
+  p->code[p->len] = 0x8b00 | ((start - p->len - 2) & 0xff);      // bf start
+  p->len++;
+  gen_end(p);
+}
+
+static void load_prog(struct prog *p)
+{
+  memcpy(&rom[(p->base & (ROM_SIZE-1)) / 2], p->code, p->len * 2);
+}
+
+static void list_prog(struct prog *p)
+{
+  char buff[64];
+  int i;
+
+  for (i = 0; i < p->len; i++) {
+    DasmSH2(buff, p->base + i*2, p->code[i]);
+    printf("  %08x %04x %s\n", p->base + i*2, p->code[i], buff);
+  }
+}
+
+// -----------------------------------------------------------------
+// CPU state
+
+static void copy_state(void);
+
+static void init_state(void)
+{
+  int i;
+
+  for (i = 0; i < SDRAM_SIZE; i += 4)
+    *(u32 *)&ref_sdram[i] = rnd();
+  for (i = 0; i < sizeof(ref_sh2.data_array); i += 4)
+    *(u32 *)&ref_sh2.data_array[i] = rnd();
+
+  for (i = 0; i < 16; i++)
+    ref_sh2.r[i] = rnd();
+  // pointers into the middle of SDRAM or data array, aligned to access size
+  for (i = 8; i < 16; i++) {
+    int s = i < 10 ? 0 : i < 12 ? 1 : 2;
+    if (rnd_n(4) == 0)
+      ref_sh2.r[i] = DA_BASE + 0x400 + (rnd_n(0x800) & ~((1 << s) - 1));
+    else
+      ref_sh2.r[i] = (rnd_n(2) ? SDRAM_BASE : SDRAM_BASE | 0x20000000) +
+                     SDRAM_SIZE/4 + (rnd_n(SDRAM_SIZE/2) & ~((1 << s) - 1));
+  }
+  ref_sh2.gbr = SDRAM_BASE + SDRAM_SIZE/2 + (rnd_n(SDRAM_SIZE/4) & ~3);
+  ref_sh2.sr = rnd() & (allow_sat ? 0x3f3 : 0x3f1);
+  ref_sh2.pr = rnd();
+  ref_sh2.vbr = rnd();
+  ref_sh2.mach = rnd();
+  ref_sh2.macl = rnd();
+  ref_sh2.delay = ref_sh2.test_irq = 0;
+  ref_sh2.pending_level = ref_sh2.pending_irl = ref_sh2.pending_int_irq = 0;
+
+  copy_state();
+}
+
+// recompiler state from the interpreter state
+static void copy_state(void)
+{
+  memcpy(Pico32xMem->sdram, ref_sdram, SDRAM_SIZE);
+  memcpy(drc_sh2.data_array, ref_sh2.data_array, sizeof(drc_sh2.data_array));
+  memcpy(drc_sh2.r, ref_sh2.r, offsetof(SH2, read8_map));
+  drc_sh2.state = drc_state;
+}
+
+static const char *reg_names[] = {
+  "r0", "r1", "r2",  "r3",  "r4",  "r5",  "r6",  "r7",
+  "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+  "pc", "ppc", "pr", "sr", "gbr", "vbr", "mach", "macl"
+};
+
+// compare registers, except ppc and the upper (drc cycle count) SR bits
+static int regs_diff(const SH2 *a, const SH2 *b, int print)
+{
+  const u32 *ra = (const u32 *)a, *rb = (const u32 *)b;
+  int i, diff = 0;
+
+  for (i = 0; i < SH2_REGS; i++) {
+    u32 m = (i == SHR_SR ? 0x3f3 : ~0);
+    if (i == SHR_PPC || !((ra[i] ^ rb[i]) & m))
+      continue;
+    if (print)
+      printf("  %-4s drc %08x ref %08x\n", reg_names[i], ra[i] & m, rb[i] & m);
+    diff++;
+  }
+  return diff;
+}
+
+static int mem_diff(int print)
+{
+  u32 i;
+
+  if (memcmp(Pico32xMem->sdram, ref_sdram, SDRAM_SIZE) == 0 &&
+      memcmp(drc_sh2.data_array, ref_sh2.data_array, sizeof(ref_sh2.data_array)) == 0)
+    return 0;
+
+  if (print) {
+    for (i = 0; i < SDRAM_SIZE; i += 2)
+      if (*(u16 *)&Pico32xMem->sdram[i] != *(u16 *)&ref_sdram[i])
+        printf("  [%08x] drc %04x ref %04x\n", SDRAM_BASE + i,
+          *(u16 *)&Pico32xMem->sdram[i], *(u16 *)&ref_sdram[i]);
+    for (i = 0; i < sizeof(ref_sh2.data_array); i += 2)
+      if (*(u16 *)&drc_sh2.data_array[i] != *(u16 *)&ref_sh2.data_array[i])
+        printf("  [%08x] drc %04x ref %04x\n", DA_BASE + i,
+          *(u16 *)&drc_sh2.data_array[i], *(u16 *)&ref_sh2.data_array[i]);
+  }
+  return 1;
+}
+
+// run both CPUs in lockstep. The recompiler executes one block at a time, the
+// interpreter then single steps until it arrives at the same PC with the same
+// register contents. The recompiler may run a loop for several iterations
+// before checking cycles, hence it isn't enough to stop at the first match.
+#define MAX_STEPS   100000
+
+// smallest budget running at least one block. A pinned loop exits at its head
+// once no cycles are left, with 1 cycle it would never run an iteration.
+#define DRC_MIN_CYCLES  2
+
+static int run_compare(u32 halt_pc, int max_blocks, int verbose)
+{
+  SH2 first;
+  int blk, steps, seen;
+  u32 pc;
+
+  for (blk = 0; blk < max_blocks; blk++) {
+    sh2_execute_drc(&drc_sh2, DRC_MIN_CYCLES);
+    pc = drc_sh2.pc;
+
+    seen = 0;
+    for (steps = 0; steps < MAX_STEPS; steps++) {
+      if (ref_sh2.pc == pc && !ref_sh2.delay) {
+        if (!regs_diff(&drc_sh2, &ref_sh2, 0))
+          break;
+        if (!seen)
+          first = ref_sh2;
+        seen = 1;
+      }
+      sh2_execute_interpreter(&ref_sh2, 1);
+    }
+
+    if (steps == MAX_STEPS) {
+      printf("block %d: state mismatch at %08x\n", blk, pc);
+      if (seen)
+        regs_diff(&drc_sh2, &first, 1);
+      else
+        printf("  interpreter never reached pc\n");
+      return -1;
+    }
+    if (mem_diff(0)) {
+      printf("block %d: memory mismatch at %08x\n", blk, pc);
+      mem_diff(1);
+      return -1;
+    }
+    if (verbose)
+      printf("block %d: ok, next pc %08x, %d insns\n", blk, pc, steps);
+    if (pc == halt_pc)
+      return 0;
+  }
+  return 0;
+}
+
+static int test_random(int count, int len, int verbose)
+{
+  static struct prog p;
+  int i, fails = 0;
+  u32 seed;
+
+  for (i = 0; i < count; i++) {
+    seed = rnd_state;
+    gen_prog(&p, ROM_BASE, 1 + rnd_n(len));
+    load_prog(&p);
+    sh2_drc_flush_all();
+    init_state();
+    ref_sh2.pc = drc_sh2.pc = p.base;
+    if (verbose) {
+      printf("test %d, seed %08x\n", i, seed);
+      list_prog(&p);
+    }
+    if (run_compare(p.base + p.halt * 2, 10000, verbose)) {
+      printf("test %d failed, seed %08x\n", i, seed);
+      if (!verbose)
+        list_prog(&p);
+      fails++;
+    }
+  }
+  printf("%d random tests, %d failed\n", count, fails);
+  return fails;
+}
+
+#ifdef SH2_THREADS
+// in parallel sh2 mode all SDRAM writes of translated code must go to the
+// memory handlers, for the write conflict check
+static int test_par_sdram(int count, int len)
+{
+  int fails;
+
+  drc_state = SH2_PAR_SDRAM;
+  sdram_writes[0] = sdram_writes[1] = 0;
+  fails = test_random(count, len, 0);
+  drc_state = 0;
+
+  printf("SDRAM writes to the handlers: interpreter %d, drc %d\n",
+    sdram_writes[0], sdram_writes[1]);
+  if (sdram_writes[0] != sdram_writes[1] || sdram_writes[0] == 0)
+    fails++;
+  return fails;
+}
+#endif
+
+static int test_file(const char *arg, u32 pc, int blocks, int verbose)
+{
+  char fname[256], *s;
+  u32 addr = ROM_BASE, mask;
+  u8 *src, *dst_r, *dst_d;
   FILE *f;
-  u32 (*testfunc)(u32), ret;
-  int arg0, arg1, arg2, arg3, sr;
-  host_arg2reg(arg0, 0);
-  host_arg2reg(arg1, 1);
-  host_arg2reg(arg2, 2);
-  host_arg2reg(arg3, 3);
-
-  g_argv = argv;
-  sh2_drc_init(sh2s);
-  f = fopen("utils.bin", "w");
-  fwrite(tcache, 1, 4096, f);
-  fclose(f);
+  long size;
+  int i;
+
+  snprintf(fname, sizeof(fname), "%s", arg);
+  if ((s = strchr(fname, '@')) != NULL) {
+    *s++ = 0;
+    addr = strtoul(s, NULL, 0);
+  }
+
+  init_state();
+  dst_r = p32x_sh2_get_mem_ptr(addr, &mask, &ref_sh2);
+  dst_d = p32x_sh2_get_mem_ptr(addr, &mask, &drc_sh2);
+  if (dst_r == (void *)-1) {
+    printf("%s: no memory at %08x\n", fname, addr);
+    return 1;
+  }
 
-  tcache_ptr = tcache_ring[0].base;
-  u8 *p1 = tcache_ptr;
-  emith_jump_patchable(0);
-  u8 *p2 = tcache_ptr;
-  emith_jump_cond_patchable(DCOND_GE, 0);
-  emith_move_r_r(0, 1);
-  emith_move_r_r(0, 2);
-  u8 *p3 = tcache_ptr;
-  emith_move_r_r(0, 3);
-  emith_move_r_r(0, 4);
-  emith_move_r_r(0, 5);
-
-  u8 *p4 = tcache_ptr;
-  emith_move_r_imm_s8_patchable(arg0, 0);
-  emith_move_r_r(0, 6);
-  emith_flush();
-
-  emith_jump_patch(p1, tcache_ptr, NULL);
-  emith_jump_patch(p2, tcache_ptr, NULL);
-  emith_jump_at(p3, tcache_ptr);
-
-  emith_move_r_imm_s8_patch(p4, 42);
-
-  emith_read8_r_r_offs(arg0, arg1, 100);
-  emith_read8_r_r_offs(arg0, arg1, 1000);
-  emith_read8_r_r_offs(arg0, arg1, 10000);
-  emith_read8_r_r_offs(arg0, arg1, -100);
-  emith_read8_r_r_offs(arg0, arg1, -1000);
-  emith_read8_r_r_offs(arg0, arg1, -10000);
-
-  emith_read16_r_r_offs(arg0, arg1, 4);
-  emith_read_r_r_offs(arg0, arg1, 4);
-  emith_read8s_r_r_offs(arg0, arg1, 4);
-  emith_read16s_r_r_offs(arg0, arg1, 4);
-
-  emith_write_r_r_offs(arg0, arg1, 4);
-
-  emith_add_r_r_r_lsl(arg0, arg1, arg2, 2);
-  emith_move_r_r(0, 0);
-
-  emith_mula_s64(arg0, arg1, arg2, arg3);
-  emith_move_r_r(0, 0);
-
-  emith_clear_msb(arg0, arg1, 8);
-  emith_clear_msb(arg0, arg1, 16);
-  emith_clear_msb(arg0, arg1, 24);
-
-  emith_sext(arg0, arg1, 8);
-  emith_sext(arg0, arg1, 16);
-  emith_sext(arg0, arg1, 24);
-  emith_move_r_r(0, 0);
-
-  emith_lsl(arg0, arg1, 24);
-  emith_lsr(arg0, arg1, 24);
-  emith_asr(arg0, arg1, 24);
-  emith_rol(arg0, arg1, 24);
-  emith_move_r_r(0, 0);
-
-  emith_lslf(arg0, arg1, 24);
-  emith_lsrf(arg0, arg1, 24);
-  emith_asrf(arg0, arg1, 24);
-  emith_rolf(arg0, arg1, 24);
-  emith_rorf(arg0, arg1, 24);
-  emith_move_r_r(0, 0);
-  emith_rolcf(arg0);
-  emith_rorcf(arg0);
-
-  emith_negcf_r_r(arg0, arg1);
-  emith_move_r_r(0, 0);
-
-  emith_eor_r_r_imm(arg0, arg1, 100);
-  emith_eor_r_r_imm(arg0, arg1, 10000);
-  emith_eor_r_r_imm(arg0, arg1, -100);
-  emith_eor_r_r_imm(arg0, arg1, -10000);
-  emith_move_r_r(0, 0);
-
-  emith_move_r_imm(arg0, 100);
-  emith_move_r_imm(arg0, 1000);
-  emith_move_r_imm(arg0, 10000);
-  emith_move_r_imm(arg0, -100);
-  emith_move_r_imm(arg0, -1000);
-  emith_move_r_imm(arg0, -10000);
-  emith_move_r_r(0, 0);
-
-  emith_move_r_ptr_imm(arg0, 0x1234567887654321ULL);
-  emith_move_r_ptr_imm(arg1, 0x8765432112345678ULL);
-  emith_move_r_ptr_imm(arg2, 0x0011223344556677ULL);
-  emith_move_r_ptr_imm(arg3, 0x7766554433221100ULL);
-  emith_move_r_r(0, 0);
-
-  emith_tpop_carry(29, 0);
-  emith_tpush_carry(29, 0);
-  emith_move_r_r(0, 0);
-
-  emith_carry_to_t(29, 0);
-  emith_t_to_carry(29, 0);
-  emith_move_r_r(0, 0);
-
-  emith_write_sr(29, arg0);
-  emith_move_r_r(0, 0);
-
-  emith_sh2_delay_loop(11, arg0);
-  emith_move_r_r(0, 0);
-  emith_sh2_delay_loop(11, -1);
-  emith_move_r_r(0, 0);
-
-  emith_sh2_div1_step(arg0, arg1, 29);
-  emith_move_r_r(0, 0);
-
-  emith_sh2_macl(arg0, arg1, arg2, arg3, 29);
-  emith_move_r_r(0, 0);
-  emith_sh2_macw(arg0, arg1, arg2, arg3, 29);
-  emith_move_r_r(0, 0);
-
-  emith_flush();
-  emith_pool_commit(1);
-
-  emith_ret();
-
-  f = fopen("test.bin", "w");
-  fwrite(tcache_ring[0].base, 1, tcache_ptr - tcache_ring[0].base, f);
+  f = fopen(fname, "rb");
+  if (f == NULL) {
+    perror(fname);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size > mask+1 - (addr & mask))
+    size = mask+1 - (addr & mask);
+  src = malloc(size);
+  if (src == NULL || fread(src, 1, size, f) != size) {
+    printf("%s: read error\n", fname);
+    fclose(f);
+    free(src);
+    return 1;
+  }
   fclose(f);
 
-  do_host_disasm(0);
+  // big endian file to host order 16 bit words
+  for (i = 0; i + 1 < size; i += 2) {
+    u16 w = (src[i] << 8) | src[i+1];
+    *(u16 *)(dst_r + (addr & mask) + i) = w;
+    *(u16 *)(dst_d + (addr & mask) + i) = w;
+  }
+  free(src);
 
-#if  0
-  testfunc = (void *)tcache_next[0];
-  tcache_ptr = tcache_next[0];
-  emith_move_r_r(RET_REG, arg0);
-  emith_ret();
-  host_instructions_updated(tcache_next[0], tcache_ptr);
-  ret = testfunc(0x00000001);
-  printf("ret %x\n",ret);
+  sh2_drc_flush_all();
+  ref_sh2.pc = drc_sh2.pc = pc ? pc : addr;
+  i = run_compare(~0, blocks, verbose);
+  printf("%s: %s\n", fname, i ? "failed" : "ok");
+  return i != 0;
+}
+
+#if SUPERBLOCKS
+// loop over a body with forward branches, to be entered often enough to be
+// translated again as superblock
+static void gen_hot_prog(struct prog *p, u32 base, int len)
+{
+  int start, dt, i;
+
+  p->base = base;
+  p->len = p->pool_len = 0;
+  start = p->len;
+  while (p->len - start < len) {
+    if (rnd_n(8) == 0) {
+      p->target[p->len] = p->len + 2 + rnd_n(16);
+      p->in_loop[p->len] = 0;
+      p->code[p->len++] = rnd_n(2) ? 0x8900 : 0x8b00;          // bt/bf
+    } else
+      gen_insn(p, F_BENCH);
+  }
+  dt = p->len;
+  p->target[p->len] = -1;
+  p->in_loop[p->len] = 0;
+  p->code[p->len++] = 0x4010 | (LOOP_REG << 8);                  // dt r7
+  p->target[p->len] = -1;
+  p->in_loop[p->len] = 0;
+  p->code[p->len] = 0x8b00 | ((start - p->len - 2) & 0xff);      // bf start
+  p->len++;
+  // branches must not leave the loop
+  for (i = start; i < dt; i++)
+    if ((p->code[i] & 0xfd00) == 0x8900 && p->target[i] > dt)
+      p->target[i] = dt;
+  gen_end(p);
+}
+
+static void clear_entry_counts(void)
+{
+  int b, i, j;
+
+  for (b = 0; b < ARRAY_SIZE(block_tables); b++)
+    for (i = block_ring[b].first; i != block_ring[b].next; i = (i+1)%block_ring[b].size)
+      for (j = 0; j < block_tables[b][i].entry_count; j++)
+        block_tables[b][i].entryp[j].entry_count = 0;
+}
+
+// run the recompiler up to halt_pc. Without superblocks a single block is run
+// at a time and the entry counters are cleared, keeping them below
+// SUPERBLOCK_COUNT.
+static int run_drc(u32 halt_pc, int superblocks)
+{
+  int n;
+
+  for (n = 0; drc_sh2.pc != halt_pc; n++) {
+    if (n == MAX_STEPS * 10)
+      return -1;
+    if (superblocks)
+      sh2_execute_drc(&drc_sh2, 10000);
+    else {
+      sh2_execute_drc(&drc_sh2, DRC_MIN_CYCLES);
+      clear_entry_counts();
+    }
+  }
+  return 0;
+}
+
+// run loops crossing SUPERBLOCK_COUNT with superblocks off and on, compare
+// both against each other and against the interpreter
+static int test_hot(int count, int len, int verbose)
+{
+  static struct prog p;
+  static u8 sdram[SDRAM_SIZE], da[sizeof(drc_sh2.data_array)];
+  struct sh2_drc_stats st0, st1;
+  SH2 regs;
+  u32 seed, halt_pc;
+  int i, fail, fails = 0, made = 0;
+
+  for (i = 0; i < count; i++) {
+    seed = rnd_state;
+    gen_hot_prog(&p, ROM_BASE, 1 + rnd_n(len));
+    load_prog(&p);
+    init_state();
+    ref_sh2.pc = p.base;
+    ref_sh2.r[LOOP_REG] = SUPERBLOCK_COUNT + rnd_n(SUPERBLOCK_COUNT);
+    halt_pc = p.base + p.halt * 2;
+    if (verbose) {
+      printf("hot test %d, seed %08x\n", i, seed);
+      list_prog(&p);
+    }
+
+    // superblocks off
+    copy_state();
+    sh2_drc_flush_all();
+    sh2_drc_get_stats(0, &st0);
+    fail = run_drc(halt_pc, 0);
+    sh2_drc_get_stats(0, &st1);
+    if (st1.superblocks != st0.superblocks) {
+      printf("hot test %d: superblock made with cleared counters\n", i);
+      fail = 1;
+    }
+    regs = drc_sh2;
+    memcpy(sdram, Pico32xMem->sdram, SDRAM_SIZE);
+    memcpy(da, drc_sh2.data_array, sizeof(da));
+
+    // superblocks on
+    copy_state();
+    sh2_drc_flush_all();
+    sh2_drc_get_stats(0, &st0);
+    fail |= run_drc(halt_pc, 1);
+    sh2_drc_get_stats(0, &st1);
+    made += st1.superblocks - st0.superblocks;
+    if (regs_diff(&drc_sh2, &regs, 0) || memcmp(sdram, Pico32xMem->sdram, SDRAM_SIZE) ||
+        memcmp(da, drc_sh2.data_array, sizeof(da))) {
+      printf("hot test %d: superblocks on/off differ\n", i);
+      regs_diff(&drc_sh2, &regs, 1);
+      fail = 1;
+    }
+
+    while (ref_sh2.pc != halt_pc)
+      sh2_execute_interpreter(&ref_sh2, 10000);
+    if (regs_diff(&drc_sh2, &ref_sh2, 1) || mem_diff(1)) {
+      printf("hot test %d: final state differs\n", i);
+      fail = 1;
+    }
+
+    if (fail) {
+      printf("hot test %d failed, seed %08x\n", i, seed);
+      if (!verbose)
+        list_prog(&p);
+      fails++;
+    }
+  }
+  printf("%d superblock tests, %d failed, %d superblocks made\n", count, fails, made);
+  if (count && !made) {
+    printf("no superblocks made\n");
+    fails++;
+  }
+  return fails;
+}
 #endif
+
+// -----------------------------------------------------------------
+// benchmarks
+
+#if defined(__x86_64__)
+#define HOST "x86_64"
+#elif defined(__i386__)
+#define HOST "i386"
+#elif defined(__aarch64__)
+#define HOST "aarch64"
+#elif defined(__arm__)
+#define HOST "arm"
+#elif defined(__mips__)
+#define HOST "mips"
+#elif defined(__riscv__) || defined(__riscv)
+#define HOST "riscv"
+#elif defined(__powerpc__) || defined(__ppc__)
+#define HOST "powerpc"
+#else
+#define HOST "unknown"
+#endif
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_translate(int count, int len)
+{
+  static struct prog p;
+  static u32 starts[ROM_SIZE / 8], ends[ROM_SIZE / 8];
+  double t = 0, t0;
+  int blocks = 0, insns = 0, bytes = 0;
+  int i, j, n, used;
+  u32 base;
+
+  for (i = 0; i < count; ) {
+    // fill ROM with programs, then translate all blocks in their code areas
+    sh2_drc_flush_all();
+    init_state();
+    for (n = 0, base = ROM_BASE; i < count && base + 2*(PROG_MAX + 2*POOL_MAX) < ROM_BASE + ROM_SIZE; i++) {
+      gen_prog(&p, base, len);
+      load_prog(&p);
+      starts[n] = base;
+      ends[n++] = base + (p.halt + 2) * 2;
+      base += p.len * 2;
+    }
+
+    used = tcache_ring[0].used;
+    t0 = now();
+    for (j = 0; j < n; j++) {
+      for (base = starts[j]; base < ends[j]; ) {
+        struct block_desc *bd;
+        drc_sh2.pc = base;
+        sh2_translate(&drc_sh2, 0);
+        bd = &block_tables[0][(block_ring[0].next + block_ring[0].size - 1) % block_ring[0].size];
+        insns += bd->size / 2;
+        blocks++;
+        base = bd->addr + bd->size;
+        if (bd->size == 0)
+          break;
+      }
+      if (tcache_ring[0].used > tcache_ring[0].size / 2)
+        break;
+    }
+    t += now() - t0;
+    bytes += tcache_ring[0].used - used;
+  }
+
+  printf("translate: %d blocks, %d insns in %.3f ms: %.2f us/block, "
+    "%.2f Minsns/s, %.1f host bytes/insn\n", blocks, insns, t * 1000,
+    t * 1e6 / blocks, insns / t / 1e6, (double)bytes / insns);
+}
+
+static double bench_run(SH2 *sh2, int use_drc, u32 halt_pc)
+{
+  double t0 = now();
+
+  while (sh2->pc != halt_pc)
+    use_drc ? sh2_execute_drc(sh2, 10000) : sh2_execute_interpreter(sh2, 10000);
+  return now() - t0;
+}
+
+// run a loop over random insns for a fixed number of iterations
+static void bench_execute(int len, int insns)
+{
+  static struct prog p;
+  u32 halt_pc, loops;
+  double td, ti;
+
+  gen_bench_prog(&p, ROM_BASE, len);
+  load_prog(&p);
+  sh2_drc_flush_all();
+  init_state();
+  ref_sh2.pc = drc_sh2.pc = p.base;
+  loops = insns / (len + 2);
+  ref_sh2.r[LOOP_REG] = drc_sh2.r[LOOP_REG] = loops;
+  halt_pc = p.base + p.halt * 2;
+
+  td = bench_run(&drc_sh2, 1, halt_pc);
+  ti = bench_run(&ref_sh2, 0, halt_pc);
+  insns = loops * (len + 2);
+  printf("execute: %d insns, drc %.1f Minsns/s, interpreter %.1f Minsns/s, "
+    "speedup %.1f\n", insns, insns / td / 1e6, insns / ti / 1e6, ti / td);
+  if (regs_diff(&drc_sh2, &ref_sh2, 1) || mem_diff(0))
+    printf("execute: final state differs\n");
 }
 
+// -----------------------------------------------------------------
+
+static void usage(const char *argv0)
+{
+  printf("usage: %s [options] [file[@addr] ...]\n"
+    "  -s seed   random seed (default 1)\n"
+    "  -n count  number of random tests (default 1000, 1/10 of it superblock tests)\n"
+    "  -l len    max. length of random tests in insns (default 64)\n"
+    "  -p pc     start pc for files (default: load address)\n"
+    "  -c count  max. number of blocks to run for files (default 100000)\n"
+    "  -b        run benchmarks\n"
+    "  -a        translate in the background (if built with USE_THREADS)\n"
+    "  -S        allow MAC saturation mode\n"
+    "  -v        verbose\n"
+    "files are big endian SH2 code images, loaded to ROM (default) or SDRAM\n",
+    argv0);
+}
+
+int main(int argc, char *argv[])
+{
+  int tests = 1000, len = 64, blocks = 100000, bench = 0, verbose = 0;
+  int fails = 0, files = 0;
+  u32 pc = 0;
+  int i;
+
+  rnd_state = 1;
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] != '-')
+      continue;
+    if (i + 1 < argc && argv[i][1] && strchr("snlpc", argv[i][1]) && argv[i][2] == 0) {
+      u32 v = strtoul(argv[++i], NULL, 0);
+      switch (argv[i-1][1]) {
+      case 's': rnd_state = v ? v : 1; break;
+      case 'n': tests = v; break;
+      case 'l': len = v > PROG_MAX - 32 ? PROG_MAX - 32 : v; break;
+      case 'p': pc = v; break;
+      case 'c': blocks = v; break;
+      }
+    } else if (!strcmp(argv[i], "-S"))
+      allow_sat = 1;
+    else if (!strcmp(argv[i], "-b"))
+      bench = 1;
+    else if (!strcmp(argv[i], "-a"))
+      PicoIn.opt |= POPT_EN_DRC_ASYNC;
+    else if (!strcmp(argv[i], "-v"))
+      verbose = 1;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  printf("host: %s, seed %08x\n", HOST, rnd_state);
+  PicoIn.opt |= POPT_EN_DRC;
+  drc_sh2.is_slave = 0;
+  drc_sh2.other_sh2 = &sh2s[1];
+  if (sh2_drc_init(&drc_sh2)) {
+    printf("drc init failed\n");
+    return 1;
+  }
+  setup_cpu(&drc_sh2, &drc_mem, Pico32xMem->sdram);
+  sh2_drc_mem_setup(&drc_sh2);
+  setup_cpu(&ref_sh2, &ref_mem, ref_sdram);
+  ref_sh2.p_drcblk_ram = ref_drcblk_ram;
+  ref_sh2.p_drcblk_da = ref_drcblk_da;
+
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') {
+      i += (argv[i][1] && strchr("snlpc", argv[i][1]) && argv[i][2] == 0);
+      continue;
+    }
+    fails += test_file(argv[i], pc, blocks, verbose);
+    files++;
+  }
+  if (!files && tests) {
+    fails += test_random(tests, len, verbose);
+#ifdef SH2_THREADS
+    fails += test_par_sdram(tests / 10, len);
+#endif
+#if SUPERBLOCKS
+    fails += test_hot(tests / 10, len, verbose);
+#endif
+  }
+
+  if (bench) {
+    bench_translate(2000, len);
+    bench_execute(len, 50000000);
+  }
+
+  sh2_drc_finish(&drc_sh2);
+  return fails != 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Mega-CD graphics benchmark and check:
+ * - renders random stamp maps with the C and the vector version of
+ *   gfx_render and compares the output
+ * - word RAM 1M/2M mode switch against word by word reference versions
+ *
+ * gfx.c is built into the c and vec variants of this file, the latter with
+ * GFX_SIMD, see variant.h.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "variant.h"
+
+struct gfx_impl {
+	const char *name;
+	void (*init)(void);
+	void (*start)(unsigned int base);
+	void (*render)(int w, int h);
+};
+
+#ifdef VARIANT
+
+#define gfx_init		SYM(gfx_init)
+#define gfx_start		SYM(gfx_start)
+#define gfx_update		SYM(gfx_update)
+#define gfx_context_save	SYM(gfx_context_save)
+#define gfx_context_load	SYM(gfx_context_load)
+#include "../pico/cd/gfx.c"
+
+// h lines of w dots, like gfx_update does them
+static void render(int w, int h)
+{
+	while (h--) {
+#ifdef GFX_SIMD
+		gfx_render_v(gfx.bufferStart, w);
+#else
+		gfx_render(gfx.bufferStart, w);
+#endif
+		gfx.bufferStart += 8;
+	}
+}
+
+const struct gfx_impl SYM(impl) = {
+	STR(VARIANT), gfx_init, gfx_start, render
+};
+
+#else
+
+#include "../pico/cd/misc.c"
+
+extern const struct gfx_impl c_impl, vec_impl;
+static const struct gfx_impl *impls[2] = { &c_impl, &vec_impl };
+
+struct Pico Pico;
+PicoInterface PicoIn;
+
+static mcd_state mcd;
+static unsigned char ram_ref[0x40000];
+
+void pcd_event_schedule(unsigned int now, enum pcd_event event, int after) {}
+void pcd_event_schedule_s68k(enum pcd_event event, int after) {}
+void pcd_irq_s68k(int irq, int state) {}
+void pcd_s68k_poll_release(u32 a) {}
+void lprintf(const char *fmt, ...) {}
+
+// registers for an operation: stamp/map size, repeat and priority mode. The
+// trace table is at 0x8000, see start.
+static void setup(int size, int repeat, int prio, int w, int h)
+{
+	unsigned char *r = mcd.s68k_regs;
+
+	r[0x03] = prio << 3;		// 2M mode
+	r[0x59] = (size << 1) | repeat;
+	r[0x5a] = 0x00; r[0x5b] = 0x00;	// stamp map at 0
+	r[0x5d] = 0x1f;			// 32 cells wide image buffer
+	r[0x5e] = 0x00; r[0x5f] = 0x80;	// image buffer at 0x200
+	r[0x61] = rand() & 0x3f;
+	r[0x62] = w >> 8; r[0x63] = w;
+	r[0x64] = h >> 8; r[0x65] = h;
+}
+
+static void start(const struct gfx_impl *impl)
+{
+	impl->start(0x8000 >> 2);
+}
+
+// trace table for a rotated and scaled plane, like a racing game floor
+static void trace(int h, double angle, double scale, int jitter)
+{
+	unsigned short *t = (unsigned short *)(mcd.word_ram2M + 0x8000);
+	double c = cos(angle) * scale, s = sin(angle) * scale;
+	int y;
+
+	for (y = 0; y < h; y++, t += 4) {
+		double z = jitter ? 1 : 64.0 / (y + 16);
+		t[0] = (int)((1024 + (-128 * c - y * s) * z) * 8) + (jitter ? rand() : 0);
+		t[1] = (int)((1024 + (-128 * s + y * c) * z) * 8) + (jitter ? rand() : 0);
+		t[2] = (int)(c * z * 2048) + (jitter ? rand() % 8192 - 4096 : 0);
+		t[3] = (int)(s * z * 2048) + (jitter ? rand() % 8192 - 4096 : 0);
+	}
+}
+
+static void fill(void)
+{
+	int i;
+
+	for (i = 0; i < 0x40000; i++)
+		mcd.word_ram2M[i] = rand();
+	// some empty stamps in the map
+	for (i = 0; i < 0x8000; i += 2)
+		if (!(rand() & 7))
+			*(unsigned short *)(mcd.word_ram2M + i) &= ~0x7ff;
+}
+
+// both renderers from the same state must give the same word RAM
+static int check(void)
+{
+	static unsigned char ram_in[0x40000];
+	int size, rep, prio, k, fails = 0;
+
+	for (size = 0; size < 4; size++)
+	for (rep = 0; rep < 2; rep++)
+	for (prio = 0; prio < 4; prio++)
+	for (k = 0; k < 4; k++) {
+		int w = 1 + rand() % 300, h = 1 + rand() % 64;
+
+		fill();
+		setup(size, rep, prio, w, h);
+		trace(h, rand() * 1e-3, 0.25 + (rand() % 64) / 16.0, k & 1);
+		memcpy(ram_in, mcd.word_ram2M, sizeof(ram_in));
+
+		start(impls[0]);
+		impls[0]->render(w, h);
+		memcpy(ram_ref, mcd.word_ram2M, sizeof(ram_ref));
+		memcpy(mcd.word_ram2M, ram_in, sizeof(ram_in));
+		start(impls[1]);
+		impls[1]->render(w, h);
+
+		if (memcmp(ram_ref, mcd.word_ram2M, sizeof(ram_ref))) {
+			printf("mismatch: size %d, repeat %d, prio %d, %dx%d\n",
+				size, rep, prio, w, h);
+			fails++;
+		}
+	}
+	return fails;
+}
+
+// reference: the word by word loops
+static void ref_wram_2M_to_1M(unsigned char *m)
+{
+	unsigned short *m1M_b0, *m1M_b1;
+	unsigned int i, tmp, *m2M;
+
+	m2M = (unsigned int *) (m + 0x40000);
+	m1M_b0 = (unsigned short *) m2M;
+	m1M_b1 = (unsigned short *) (m + 0x60000);
+
+	for (i = 0x40000/4; i; i--)
+	{
+		tmp = *(--m2M);
+		*(--m1M_b0) = tmp;
+		*(--m1M_b1) = tmp >> 16;
+	}
+}
+
+static void ref_wram_1M_to_2M(unsigned char *m)
+{
+	unsigned short *m1M_b0, *m1M_b1;
+	unsigned int i, tmp, *m2M;
+
+	m2M = (unsigned int *) m;
+	m1M_b0 = (unsigned short *) (m + 0x20000);
+	m1M_b1 = (unsigned short *) (m + 0x40000);
+
+	for (i = 0x40000/4; i; i--)
+	{
+		tmp = *m1M_b0++ | (*m1M_b1++ << 16);
+		*m2M++ = tmp;
+	}
+}
+
+static int check_wram(int loops)
+{
+	static unsigned char a[0x60000], b[0x60000];
+	double t0, t1, t2;
+	int i, fails = 0;
+
+	for (i = 0; i < sizeof(a); i++)
+		a[i] = b[i] = rand();
+	ref_wram_2M_to_1M(a);
+	wram_2M_to_1M(b);
+	fails += memcmp(a, b, sizeof(a)) != 0;
+	ref_wram_1M_to_2M(a);
+	wram_1M_to_2M(b);
+	fails += memcmp(a, b, sizeof(a)) != 0;
+	if (fails)
+		printf("wram conversion mismatch\n");
+
+	t0 = now();
+	for (i = 0; i < loops; i++) {
+		ref_wram_2M_to_1M(a);
+		ref_wram_1M_to_2M(a);
+	}
+	t1 = now();
+	for (i = 0; i < loops; i++) {
+		wram_2M_to_1M(b);
+		wram_1M_to_2M(b);
+	}
+	t2 = now();
+	printf("wram 2M->1M->2M: C %.1f us, vector %.1f us\n",
+		(t1 - t0) * 1e6 / loops, (t2 - t1) * 1e6 / loops);
+	return fails;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 500;
+	int fails, size, f, v;
+
+	Pico.rom = (void *)&mcd;
+	impls[0]->init();
+	impls[1]->init();
+	fails = check();
+	fails += check_wram(frames);
+
+	// a full screen rotated plane per frame
+	for (size = 0; size < 4; size++) {
+		double t[2];
+
+		fill();
+		for (v = 0; v < 2; v++) {
+			double t0 = now();
+			for (f = 0; f < frames; f++) {
+				setup(size, 1, 0, 256, 224);
+				start(impls[v]);
+				trace(224, f * 0.01, 1.0, 0);
+				impls[v]->render(256, 224);
+			}
+			t[v] = (now() - t0) * 1e6 / frames;
+		}
+		printf("stamp %2d, map %4d: per frame C %.1f us, vector %.1f us\n",
+			size & 1 ? 32 : 16, size & 2 ? 4096 : 256, t[0], t[1]);
+	}
+
+	if (fails)
+		printf("FAILED\n");
+	return fails != 0;
+}
+
+#endif
@@ -29,7 +29,7 @@
 #define OFS_PMEM_vram        0x10000
 #define OFS_PMEM_vsram       0x22100
 #define OFS_PMEM32x_pal_native 0x90e00
-#define OFS_SH2_is_slave     0x055c
+#define OFS_SH2_is_slave     0x056c
 #define OFS_SH2_p_bios       0x0080
 #define OFS_SH2_p_da         0x0084
 #define OFS_SH2_p_sdram      0x0088
@@ -29,7 +29,7 @@
 #define OFS_PMEM_vram        0x10000
 #define OFS_PMEM_vsram       0x22100
 #define OFS_PMEM32x_pal_native 0x90e00
-#define OFS_SH2_is_slave     0x0a18
+#define OFS_SH2_is_slave     0x0a28
 #define OFS_SH2_p_bios       0x0098
 #define OFS_SH2_p_da         0x00a0
 #define OFS_SH2_p_sdram      0x00a8
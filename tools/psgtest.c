@@ -0,0 +1,230 @@
+/*
+ * PSG check: skipping muted voices in SN76496Update against the full loop
+ *
+ * This file is built once per variant of sn76496.c with VARIANT set, which
+ * includes it with its global symbols prefixed, and once as the driver, see
+ * variant.h. The reference variant is built with PSG_REF and updates with the
+ * loop below instead, which runs every voice through all samples. The driver
+ * runs both in lockstep on the same random writes and compares output and
+ * chip state after each update.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "variant.h"
+
+struct psg_impl {
+	const char *name;
+	int  (*init)(int clock, int sample_rate);
+	void (*write)(int data);
+	int  (*update)(short *buffer, int length, int stereo);
+	void (*get_state)(void *st, int *size);
+};
+
+#ifdef VARIANT
+
+#define SN76496Write		SYM(SN76496Write)
+#define SN76496Update		SYM(SN76496Update)
+#define SN76496_init		SYM(SN76496_init)
+#define sn76496_regs		SYM(sn76496_regs)
+#include "../pico/sound/sn76496.c"
+
+static void get_state(void *st, int *size)
+{
+	memcpy(st, &ono_sn, sizeof(ono_sn));
+	*size = sizeof(ono_sn);
+}
+
+#ifdef PSG_REF
+// SN76496Update without skipping muted voices
+static int update_ref(short *buffer, int length, int stereo)
+{
+	int i, active = 0;
+	struct SN76496 *R = &ono_sn;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (R->Volume[i] == 0)
+		{
+			if (R->Count[i] <= length*STEP) R->Count[i] += length*STEP;
+		}
+		else
+			active |= 1 << i;
+	}
+
+	while (length > 0)
+	{
+		int vol[4];
+		unsigned int out;
+		int left;
+
+		vol[0] = vol[1] = vol[2] = vol[3] = 0;
+
+		for (i = 0; i < 3; i++)
+		{
+			if (R->Output[i]) vol[i] += R->Count[i];
+			R->Count[i] -= STEP;
+			left = 0;
+			while (R->Count[i] <= 0)
+			{
+				if (R->Count[i] + R->Period[i]*4 < R->Period[i])
+					left+= 4, R->Count[i] += R->Period[i]*4;
+				else	left++,   R->Count[i] += R->Period[i];
+				if (R->Count[i] > 0)
+				{
+					R->Output[i] ^= 1;
+					if (R->Output[i]) vol[i] += R->Period[i];
+					break;
+				}
+				R->Count[i] += R->Period[i];
+				vol[i] += R->Period[i];
+			}
+			if (R->Output[i]) vol[i] -= R->Count[i];
+			if (left > 1) vol[i] = STEP/2;
+		}
+
+		left = STEP;
+		do
+		{
+			int nextevent;
+
+			if (R->Count[3] < left) nextevent = R->Count[3];
+			else nextevent = left;
+
+			if (R->Output[3]) vol[3] += R->Count[3];
+			R->Count[3] -= nextevent;
+			if (R->Count[3] <= 0)
+			{
+				if (R->RNG & 1) R->RNG ^= R->NoiseFB;
+				R->RNG >>= 1;
+				R->Output[3] = R->RNG & 1;
+				R->Count[3] += R->Period[3];
+				if (R->Output[3]) vol[3] += R->Period[3];
+			}
+			if (R->Output[3]) vol[3] -= R->Count[3];
+
+			left -= nextevent;
+		} while (left > 0);
+
+		out = vol[0] * R->Volume[0] + vol[1] * R->Volume[1] +
+				vol[2] * R->Volume[2] + vol[3] * R->Volume[3];
+
+		if (out > MAX_OUTPUT * STEP) out = MAX_OUTPUT * STEP;
+
+		if ((out /= STEP))
+			*buffer += out;
+		if (stereo) buffer += 2;
+		else buffer++;
+
+		length--;
+	}
+
+	return active;
+}
+
+const struct psg_impl SYM(impl) = {
+	STR(VARIANT), SN76496_init, SN76496Write, update_ref, get_state
+};
+#else
+const struct psg_impl SYM(impl) = {
+	STR(VARIANT), SN76496_init, SN76496Write, SN76496Update, get_state
+};
+#endif
+
+#else
+
+extern const struct psg_impl ref_impl, skip_impl;
+
+static const struct psg_impl *impls[2] = { &ref_impl, &skip_impl };
+static double impl_time[2];
+
+#define OSC_NTSC	53693100
+#define MAX_LEN		1024
+
+static void write_all(int data)
+{
+	impls[0]->write(data);
+	impls[1]->write(data);
+}
+
+// a few writes per update. Voices are often muted, to have both voices which
+// are skipped and voices whose counter runs out while muted.
+static void random_writes(void)
+{
+	int n = rnd_n(6), i, r, v;
+
+	for (i = 0; i < n; i++) {
+		r = rnd_n(8);
+		v = rnd_n(16);
+		if ((r & 1) && rnd_n(2))
+			v = 0x0f;
+		write_all(0x80 | (r << 4) | v);
+		if (!(r & 1) && r != 6 && rnd_n(2))
+			write_all(rnd_n(0x40));	// tone data byte
+	}
+}
+
+static int run_test(int test, int updates)
+{
+	static const int rates[] = { 8000, 22050, 44100, 48000 };
+	static short buf0[2*MAX_LEN], buf[2][2*MAX_LEN];
+	static unsigned char st[2][256];
+	int rate = rates[rnd_n(4)], stereo = rnd_n(2);
+	int u, i, j, len, ret[2], size[2];
+	double t0;
+
+	for (i = 0; i < 2; i++)
+		impls[i]->init(OSC_NTSC / 15, rate);
+
+	for (u = 0; u < updates; u++) {
+		random_writes();
+		// from a single sample (line based updates) to a whole frame
+		len = 1 + (rnd_n(2) ? rnd_n(4) : rnd_n(rate / 50));
+		for (j = 0; j < 2*len; j++)
+			buf0[j] = rnd();
+		for (i = 0; i < 2; i++) {
+			memcpy(buf[i], buf0, sizeof(buf0));
+			t0 = now();
+			ret[i] = impls[i]->update(buf[i], len, stereo);
+			impl_time[i] += now() - t0;
+			impls[i]->get_state(st[i], &size[i]);
+		}
+		if (memcmp(buf[0], buf[1], sizeof(buf0)) || ret[0] != ret[1]) {
+			printf("test %d, update %d: output differs (rate %d, stereo %d, len %d)\n",
+				test, u, rate, stereo, len);
+			return 1;
+		}
+		if (memcmp(st[0], st[1], size[0])) {
+			printf("test %d, update %d: state differs\n", test, u);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int tests = argc > 1 ? atoi(argv[1]) : 1000;
+	int i, fails = 0;
+
+	printf("seed %08x\n", rnd_seed(argc, argv, 2));
+
+	for (i = 0; i < tests; i++) {
+		unsigned int seed = rnd_state;
+		if (run_test(i, 500)) {
+			printf("test %d failed, seed %08x\n", i, seed);
+			fails++;
+		}
+	}
+
+	printf("%d tests, %d failed; update time %s %.1f ms, %s %.1f ms\n",
+		tests, fails, impls[0]->name, impl_time[0] * 1000,
+		impls[1]->name, impl_time[1] * 1000);
+	return fails != 0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * sound stage benchmark and check: CD-DA resampling and final mix per frame
+ * at several output rates, Mega-CD PCM style paced resampling
+ *
+ * The final mix is checked against the C mixer, which is built into the ref
+ * variant of this file, see variant.h.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "variant.h"
+
+struct mix_impl {
+	const char *name;
+	int  *level;
+	void (*reset)(int alpha_q16);
+	void (*stereo)(short *dest, int *src, int count);
+	void (*stereo_lvl)(short *dest, int *src, int count);
+	void (*mono)(short *dest, int *src, int count);
+};
+
+#ifdef VARIANT
+
+#define mix_32_to_16l_level		SYM(mix_32_to_16l_level)
+#define mix_32_to_16l_stereo_lvl	SYM(mix_32_to_16l_stereo_lvl)
+#define mix_32_to_16l_stereo		SYM(mix_32_to_16l_stereo)
+#define mix_32_to_16_mono		SYM(mix_32_to_16_mono)
+#define mix_16h_to_32			SYM(mix_16h_to_32)
+#define mix_16h_to_32_s1		SYM(mix_16h_to_32_s1)
+#define mix_16h_to_32_s2		SYM(mix_16h_to_32_s2)
+#define mix_reset			SYM(mix_reset)
+#include "../pico/sound/mix.c"
+
+const struct mix_impl SYM(impl) = {
+	STR(VARIANT), &mix_32_to_16l_level, mix_reset, mix_32_to_16l_stereo,
+	mix_32_to_16l_stereo_lvl, mix_32_to_16_mono
+};
+
+#else
+
+#include <pico/sound/mix.h>
+#include <pico/sound/resampler.h>
+
+extern const struct mix_impl ref_impl;
+static const struct mix_impl *ref = &ref_impl;
+
+#define FPS	60
+#define IN_RATE	44100
+
+static struct resampler rs;
+static short in[2*1152];
+static int buf32[2*1152];
+static short out[2*1152];
+
+// feed one frame of a stereo tone at freq Hz, return output samples produced
+static int frame(int rate, double freq, int *t)
+{
+	int len = rate / FPS, n, i;
+
+	n = resampler_need(&rs, len);
+	for (i = 0; i < n; i++, (*t)++) {
+		in[2*i]   = 16000 * sin(2 * M_PI * freq * *t / IN_RATE);
+		in[2*i+1] = -in[2*i];
+	}
+	resampler_push(&rs, in, n);
+	memset(buf32, 0, len * 2 * sizeof(int));
+	resampler_mix_16h_to_32(&rs, buf32, len);
+	return len;
+}
+
+// RMS level of the left channel in dB relative to the input tone level
+static double tone_level(int rate, double freq)
+{
+	double e = 0;
+	int t = 0, f, i, len, cnt = 0;
+
+	resampler_init(&rs, IN_RATE, rate);
+	for (f = 0; f < 20; f++) {
+		len = frame(rate, freq, &t);
+		if (f < 2)
+			continue;
+		for (i = 0; i < len; i++, cnt++)
+			e += (double)buf32[2*i] * buf32[2*i];
+	}
+	return 20 * log10(sqrt(e / cnt) / (8000 / sqrt(2)));
+}
+
+// at equal rates the output must be the same as from mix_16h_to_32
+static int check_identity(void)
+{
+	static int ref[2*IN_RATE/FPS];
+	int len = IN_RATE / FPS, i, n;
+
+	resampler_init(&rs, IN_RATE, IN_RATE);
+	for (i = 0; i < 2*len; i++)
+		in[i] = rand();
+	n = resampler_need(&rs, len);
+	resampler_push(&rs, in, n);
+	memset(buf32, 0, sizeof(buf32));
+	resampler_mix_16h_to_32(&rs, buf32, len);
+	memset(ref, 0, sizeof(ref));
+	mix_16h_to_32(ref, in, 2*len);
+	for (i = 0; i < 2*len; i++)
+		if (buf32[i] != ref[i]) {
+			printf("identity mismatch at %d: %d vs %d\n", i,
+				buf32[i], ref[i]);
+			return 1;
+		}
+	return 0;
+}
+
+// paced source at the Mega-CD PCM rate with 17 bit samples, frames per update
+// vary like they do with the emulated cpu. Output must have the input level
+// and no seams at the update boundaries (bounded second difference).
+#define PCM_RATE	(12500000.0 / 384)
+
+static int check_paced(int rate, double freq, double *level)
+{
+	static int src[2*1152];
+	double e = 0, amp = 100000, d2, d2max = 0, lim;
+	int t = 0, f, i, n, len, cnt = 0, fails = 0, prev[2] = { 0, 0 };
+
+	resampler_init_paced(&rs, (int)PCM_RATE, rate);
+	// a sine's second difference is amp * (2 pi f / rate)^2, allow 10%
+	// plus rounding
+	lim = amp * pow(2 * M_PI * freq / rate, 2) * 1.1 + 4;
+	for (f = 0; f < 60; f++) {
+		n = (int)((f + 1) * PCM_RATE / FPS) - (int)(f * PCM_RATE / FPS);
+		len = rate / FPS + (f & 1); // uneven output lengths, too
+		for (i = 0; i < n; i++, t++) {
+			src[2*i]   = amp * sin(2 * M_PI * freq * t / PCM_RATE);
+			src[2*i+1] = -src[2*i];
+		}
+		resampler_push_32(&rs, src, n, 1);
+		memset(buf32, 0, len * 2 * sizeof(int));
+		resampler_mix_paced(&rs, buf32, len, n, 13, 1);
+		for (i = 0; i < len; i++) {
+			if (f < 2)
+				goto next;
+			e += (double)buf32[2*i] * buf32[2*i];
+			cnt++;
+			d2 = fabs(buf32[2*i] - 2.0 * prev[1] + prev[0]);
+			if (d2 > d2max)
+				d2max = d2;
+next:
+			prev[0] = prev[1];
+			prev[1] = buf32[2*i];
+		}
+	}
+	*level = 20 * log10(sqrt(e / cnt) / (amp / sqrt(2)));
+	if (d2max > lim) {
+		printf("\npaced %d Hz, %.0f Hz tone: step %.0f, expected %.0f max\n",
+			rate, freq, d2max, lim);
+		fails++;
+	}
+	if (fabs(*level) > 0.1) {
+		printf("\npaced %d Hz, %.0f Hz tone: level %+.2f dB\n",
+			rate, freq, *level);
+		fails++;
+	}
+	return fails;
+}
+
+// the mixer must give the same output as the C reference, for any counts
+static int check_mix(void)
+{
+	static short d1[2*1152], d2[2*1152];
+	static int s1[2*1152], s2[2*1152];
+	static const int alphas[] = { 0, 0x8000, 0xe000 };
+	int a, f, i, n, m, fails = 0;
+
+	for (a = 0; a < 3; a++) {
+		mix_reset(alphas[a]);
+		ref->reset(alphas[a]);
+		for (f = 0; f < 200; f++) {
+			n = 1 + rand() % 1152;
+			m = rand() % 3;
+			// sources add up to about 18 bits, see QB in mix.c
+			for (i = 0; i < 2*n; i++) {
+				d1[i] = d2[i] = rand();
+				s1[i] = s2[i] = (rand() % 0x40000) - 0x20000;
+			}
+			switch (m) {
+			case 0:
+				mix_32_to_16l_stereo(d1, s1, n);
+				ref->stereo(d2, s2, n);
+				break;
+			case 1:
+				mix_32_to_16l_level = *ref->level = rand() % 6;
+				mix_32_to_16l_stereo_lvl(d1, s1, n);
+				ref->stereo_lvl(d2, s2, n);
+				break;
+			case 2:
+				mix_32_to_16_mono(d1, s1, 2*n);
+				ref->mono(d2, s2, 2*n);
+				break;
+			}
+			if (memcmp(d1, d2, sizeof(d1)) || memcmp(s1, s2, sizeof(s1))) {
+				printf("mix mismatch: alpha %x, mode %d, count %d\n",
+					alphas[a], m, n);
+				fails++;
+				break;
+			}
+		}
+	}
+	return fails;
+}
+
+int main(int argc, char **argv)
+{
+	static const int rates[] = { 22050, 44100, 48000 };
+	int frames = argc > 1 ? atoi(argv[1]) : 20000;
+	int fails = check_identity() + check_mix();
+	int r, f;
+
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+		int rate = rates[r];
+		double t0, t1, t2, t3;
+
+		double pcm1k, pcm5k;
+
+		printf("%5d Hz: 1k %+.2f dB, 8k %+.2f dB, 20k %+.2f dB",
+			rate, tone_level(rate, 1000), tone_level(rate, 8000),
+			tone_level(rate, 20000));
+		fails += check_paced(rate, 1000, &pcm1k);
+		fails += check_paced(rate, 5000, &pcm5k);
+		printf(", pcm 1k %+.2f dB, 5k %+.2f dB", pcm1k, pcm5k);
+
+		resampler_init(&rs, IN_RATE, rate);
+		mix_reset(0);
+		t0 = now();
+		for (f = 0; f < frames; f++) {
+			int len = rate / FPS;
+			resampler_push(&rs, in, resampler_need(&rs, len));
+			resampler_mix_16h_to_32(&rs, buf32, len);
+		}
+		t1 = now();
+		for (f = 0; f < frames; f++) {
+			memset(out, 0, rate / FPS * 4);
+			mix_32_to_16l_stereo(out, buf32, rate / FPS);
+		}
+		t2 = now();
+		for (f = 0; f < frames; f++) {
+			memset(out, 0, rate / FPS * 4);
+			ref->stereo(out, buf32, rate / FPS);
+		}
+		t3 = now();
+		printf(", per frame: resample %.2f us, mix %.2f us (C %.2f us)\n",
+			(t1 - t0) * 1e6 / frames, (t2 - t1) * 1e6 / frames,
+			(t3 - t2) * 1e6 / frames);
+	}
+
+	if (fails)
+		printf("FAILED\n");
+	return fails != 0;
+}
+
+#endif
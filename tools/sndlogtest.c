@@ -0,0 +1,246 @@
+/*
+ * sound write log check: YM2612 and SN76496 output with POPT_EN_SND_LOG and
+ * POPT_EN_SND_THREAD against immediate rendering
+ *
+ * sound.c is built with the real chip cores. Each mode runs the same frames
+ * of random register writes, some with a YM2612 reset by the z80 reset line
+ * in between, and the output of every frame must be identical.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <pico/pico_int.h>
+#include <pico/sound/ym2612.h>
+
+#define LINES		262
+#define Z80_LINE	228	// z80 cycles per line
+#define RATE		44100
+#define FRAME_MAX	(2*(RATE/50+2))	// stereo samples per frame, max
+
+struct Pico Pico;
+PicoInterface PicoIn;
+
+// the rest of the emulator, not used with FM and PSG only
+void lprintf(const char *fmt, ...) {}
+void PicoPicoPCMUpdate(short *buffer, int length, int stereo) {}
+void PicoReratePico(void) {}
+void pcd_pcm_update(s32 *buffer, int length, int stereo) {}
+void pcd_pcm_rerate(void) {}
+void p32x_pwm_update(int *buf32, int length, int stereo) {}
+void p32x_pwm_rerate(void) {}
+void mp3_start_play(void *f, int pos) {}
+void mp3_update(int *buffer, int length, int stereo) {}
+int mp3_read(short *buffer, int frames) { return -1; }
+size_t pm_read_audio(void *ptr, size_t bytes, pm_file *stream) { return 0; }
+int pm_seek(pm_file *stream, long offset, int whence) { return 0; }
+void pm_sequential(pm_file *stream, long offset) {}
+void ym2612_pack_state(void) {}
+void ym2612_unpack_state(void) {}
+
+static short snd_out[FRAME_MAX];
+static short *frame_out;
+static int *run_resets;		// shared with the parent
+
+static void write_sound(int len)
+{
+	memcpy(frame_out, PicoIn.sndOut, len);
+}
+
+static unsigned int rnd_state = 1;
+
+static unsigned int rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static int rnd_n(int n)
+{
+	return rnd() % n;
+}
+
+// a YM2612 register and value which makes some sound, A1 in bit 8
+static void rnd_fm(int *reg, int *d)
+{
+	static const int chans[6] = { 0, 1, 2, 4, 5, 6 };
+	int a1 = rnd_n(2) << 8;
+
+	switch (rnd_n(8)) {
+	case 0: // key on/off
+		*reg = 0x28, *d = (rnd() & 0xf0) | chans[rnd_n(6)];
+		break;
+	case 1: // frequency, high byte latch first
+		*reg = a1 | (0xa0 + rnd_n(3) + (rnd_n(2) ? 4 : 0));
+		*d = rnd() & 0xff;
+		break;
+	case 2: // algorithm/feedback, pan/lfo sensitivity
+		*reg = a1 | (0xb0 + rnd_n(3) + (rnd_n(2) ? 4 : 0));
+		*d = rnd() & 0xff;
+		break;
+	case 3: // lfo
+		*reg = 0x22, *d = rnd() & 0x0f;
+		break;
+	default: // operators, TL kept low enough to be heard
+		*reg = a1 | (0x30 + rnd_n(0x70));
+		if ((*reg & 3) == 3)
+			*reg &= ~1;
+		*d = rnd() & 0xff;
+		if ((*reg & 0xf0) == 0x40)
+			*d &= 0x3f;
+		break;
+	}
+}
+
+// a SN76496 latch or data byte
+static int rnd_psg(void)
+{
+	if (rnd_n(3))
+		return 0x80 | (rnd() & 0x7f);
+	return rnd() & 0x3f;
+}
+
+// one frame of writes like the memory handlers do them, returns resets done
+static int frame(void)
+{
+	int writes = rnd_n(80), resets = 0;
+	int t = 0, i, reg, d;
+
+	PsndStartFrame();
+	for (i = 0; i < writes; i++) {
+		t += rnd_n(LINES * Z80_LINE / (writes + 1) + 1);
+		switch (rnd_n(16)) {
+		case 0: case 1: case 2: case 3:
+			PsndWritePSG(t / Z80_LINE, rnd_psg());
+			break;
+		case 4: // ch3 mode, written directly by the handler
+			ym2612.OPN.ST.mode = (ym2612.OPN.ST.mode & 0x3f)
+				| (rnd() & 0xc0);
+			ym2612.REGS[0x27] = ym2612.OPN.ST.mode;
+			PsndWriteFM(t, -1, ym2612.OPN.ST.mode);
+			break;
+		case 5:
+			if (rnd_n(8) == 0) {
+				PsndResetFM();
+				resets++;
+				break;
+			}
+			// fallthrough
+		default:
+			rnd_fm(&reg, &d);
+			ym2612.REGS[reg] = d;
+			PsndWriteFM(t, reg, d);
+			break;
+		}
+	}
+	PsndGetSamples(LINES);
+	return resets;
+}
+
+// run frames in a mode from a fixed start, output of each frame to out.
+// ym2612.c keeps some render state across YM2612Init (crct), so every run is
+// done in a fresh child process.
+static int run(int opt, int frames, unsigned int seed, short *out)
+{
+	int f, resets = 0, status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid > 0) {
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			return -1;
+		return *run_resets;
+	}
+
+	PicoIn.opt = POPT_EN_FM | POPT_EN_PSG | POPT_EN_STEREO | opt;
+	PicoIn.sndRate = RATE;
+	PicoIn.sndOut = snd_out;
+	PicoIn.writeSound = write_sound;
+	rnd_state = seed;
+	PsndRerate(0);
+	PsndClear();
+	for (f = 0; f < frames; f++) {
+		frame_out = out + f * FRAME_MAX;
+		resets += frame();
+	}
+	// stop the worker, if any
+	PicoIn.opt &= ~POPT_EN_SND_THREAD;
+	PsndStartFrame();
+	PsndGetSamples(LINES);
+	*run_resets = resets;
+	_exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct { const char *name; int opt; } modes[] = {
+		{ "log",    POPT_EN_SND_LOG },
+#ifdef USE_THREADS
+		{ "thread", POPT_EN_SND_THREAD },
+#endif
+	};
+	int frames = argc > 1 ? atoi(argv[1]) : 600;
+	unsigned int seed;
+	short *ref, *out;
+	int m, f, resets, fails = 0;
+
+	seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+	if (seed == 0)
+		seed = 1;
+	printf("seed %08x\n", seed);
+
+	// shared with the child processes doing the runs
+	ref = mmap(NULL, frames * sizeof(snd_out), PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	out = mmap(NULL, frames * sizeof(snd_out), PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	run_resets = mmap(NULL, sizeof(*run_resets), PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	if (ref == MAP_FAILED || out == MAP_FAILED || run_resets == MAP_FAILED)
+		return 1;
+
+	resets = run(0, frames, seed, ref);
+	if (resets < 0)
+		return 1;
+	for (f = 0; f < frames * FRAME_MAX && ref[f] == 0; f++)
+		;
+	if (f == frames * FRAME_MAX) {
+		printf("no output\n");
+		fails++;
+	}
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		memset(out, 0, frames * sizeof(snd_out));
+		if (run(modes[m].opt, frames, seed, out) != resets) {
+			printf("%s: run failed\n", modes[m].name);
+			fails++;
+			continue;
+		}
+		for (f = 0; f < frames; f++) {
+			short *a = ref + f * FRAME_MAX, *b = out + f * FRAME_MAX;
+			if (memcmp(a, b, sizeof(snd_out))) {
+				printf("%s: frame %d differs\n", modes[m].name, f);
+				fails++;
+				break;
+			}
+		}
+		printf("%s: %d frames, %d fm resets%s\n", modes[m].name, frames,
+			resets, f == frames ? ", ok" : "");
+	}
+
+	munmap(ref, frames * sizeof(snd_out));
+	munmap(out, frames * sizeof(snd_out));
+	if (fails)
+		printf("FAILED\n");
+	return fails != 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * SSP1601 recompiler check: compiler_emith.c against the ssp16.c interpreter
+ *
+ * Random programs are run block by block by the recompiler, then the
+ * interpreter runs the same number of cycles from the same state, and both
+ * states must match after every block. Writes to ST with Z and N both set
+ * are frequent, to exercise the interpreter fallback of the recompiler.
+ * PMx, XST and PMC are left out, both use the same handlers for them.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <pico/carthw/svp/compiler_emith.c>
+
+#define PROG_START	0x400	// ROM, words
+#define PROG_LEN	0x100
+
+struct Pico Pico;
+PicoInterface PicoIn;
+svp_t *svp;
+void (*PicoLoadStateHook)(void);
+
+static svp_t svp_drc, svp_int;
+static int anomalies;
+
+void cache_flush_d_inval_i(void *start_addr, void *end_addr)
+{
+#if defined(__GNUC__) && !(defined(__i386__) || defined(__x86_64__))
+	__builtin___clear_cache(start_addr, end_addr);
+#endif
+}
+
+void *plat_mem_get_for_drc(size_t size) { return NULL; }
+
+int plat_mem_set_exec(void *ptr, size_t size)
+{
+	uptr start = (uptr)ptr & ~4095, end = ((uptr)ptr + size + 4095) & ~4095;
+	return mprotect((void *)start, end - start, PROT_READ|PROT_WRITE|PROT_EXEC);
+}
+
+// anomalies are expected for some random ops, count them only
+void lprintf(const char *fmt, ...)
+{
+	anomalies++;
+}
+
+// programs are in ROM only
+int ssp_get_iram_context(void) { return 0; }
+
+static unsigned int rnd_state = 1;
+
+static unsigned int rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static int rnd_n(int n)
+{
+	return rnd() % n;
+}
+
+// -----------------------------------------------------------------
+// program generator
+
+static const int regs_r[] = { SSP_GR0, SSP_X, SSP_Y, SSP_A, SSP_ST, SSP_STACK, SSP_P, SSP_AL };
+static const int regs_w[] = { SSP_GR0, SSP_X, SSP_Y, SSP_A, SSP_ST, SSP_STACK, SSP_AL };
+
+static int rnd_rs(void)
+{
+	return regs_r[rnd_n(ARRAY_SIZE(regs_r))];
+}
+
+static int rnd_rd(void)
+{
+	return regs_w[rnd_n(ARRAY_SIZE(regs_w))];
+}
+
+// ri and mod fields of the pointer register ops
+static int rnd_ri(int mod)
+{
+	int ri = rnd_n(8);
+	return (ri & 3) | ((ri & 4) << 6) | (mod << 2);
+}
+
+// call/bra/mod condition: always, Z or N, and the flag value in bit 8
+static int rnd_cond(void)
+{
+	static const int conds[] = { 0x00, 0x50, 0x70 };
+	return conds[rnd_n(3)] | (rnd() & 0x100);
+}
+
+// ST value, Z and N both set often
+static int rnd_st(void)
+{
+	int st = rnd() & 0xffff;
+	if (rnd_n(3) == 0)
+		st |= SSP_FLAG_Z|SSP_FLAG_N;
+	return st;
+}
+
+// ops are 2 words apart, padded with a nop, so jumps never land on an
+// immediate and run data as code
+static u16 rnd_target(void)
+{
+	return PROG_START + rnd_n(PROG_LEN / 2) * 2;
+}
+
+// one op at p, returns its length in words
+static int gen_op(u16 *p)
+{
+	int aop = "\1\3\4\5\6\7"[rnd_n(6)] << 13;
+	int rd;
+
+	switch (rnd_n(22)) {
+	case 0: // ld d, s
+		p[0] = (rnd_rd() << 4) | rnd_rs();
+		return 1;
+	case 1: // ld d, (ri)
+		p[0] = (0x01 << 9) | (rnd_rd() << 4) | rnd_ri(rnd_n(4));
+		return 1;
+	case 2: // ld (ri), s
+		p[0] = (0x02 << 9) | (rnd_rs() << 4) | rnd_ri(rnd_n(4));
+		return 1;
+	case 3: // ld a, adr / ld adr, a
+		p[0] = ((rnd_n(2) ? 0x03 : 0x07) << 9) | rnd_n(0x200);
+		return 1;
+	case 4: // ldi d, imm
+		rd = rnd_rd();
+		p[0] = (0x04 << 9) | (rd << 4);
+		p[1] = rd == SSP_ST ? rnd_st() : rnd();
+		return 2;
+	case 5: // ld d, ((ri)), mod only for the fixed pointers
+		rd = rnd_ri(0);
+		if ((rd & 3) == 3)
+			rd |= rnd_n(4) << 2;
+		p[0] = (0x05 << 9) | (rnd_rd() << 4) | rd;
+		return 1;
+	case 6: // ldi (ri), imm
+		p[0] = (0x06 << 9) | rnd_ri(rnd_n(4));
+		p[1] = rnd();
+		return 2;
+	case 7: // ld d, ri / ld ri, s
+		if (rnd_n(2))
+			p[0] = (0x09 << 9) | (rnd_rd() << 4) | rnd_ri(0);
+		else	p[0] = (0x0a << 9) | (rnd_rs() << 4) | rnd_ri(0);
+		return 1;
+	case 8: // ldi ri, simm
+		p[0] = (0x0c << 9) | (rnd_n(8) << 8) | (rnd() & 0xff);
+		return 1;
+	case 9: // call cond, addr
+		p[0] = (0x24 << 9) | rnd_cond();
+		p[1] = rnd_target();
+		return 2;
+	case 10: // ld d, (a)
+		p[0] = (0x25 << 9) | (rnd_rd() << 4);
+		return 1;
+	case 11: // bra cond, addr
+		p[0] = (0x26 << 9) | rnd_cond();
+		p[1] = rnd_target();
+		return 2;
+	case 12: // mod cond, op
+		p[0] = (0x48 << 9) | rnd_cond() | "\2\3\6\7"[rnd_n(4)];
+		return 1;
+	case 13: // mpys, mpya, mld
+		p[0] = ("\x1b\x4b\x5b"[rnd_n(3)] << 9) | 0x100 | (rnd() & 0xff);
+		return 1;
+	case 14: // ld ST, imm on its own as well
+		p[0] = (0x04 << 9) | (SSP_ST << 4);
+		p[1] = rnd_st();
+		return 2;
+	case 15: // OP a, s
+		p[0] = aop | rnd_rs();
+		return 1;
+	case 16: // OP a, (ri)
+		p[0] = aop | (0x01 << 9) | rnd_ri(rnd_n(4));
+		return 1;
+	case 17: // OP a, adr
+		p[0] = aop | (0x03 << 9) | rnd_n(0x200);
+		return 1;
+	case 18: // OP a, imm
+		p[0] = aop | (0x04 << 9);
+		p[1] = rnd();
+		return 2;
+	case 19: // OP a, ((ri))
+		rd = rnd_ri(0);
+		if ((rd & 3) == 3)
+			rd |= rnd_n(4) << 2;
+		p[0] = aop | (0x05 << 9) | rd;
+		return 1;
+	case 20: // OP a, ri
+		p[0] = aop | (0x09 << 9) | rnd_ri(0);
+		return 1;
+	default: // OP simm
+		p[0] = aop | (0x0c << 9) | (rnd() & 0xff);
+		return 1;
+	}
+}
+
+// random data everywhere, the program at PROG_START looping back to it
+static void gen_program(void)
+{
+	u16 *rom = (u16 *)svp_drc.iram_rom;
+	int i, pc;
+
+	for (i = 0; i < sizeof(svp_drc.iram_rom) / 2; i++)
+		rom[i] = rnd();
+	for (pc = PROG_START; pc < PROG_START + PROG_LEN - 2; pc += 2) {
+		if (gen_op(&rom[pc]) == 1)
+			rom[pc + 1] = 0; // nop
+	}
+	rom[pc++] = 0x26 << 9; // bra always
+	rom[pc++] = PROG_START;
+
+	memcpy(svp_int.iram_rom, svp_drc.iram_rom, sizeof(svp_int.iram_rom));
+}
+
+static void gen_state(ssp1601_t *s)
+{
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	for (i = 0; i < ARRAY_SIZE(s->RAM); i++)
+		s->RAM[i] = rnd();
+	for (i = 0; i < 8; i++)
+		s->r[i] = rnd();
+	for (i = 0; i < 6; i++)
+		s->stack[i] = rnd();
+	s->gr[SSP_GR0].v = 0xffff0000;
+	s->gr[SSP_X].h = rnd();
+	s->gr[SSP_Y].h = rnd();
+	s->gr[SSP_A].v = rnd();
+	s->gr[SSP_ST].h = rnd_st();
+	s->gr[SSP_STACK].h = rnd_n(6);
+	s->gr[SSP_PC].h = PROG_START;
+	s->gr[SSP_P].v = (signed short)s->gr[SSP_X].h * (signed short)s->gr[SSP_Y].h * 2;
+}
+
+// -----------------------------------------------------------------
+
+static void use(svp_t *s)
+{
+	svp = s;
+	ssp = &s->ssp1601;
+}
+
+static int compare(const ssp1601_t *d, const ssp1601_t *i)
+{
+	static const int regs[] = { SSP_X, SSP_Y, SSP_A, SSP_STACK, SSP_PC, SSP_P };
+	int r, bad = 0;
+
+	for (r = 0; r < ARRAY_SIZE(regs); r++) {
+		if (d->gr[regs[r]].v != i->gr[regs[r]].v) {
+			printf("  gr%d %08x, interpreter %08x\n", regs[r],
+				d->gr[regs[r]].v, i->gr[regs[r]].v);
+			bad++;
+		}
+	}
+	if (d->gr[SSP_ST].h != i->gr[SSP_ST].h) {
+		printf("  ST %04x, interpreter %04x\n",
+			d->gr[SSP_ST].h, i->gr[SSP_ST].h);
+		bad++;
+	}
+	if (memcmp(d->r, i->r, sizeof(d->r))) {
+		printf("  pointer regs differ\n");
+		bad++;
+	}
+	if (memcmp(d->stack, i->stack, sizeof(d->stack))) {
+		printf("  stack differs\n");
+		bad++;
+	}
+	for (r = 0; r < ARRAY_SIZE(d->RAM); r++) {
+		if (d->RAM[r] != i->RAM[r]) {
+			printf("  RAM[%03x] %04x, interpreter %04x\n", r,
+				d->RAM[r], i->RAM[r]);
+			bad++;
+			break;
+		}
+	}
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	int programs = argc > 1 ? atoi(argv[1]) : 2000;
+	int blocks = 200, p, b, cycles, left, zn_entries = 0, fails = 0;
+	unsigned int seed;
+
+	seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+	if (seed == 0)
+		seed = 1;
+	rnd_state = seed;
+	printf("seed %08x\n", seed);
+
+	if (ssp1601_dyn_startup() != 0) {
+		printf("drc startup failed\n");
+		return 1;
+	}
+
+	for (p = 0; p < programs && fails < 10; p++) {
+		gen_program();
+		gen_state(&svp_drc.ssp1601);
+		svp_int.ssp1601 = svp_drc.ssp1601;
+		tcache_flush();
+
+		for (b = 0; b < blocks; b++) {
+			u16 pc = svp_drc.ssp1601.gr[SSP_PC].h;
+
+			use(&svp_drc);
+			if ((rST & (SSP_FLAG_Z|SSP_FLAG_N)) == (SSP_FLAG_Z|SSP_FLAG_N))
+				zn_entries++;
+			ssp1601_dyn_run(1);
+			cycles = 1 - ssp->drc.cycles;
+
+			use(&svp_int);
+			left = ssp1601_run(cycles);
+
+			if (left != 0 || compare(&svp_drc.ssp1601, &svp_int.ssp1601)) {
+				printf("program %d block %d @ %04x, %d cycles, "
+					"interpreter left %d\n", p, b, pc, cycles, left);
+				fails++;
+				break;
+			}
+		}
+	}
+
+	ssp1601_dyn_exit();
+
+	printf("%d programs, %d runs with Z and N set, %d anomalies\n",
+		p, zn_entries, anomalies);
+	if (fails)
+		printf("FAILED\n");
+	return fails != 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * common parts of the checks comparing builds of an emulator source file
+ *
+ * Such a check is built once per variant with VARIANT set to the variant
+ * name, which includes the source with its global symbols renamed by SYM to
+ * <variant>_<symbol>, and once without VARIANT as the driver linking all of
+ * them. Each variant exports the check's implementation struct as
+ * <variant>_impl, named STR(VARIANT).
+ *
+ * The driver gets the random generator, seeded with 1 by default so that
+ * runs repeat, and a timer.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#ifndef TOOLS_VARIANT_H
+#define TOOLS_VARIANT_H
+
+#include <stdlib.h>
+#include <time.h>
+
+#define SYM__(v, n)		v##_##n
+#define SYM_(v, n)		SYM__(v, n)
+#define SYM(n)			SYM_(VARIANT, n)
+#define STR_(v)			#v
+#define STR(v)			STR_(v)
+
+#ifndef VARIANT
+
+static unsigned int rnd_state = 1;
+
+static inline unsigned int rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+#define rnd_n(n)	(rnd() % (n))
+
+// seed from argv[i] if given, else 1. 0 would stop the generator.
+static inline unsigned int rnd_seed(int argc, char **argv, int i)
+{
+	rnd_state = argc > i ? strtoul(argv[i], NULL, 0) : 1;
+	if (rnd_state == 0)
+		rnd_state = 1;
+	return rnd_state;
+}
+
+static inline double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif /* !VARIANT */
+#endif
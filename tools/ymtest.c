@@ -0,0 +1,245 @@
+/*
+ * FM core check: the vector channel renderers (YM2612_SIMD) against the C one
+ *
+ * This file is built once per variant of the FM core with VARIANT set, which
+ * includes ym2612.c with its global symbols prefixed, and once as the driver,
+ * see variant.h.
+ * The driver runs all variants in lockstep on the same random register writes
+ * and compares output and chip state after each update. With VEC_FORCE the
+ * variant renders with that vector renderer whatever the playing channels,
+ * the auto variant uses the renderer and channel count chosen at init.
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "variant.h"
+
+#ifdef VARIANT
+#define ym2612			SYM(ym2612)
+#define ym_tl_tab		SYM(ym_tl_tab)
+#define ym_tl_tab2		SYM(ym_tl_tab2)
+#define YM2612Init_		SYM(YM2612Init_)
+#define YM2612ResetChip_	SYM(YM2612ResetChip_)
+#define YM2612UpdateOne_	SYM(YM2612UpdateOne_)
+#define YM2612UpdateOneSt_	SYM(YM2612UpdateOneSt_)
+#define YM2612Write_		SYM(YM2612Write_)
+#define YM2612WriteReg_		SYM(YM2612WriteReg_)
+#define YM2612PicoStateLoad_	SYM(YM2612PicoStateLoad_)
+#define YM2612PicoStateSave2	SYM(YM2612PicoStateSave2)
+#define YM2612PicoStateLoad2	SYM(YM2612PicoStateLoad2)
+#define YM2612GetRegs		SYM(YM2612GetRegs)
+#endif
+#include <pico/sound/ym2612.h>
+
+struct ym_impl {
+	const char *name;
+	void (*init)(int clock, int rate, int ssg);
+	int  (*write_reg)(unsigned int addr, unsigned int v);
+	int  (*update)(int *buffer, int length, int stereo, int is_buf_empty);
+	void (*state_save)(int tat, int tbt);
+	int  (*state_load)(int *tat, int *tbt);
+	void (*get_state)(YM2612 *st, int *lfo_ampm);
+};
+
+#ifdef VARIANT
+
+#include "../pico/sound/ym2612.c"
+
+// chip state with the detune pointers made independent of the variant
+static void get_state(YM2612 *st, int *lfo_ampm)
+{
+	int c, s;
+
+	*st = ym2612;
+	for (c = 0; c < 6; c++)
+		for (s = 0; s < 4; s++)
+			st->CH[c].SLOT[s].DT = (INT32 *)(ym2612.CH[c].SLOT[s].DT -
+						ym2612.OPN.ST.dt_tab[0]);
+	*lfo_ampm = g_lfo_ampm;
+}
+
+static void init(int clock, int rate, int ssg)
+{
+	YM2612Init_(clock, rate, ssg);
+#ifdef VEC_FORCE
+	chan_render_vec = VEC_FORCE;
+	chan_render_vec_min = 0;
+#endif
+}
+
+const struct ym_impl SYM(impl) = {
+	STR(VARIANT), init, YM2612WriteReg_, YM2612UpdateOne_,
+	YM2612PicoStateSave2, YM2612PicoStateLoad2, get_state
+};
+
+#else
+
+extern const struct ym_impl c_impl, v4_impl, auto_impl;
+#if defined(__i386__) || defined(__x86_64__)
+extern const struct ym_impl v8_impl;
+#endif
+
+static const struct ym_impl *impls[4];
+static int impl_count;
+static double impl_time[4];
+
+#define OSC_NTSC	53693100
+#define MAX_LEN		1024
+
+void memset32(void *dest, int c, int count)
+{
+	int *d = dest;
+	while (count--)
+		*d++ = c;
+}
+
+static void write_all(unsigned int addr, unsigned int v)
+{
+	int i;
+	for (i = 0; i < impl_count; i++)
+		impls[i]->write_reg(addr, v);
+}
+
+// a burst of register writes, mostly to the operator and channel registers.
+// Timers stay off, CSM and 3 slot mode are set at random.
+static void random_writes(void)
+{
+	int n = rnd_n(24), i;
+	unsigned int a, v;
+
+	for (i = 0; i < n; i++) {
+		v = rnd() & 0xff;
+		switch (rnd_n(16)) {
+		case 0:  write_all(0x22, v); break;
+		case 1:  write_all(0x27, v & 0xc0); break;
+		case 2:
+		case 3:
+		case 4:  write_all(0x28, v); break;
+		case 5:  write_all(0x2a, v); break;
+		case 6:  write_all(0x2b, v); break;
+		default:
+			a = 0x30 + rnd_n(0xb7 - 0x30);
+			if ((a & 3) == 3)
+				a &= ~1;
+			// channels using SSG-EG aren't rendered in vector lanes
+			if ((a & 0xf0) == 0x90 && rnd_n(8))
+				v &= ~0x08;
+			write_all(a | (rnd_n(2) << 8), v);
+			break;
+		}
+	}
+}
+
+static int check_state(int test, int frame)
+{
+	static YM2612 st0, st;
+	int ampm0, ampm, i;
+
+	impls[0]->get_state(&st0, &ampm0);
+	for (i = 1; i < impl_count; i++) {
+		impls[i]->get_state(&st, &ampm);
+		if (memcmp(&st0, &st, sizeof(st)) || ampm0 != ampm) {
+			printf("test %d, frame %d: %s state differs from %s\n",
+				test, frame, impls[i]->name, impls[0]->name);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int run_test(int test, int frames)
+{
+	static const int rates[] = { 11025, 22050, 32000, 44100, 48000, 53267 };
+	static int buf0[2*MAX_LEN], buf[4][2*MAX_LEN];
+	int rate = rates[rnd_n(6)], ssg = rnd_n(2), stereo = rnd_n(2);
+	int f, i, j, len, empty, tat, tbt, ret[4];
+	double t0;
+
+	for (i = 0; i < impl_count; i++)
+		impls[i]->init(OSC_NTSC / 7, rate, ssg);
+
+	for (f = 0; f < frames; f++) {
+		random_writes();
+		if (rnd_n(32) == 0) {
+			// save and reload, which refreshes all channels
+			for (i = 0; i < impl_count; i++) {
+				impls[i]->state_save(0, 0);
+				impls[i]->state_load(&tat, &tbt);
+			}
+		}
+
+		len = 1 + rnd_n(rate / 60 < MAX_LEN ? rate / 60 : MAX_LEN);
+		empty = rnd_n(4) == 0;
+		for (j = 0; j < 2*len; j++)
+			buf0[j] = (int)rnd() >> 14;
+		// all variants must see the same updates, even after a mismatch
+		for (i = 0; i < impl_count; i++) {
+			memcpy(buf[i], buf0, sizeof(buf0));
+			t0 = now();
+			ret[i] = impls[i]->update(buf[i], len, stereo, empty);
+			impl_time[i] += now() - t0;
+		}
+		for (i = 1; i < impl_count; i++) {
+			if (memcmp(buf[i], buf[0], sizeof(buf0)) || !ret[i] != !ret[0]) {
+				printf("test %d, frame %d: %s output differs from %s "
+					"(rate %d, ssg %d, stereo %d, len %d)\n",
+					test, f, impls[i]->name, impls[0]->name,
+					rate, ssg, stereo, len);
+				for (j = 0; j < (2*len); j++)
+					if (buf[i][j] != buf[0][j]) {
+						printf("  sample %d: %d vs %d\n",
+							j, buf[i][j], buf[0][j]);
+						break;
+					}
+				return 1;
+			}
+		}
+		if (check_state(test, f))
+			return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int tests = argc > 1 ? atoi(argv[1]) : 200;
+	int i, fails = 0;
+
+	printf("seed %08x\n", rnd_seed(argc, argv, 2));
+
+	impls[impl_count++] = &c_impl;
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1"))
+		impls[impl_count++] = &v4_impl;
+	else
+		printf("no sse4.1 on this cpu, v4 skipped\n");
+	if (__builtin_cpu_supports("avx2"))
+		impls[impl_count++] = &v8_impl;
+	else
+		printf("no avx2 on this cpu, v8 skipped\n");
+#else
+	impls[impl_count++] = &v4_impl;
+#endif
+	impls[impl_count++] = &auto_impl;
+
+	for (i = 0; i < tests; i++) {
+		unsigned int seed = rnd_state;
+		if (run_test(i, 300)) {
+			printf("test %d failed, seed %08x\n", i, seed);
+			fails++;
+		}
+	}
+
+	printf("%d tests, %d failed; render time", tests, fails);
+	for (i = 0; i < impl_count; i++)
+		printf(" %s %.1f ms", impls[i]->name, impl_time[i] * 1000);
+	printf("\n");
+	return fails != 0;
+}
+
+#endif